@@ -18,8 +18,19 @@
 #include "qgsfeatureiterator.h"
 #include "qgsgeometry.h"
 
+#include <QtConcurrentMap>
+
 #define NO_DATA -9999
 
+// Size in pixels of the in-memory tiles the surface is accumulated into
+static const int TILE_SIZE = 256;
+
+// Number of points accumulated at once into the tiles
+static const int POINT_BATCH_SIZE = 100000;
+
+// Default maximum number of in-memory tiles (256 MB)
+static const int DEFAULT_MAX_TILES = 1024;
+
 QgsKernelDensityEstimation::QgsKernelDensityEstimation( const QgsKernelDensityEstimation::Parameters &parameters, const QString &outputFile, const QString &outputFormat )
   : mSource( parameters.source )
   , mOutputFile( outputFile )
@@ -32,6 +43,7 @@ QgsKernelDensityEstimation::QgsKernelDensityEstimation( const QgsKernelDensityEs
   , mDecay( parameters.decayRatio )
   , mOutputValues( parameters.outputValues )
   , mBufferSize( -1 )
+  , mMaximumTileCount( DEFAULT_MAX_TILES )
   , mDatasetH( nullptr )
   , mRasterBandH( nullptr )
 {
@@ -41,6 +53,11 @@ QgsKernelDensityEstimation::QgsKernelDensityEstimation( const QgsKernelDensityEs
     mWeightField = mSource->fields().lookupField( parameters.weightField );
 }
 
+void QgsKernelDensityEstimation::setMaximumTileCount( int count )
+{
+  mMaximumTileCount = std::max( 1, count );
+}
+
 QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::run()
 {
   Result result = prepare();
@@ -83,10 +100,11 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::prepare()
   if ( mBounds.isNull() )
     return InvalidParameters;
 
-  int rows = std::max( std::ceil( mBounds.height() / mPixelSize ) + 1, 1.0 );
-  int cols = std::max( std::ceil( mBounds.width() / mPixelSize ) + 1, 1.0 );
+  mRows = std::max( std::ceil( mBounds.height() / mPixelSize ) + 1, 1.0 );
+  mColumns = std::max( std::ceil( mBounds.width() / mPixelSize ) + 1, 1.0 );
+  mTileColumns = ( mColumns + TILE_SIZE - 1 ) / TILE_SIZE;
 
-  if ( !createEmptyLayer( driver, mBounds, rows, cols ) )
+  if ( !createEmptyLayer( driver, mBounds, mRows, mColumns ) )
     return FileCreationError;
 
   // open the raster in GA_Update mode
@@ -101,6 +119,10 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::prepare()
   if ( mRadiusField < 0 )
     mBufferSize = radiusSizeInPixels( mRadius );
 
+  mPendingPoints.clear();
+  mTiles.clear();
+  mFlushedTiles.clear();
+
   return Success;
 }
 
@@ -145,8 +167,6 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::addFeature( const
     weight = feature.attribute( mWeightField ).toDouble();
   }
 
-  Result result = Success;
-
   //loop through all points in multipoint
   for ( QgsMultiPoint::const_iterator pointIt = multiPoints.constBegin(); pointIt != multiPoints.constEnd(); ++pointIt )
   {
@@ -157,60 +177,192 @@ QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::addFeature( const
     }
 
     // calculate the pixel position
-    unsigned int xPosition = ( ( ( *pointIt ).x() - mBounds.xMinimum() ) / mPixelSize ) - buffer;
-    unsigned int yPosition = ( ( ( *pointIt ).y() - mBounds.yMinimum() ) / mPixelSize ) - buffer;
-    unsigned int yPositionIO = ( ( mBounds.yMaximum() - ( *pointIt ).y() ) / mPixelSize ) - buffer;
+    KdePoint point;
+    point.x = ( *pointIt ).x();
+    point.y = ( *pointIt ).y();
+    point.radius = radius;
+    point.weight = weight;
+    point.xPosition = ( ( point.x - mBounds.xMinimum() ) / mPixelSize ) - buffer;
+    point.yPosition = ( ( point.y - mBounds.yMinimum() ) / mPixelSize ) - buffer;
+    point.yPositionIO = ( ( mBounds.yMaximum() - point.y ) / mPixelSize ) - buffer;
+    point.blockSize = blockSize;
+    mPendingPoints << point;
+  }
+
+  // points are accumulated by batches, so that tiles can be processed in parallel
+  if ( mPendingPoints.count() >= POINT_BATCH_SIZE )
+    return accumulatePendingPoints();
+
+  return Success;
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::accumulatePendingPoints()
+{
+  Result result = Success;
+
+  QVector< TileJob > jobs;
+  QHash< int, int > jobIndexes;
+
+  auto runJobs = [this, &jobs, &jobIndexes]
+  {
+    // tiles are not allocated nor removed while the jobs are running
+    for ( TileJob &job : jobs )
+      job.data = mTiles[ job.tileIndex ].data();
+
+    QtConcurrent::blockingMap( jobs, [this]( const TileJob & job ) { accumulateTile( job ); } );
+    jobs.clear();
+    jobIndexes.clear();
+  };
+
+  for ( int i = 0; i < mPendingPoints.count(); ++i )
+  {
+    const KdePoint &point = mPendingPoints.at( i );
 
+    // pixels of the kernel window within the raster
+    const QRect window = QRect( point.xPosition, point.yPositionIO, point.blockSize, point.blockSize ).intersected( QRect( 0, 0, mColumns, mRows ) );
+    if ( window.isEmpty() )
+      continue;
+
+    const int firstTileColumn = window.left() / TILE_SIZE;
+    const int lastTileColumn = window.right() / TILE_SIZE;
+    const int firstTileRow = window.top() / TILE_SIZE;
+    const int lastTileRow = window.bottom() / TILE_SIZE;
 
-    // get the data
-    float *dataBuffer = ( float * ) CPLMalloc( sizeof( float ) * blockSize * blockSize );
-    if ( GDALRasterIO( mRasterBandH, GF_Read, xPosition, yPositionIO, blockSize, blockSize,
-                       dataBuffer, blockSize, blockSize, GDT_Float32, 0, 0 ) != CE_None )
+    // add the tiles to the raster when the point would exceed the memory budget
+    int newTiles = 0;
+    for ( int tileRow = firstTileRow; tileRow <= lastTileRow; ++tileRow )
     {
-      result = RasterIoError;
+      for ( int tileColumn = firstTileColumn; tileColumn <= lastTileColumn; ++tileColumn )
+      {
+        if ( !mTiles.contains( tileRow * mTileColumns + tileColumn ) )
+          newTiles++;
+      }
+    }
+    if ( newTiles > 0 && !mTiles.isEmpty() && mTiles.count() + newTiles > mMaximumTileCount )
+    {
+      runJobs();
+      if ( flushTiles() != Success )
+        result = RasterIoError;
+    }
+
+    for ( int tileRow = firstTileRow; tileRow <= lastTileRow; ++tileRow )
+    {
+      for ( int tileColumn = firstTileColumn; tileColumn <= lastTileColumn; ++tileColumn )
+      {
+        const int tileIndex = tileRow * mTileColumns + tileColumn;
+        if ( !mTiles.contains( tileIndex ) && !createTile( tileIndex ) )
+          result = RasterIoError;
+
+        int jobIndex = jobIndexes.value( tileIndex, -1 );
+        if ( jobIndex < 0 )
+        {
+          jobIndex = jobs.count();
+          jobIndexes.insert( tileIndex, jobIndex );
+          jobs.append( TileJob{ tileIndex, nullptr, QVector< int >() } );
+        }
+        jobs[ jobIndex ].points << i;
+      }
     }
+  }
 
-    for ( int xp = 0; xp < blockSize; xp++ )
+  runJobs();
+  mPendingPoints.clear();
+  return result;
+}
+
+void QgsKernelDensityEstimation::accumulateTile( const TileJob &job ) const
+{
+  const QRect tile = tileRect( job.tileIndex );
+
+  // points are accumulated in the order they were added, which gives the same result
+  // as accumulating them directly into the raster
+  for ( int pointIndex : job.points )
+  {
+    const KdePoint &point = mPendingPoints.at( pointIndex );
+    const QRect window = QRect( point.xPosition, point.yPositionIO, point.blockSize, point.blockSize ).intersected( tile );
+
+    for ( int row = window.top(); row <= window.bottom(); ++row )
     {
-      for ( int yp = 0; yp < blockSize; yp++ )
+      const int yp = row - point.yPositionIO;
+      const double pixelCentroidY = ( point.yPosition + yp + 0.5 ) * mPixelSize + mBounds.yMinimum();
+      const double dy2 = std::pow( pixelCentroidY - point.y, 2.0 );
+      float *line = job.data + ( row - tile.top() ) * TILE_SIZE;
+
+      for ( int column = window.left(); column <= window.right(); ++column )
       {
-        double pixelCentroidX = ( xPosition + xp + 0.5 ) * mPixelSize + mBounds.xMinimum();
-        double pixelCentroidY = ( yPosition + yp + 0.5 ) * mPixelSize + mBounds.yMinimum();
+        const int xp = column - point.xPosition;
+        const double pixelCentroidX = ( point.xPosition + xp + 0.5 ) * mPixelSize + mBounds.xMinimum();
 
-        double distance = std::sqrt( std::pow( pixelCentroidX - ( *pointIt ).x(), 2.0 ) + std::pow( pixelCentroidY - ( *pointIt ).y(), 2.0 ) );
+        double distance = std::sqrt( std::pow( pixelCentroidX - point.x, 2.0 ) + dy2 );
 
         // is pixel outside search bandwidth of feature?
-        if ( distance > radius )
+        if ( distance > point.radius )
         {
           continue;
         }
 
-        double pixelValue = weight * calculateKernelValue( distance, radius, mShape, mOutputValues );
-        int pos = xp + blockSize * yp;
-        if ( dataBuffer[ pos ] == NO_DATA )
+        double pixelValue = point.weight * calculateKernelValue( distance, point.radius, mShape, mOutputValues );
+        const int pos = column - tile.left();
+        if ( line[ pos ] == NO_DATA )
         {
-          dataBuffer[ pos ] = 0;
+          line[ pos ] = 0;
         }
-        dataBuffer[ pos ] += pixelValue;
+        line[ pos ] += pixelValue;
       }
     }
-    if ( GDALRasterIO( mRasterBandH, GF_Write, xPosition, yPositionIO, blockSize, blockSize,
-                       dataBuffer, blockSize, blockSize, GDT_Float32, 0, 0 ) != CE_None )
+  }
+}
+
+QRect QgsKernelDensityEstimation::tileRect( int tileIndex ) const
+{
+  const int left = ( tileIndex % mTileColumns ) * TILE_SIZE;
+  const int top = ( tileIndex / mTileColumns ) * TILE_SIZE;
+  return QRect( left, top, std::min( TILE_SIZE, mColumns - left ), std::min( TILE_SIZE, mRows - top ) );
+}
+
+bool QgsKernelDensityEstimation::createTile( int tileIndex )
+{
+  QVector< float > &data = mTiles[ tileIndex ];
+  data.fill( NO_DATA, TILE_SIZE * TILE_SIZE );
+  if ( !mFlushedTiles.contains( tileIndex ) )
+    return true;
+
+  // continue from the values already written to the raster, so that each pixel
+  // sums the points in the same order whatever the number of in-memory tiles
+  const QRect tile = tileRect( tileIndex );
+  return GDALRasterIO( mRasterBandH, GF_Read, tile.left(), tile.top(), tile.width(), tile.height(),
+                       data.data(), tile.width(), tile.height(), GDT_Float32, 0, sizeof( float ) * TILE_SIZE ) == CE_None;
+}
+
+QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::flushTiles()
+{
+  Result result = Success;
+
+  for ( auto it = mTiles.constBegin(); it != mTiles.constEnd(); ++it )
+  {
+    const QRect tile = tileRect( it.key() );
+    if ( GDALRasterIO( mRasterBandH, GF_Write, tile.left(), tile.top(), tile.width(), tile.height(),
+                       const_cast< float * >( it.value().constData() ), tile.width(), tile.height(), GDT_Float32, 0, sizeof( float ) * TILE_SIZE ) != CE_None )
     {
       result = RasterIoError;
     }
-    CPLFree( dataBuffer );
+    mFlushedTiles.insert( it.key() );
   }
 
+  mTiles.clear();
   return result;
 }
 
 QgsKernelDensityEstimation::Result QgsKernelDensityEstimation::finalise()
 {
+  Result result = accumulatePendingPoints();
+  if ( flushTiles() != Success )
+    result = RasterIoError;
+
   GDALClose( ( GDALDatasetH ) mDatasetH );
   mDatasetH = nullptr;
   mRasterBandH = nullptr;
-  return Success;
+  return result;
 }
 
 int QgsKernelDensityEstimation::radiusSizeInPixels( double radius ) const
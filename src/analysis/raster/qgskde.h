@@ -17,7 +17,11 @@
 #define QGSKDE_H
 
 #include "qgsrectangle.h"
+#include <QHash>
+#include <QRect>
+#include <QSet>
 #include <QString>
+#include <QVector>
 
 // GDAL includes
 #include <gdal.h>
@@ -100,6 +104,22 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
      */
     QgsKernelDensityEstimation( const Parameters &parameters, const QString &outputFile, const QString &outputFormat );
 
+    /**
+     * Sets the maximum number of tiles of 256x256 pixels (256 kB) the surface is accumulated
+     * into in memory. When more tiles are needed, the tiles are written to the output file
+     * and read back when points are added to them again. The default is 1024 tiles (256 MB).
+     * \see maximumTileCount()
+     * \since QGIS 3.0
+     */
+    void setMaximumTileCount( int count );
+
+    /**
+     * Returns the maximum number of tiles the surface is accumulated into in memory.
+     * \see setMaximumTileCount()
+     * \since QGIS 3.0
+     */
+    int maximumTileCount() const { return mMaximumTileCount; }
+
     /**
      * Runs the KDE calculation across the whole layer at once. Either call this method, or manually
      * call run(), addFeature() and finalise() separately.
@@ -116,6 +136,7 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
 
     /**
      * Adds a single feature to the KDE surface. prepare() must be called before adding features.
+     * The surface is accumulated in memory and only written to the output file by finalise().
      * \see prepare()
      * \see finalise()
      */
@@ -130,6 +151,30 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
 
   private:
 
+    //! Point added to the surface, waiting to be accumulated into the in-memory tiles
+    struct KdePoint
+    {
+      double x;
+      double y;
+      double radius;
+      double weight;
+      //! Top left pixel of the kernel window, with y axis pointing up
+      int xPosition;
+      int yPosition;
+      //! Top row of the kernel window in the raster
+      int yPositionIO;
+      //! Size of the kernel window in pixels
+      int blockSize;
+    };
+
+    //! Tile of the surface and points to accumulate into it
+    struct TileJob
+    {
+      int tileIndex;
+      float *data;
+      QVector< int > points;
+    };
+
     //! Calculate the value given to a point width a given distance for a specified kernel shape
     double calculateKernelValue( const double distance, const double bandwidth, const KernelShape shape, const OutputValues outputType ) const;
     //! Uniform kernel function
@@ -161,13 +206,42 @@ class ANALYSIS_EXPORT QgsKernelDensityEstimation
     OutputValues mOutputValues;
 
     int mBufferSize;
+    int mMaximumTileCount;
+
+    int mRows = 0;
+    int mColumns = 0;
+    int mTileColumns = 0;
 
     GDALDatasetH mDatasetH;
     GDALRasterBandH mRasterBandH;
 
+    //! Points waiting to be accumulated into the tiles
+    QVector< KdePoint > mPendingPoints;
+
+    //! In-memory tiles of the surface, initialized to the no data value
+    QHash< int, QVector< float > > mTiles;
+
+    //! Tiles which were written to the raster
+    QSet< int > mFlushedTiles;
+
     //! Creates a new raster layer and initializes it to the no data value
     bool createEmptyLayer( GDALDriverH driver, const QgsRectangle &bounds, int rows, int columns ) const;
     int radiusSizeInPixels( double radius ) const;
+
+    //! Accumulates the pending points into the in-memory tiles
+    Result accumulatePendingPoints();
+
+    //! Accumulates the points of a tile job into its tile
+    void accumulateTile( const TileJob &job ) const;
+
+    //! Returns the area of the raster covered by a tile
+    QRect tileRect( int tileIndex ) const;
+
+    //! Allocates an in-memory tile, with the values of the raster if the tile was written to it
+    bool createTile( int tileIndex );
+
+    //! Writes the in-memory tiles to the raster and clears them
+    Result flushTiles();
 };
 
 
@@ -27,6 +27,69 @@
 #include "qgslogger.h"
 
 #include <QFile>
+#include <QThreadPool>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+
+// Size in cells of the side of the raster tiles read from the provider
+static const int TILE_SIZE = 512;
+// Maximum number of raster tiles kept in memory
+static const int MAX_CACHED_TILES = 32;
+// Maximum number of features and of raster cells processed at once
+static const int CHUNK_FEATURES = 1024;
+static const qint64 CHUNK_CELLS = 16 * 1024 * 1024;
+
+///@cond PRIVATE
+
+//! A GEOS context, which cannot be shared by threads processing geometries at the same time
+class QgsZonalStatisticsGeosContext
+{
+  public:
+    QgsZonalStatisticsGeosContext()
+      : ctxt( initGEOS_r( nullptr, nullptr ) )
+    {}
+
+    ~QgsZonalStatisticsGeosContext()
+    {
+      finishGEOS_r( ctxt );
+    }
+
+    QgsZonalStatisticsGeosContext( const QgsZonalStatisticsGeosContext &rh ) = delete;
+    QgsZonalStatisticsGeosContext &operator=( const QgsZonalStatisticsGeosContext &rh ) = delete;
+
+    GEOSContextHandle_t ctxt;
+};
+
+//! Returns the GEOS context of the current thread
+static GEOSContextHandle_t threadGeosContext()
+{
+  static thread_local QgsZonalStatisticsGeosContext sContext;
+  return sContext.ctxt;
+}
+
+//! Returns the polygon of \a rect, created with the GEOS context \a geosctxt
+static GEOSGeometry *pixelRectangle( GEOSContextHandle_t geosctxt, const QgsRectangle &rect )
+{
+  GEOSCoordSequence *coords = GEOSCoordSeq_create_r( geosctxt, 5, 2 );
+  if ( !coords )
+    return nullptr;
+
+  const double x[5] = { rect.xMinimum(), rect.xMaximum(), rect.xMaximum(), rect.xMinimum(), rect.xMinimum() };
+  const double y[5] = { rect.yMinimum(), rect.yMinimum(), rect.yMaximum(), rect.yMaximum(), rect.yMinimum() };
+  for ( unsigned int i = 0; i < 5; ++i )
+  {
+    GEOSCoordSeq_setX_r( geosctxt, coords, i, x[i] );
+    GEOSCoordSeq_setY_r( geosctxt, coords, i, y[i] );
+  }
+
+  GEOSGeometry *ring = GEOSGeom_createLinearRing_r( geosctxt, coords );
+  if ( !ring )
+    return nullptr;
+  return GEOSGeom_createPolygon_r( geosctxt, ring, nullptr, 0 );
+}
+
+///@endcond
 
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer *polygonLayer, QgsRasterLayer *rasterLayer, const QString &attributePrefix, int rasterBand, QgsZonalStatistics::Statistics stats )
   : mRasterLayer( rasterLayer )
@@ -197,150 +260,206 @@ int QgsZonalStatistics::calculateStatistics( QgsFeedback *feedback )
     return 8;
   }
 
-  //progress dialog
-  long featureCount = vectorProvider->featureCount();
+  bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
+                          ( mStatistics & QgsZonalStatistics::StDev ) ||
+                          ( mStatistics & QgsZonalStatistics::Variance );
+  bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
+                              ( mStatistics & QgsZonalStatistics::Majority );
 
-  //iterate over each polygon
+  //the polygons are read and processed chunk by chunk, so that only the geometries and
+  //raster windows of a chunk are kept in memory
   QgsFeatureRequest request;
   request.setSubsetOfAttributes( QgsAttributeList() );
   QgsFeatureIterator fi = vectorProvider->getFeatures( request );
   QgsFeature f;
+  long featureCount = vectorProvider->featureCount();
+  long readFeatures = 0;
 
-  bool statsStoreValues = ( mStatistics & QgsZonalStatistics::Median ) ||
-                          ( mStatistics & QgsZonalStatistics::StDev ) ||
-                          ( mStatistics & QgsZonalStatistics::Variance );
-  bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
-                              ( mStatistics & QgsZonalStatistics::Majority );
+  //within a chunk the polygons are processed tile by tile, so that the raster tiles are read while they are in the cache
+  auto tileKey = []( const FeatureJob & job )
+  {
+    return qMakePair( ( job.offsetY + job.nCellsY / 2 ) / TILE_SIZE, ( job.offsetX + job.nCellsX / 2 ) / TILE_SIZE );
+  };
 
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
-  int featureCounter = 0;
+  //a thread pool limited to a single thread processes the polygons sequentially
+  bool parallel = QThreadPool::globalInstance()->maxThreadCount() > 1;
 
+  QCache<qint64, QgsRasterBlock> tiles( MAX_CACHED_TILES );
   QgsChangedAttributesMap changeMap;
-  while ( fi.nextFeature( f ) )
+  QVector<FeatureJob> jobs;
+  bool featuresLeft = true;
+  while ( featuresLeft )
   {
     if ( feedback && feedback->isCanceled() )
     {
       break;
     }
 
-    if ( feedback )
+    if ( feedback && featureCount > 0 )
     {
-      feedback->setProgress( 100.0 * static_cast< double >( featureCounter ) / featureCount );
+      feedback->setProgress( 100.0 * static_cast< double >( readFeatures ) / featureCount );
     }
 
-    if ( !f.hasGeometry() )
+    //collect the polygons of the chunk and the raster windows covering them
+    jobs.clear();
+    qint64 chunkCells = 0;
+    while ( jobs.count() < CHUNK_FEATURES && chunkCells < CHUNK_CELLS )
     {
-      ++featureCounter;
-      continue;
+      if ( !fi.nextFeature( f ) )
+      {
+        featuresLeft = false;
+        break;
+      }
+      ++readFeatures;
+
+      if ( !f.hasGeometry() )
+      {
+        continue;
+      }
+      QgsGeometry featureGeometry = f.geometry();
+
+      QgsRectangle featureRect = featureGeometry.boundingBox().intersect( &rasterBBox );
+      if ( featureRect.isEmpty() )
+      {
+        continue;
+      }
+
+      int offsetX, offsetY, nCellsX, nCellsY;
+      if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
+      {
+        continue;
+      }
+
+      //avoid access to cells outside of the raster (may occur because of rounding)
+      if ( ( offsetX + nCellsX ) > nCellsXProvider )
+      {
+        nCellsX = nCellsXProvider - offsetX;
+      }
+      if ( ( offsetY + nCellsY ) > nCellsYProvider )
+      {
+        nCellsY = nCellsYProvider - offsetY;
+      }
+
+      //the geometries are converted here, so that the global GEOS context is only used by this thread
+      GEOSGeometry *geos = featureGeometry.exportToGeos();
+      if ( !geos )
+      {
+        continue;
+      }
+
+      FeatureJob job;
+      job.id = f.id();
+      job.geometry.reset( geos, []( GEOSGeometry * geometry ) { GEOSGeom_destroy_r( QgsGeometry::getGEOSHandler(), geometry ); } );
+      job.offsetX = offsetX;
+      job.offsetY = offsetY;
+      job.nCellsX = std::max( nCellsX, 0 );
+      job.nCellsY = std::max( nCellsY, 0 );
+      job.stats = FeatureStats( statsStoreValues, statsStoreValueCount );
+      jobs.append( job );
+      chunkCells += static_cast< qint64 >( job.nCellsX ) * job.nCellsY;
     }
-    QgsGeometry featureGeometry = f.geometry();
 
-    QgsRectangle featureRect = featureGeometry.boundingBox().intersect( &rasterBBox );
-    if ( featureRect.isEmpty() )
+    std::stable_sort( jobs.begin(), jobs.end(), [&tileKey]( const FeatureJob & job1, const FeatureJob & job2 )
     {
-      ++featureCounter;
-      continue;
-    }
+      return tileKey( job1 ) < tileKey( job2 );
+    } );
 
-    int offsetX, offsetY, nCellsX, nCellsY;
-    if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
+    //read the raster windows of the chunk
+    for ( FeatureJob &job : jobs )
     {
-      ++featureCounter;
-      continue;
+      readWindow( job, tiles );
     }
 
-    //avoid access to cells outside of the raster (may occur because of rounding)
-    if ( ( offsetX + nCellsX ) > nCellsXProvider )
+    auto process = [this, cellsizeX, cellsizeY, &rasterBBox]( FeatureJob & job )
     {
-      nCellsX = nCellsXProvider - offsetX;
-    }
-    if ( ( offsetY + nCellsY ) > nCellsYProvider )
+      processFeature( job, cellsizeX, cellsizeY, rasterBBox );
+    };
+    if ( parallel )
     {
-      nCellsY = nCellsYProvider - offsetY;
+      QtConcurrent::blockingMap( jobs, process );
     }
-
-    statisticsFromMiddlePointTest( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                   rasterBBox, featureStats );
-
-    if ( featureStats.count <= 1 )
+    else
     {
-      //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      statisticsFromPreciseIntersection( featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                         rasterBBox, featureStats );
+      std::for_each( jobs.begin(), jobs.end(), process );
     }
 
-    //write the statistics value to the vector data provider
-    QgsAttributeMap changeAttributeMap;
-    if ( mStatistics & QgsZonalStatistics::Count )
-      changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
-    if ( mStatistics & QgsZonalStatistics::Sum )
-      changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
-    if ( featureStats.count > 0 )
+    for ( FeatureJob &job : jobs )
     {
-      double mean = featureStats.sum / featureStats.count;
-      if ( mStatistics & QgsZonalStatistics::Mean )
-        changeAttributeMap.insert( meanIndex, QVariant( mean ) );
-      if ( mStatistics & QgsZonalStatistics::Median )
-      {
-        std::sort( featureStats.values.begin(), featureStats.values.end() );
-        int size = featureStats.values.count();
-        bool even = ( size % 2 ) < 1;
-        double medianValue;
-        if ( even )
-        {
-          medianValue = ( featureStats.values.at( size / 2 - 1 ) + featureStats.values.at( size / 2 ) ) / 2;
-        }
-        else //odd
-        {
-          medianValue = featureStats.values.at( ( size + 1 ) / 2 - 1 );
-        }
-        changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
-      }
-      if ( mStatistics & QgsZonalStatistics::StDev || mStatistics & QgsZonalStatistics::Variance )
+      FeatureStats &featureStats = job.stats;
+
+      //write the statistics value to the vector data provider
+      QgsAttributeMap changeAttributeMap;
+      if ( mStatistics & QgsZonalStatistics::Count )
+        changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
+      if ( mStatistics & QgsZonalStatistics::Sum )
+        changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
+      if ( featureStats.count > 0 )
       {
-        double sumSquared = 0;
-        for ( int i = 0; i < featureStats.values.count(); ++i )
+        double mean = featureStats.sum / featureStats.count;
+        if ( mStatistics & QgsZonalStatistics::Mean )
+          changeAttributeMap.insert( meanIndex, QVariant( mean ) );
+        if ( mStatistics & QgsZonalStatistics::Median )
         {
-          double diff = featureStats.values.at( i ) - mean;
-          sumSquared += diff * diff;
-        }
-        double variance = sumSquared / featureStats.values.count();
-        if ( mStatistics & QgsZonalStatistics::StDev )
-        {
-          double stdev = std::pow( variance, 0.5 );
-          changeAttributeMap.insert( stdevIndex, QVariant( stdev ) );
+          std::sort( featureStats.values.begin(), featureStats.values.end() );
+          int size = featureStats.values.count();
+          bool even = ( size % 2 ) < 1;
+          double medianValue;
+          if ( even )
+          {
+            medianValue = ( featureStats.values.at( size / 2 - 1 ) + featureStats.values.at( size / 2 ) ) / 2;
+          }
+          else //odd
+          {
+            medianValue = featureStats.values.at( ( size + 1 ) / 2 - 1 );
+          }
+          changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
         }
-        if ( mStatistics & QgsZonalStatistics::Variance )
-          changeAttributeMap.insert( varianceIndex, QVariant( variance ) );
-      }
-      if ( mStatistics & QgsZonalStatistics::Min )
-        changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Max )
-        changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
-      if ( mStatistics & QgsZonalStatistics::Range )
-        changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
-      {
-        QList<int> vals = featureStats.valueCount.values();
-        std::sort( vals.begin(), vals.end() );
-        if ( mStatistics & QgsZonalStatistics::Minority )
+        if ( mStatistics & QgsZonalStatistics::StDev || mStatistics & QgsZonalStatistics::Variance )
         {
-          float minorityKey = featureStats.valueCount.key( vals.first() );
-          changeAttributeMap.insert( minorityIndex, QVariant( minorityKey ) );
+          double sumSquared = 0;
+          for ( int i = 0; i < featureStats.values.count(); ++i )
+          {
+            double diff = featureStats.values.at( i ) - mean;
+            sumSquared += diff * diff;
+          }
+          double variance = sumSquared / featureStats.values.count();
+          if ( mStatistics & QgsZonalStatistics::StDev )
+          {
+            double stdev = std::pow( variance, 0.5 );
+            changeAttributeMap.insert( stdevIndex, QVariant( stdev ) );
+          }
+          if ( mStatistics & QgsZonalStatistics::Variance )
+            changeAttributeMap.insert( varianceIndex, QVariant( variance ) );
         }
-        if ( mStatistics & QgsZonalStatistics::Majority )
+        if ( mStatistics & QgsZonalStatistics::Min )
+          changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
+        if ( mStatistics & QgsZonalStatistics::Max )
+          changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
+        if ( mStatistics & QgsZonalStatistics::Range )
+          changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
+        if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
         {
-          float majKey = featureStats.valueCount.key( vals.last() );
-          changeAttributeMap.insert( majorityIndex, QVariant( majKey ) );
+          QList<int> vals = featureStats.valueCount.values();
+          std::sort( vals.begin(), vals.end() );
+          if ( mStatistics & QgsZonalStatistics::Minority )
+          {
+            float minorityKey = featureStats.valueCount.key( vals.first() );
+            changeAttributeMap.insert( minorityIndex, QVariant( minorityKey ) );
+          }
+          if ( mStatistics & QgsZonalStatistics::Majority )
+          {
+            float majKey = featureStats.valueCount.key( vals.last() );
+            changeAttributeMap.insert( majorityIndex, QVariant( majKey ) );
+          }
         }
+        if ( mStatistics & QgsZonalStatistics::Variety )
+          changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
       }
-      if ( mStatistics & QgsZonalStatistics::Variety )
-        changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
-    }
 
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
+      changeMap.insert( job.id, changeAttributeMap );
+    }
   }
+  jobs.clear();
 
   vectorProvider->changeAttributeValues( changeMap );
 
@@ -386,41 +505,109 @@ int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle &rasterBBox, const Q
   return 0;
 }
 
-void QgsZonalStatistics::statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats )
+void QgsZonalStatistics::readWindow( FeatureJob &job, QCache<qint64, QgsRasterBlock> &tiles ) const
+{
+  job.values.resize( job.nCellsX * job.nCellsY );
+  if ( job.values.isEmpty() )
+  {
+    return;
+  }
+
+  int nCellsXProvider = mRasterProvider->xSize();
+  int nCellsYProvider = mRasterProvider->ySize();
+  int nTilesX = ( nCellsXProvider + TILE_SIZE - 1 ) / TILE_SIZE;
+  QgsRectangle rasterBBox = mRasterProvider->extent();
+  double cellSizeX = rasterBBox.width() / nCellsXProvider;
+  double cellSizeY = rasterBBox.height() / nCellsYProvider;
+
+  int firstTileRow = job.offsetY / TILE_SIZE;
+  int lastTileRow = ( job.offsetY + job.nCellsY - 1 ) / TILE_SIZE;
+  int firstTileColumn = job.offsetX / TILE_SIZE;
+  int lastTileColumn = ( job.offsetX + job.nCellsX - 1 ) / TILE_SIZE;
+  for ( int tileRow = firstTileRow; tileRow <= lastTileRow; ++tileRow )
+  {
+    for ( int tileColumn = firstTileColumn; tileColumn <= lastTileColumn; ++tileColumn )
+    {
+      int tileTop = tileRow * TILE_SIZE;
+      int tileLeft = tileColumn * TILE_SIZE;
+      int tileWidth = std::min( TILE_SIZE, nCellsXProvider - tileLeft );
+      int tileHeight = std::min( TILE_SIZE, nCellsYProvider - tileTop );
+
+      qint64 key = static_cast< qint64 >( tileRow ) * nTilesX + tileColumn;
+      QgsRasterBlock *tile = tiles.object( key );
+      if ( !tile )
+      {
+        //read the tile on the raster grid, so that each block cell is a raster cell
+        QgsRectangle tileExtent( rasterBBox.xMinimum() + tileLeft * cellSizeX,
+                                 rasterBBox.yMaximum() - ( tileTop + tileHeight ) * cellSizeY,
+                                 rasterBBox.xMinimum() + ( tileLeft + tileWidth ) * cellSizeX,
+                                 rasterBBox.yMaximum() - tileTop * cellSizeY );
+        tile = mRasterProvider->block( mRasterBand, tileExtent, tileWidth, tileHeight );
+        tiles.insert( key, tile );
+      }
+
+      //copy the part of the tile overlapping the window
+      bool tileValid = tile->isValid();
+      int top = std::max( tileTop, job.offsetY );
+      int bottom = std::min( tileTop + tileHeight, job.offsetY + job.nCellsY );
+      int left = std::max( tileLeft, job.offsetX );
+      int right = std::min( tileLeft + tileWidth, job.offsetX + job.nCellsX );
+      for ( int row = top; row < bottom; ++row )
+      {
+        float *value = job.values.data() + ( row - job.offsetY ) * job.nCellsX + ( left - job.offsetX );
+        for ( int column = left; column < right; ++column )
+        {
+          *value++ = tileValid ? tile->value( row - tileTop, column - tileLeft ) : std::numeric_limits<float>::quiet_NaN();
+        }
+      }
+    }
+  }
+}
+
+void QgsZonalStatistics::processFeature( FeatureJob &job, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox ) const
+{
+  GEOSContextHandle_t geosctxt = threadGeosContext();
+
+  statisticsFromMiddlePointTest( geosctxt, job.geometry.get(), job.values, job.offsetX, job.offsetY, job.nCellsX, job.nCellsY, cellSizeX, cellSizeY,
+                                 rasterBBox, job.stats );
+
+  if ( job.stats.count <= 1 )
+  {
+    //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
+    statisticsFromPreciseIntersection( geosctxt, job.geometry.get(), job.values, job.offsetX, job.offsetY, job.nCellsX, job.nCellsY, cellSizeX, cellSizeY,
+                                       rasterBBox, job.stats );
+  }
+}
+
+void QgsZonalStatistics::statisticsFromMiddlePointTest( GEOSContextHandle_t geosctxt, const GEOSGeometry *poly, const QVector<float> &values, int pixelOffsetX,
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const
 {
   double cellCenterX, cellCenterY;
 
   cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
   stats.reset();
 
-  GEOSGeometry *polyGeos = poly.exportToGeos();
-  if ( !polyGeos )
+  if ( !poly )
   {
     return;
   }
 
-  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
-  const GEOSPreparedGeometry *polyGeosPrepared = GEOSPrepare_r( geosctxt, polyGeos );
+  const GEOSPreparedGeometry *polyGeosPrepared = GEOSPrepare_r( geosctxt, poly );
   if ( !polyGeosPrepared )
   {
-    GEOSGeom_destroy_r( geosctxt, polyGeos );
     return;
   }
 
   GEOSCoordSequence *cellCenterCoords = nullptr;
   GEOSGeometry *currentCellCenter = nullptr;
 
-  QgsRectangle featureBBox = poly.boundingBox().intersect( &rasterBBox );
-  QgsRectangle intersectBBox = rasterBBox.intersect( &featureBBox );
-
-  QgsRasterBlock *block = mRasterProvider->block( mRasterBand, intersectBBox, nCellsX, nCellsY );
+  const float *value = values.constData();
   for ( int i = 0; i < nCellsY; ++i )
   {
     cellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
-    for ( int j = 0; j < nCellsX; ++j )
+    for ( int j = 0; j < nCellsX; ++j, ++value )
     {
-      if ( validPixel( block->value( i, j ) ) )
+      if ( validPixel( *value ) )
       {
         GEOSGeom_destroy_r( geosctxt, currentCellCenter );
         cellCenterCoords = GEOSCoordSeq_create_r( geosctxt, 1, 2 );
@@ -429,7 +616,7 @@ void QgsZonalStatistics::statisticsFromMiddlePointTest( const QgsGeometry &poly,
         currentCellCenter = GEOSGeom_createPoint_r( geosctxt, cellCenterCoords );
         if ( GEOSPreparedContains_r( geosctxt, polyGeosPrepared, currentCellCenter ) )
         {
-          stats.addValue( block->value( i, j ) );
+          stats.addValue( *value );
         }
       }
       cellCenterX += cellSizeX;
@@ -439,58 +626,56 @@ void QgsZonalStatistics::statisticsFromMiddlePointTest( const QgsGeometry &poly,
 
   GEOSGeom_destroy_r( geosctxt, currentCellCenter );
   GEOSPreparedGeom_destroy_r( geosctxt, polyGeosPrepared );
-  GEOSGeom_destroy_r( geosctxt, polyGeos );
-  delete block;
 }
 
-void QgsZonalStatistics::statisticsFromPreciseIntersection( const QgsGeometry &poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats )
+void QgsZonalStatistics::statisticsFromPreciseIntersection( GEOSContextHandle_t geosctxt, const GEOSGeometry *poly, const QVector<float> &values, int pixelOffsetX,
+    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const
 {
   stats.reset();
 
+  if ( !poly )
+  {
+    return;
+  }
+
   double currentY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  QgsGeometry pixelRectGeometry;
 
   double hCellSizeX = cellSizeX / 2.0;
   double hCellSizeY = cellSizeY / 2.0;
   double pixelArea = cellSizeX * cellSizeY;
   double weight = 0;
 
-  QgsRectangle featureBBox = poly.boundingBox().intersect( &rasterBBox );
-  QgsRectangle intersectBBox = rasterBBox.intersect( &featureBBox );
-
-  QgsRasterBlock *block = mRasterProvider->block( mRasterBand, intersectBBox, nCellsX, nCellsY );
+  const float *value = values.constData();
   for ( int i = 0; i < nCellsY; ++i )
   {
     double currentX = rasterBBox.xMinimum() + cellSizeX / 2.0 + pixelOffsetX * cellSizeX;
-    for ( int j = 0; j < nCellsX; ++j )
+    for ( int j = 0; j < nCellsX; ++j, ++value, currentX += cellSizeX )
     {
-      if ( !validPixel( block->value( i, j ) ) )
+      if ( !validPixel( *value ) )
       {
         continue;
       }
 
-      pixelRectGeometry = QgsGeometry::fromRect( QgsRectangle( currentX - hCellSizeX, currentY - hCellSizeY, currentX + hCellSizeX, currentY + hCellSizeY ) );
-      if ( !pixelRectGeometry.isNull() )
+      GEOSGeometry *pixelRectGeometry = pixelRectangle( geosctxt, QgsRectangle( currentX - hCellSizeX, currentY - hCellSizeY, currentX + hCellSizeX, currentY + hCellSizeY ) );
+      if ( pixelRectGeometry )
       {
         //intersection
-        QgsGeometry intersectGeometry = pixelRectGeometry.intersection( poly );
-        if ( !intersectGeometry.isNull() )
+        GEOSGeometry *intersectGeometry = GEOSIntersection_r( geosctxt, pixelRectGeometry, poly );
+        if ( intersectGeometry )
         {
-          double intersectionArea = intersectGeometry.area();
-          if ( intersectionArea >= 0.0 )
+          double intersectionArea = 0;
+          if ( GEOSArea_r( geosctxt, intersectGeometry, &intersectionArea ) && intersectionArea >= 0.0 )
           {
             weight = intersectionArea / pixelArea;
-            stats.addValue( block->value( i, j ), weight );
+            stats.addValue( *value, weight );
           }
+          GEOSGeom_destroy_r( geosctxt, intersectGeometry );
         }
-        pixelRectGeometry = QgsGeometry();
+        GEOSGeom_destroy_r( geosctxt, pixelRectGeometry );
       }
-      currentX += cellSizeX;
     }
     currentY -= cellSizeY;
   }
-  delete block;
 }
 
 bool QgsZonalStatistics::validPixel( float value ) const
@@ -20,17 +20,22 @@
 
 #include <QString>
 #include <QMap>
+#include <QVector>
+#include <QCache>
 
 #include <limits>
 #include <cfloat>
+#include <memory>
 
 #include "qgis_analysis.h"
 #include "qgsfeedback.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
 
-class QgsGeometry;
 class QgsVectorLayer;
 class QgsRasterLayer;
 class QgsRasterDataProvider;
+class QgsRasterBlock;
 class QgsRectangle;
 class QgsField;
 
@@ -70,7 +75,11 @@ class ANALYSIS_EXPORT QgsZonalStatistics
                         QgsZonalStatistics::Statistics stats = QgsZonalStatistics::Statistics( QgsZonalStatistics::Count | QgsZonalStatistics::Sum | QgsZonalStatistics::Mean ) );
 
     /**
-     * Starts the calculation
+     * Starts the calculation.
+     * The polygons are read by chunks, processed in spatial order within each chunk,
+     * and the raster is read by tiles which are kept in a cache, so that raster areas
+     * shared by neighbouring polygons are only read once. The statistics of the polygons
+     * are calculated in parallel, unless the global thread pool is limited to a single thread.
       \returns 0 in case of success*/
     int calculateStatistics( QgsFeedback *feedback );
 
@@ -118,19 +127,40 @@ class ANALYSIS_EXPORT QgsZonalStatistics
         bool mStoreValueCounts;
     };
 
+    //! A polygon and the raster window covering its bounding box
+    struct FeatureJob
+    {
+      QgsFeatureId id;
+      //! Polygon converted to GEOS while the features are read
+      std::shared_ptr<GEOSGeometry> geometry;
+      int offsetX;
+      int offsetY;
+      int nCellsX;
+      int nCellsY;
+      //! Cell values of the window, row by row
+      QVector<float> values;
+      FeatureStats stats;
+    };
+
     /**
      * Analysis what cells need to be considered to cover the bounding box of a feature
       \returns 0 in case of success*/
     int cellInfoForBBox( const QgsRectangle &rasterBBox, const QgsRectangle &featureBBox, double cellSizeX, double cellSizeY,
                          int &offsetX, int &offsetY, int &nCellsX, int &nCellsY ) const;
 
+    //! Copies the cells of the window of \a job from the cached raster tiles, reading the missing tiles from the provider
+    void readWindow( FeatureJob &job, QCache<qint64, QgsRasterBlock> &tiles ) const;
+
+    //! Calculates the statistics of a job from its raster window
+    void processFeature( FeatureJob &job, double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox ) const;
+
     //! Returns statistics by considering the pixels where the center point is within the polygon (fast)
-    void statisticsFromMiddlePointTest( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                        double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
+    void statisticsFromMiddlePointTest( GEOSContextHandle_t geosctxt, const GEOSGeometry *poly, const QVector<float> &values, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
+                                        double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const;
 
     //! Returns statistics with precise pixel - polygon intersection test (slow)
-    void statisticsFromPreciseIntersection( const QgsGeometry &poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                            double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats );
+    void statisticsFromPreciseIntersection( GEOSContextHandle_t geosctxt, const GEOSGeometry *poly, const QVector<float> &values, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
+                                            double cellSizeX, double cellSizeY, const QgsRectangle &rasterBBox, FeatureStats &stats ) const;
 
     //! Tests whether a pixel's value should be included in the result
     bool validPixel( float value ) const;
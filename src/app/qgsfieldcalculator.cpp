@@ -276,34 +276,61 @@ void QgsFieldCalculator::accept()
     {
       req.setFilterFids( mVectorLayer->selectedFeatureIds() );
     }
+    // unless it depends on the row number, the expression is evaluated for blocks of features at once
+    const QSet<QString> referencedVariables = exp.referencedVariables();
+    const bool evaluateBatches = !referencedVariables.contains( QStringLiteral( "row_number" ) ) && !referencedVariables.contains( QString() );
+    const int batchSize = evaluateBatches ? 1000 : 1;
+
     QgsFeatureIterator fit = mVectorLayer->getFeatures( req );
-    while ( fit.nextFeature( feature ) )
+    QgsFeatureList features;
+    bool hasMoreFeatures = true;
+    while ( hasMoreFeatures )
     {
-      expContext.setFeature( feature );
-      expContext.lastScope()->addVariable( QgsExpressionContextScope::StaticVariable( QStringLiteral( "row_number" ), rownum, true ) );
+      features.clear();
+      while ( features.size() < batchSize && ( hasMoreFeatures = fit.nextFeature( feature ) ) )
+        features << feature;
+      if ( features.isEmpty() )
+        break;
+
+      QVariantList values;
+      if ( evaluateBatches )
+      {
+        values = exp.evaluateBatch( features, &expContext );
+      }
+      else
+      {
+        expContext.setFeature( features.at( 0 ) );
+        expContext.lastScope()->addVariable( QgsExpressionContextScope::StaticVariable( QStringLiteral( "row_number" ), rownum, true ) );
+        values << exp.evaluate( &expContext );
+      }
 
-      QVariant value = exp.evaluate( &expContext );
       if ( exp.hasEvalError() )
       {
         calculationSuccess = false;
         error = exp.evalErrorString();
         break;
       }
-      else if ( updatingGeom )
+
+      for ( int i = 0; i < features.size(); ++i )
       {
-        if ( value.canConvert< QgsGeometry >() )
+        const QgsFeature &f = features.at( i );
+        QVariant value = values.at( i );
+        if ( updatingGeom )
         {
-          QgsGeometry geom = value.value< QgsGeometry >();
-          mVectorLayer->changeGeometry( feature.id(), geom );
+          if ( value.canConvert< QgsGeometry >() )
+          {
+            QgsGeometry geom = value.value< QgsGeometry >();
+            mVectorLayer->changeGeometry( f.id(), geom );
+          }
+        }
+        else
+        {
+          field.convertCompatible( value );
+          mVectorLayer->changeAttributeValue( f.id(), mAttributeId, value, newField ? emptyAttribute : f.attributes().value( mAttributeId ) );
         }
-      }
-      else
-      {
-        field.convertCompatible( value );
-        mVectorLayer->changeAttributeValue( feature.id(), mAttributeId, value, newField ? emptyAttribute : feature.attributes().value( mAttributeId ) );
-      }
 
-      rownum++;
+        rownum++;
+      }
     }
 
     QApplication::restoreOverrideCursor();
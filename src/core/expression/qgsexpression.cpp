@@ -15,6 +15,7 @@
 
 #include "qgsexpression.h"
 #include "qgsexpressionfunction.h"
+#include "qgsexpressionbatchevaluator.h"
 #include "qgsexpressionprivate.h"
 #include "qgsexpressionnodeimpl.h"
 #include "qgsfeaturerequest.h"
@@ -99,6 +100,7 @@ bool QgsExpression::checkExpression( const QString &text, const QgsExpressionCon
 void QgsExpression::setExpression( const QString &expression )
 {
   detach();
+  d->mProgram.reset();
   d->mRootNode = ::parseExpression( expression, d->mParserErrorString );
   d->mEvalErrorString = QString();
   d->mExp = expression;
@@ -327,6 +329,7 @@ void QgsExpression::setGeomCalculator( const QgsDistanceArea *calc )
 bool QgsExpression::prepare( const QgsExpressionContext *context )
 {
   detach();
+  d->mProgram.reset();
   d->mEvalErrorString = QString();
   if ( !d->mRootNode )
   {
@@ -345,6 +348,20 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
   return d->mRootNode->prepare( this, context );
 }
 
+bool QgsExpression::compile( const QgsExpressionContext *context )
+{
+  if ( !prepare( context ) )
+    return false;
+
+  d->mProgram.reset( new QgsExpressionProgram( d->mRootNode, context ) );
+  return true;
+}
+
+bool QgsExpression::isCompiled() const
+{
+  return static_cast< bool >( d->mProgram );
+}
+
 QVariant QgsExpression::evaluate()
 {
   d->mEvalErrorString = QString();
@@ -354,6 +371,9 @@ QVariant QgsExpression::evaluate()
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->run( this, nullptr );
+
   return d->mRootNode->eval( this, static_cast<const QgsExpressionContext *>( nullptr ) );
 }
 
@@ -366,9 +386,29 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->run( this, context );
+
   return d->mRootNode->eval( this, context );
 }
 
+QVariantList QgsExpression::evaluateBatch( const QList< QgsFeature > &features, QgsExpressionContext *context )
+{
+  d->mEvalErrorString = QString();
+  if ( !d->mRootNode )
+  {
+    d->mEvalErrorString = tr( "No root node! Parsing failed?" );
+    return QVector<QVariant>( features.count() ).toList();
+  }
+
+  if ( features.isEmpty() )
+    return QVariantList();
+
+  QgsExpressionContext defaultContext;
+  QgsExpressionBatchEvaluator evaluator( this, context ? context : &defaultContext );
+  return evaluator.evaluate( d->mRootNode, features );
+}
+
 bool QgsExpression::hasEvalError() const
 {
   return !d->mEvalErrorString.isNull();
@@ -177,6 +177,34 @@ class CORE_EXPORT QgsExpression
      */
     bool prepare( const QgsExpressionContext *context );
 
+    /**
+     * Prepares the expression with the \a context, then compiles it to a flat program
+     * which is used by subsequent calls to evaluate() in place of walking the tree of
+     * expression nodes. Static parts of the expression are replaced by their values and
+     * fields are looked up by their index in the fields of the \a context, so the program
+     * is faster to evaluate many times. The results are the same as for a prepared
+     * expression.
+     *
+     * The expression must only be evaluated for features with the fields of the \a context.
+     * Calling prepare() or setExpression() discards the compiled program.
+     *
+     * Returns the result of preparing the expression. The expression is only compiled if it
+     * could be prepared.
+     *
+     * \see isCompiled()
+     * \see prepare()
+     * \since QGIS 3.0
+     */
+    bool compile( const QgsExpressionContext *context );
+
+    /**
+     * Returns true if the expression was compiled and is evaluated with its compiled program.
+     *
+     * \see compile()
+     * \since QGIS 3.0
+     */
+    bool isCompiled() const;
+
     /**
      * Get list of columns referenced by the expression.
      *
@@ -224,6 +252,25 @@ class CORE_EXPORT QgsExpression
      */
     QVariant evaluate( const QgsExpressionContext *context );
 
+    /**
+     * Evaluates the expression for a block of \a features and returns the results, in the
+     * same order as the features. Column references, operators, IN lists and common math
+     * and string functions are computed for the whole block at once over typed arrays of
+     * values, which is much faster than evaluating the expression feature by feature. Other
+     * parts of the expression are evaluated for each feature in turn, by setting the feature
+     * of the \a context. The results are the same as calling evaluate() for each feature.
+     *
+     * If the evaluation fails for some features, their result is NULL and hasEvalError()
+     * returns true, with the error of the first of these features.
+     *
+     * \param features features to evaluate the expression for, with the fields of the context
+     * \param context context for evaluating expression. Other values than the feature must
+     * not change between the features of the block.
+     * \note prepare() should be called before calling this method.
+     * \since QGIS 3.0
+     */
+    QVariantList evaluateBatch( const QList< QgsFeature > &features, QgsExpressionContext *context );
+
     //! Returns true if an error occurred when evaluating last input
     bool hasEvalError() const;
     //! Returns evaluation error
@@ -0,0 +1,899 @@
+/***************************************************************************
+                               qgsexpressionbatchevaluator.cpp
+                             -------------------
+    begin                : October 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionbatchevaluator.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsexpressionfunction.h"
+#include "qgsexpressionnodeimpl.h"
+#include "qgsexpressionutils.h"
+
+#include <QRegExp>
+#include <QSet>
+#include <cmath>
+
+///@cond PRIVATE
+
+//! Sets \a value to the value of \a node if it does not depend on the feature
+static bool staticValue( const QgsExpressionNode *node, QVariant &value )
+{
+  if ( node->hasCachedStaticValue() )
+  {
+    value = node->cachedStaticValue();
+    return true;
+  }
+  else if ( node->nodeType() == QgsExpressionNode::ntLiteral )
+  {
+    value = static_cast< const QgsExpressionNodeLiteral * >( node )->value();
+    return true;
+  }
+  return false;
+}
+
+//! Returns the result of a comparison operator, from the difference between its operands
+static bool compareDiff( QgsExpressionNodeBinaryOperator::BinaryOperator op, double diff )
+{
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boEQ:
+      return qgsDoubleNear( diff, 0.0 );
+    case QgsExpressionNodeBinaryOperator::boNE:
+      return !qgsDoubleNear( diff, 0.0 );
+    case QgsExpressionNodeBinaryOperator::boLT:
+      return diff < 0;
+    case QgsExpressionNodeBinaryOperator::boGT:
+      return diff > 0;
+    case QgsExpressionNodeBinaryOperator::boLE:
+      return diff <= 0;
+    case QgsExpressionNodeBinaryOperator::boGE:
+      return diff >= 0;
+    default:
+      Q_ASSERT( false );
+      return false;
+  }
+}
+
+QgsExpressionBatchEvaluator::QgsExpressionBatchEvaluator( QgsExpression *expression, QgsExpressionContext *context )
+  : mExpression( expression )
+  , mContext( context )
+  , mFields( context->fields() )
+{
+}
+
+QVariantList QgsExpressionBatchEvaluator::evaluate( QgsExpressionNode *node, const QgsFeatureList &features )
+{
+  mFeatures = &features;
+  mRowCount = features.count();
+  mErrors = QBitArray( mRowCount );
+  mErrorRow = -1;
+  mError = QString();
+
+  Column result;
+  evaluateNode( node, result );
+
+  QVariantList values;
+  values.reserve( mRowCount );
+  for ( int row = 0; row < mRowCount; ++row )
+  {
+    values << ( mErrors.testBit( row ) ? QVariant() : value( result, row ) );
+  }
+
+  mExpression->setEvalErrorString( mError );
+  mFeatures = nullptr;
+  return values;
+}
+
+void QgsExpressionBatchEvaluator::evaluateNode( QgsExpressionNode *node, Column &result )
+{
+  if ( node->hasCachedStaticValue() )
+  {
+    setValues( QVector<QVariant>( mRowCount, node->cachedStaticValue() ), result );
+    return;
+  }
+
+  bool evaluated = false;
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntLiteral:
+      setValues( QVector<QVariant>( mRowCount, static_cast< QgsExpressionNodeLiteral * >( node )->value() ), result );
+      evaluated = true;
+      break;
+
+    case QgsExpressionNode::ntColumnRef:
+    {
+      const int index = mFields.lookupField( static_cast< QgsExpressionNodeColumnRef * >( node )->name() );
+      if ( index >= 0 )
+      {
+        QVector<QVariant> values;
+        values.reserve( mRowCount );
+        for ( const QgsFeature &feature : *mFeatures )
+        {
+          values << feature.attribute( index );
+        }
+        setValues( values, result );
+        evaluated = true;
+      }
+      break;
+    }
+
+    case QgsExpressionNode::ntUnaryOperator:
+      evaluated = evaluateUnaryOperator( static_cast< QgsExpressionNodeUnaryOperator * >( node ), result );
+      break;
+
+    case QgsExpressionNode::ntBinaryOperator:
+      evaluated = evaluateBinaryOperator( static_cast< QgsExpressionNodeBinaryOperator * >( node ), result );
+      break;
+
+    case QgsExpressionNode::ntInOperator:
+      evaluated = evaluateInOperator( static_cast< QgsExpressionNodeInOperator * >( node ), result );
+      break;
+
+    case QgsExpressionNode::ntFunction:
+      evaluated = evaluateFunction( static_cast< QgsExpressionNodeFunction * >( node ), result );
+      break;
+
+    case QgsExpressionNode::ntCondition:
+      // branches are only evaluated for the features matching their condition
+      break;
+  }
+
+  if ( !evaluated )
+    evaluateRows( node, result );
+}
+
+void QgsExpressionBatchEvaluator::evaluateRows( QgsExpressionNode *node, Column &result )
+{
+  QVector<QVariant> values( mRowCount );
+  for ( int row = 0; row < mRowCount; ++row )
+  {
+    // the result is NULL anyway
+    if ( mErrors.testBit( row ) )
+      continue;
+
+    mContext->setFeature( mFeatures->at( row ) );
+    mExpression->setEvalErrorString( QString() );
+    const QVariant v = node->eval( mExpression, mContext );
+    if ( mExpression->hasEvalError() )
+    {
+      mErrors.setBit( row );
+      if ( mErrorRow < 0 || row < mErrorRow )
+      {
+        mErrorRow = row;
+        mError = mExpression->evalErrorString();
+      }
+      continue;
+    }
+    values[row] = v;
+  }
+  setValues( values, result );
+}
+
+bool QgsExpressionBatchEvaluator::evaluateUnaryOperator( const QgsExpressionNodeUnaryOperator *node, Column &result )
+{
+  Column operand;
+  evaluateNode( node->operand(), operand );
+  if ( !isNumeric( operand ) )
+    return false;
+
+  switch ( node->op() )
+  {
+    case QgsExpressionNodeUnaryOperator::uoNot:
+      initColumn( result, Int );
+      result.intType = QVariant::Int;
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( operand.nulls.testBit( row ) )
+          result.nulls.setBit( row );
+        else
+          result.ints[row] = isTrue( operand, row ) ? 0 : 1;
+      }
+      return true;
+
+    case QgsExpressionNodeUnaryOperator::uoMinus:
+      // NULL values are converted depending on their type, leave them to the feature by feature evaluation
+      if ( operand.nulls.count( true ) > 0 || !isFinite( operand ) )
+        return false;
+
+      if ( operand.storage == Int )
+      {
+        initColumn( result, Int );
+        for ( int row = 0; row < mRowCount; ++row )
+          result.ints[row] = -operand.ints.at( row );
+      }
+      else
+      {
+        initColumn( result, Double );
+        for ( int row = 0; row < mRowCount; ++row )
+          result.doubles[row] = -operand.doubles.at( row );
+      }
+      return true;
+  }
+  return false;
+}
+
+bool QgsExpressionBatchEvaluator::evaluateBinaryOperator( const QgsExpressionNodeBinaryOperator *node, Column &result )
+{
+  const QgsExpressionNodeBinaryOperator::BinaryOperator op = node->op();
+
+  // patterns are only compiled once, which requires a static right operand
+  QVariant pattern;
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boRegexp:
+    case QgsExpressionNodeBinaryOperator::boLike:
+    case QgsExpressionNodeBinaryOperator::boNotLike:
+    case QgsExpressionNodeBinaryOperator::boILike:
+    case QgsExpressionNodeBinaryOperator::boNotILike:
+      if ( !staticValue( node->opRight(), pattern ) )
+        return false;
+      break;
+
+    default:
+      break;
+  }
+
+  Column left;
+  evaluateNode( node->opLeft(), left );
+  Column right;
+  evaluateNode( node->opRight(), right );
+
+  switch ( op )
+  {
+    case QgsExpressionNodeBinaryOperator::boPlus:
+      // string concatenation, which also applies to NULL strings, is left to the feature by feature evaluation
+      if ( left.storage == String || right.storage == String || hasStringNulls( left ) || hasStringNulls( right ) )
+        return false;
+      FALLTHROUGH;
+    case QgsExpressionNodeBinaryOperator::boMinus:
+    case QgsExpressionNodeBinaryOperator::boMul:
+    case QgsExpressionNodeBinaryOperator::boDiv:
+    case QgsExpressionNodeBinaryOperator::boMod:
+    {
+      if ( !isNumeric( left ) || !isNumeric( right ) )
+        return false;
+
+      if ( op != QgsExpressionNodeBinaryOperator::boDiv && left.storage != Double && right.storage != Double )
+      {
+        // both are integers - let's use integer arithmetics
+        initColumn( result, Int );
+        for ( int row = 0; row < mRowCount; ++row )
+        {
+          if ( left.nulls.testBit( row ) || right.nulls.testBit( row ) )
+          {
+            result.nulls.setBit( row );
+            continue;
+          }
+
+          const qlonglong l = left.ints.at( row );
+          const qlonglong r = right.ints.at( row );
+          switch ( op )
+          {
+            case QgsExpressionNodeBinaryOperator::boPlus:
+              result.ints[row] = l + r;
+              break;
+            case QgsExpressionNodeBinaryOperator::boMinus:
+              result.ints[row] = l - r;
+              break;
+            case QgsExpressionNodeBinaryOperator::boMul:
+              result.ints[row] = l * r;
+              break;
+            default:
+              if ( r == 0 )
+                result.nulls.setBit( row );
+              else
+                result.ints[row] = l % r;
+              break;
+          }
+        }
+        return true;
+      }
+
+      if ( !isFinite( left ) || !isFinite( right ) )
+        return false;
+
+      initColumn( result, Double );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( left.nulls.testBit( row ) || right.nulls.testBit( row ) )
+        {
+          result.nulls.setBit( row );
+          continue;
+        }
+
+        const double l = doubleValue( left, row );
+        const double r = doubleValue( right, row );
+        switch ( op )
+        {
+          case QgsExpressionNodeBinaryOperator::boPlus:
+            result.doubles[row] = l + r;
+            break;
+          case QgsExpressionNodeBinaryOperator::boMinus:
+            result.doubles[row] = l - r;
+            break;
+          case QgsExpressionNodeBinaryOperator::boMul:
+            result.doubles[row] = l * r;
+            break;
+          case QgsExpressionNodeBinaryOperator::boDiv:
+            if ( r == 0. )
+              result.nulls.setBit( row );
+            else
+              result.doubles[row] = l / r;
+            break;
+          default:
+            if ( r == 0. )
+              result.nulls.setBit( row );
+            else
+              result.doubles[row] = std::fmod( l, r );
+            break;
+        }
+      }
+      return true;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boIntDiv:
+      // NULL values are converted depending on their type, leave them to the feature by feature evaluation
+      if ( !isNumeric( left ) || !isNumeric( right ) || !isFinite( left ) || !isFinite( right )
+           || left.nulls.count( true ) > 0 || right.nulls.count( true ) > 0 )
+        return false;
+
+      initColumn( result, Int );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        const double r = doubleValue( right, row );
+        if ( r == 0. )
+          result.nulls.setBit( row );
+        else
+          result.ints[row] = qlonglong( std::floor( doubleValue( left, row ) / r ) );
+      }
+      return true;
+
+    case QgsExpressionNodeBinaryOperator::boPow:
+      if ( !isNumeric( left ) || !isNumeric( right ) || !isFinite( left ) || !isFinite( right ) )
+        return false;
+
+      initColumn( result, Double );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( left.nulls.testBit( row ) || right.nulls.testBit( row ) )
+          result.nulls.setBit( row );
+        else
+          result.doubles[row] = std::pow( doubleValue( left, row ), doubleValue( right, row ) );
+      }
+      return true;
+
+    case QgsExpressionNodeBinaryOperator::boAnd:
+    case QgsExpressionNodeBinaryOperator::boOr:
+      if ( !isNumeric( left ) || !isNumeric( right ) )
+        return false;
+
+      initColumn( result, Int );
+      result.intType = QVariant::Int;
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        const QgsExpressionUtils::TVL tvlL = left.nulls.testBit( row ) ? QgsExpressionUtils::Unknown : isTrue( left, row ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+        const QgsExpressionUtils::TVL tvlR = right.nulls.testBit( row ) ? QgsExpressionUtils::Unknown : isTrue( right, row ) ? QgsExpressionUtils::True : QgsExpressionUtils::False;
+        const QgsExpressionUtils::TVL tvl = op == QgsExpressionNodeBinaryOperator::boAnd ? QgsExpressionUtils::AND[tvlL][tvlR] : QgsExpressionUtils::OR[tvlL][tvlR];
+        if ( tvl == QgsExpressionUtils::Unknown )
+          result.nulls.setBit( row );
+        else
+          result.ints[row] = tvl == QgsExpressionUtils::True ? 1 : 0;
+      }
+      return true;
+
+    case QgsExpressionNodeBinaryOperator::boEQ:
+    case QgsExpressionNodeBinaryOperator::boNE:
+    case QgsExpressionNodeBinaryOperator::boLT:
+    case QgsExpressionNodeBinaryOperator::boGT:
+    case QgsExpressionNodeBinaryOperator::boLE:
+    case QgsExpressionNodeBinaryOperator::boGE:
+    case QgsExpressionNodeBinaryOperator::boIs:
+    case QgsExpressionNodeBinaryOperator::boIsNot:
+    {
+      // numbers are compared as numbers and strings as strings, other combinations depend on the values
+      const bool numeric = isNumeric( left ) && isNumeric( right );
+      if ( numeric ? !isFinite( left ) || !isFinite( right ) : !isString( left ) || !isString( right ) )
+        return false;
+
+      const bool isOperator = op == QgsExpressionNodeBinaryOperator::boIs || op == QgsExpressionNodeBinaryOperator::boIsNot;
+      initColumn( result, Int );
+      result.intType = QVariant::Int;
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        const bool nullL = left.nulls.testBit( row );
+        const bool nullR = right.nulls.testBit( row );
+        bool match;
+        if ( nullL || nullR )
+        {
+          if ( !isOperator )
+          {
+            result.nulls.setBit( row );
+            continue;
+          }
+          match = nullL && nullR;
+        }
+        else if ( isOperator )
+        {
+          match = numeric ? qgsDoubleNear( doubleValue( left, row ), doubleValue( right, row ) )
+                  : QString::compare( left.strings.at( row ), right.strings.at( row ) ) == 0;
+        }
+        else
+        {
+          match = numeric ? compareDiff( op, doubleValue( left, row ) - doubleValue( right, row ) )
+                  : compareDiff( op, QString::compare( left.strings.at( row ), right.strings.at( row ) ) );
+        }
+
+        if ( op == QgsExpressionNodeBinaryOperator::boIsNot )
+          match = !match;
+        result.ints[row] = match ? 1 : 0;
+      }
+      return true;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boRegexp:
+    case QgsExpressionNodeBinaryOperator::boLike:
+    case QgsExpressionNodeBinaryOperator::boNotLike:
+    case QgsExpressionNodeBinaryOperator::boILike:
+    case QgsExpressionNodeBinaryOperator::boNotILike:
+    {
+      initColumn( result, Int );
+      result.intType = QVariant::Int;
+      if ( pattern.isNull() )
+      {
+        result.nulls.fill( true );
+        return true;
+      }
+
+      const QString patternString = pattern.toString();
+      QRegExp rx = op == QgsExpressionNodeBinaryOperator::boRegexp ? QRegExp( patternString )
+                   : QRegExp( QgsExpressionUtils::likePatternToRegExp( patternString ),
+                              op == QgsExpressionNodeBinaryOperator::boLike || op == QgsExpressionNodeBinaryOperator::boNotLike ? Qt::CaseSensitive : Qt::CaseInsensitive );
+      const bool negate = op == QgsExpressionNodeBinaryOperator::boNotLike || op == QgsExpressionNodeBinaryOperator::boNotILike;
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( left.nulls.testBit( row ) )
+        {
+          result.nulls.setBit( row );
+          continue;
+        }
+
+        const QString str = stringValue( left, row );
+        bool matches = op == QgsExpressionNodeBinaryOperator::boRegexp ? rx.indexIn( str ) != -1 : rx.exactMatch( str );
+        result.ints[row] = matches != negate ? 1 : 0;
+      }
+      return true;
+    }
+
+    case QgsExpressionNodeBinaryOperator::boConcat:
+      initColumn( result, String );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( left.nulls.testBit( row ) || right.nulls.testBit( row ) )
+          result.nulls.setBit( row );
+        else
+          result.strings[row] = stringValue( left, row ) + stringValue( right, row );
+      }
+      return true;
+  }
+  return false;
+}
+
+bool QgsExpressionBatchEvaluator::evaluateInOperator( const QgsExpressionNodeInOperator *node, Column &result )
+{
+  const QList< QgsExpressionNode * > nodeList = node->list()->list();
+  initColumn( result, Int );
+  result.intType = QVariant::Int;
+  if ( nodeList.isEmpty() )
+  {
+    result.ints.fill( node->isNotIn() ? 1 : 0 );
+    return true;
+  }
+
+  QVariantList items;
+  for ( const QgsExpressionNode *n : nodeList )
+  {
+    QVariant item;
+    if ( !staticValue( n, item ) )
+      return false;
+    items << item;
+  }
+
+  Column v;
+  evaluateNode( node->node(), v );
+
+  // values are compared as numbers when both can be converted to numbers, as strings otherwise
+  bool listHasNull = false;
+  QVector<double> numbers;
+  QSet<QString> strings;
+  if ( isNumeric( v ) )
+  {
+    if ( !isFinite( v ) )
+      return false;
+
+    for ( const QVariant &item : qgsAsConst( items ) )
+    {
+      if ( item.isNull() )
+        listHasNull = true;
+      // numbers are never equal to strings which cannot be converted to numbers
+      else if ( QgsExpressionUtils::isDoubleSafe( item ) )
+        numbers << item.toDouble();
+    }
+  }
+  else if ( v.storage == String )
+  {
+    for ( const QVariant &item : qgsAsConst( items ) )
+    {
+      if ( item.isNull() )
+        listHasNull = true;
+      else if ( QgsExpressionUtils::isDoubleSafe( item ) )
+        return false;
+      else
+        strings << item.toString();
+    }
+  }
+  else
+  {
+    return false;
+  }
+
+  for ( int row = 0; row < mRowCount; ++row )
+  {
+    if ( v.nulls.testBit( row ) )
+    {
+      result.nulls.setBit( row );
+      continue;
+    }
+
+    bool found = false;
+    if ( v.storage == String )
+    {
+      found = strings.contains( v.strings.at( row ) );
+    }
+    else
+    {
+      const double x = doubleValue( v, row );
+      for ( double number : qgsAsConst( numbers ) )
+      {
+        if ( qgsDoubleNear( x, number ) )
+        {
+          found = true;
+          break;
+        }
+      }
+    }
+
+    if ( found )
+      result.ints[row] = node->isNotIn() ? 0 : 1;
+    else if ( listHasNull )
+      result.nulls.setBit( row );
+    else
+      result.ints[row] = node->isNotIn() ? 1 : 0;
+  }
+  return true;
+}
+
+bool QgsExpressionBatchEvaluator::evaluateFunction( const QgsExpressionNodeFunction *node, Column &result )
+{
+  const QString name = QgsExpression::Functions().at( node->fnIndex() )->name();
+  if ( mContext->hasFunction( name ) )
+    return false;
+
+  const QList< QgsExpressionNode * > args = node->args() ? node->args()->list() : QList< QgsExpressionNode * >();
+  if ( args.isEmpty() )
+    return false;
+
+  if ( name == QLatin1String( "coalesce" ) )
+  {
+    QVector<Column> columns( args.count() );
+    for ( int i = 0; i < args.count(); ++i )
+      evaluateNode( args.at( i ), columns[i] );
+
+    QVector<QVariant> values( mRowCount );
+    for ( int row = 0; row < mRowCount; ++row )
+    {
+      for ( const Column &column : qgsAsConst( columns ) )
+      {
+        if ( !column.nulls.testBit( row ) )
+        {
+          values[row] = value( column, row );
+          break;
+        }
+      }
+    }
+    setValues( values, result );
+    return true;
+  }
+
+  // functions return NULL when their arguments are NULL
+  double ( *mathFunction )( double ) = nullptr;
+  if ( name == QLatin1String( "abs" ) )
+    mathFunction = []( double x ) { return std::fabs( x ); };
+  else if ( name == QLatin1String( "sqrt" ) )
+    mathFunction = []( double x ) { return std::sqrt( x ); };
+  else if ( name == QLatin1String( "floor" ) )
+    mathFunction = []( double x ) { return std::floor( x ); };
+  else if ( name == QLatin1String( "ceil" ) )
+    mathFunction = []( double x ) { return std::ceil( x ); };
+  else if ( name == QLatin1String( "to_real" ) )
+    mathFunction = []( double x ) { return x; };
+
+  if ( mathFunction )
+  {
+    Column arg;
+    evaluateNode( args.at( 0 ), arg );
+    if ( !isNumeric( arg ) || !isFinite( arg ) )
+      return false;
+
+    initColumn( result, Double );
+    for ( int row = 0; row < mRowCount; ++row )
+    {
+      if ( arg.nulls.testBit( row ) )
+        result.nulls.setBit( row );
+      else
+        result.doubles[row] = mathFunction( doubleValue( arg, row ) );
+    }
+    return true;
+  }
+  else if ( name == QLatin1String( "to_int" ) || name == QLatin1String( "round" ) )
+  {
+    double scaler = 1;
+    if ( name == QLatin1String( "round" ) && args.count() > 1 )
+    {
+      QVariant places;
+      if ( !staticValue( args.at( 1 ), places ) )
+        return false;
+
+      if ( places.isNull() )
+      {
+        initColumn( result, Null );
+        result.nulls.fill( true );
+        return true;
+      }
+      else if ( places.toInt() != 0 )
+      {
+        bool ok;
+        const qlonglong exponent = places.toLongLong( &ok );
+        if ( !ok )
+          return false;
+        scaler = std::pow( 10.0, exponent );
+      }
+    }
+
+    Column arg;
+    evaluateNode( args.at( 0 ), arg );
+    if ( !isNumeric( arg ) )
+      return false;
+
+    if ( scaler != 1 )
+    {
+      // rounding to decimal places
+      if ( !isFinite( arg ) )
+        return false;
+
+      initColumn( result, Double );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( arg.nulls.testBit( row ) )
+          result.nulls.setBit( row );
+        else
+          result.doubles[row] = std::round( doubleValue( arg, row ) * scaler ) / scaler;
+      }
+      return true;
+    }
+
+    // doubles are converted to integers the way QVariant does
+    const bool round = name == QLatin1String( "round" );
+    initColumn( result, Int );
+    for ( int row = 0; row < mRowCount; ++row )
+    {
+      if ( arg.nulls.testBit( row ) )
+      {
+        result.nulls.setBit( row );
+      }
+      else
+      {
+        bool ok = true;
+        const qlonglong number = arg.storage == Int ? arg.ints.at( row ) : QVariant( arg.doubles.at( row ) ).toLongLong( &ok );
+        if ( !ok )
+          return false;
+        result.ints[row] = round ? qlonglong( std::round( static_cast< double >( number ) ) ) : number;
+      }
+    }
+    return true;
+  }
+  else if ( name == QLatin1String( "upper" ) || name == QLatin1String( "lower" ) || name == QLatin1String( "length" ) )
+  {
+    Column arg;
+    evaluateNode( args.at( 0 ), arg );
+    // length() of other values may be the length of geometries
+    if ( !isString( arg ) )
+      return false;
+
+    const bool length = name == QLatin1String( "length" );
+    const bool upper = name == QLatin1String( "upper" );
+    initColumn( result, length ? Int : String );
+    result.intType = QVariant::Int;
+    for ( int row = 0; row < mRowCount; ++row )
+    {
+      if ( arg.nulls.testBit( row ) )
+        result.nulls.setBit( row );
+      else if ( length )
+        result.ints[row] = arg.strings.at( row ).length();
+      else
+        result.strings[row] = upper ? arg.strings.at( row ).toUpper() : arg.strings.at( row ).toLower();
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void QgsExpressionBatchEvaluator::setValues( const QVector<QVariant> &values, Column &column ) const
+{
+  column = Column();
+  column.nulls = QBitArray( mRowCount );
+  column.variants = values;
+
+  Storage storage = Null;
+  for ( int row = 0; row < mRowCount; ++row )
+  {
+    const QVariant &v = values.at( row );
+    if ( v.isNull() )
+    {
+      column.nulls.setBit( row );
+      continue;
+    }
+
+    Storage valueStorage = Variant;
+    switch ( v.type() )
+    {
+      case QVariant::Int:
+      case QVariant::LongLong:
+        valueStorage = Int;
+        break;
+      case QVariant::Double:
+        valueStorage = Double;
+        break;
+      case QVariant::String:
+        valueStorage = String;
+        break;
+      default:
+        break;
+    }
+
+    if ( storage == Null )
+      storage = valueStorage;
+    else if ( storage != valueStorage )
+      storage = Variant;
+  }
+
+  column.storage = storage;
+  switch ( storage )
+  {
+    case Int:
+      column.ints.resize( mRowCount );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( !column.nulls.testBit( row ) )
+          column.ints[row] = values.at( row ).toLongLong();
+      }
+      break;
+
+    case Double:
+      column.doubles.resize( mRowCount );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( !column.nulls.testBit( row ) )
+          column.doubles[row] = values.at( row ).toDouble();
+      }
+      break;
+
+    case String:
+      column.strings.resize( mRowCount );
+      for ( int row = 0; row < mRowCount; ++row )
+      {
+        if ( !column.nulls.testBit( row ) )
+          column.strings[row] = values.at( row ).toString();
+      }
+      break;
+
+    case Null:
+    case Variant:
+      break;
+  }
+}
+
+void QgsExpressionBatchEvaluator::initColumn( Column &column, Storage storage ) const
+{
+  column = Column();
+  column.storage = storage;
+  column.nulls = QBitArray( mRowCount );
+  switch ( storage )
+  {
+    case Int:
+      column.ints.resize( mRowCount );
+      break;
+    case Double:
+      column.doubles.resize( mRowCount );
+      break;
+    case String:
+      column.strings.resize( mRowCount );
+      break;
+    case Variant:
+      column.variants.resize( mRowCount );
+      break;
+    case Null:
+      break;
+  }
+}
+
+QVariant QgsExpressionBatchEvaluator::value( const Column &column, int row ) const
+{
+  if ( !column.variants.isEmpty() )
+    return column.variants.at( row );
+  if ( column.nulls.testBit( row ) )
+    return QVariant();
+
+  switch ( column.storage )
+  {
+    case Int:
+      return column.intType == QVariant::Int ? QVariant( static_cast< int >( column.ints.at( row ) ) ) : QVariant( column.ints.at( row ) );
+    case Double:
+      return QVariant( column.doubles.at( row ) );
+    case String:
+      return QVariant( column.strings.at( row ) );
+    case Null:
+    case Variant:
+      break;
+  }
+  return QVariant();
+}
+
+QString QgsExpressionBatchEvaluator::stringValue( const Column &column, int row ) const
+{
+  if ( column.storage == String )
+    return column.strings.at( row );
+  return value( column, row ).toString();
+}
+
+bool QgsExpressionBatchEvaluator::isFinite( const Column &column )
+{
+  if ( column.storage != Double )
+    return true;
+
+  for ( int row = 0; row < column.doubles.count(); ++row )
+  {
+    if ( !column.nulls.testBit( row ) && !std::isfinite( column.doubles.at( row ) ) )
+      return false;
+  }
+  return true;
+}
+
+bool QgsExpressionBatchEvaluator::hasStringNulls( const Column &column )
+{
+  for ( int row = 0; row < column.variants.count(); ++row )
+  {
+    if ( column.nulls.testBit( row ) && column.variants.at( row ).type() == QVariant::String )
+      return true;
+  }
+  return false;
+}
+
+bool QgsExpressionBatchEvaluator::isTrue( const Column &column, int row )
+{
+  if ( column.storage == Int )
+    return column.ints.at( row ) != 0;
+  return !qgsDoubleNear( column.doubles.at( row ), 0.0 );
+}
+
+///@endcond PRIVATE
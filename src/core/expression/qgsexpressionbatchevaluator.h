@@ -0,0 +1,128 @@
+/***************************************************************************
+                               qgsexpressionbatchevaluator.h
+                             -------------------
+    begin                : October 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONBATCHEVALUATOR_H
+#define QGSEXPRESSIONBATCHEVALUATOR_H
+
+#define SIP_NO_FILE
+
+#include "qgsfeature.h"
+#include "qgsfields.h"
+
+#include <QBitArray>
+#include <QVector>
+
+///@cond PRIVATE
+
+class QgsExpression;
+class QgsExpressionContext;
+class QgsExpressionNode;
+class QgsExpressionNodeUnaryOperator;
+class QgsExpressionNodeBinaryOperator;
+class QgsExpressionNodeInOperator;
+class QgsExpressionNodeFunction;
+
+/**
+ * Evaluates an expression for a block of features, see QgsExpression::evaluateBatch().
+ *
+ * Each node is evaluated to a column holding its values for all the features. Column
+ * references, literals, operators, IN lists and a few common functions are computed
+ * over typed arrays of values. Other nodes, and nodes whose operands are not of a type
+ * supported by the typed implementation, are evaluated feature by feature with
+ * QgsExpressionNode::eval(). Both paths return the same values.
+ */
+class QgsExpressionBatchEvaluator
+{
+  public:
+
+    /**
+     * Constructor for QgsExpressionBatchEvaluator. The feature of the \a context is
+     * changed while evaluating nodes feature by feature.
+     */
+    QgsExpressionBatchEvaluator( QgsExpression *expression, QgsExpressionContext *context );
+
+    /**
+     * Evaluates the \a node of the expression for all \a features. The results of features
+     * for which the evaluation failed are NULL, and the expression's error is set to the
+     * error of the first of these features.
+     */
+    QVariantList evaluate( QgsExpressionNode *node, const QgsFeatureList &features );
+
+  private:
+
+    enum Storage
+    {
+      Null, //!< All values are NULL
+      Int,
+      Double,
+      String,
+      Variant, //!< Mixed or unsupported types, only stored as QVariant
+    };
+
+    struct Column
+    {
+      Storage storage = Null;
+      //! Set bits are NULL values
+      QBitArray nulls;
+      QVector<qlonglong> ints;
+      //! Type of the QVariant values of Int columns
+      QVariant::Type intType = QVariant::LongLong;
+      QVector<double> doubles;
+      QVector<QString> strings;
+      //! Values of Variant columns, or the original values of other columns when known
+      QVector<QVariant> variants;
+    };
+
+    void evaluateNode( QgsExpressionNode *node, Column &result );
+    //! Evaluates \a node feature by feature
+    void evaluateRows( QgsExpressionNode *node, Column &result );
+    bool evaluateUnaryOperator( const QgsExpressionNodeUnaryOperator *node, Column &result );
+    bool evaluateBinaryOperator( const QgsExpressionNodeBinaryOperator *node, Column &result );
+    bool evaluateInOperator( const QgsExpressionNodeInOperator *node, Column &result );
+    bool evaluateFunction( const QgsExpressionNodeFunction *node, Column &result );
+
+    //! Stores \a values in \a column, using typed arrays if all values have the same type
+    void setValues( const QVector<QVariant> &values, Column &column ) const;
+    //! Resets \a column to an empty column of the given \a storage, with no NULL values
+    void initColumn( Column &column, Storage storage ) const;
+    QVariant value( const Column &column, int row ) const;
+    QString stringValue( const Column &column, int row ) const;
+
+    //! Returns true if \a column only contains numbers or NULL values
+    static bool isNumeric( const Column &column ) { return column.storage == Int || column.storage == Double || column.storage == Null; }
+    //! Returns true if \a column only contains strings or NULL values
+    static bool isString( const Column &column ) { return column.storage == String || column.storage == Null; }
+    //! Returns false if a double value of \a column is infinite or NaN, which cannot be used in arithmetic
+    static bool isFinite( const Column &column );
+    //! Returns true if \a column contains NULL values of string type, which are concatenated by the + operator
+    static bool hasStringNulls( const Column &column );
+    static double doubleValue( const Column &column, int row ) { return column.storage == Int ? column.ints.at( row ) : column.doubles.at( row ); }
+    //! Returns the truth of the non NULL value of a numeric \a column in a \a row
+    static bool isTrue( const Column &column, int row );
+
+    QgsExpression *mExpression = nullptr;
+    QgsExpressionContext *mContext = nullptr;
+    QgsFields mFields;
+    const QgsFeatureList *mFeatures = nullptr;
+    int mRowCount = 0;
+    //! Rows for which the evaluation of a node failed
+    QBitArray mErrors;
+    //! First row for which the evaluation failed, and its error
+    int mErrorRow = -1;
+    QString mError;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSEXPRESSIONBATCHEVALUATOR_H
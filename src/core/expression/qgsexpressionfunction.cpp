@@ -449,6 +449,120 @@ static QVariant fcnMin( const QVariantList &values, const QgsExpressionContext *
   return QVariant( minVal );
 }
 
+// Number of groups aggregated individually (e.g. the related features of a few parent features)
+// before an aggregate is calculated for all the groups with a single iteration over the layer
+static const int GROUPED_AGGREGATE_THRESHOLD = 5;
+
+/**
+ * Calculates an aggregate for the group of features having the \a groupValues values for the
+ * \a groupBy fields or expressions. Once a few groups have been requested in the same evaluation
+ * context, the aggregate is calculated for all the groups at once and cached in the context,
+ * so that evaluating an aggregate for every feature of a layer does not run one query per feature.
+ * \returns false if the aggregate has to be calculated for this group only
+ */
+static bool groupedAggregate( QgsVectorLayer *layer, QgsAggregateCalculator::Aggregate aggregate, const QString &subExpression,
+                              const QgsAggregateCalculator::AggregateParameters &parameters, const QStringList &groupBy,
+                              const QVariantList &groupValues, const QgsExpressionContext *context, QVariant &result )
+{
+  const QString cacheKey = QStringLiteral( "groupedagg:%1:%2:%3:%4:%5:%6" ).arg( layer->id(),
+                           QString::number( static_cast< int >( aggregate ) ),
+                           subExpression,
+                           groupBy.join( QStringLiteral( " AND " ) ),
+                           parameters.filter,
+                           parameters.delimiter );
+  if ( !context->hasCachedValue( cacheKey ) )
+  {
+    const QString countCacheKey = cacheKey + QStringLiteral( ":count" );
+    const int count = context->cachedValue( countCacheKey ).toInt() + 1;
+    if ( count < GROUPED_AGGREGATE_THRESHOLD )
+    {
+      context->setCachedValue( countCacheKey, count );
+      return false;
+    }
+
+    QgsAggregateCalculator calculator( layer );
+    calculator.setParameters( parameters );
+    QgsExpressionContext subContext( *context );
+    bool ok = false;
+    QVariantMap results = calculator.calculateGrouped( aggregate, subExpression, groupBy, &subContext, &ok );
+    // the value of groups without features is stored with an empty key, which no group can have
+    results.insert( QString(), calculator.emptyAggregate( aggregate, subExpression ) );
+    // an invalid value means that the aggregate cannot be calculated by group
+    context->setCachedValue( cacheKey, ok ? QVariant( results ) : QVariant() );
+  }
+
+  const QVariant groupedResults = context->cachedValue( cacheKey );
+  if ( !groupedResults.isValid() )
+    return false;
+
+  const QVariantMap results = groupedResults.toMap();
+  auto it = results.constFind( QgsAggregateCalculator::groupKey( groupValues ) );
+  result = it != results.constEnd() ? it.value() : results.value( QString() );
+  return true;
+}
+
+// Returns the attribute name if node is attribute( @parent, 'name' ), or an empty string
+static QString parentAttributeName( const QgsExpressionNode *node )
+{
+  if ( node->nodeType() != QgsExpressionNode::ntFunction )
+    return QString();
+
+  const QgsExpressionNodeFunction *function = static_cast< const QgsExpressionNodeFunction * >( node );
+  if ( QgsExpression::Functions()[ function->fnIndex()]->name() != QLatin1String( "attribute" )
+       || !function->args() || function->args()->count() != 2 )
+    return QString();
+
+  QgsExpressionNode *featureNode = function->args()->at( 0 );
+  QgsExpressionNode *nameNode = function->args()->at( 1 );
+  if ( featureNode->nodeType() != QgsExpressionNode::ntFunction
+       || QgsExpression::Functions()[ static_cast< QgsExpressionNodeFunction * >( featureNode )->fnIndex()]->name() != QLatin1String( "var" )
+       || featureNode->referencedVariables() != QSet< QString >() << QStringLiteral( "parent" )
+       || nameNode->nodeType() != QgsExpressionNode::ntLiteral )
+    return QString();
+
+  return static_cast< QgsExpressionNodeLiteral * >( nameNode )->value().toString();
+}
+
+/**
+ * Splits a filter made of equalities between expressions on the aggregated features and attributes
+ * of the parent feature (e.g. "fk" = attribute( @parent, 'id' ) AND ...).
+ * \returns false if the filter has another form
+ */
+static bool parentEqualityFilter( const QgsExpressionNode *node, QStringList &childExpressions, QStringList &parentAttributes )
+{
+  if ( node->nodeType() != QgsExpressionNode::ntBinaryOperator )
+    return false;
+
+  const QgsExpressionNodeBinaryOperator *op = static_cast< const QgsExpressionNodeBinaryOperator * >( node );
+  if ( op->op() == QgsExpressionNodeBinaryOperator::boAnd )
+  {
+    return parentEqualityFilter( op->opLeft(), childExpressions, parentAttributes )
+           && parentEqualityFilter( op->opRight(), childExpressions, parentAttributes );
+  }
+  else if ( op->op() != QgsExpressionNodeBinaryOperator::boEQ )
+  {
+    return false;
+  }
+
+  QString parentAttribute = parentAttributeName( op->opRight() );
+  const QgsExpressionNode *childNode = op->opLeft();
+  if ( parentAttribute.isEmpty() )
+  {
+    parentAttribute = parentAttributeName( op->opLeft() );
+    childNode = op->opRight();
+  }
+  if ( parentAttribute.isEmpty() )
+    return false;
+
+  const QSet< QString > childVariables = childNode->referencedVariables();
+  if ( childVariables.contains( QStringLiteral( "parent" ) ) || childVariables.contains( QString() ) )
+    return false;
+
+  childExpressions << childNode->dump();
+  parentAttributes << parentAttribute;
+  return true;
+}
+
 static QVariant fcnAggregate( const QVariantList &values, const QgsExpressionContext *context, QgsExpression *parent, const QgsExpressionNodeFunction * )
 {
   //lazy eval, so we need to evaluate nodes now
@@ -526,6 +640,39 @@ static QVariant fcnAggregate( const QVariantList &values, const QgsExpressionCon
     if ( context && context->hasCachedValue( cacheKey ) )
       return context->cachedValue( cacheKey );
 
+    // filters matching attributes of the parent feature can be calculated for all the parent features at once
+    QStringList childExpressions;
+    QStringList parentAttributes;
+    const QSet< QString > subExpressionVariables = subExp.referencedVariables();
+    if ( !subExpressionVariables.contains( QStringLiteral( "parent" ) ) && !subExpressionVariables.contains( QString() )
+         && filterExp.rootNode() && parentEqualityFilter( filterExp.rootNode(), childExpressions, parentAttributes ) )
+    {
+      QVariantList parentValues;
+      bool hasNullValue = false;
+      for ( const QString &attribute : qgsAsConst( parentAttributes ) )
+      {
+        parentValues << context->feature().attribute( attribute );
+        hasNullValue = hasNullValue || parentValues.last().isNull();
+      }
+
+      QgsAggregateCalculator::AggregateParameters groupedParameters = parameters;
+      groupedParameters.filter.clear();
+      // NULL values are never equal, so that no feature matches the filter
+      if ( hasNullValue )
+      {
+        QgsAggregateCalculator calculator( vl );
+        calculator.setParameters( groupedParameters );
+        result = calculator.emptyAggregate( aggregate, subExpression );
+        context->setCachedValue( cacheKey, result );
+        return result;
+      }
+      else if ( groupedAggregate( vl, aggregate, subExpression, groupedParameters, childExpressions, parentValues, context, result ) )
+      {
+        context->setCachedValue( cacheKey, result );
+        return result;
+      }
+    }
+
     QgsExpressionContext subContext( *context );
     QgsExpressionContextScope *subScope = new QgsExpressionContextScope();
     subScope->setVariable( QStringLiteral( "parent" ), context->feature() );
@@ -630,9 +777,25 @@ static QVariant fcnAggregateRelation( const QVariantList &values, const QgsExpre
     return context->cachedValue( cacheKey );
 
   QVariant result;
-  ok = false;
 
+  // the aggregate can be calculated for all the parent features at once, grouping the child features by referencing fields
+  QStringList referencingFields;
+  QVariantList referencedValues;
+  const QList< QgsRelation::FieldPair > fieldPairs = relation.fieldPairs();
+  for ( const QgsRelation::FieldPair &fieldPair : fieldPairs )
+  {
+    referencingFields << fieldPair.referencingField();
+    referencedValues << f.attribute( fieldPair.referencedField() );
+  }
+  QgsAggregateCalculator::AggregateParameters groupedParameters = parameters;
+  groupedParameters.filter.clear();
+  if ( groupedAggregate( childLayer, aggregate, subExpression, groupedParameters, referencingFields, referencedValues, context, result ) )
+  {
+    context->setCachedValue( cacheKey, result );
+    return result;
+  }
 
+  ok = false;
   QgsExpressionContext subContext( *context );
   result = childLayer->aggregate( aggregate, subExpression, parameters, &subContext, &ok );
 
@@ -696,10 +859,12 @@ static QVariant fcnAggregateGeneric( QgsAggregateCalculator::Aggregate aggregate
   // build up filter with group by
 
   // find current group by value
+  QVariant groupByValue;
+  const QgsAggregateCalculator::AggregateParameters groupedParameters = parameters;
   if ( !groupBy.isEmpty() )
   {
     QgsExpression groupByExp( groupBy );
-    QVariant groupByValue = groupByExp.evaluate( context );
+    groupByValue = groupByExp.evaluate( context );
     QString groupByClause = QStringLiteral( "%1 %2 %3" ).arg( groupBy,
                             groupByValue.isNull() ? QStringLiteral( "is" ) : QStringLiteral( "=" ),
                             QgsExpression::quotedValue( groupByValue ) );
@@ -717,8 +882,16 @@ static QVariant fcnAggregateGeneric( QgsAggregateCalculator::Aggregate aggregate
     return context->cachedValue( cacheKey );
 
   QVariant result;
-  bool ok = false;
 
+  // the aggregate can be calculated for all the groups at once
+  if ( !groupBy.isEmpty()
+       && groupedAggregate( vl, aggregate, subExpression, groupedParameters, QStringList() << groupBy, QVariantList() << groupByValue, context, result ) )
+  {
+    context->setCachedValue( cacheKey, result );
+    return result;
+  }
+
+  bool ok = false;
   QgsExpressionContext subContext( *context );
   result = vl->aggregate( aggregate, subExpression, parameters, &subContext, &ok );
 
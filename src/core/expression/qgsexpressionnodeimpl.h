@@ -69,10 +69,15 @@ class CORE_EXPORT QgsExpressionNodeUnaryOperator : public QgsExpressionNode
     QString text() const;
 
   private:
+    //! Applies the operator to the value \a val of its operand
+    QVariant evalOperator( const QVariant &val, QgsExpression *parent );
+
     UnaryOperator mOp;
     QgsExpressionNode *mOperand = nullptr;
 
     static const char *UNARY_OPERATOR_TEXT[];
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -155,6 +160,8 @@ class CORE_EXPORT QgsExpressionNodeBinaryOperator : public QgsExpressionNode
     QString text() const;
 
   private:
+    //! Applies the operator to the values \a vL and \a vR of its operands
+    QVariant evalOperator( const QVariant &vL, const QVariant &vR, QgsExpression *parent, const QgsExpressionContext *context );
     bool compare( double diff );
     qlonglong computeInt( qlonglong x, qlonglong y );
     double computeDouble( double x, double y );
@@ -171,6 +178,8 @@ class CORE_EXPORT QgsExpressionNodeBinaryOperator : public QgsExpressionNode
     QgsExpressionNode *mOpRight = nullptr;
 
     static const char *BINARY_OPERATOR_TEXT[];
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -341,6 +350,7 @@ class CORE_EXPORT QgsExpressionNodeCondition : public QgsExpressionNode
         QgsExpressionNode *mThenExp = nullptr;
 
         friend class QgsExpressionNodeCondition;
+        friend class QgsExpressionProgram;
     };
     typedef QList<QgsExpressionNodeCondition::WhenThen *> WhenThenList;
 
@@ -373,6 +383,8 @@ class CORE_EXPORT QgsExpressionNodeCondition : public QgsExpressionNode
   private:
     WhenThenList mConditions;
     QgsExpressionNode *mElseExp = nullptr;
+
+    friend class QgsExpressionProgram;
 };
 
 
@@ -0,0 +1,393 @@
+/***************************************************************************
+                               qgsexpressionprogram.cpp
+                             -------------------
+    begin                : October 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionprogram.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsexpressionfunction.h"
+#include "qgsexpressionnodeimpl.h"
+#include "qgsexpressionutils.h"
+#include "qgsfeature.h"
+
+#include <QMutexLocker>
+#include <QVarLengthArray>
+
+///@cond PRIVATE
+
+// Number of times the handle of a variable is replaced before falling back to lookups
+// by name, e.g. if the program runs alternately in contexts with different scopes
+static const size_t MAX_RETIRED_HANDLES = 16;
+
+QgsExpressionProgram::Variable::Variable( const QgsExpressionContext::VariableHandle &resolved )
+  : handle( new QgsExpressionContext::VariableHandle( resolved ) )
+{
+}
+
+QgsExpressionProgram::Variable::~Variable()
+{
+  delete handle.load();
+}
+
+QgsExpressionProgram::QgsExpressionProgram( QgsExpressionNode *root, const QgsExpressionContext *context )
+{
+  if ( context )
+    mFields = context->fields();
+
+  mContext = context;
+  compileNode( root, 0 );
+  mContext = nullptr;
+}
+
+int QgsExpressionProgram::addInstruction( Opcode opcode, int target, int a, int b, QgsExpressionNode *node )
+{
+  Instruction instruction;
+  instruction.opcode = opcode;
+  instruction.target = target;
+  instruction.a = a;
+  instruction.b = b;
+  instruction.node = node;
+  mInstructions << instruction;
+  return mInstructions.count() - 1;
+}
+
+int QgsExpressionProgram::addConstant( const QVariant &value )
+{
+  mConstants << value;
+  return mConstants.count() - 1;
+}
+
+bool QgsExpressionProgram::staticValue( QgsExpressionNode *node, QVariant &value )
+{
+  if ( node->hasCachedStaticValue() )
+  {
+    value = node->cachedStaticValue();
+    return true;
+  }
+  else if ( node->nodeType() == QgsExpressionNode::ntLiteral )
+  {
+    value = static_cast< QgsExpressionNodeLiteral * >( node )->value();
+    return true;
+  }
+  return false;
+}
+
+void QgsExpressionProgram::compileNode( QgsExpressionNode *node, int target )
+{
+  QVariant value;
+  if ( staticValue( node, value ) )
+  {
+    addInstruction( LoadConstant, target, addConstant( value ) );
+    return;
+  }
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntColumnRef:
+    {
+      const QString name = static_cast< QgsExpressionNodeColumnRef * >( node )->name();
+      int index = mFields.lookupField( name );
+      if ( index < 0 )
+        break; // the node looks for the field when evaluated
+
+      mNames << name;
+      addInstruction( LoadField, target, index, mNames.count() - 1 );
+      mUsesFeature = true;
+      return;
+    }
+
+    case QgsExpressionNode::ntUnaryOperator:
+    {
+      QgsExpressionNodeUnaryOperator *unaryNode = static_cast< QgsExpressionNodeUnaryOperator * >( node );
+      int operand = addRegister();
+      compileNode( unaryNode->mOperand, operand );
+      addInstruction( UnaryOperator, target, operand, 0, node );
+      return;
+    }
+
+    case QgsExpressionNode::ntBinaryOperator:
+    {
+      QgsExpressionNodeBinaryOperator *binaryNode = static_cast< QgsExpressionNodeBinaryOperator * >( node );
+      int left = addRegister();
+      int right = addRegister();
+      compileNode( binaryNode->mOpLeft, left );
+      compileNode( binaryNode->mOpRight, right );
+      addInstruction( BinaryOperator, target, left, right, node );
+      return;
+    }
+
+    case QgsExpressionNode::ntInOperator:
+    {
+      QgsExpressionNodeInOperator *inNode = static_cast< QgsExpressionNodeInOperator * >( node );
+      const QList< QgsExpressionNode * > nodeList = inNode->list()->list();
+      if ( nodeList.isEmpty() )
+        break;
+
+      // only lists of static values are compiled, as the items of other lists are evaluated one by one
+      QVariantList list;
+      bool isStatic = true;
+      for ( QgsExpressionNode *n : nodeList )
+      {
+        if ( !staticValue( n, value ) )
+        {
+          isStatic = false;
+          break;
+        }
+        list << value;
+      }
+      if ( !isStatic )
+        break;
+
+      int operand = addRegister();
+      compileNode( inNode->node(), operand );
+      mLists << list;
+      addInstruction( InList, target, operand, mLists.count() - 1, node );
+      return;
+    }
+
+    case QgsExpressionNode::ntFunction:
+    {
+      QgsExpressionNodeFunction *functionNode = static_cast< QgsExpressionNodeFunction * >( node );
+      QgsExpressionFunction *function = QgsExpression::Functions()[functionNode->fnIndex()];
+      // functions evaluating their arguments themselves, or overriding run(), are not compiled
+      if ( function->lazyEval() || !dynamic_cast< QgsStaticExpressionFunction * >( function ) )
+        break;
+
+      // a function of the context replaces the built-in function
+      mNames << function->name();
+      int contextFunction = addInstruction( ContextFunction, target, mNames.count() - 1, 0, node );
+
+      const QList< QgsExpressionNode * > args = functionNode->args() ? functionNode->args()->list() : QList< QgsExpressionNode * >();
+
+      // var() with a static name reads the variable through a handle
+      if ( mContext && function->name() == QLatin1String( "var" ) && args.count() == 1
+           && staticValue( args.at( 0 ), value ) && !QgsExpressionUtils::isNull( value ) )
+      {
+        mVariables.emplace_back( new Variable( mContext->resolveVariable( value.toString() ) ) );
+        addInstruction( LoadVariable, target, static_cast< int >( mVariables.size() ) - 1 );
+        mInstructions[contextFunction].b = mInstructions.count();
+        return;
+      }
+      const QgsExpressionFunction::ParameterList &parameters = function->parameters();
+      int firstArg = mRegisterCount;
+      mRegisterCount += args.count();
+
+      // like QgsExpressionFunction::run(), return NULL as soon as an argument is NULL
+      QList< int > nullChecks;
+      for ( int i = 0; i < args.count(); ++i )
+      {
+        compileNode( args.at( i ), firstArg + i );
+        bool defaultParamIsNull = parameters.count() > i && parameters.at( i ).optional() && !parameters.at( i ).defaultValue().isValid();
+        if ( !defaultParamIsNull && !function->handlesNull() )
+          nullChecks << addInstruction( NullArgument, target, firstArg + i );
+      }
+      addInstruction( CallFunction, target, firstArg, args.count(), node );
+
+      mInstructions[contextFunction].b = mInstructions.count();
+      for ( int instruction : qgsAsConst( nullChecks ) )
+        mInstructions[instruction].b = mInstructions.count();
+      return;
+    }
+
+    case QgsExpressionNode::ntCondition:
+    {
+      QgsExpressionNodeCondition *conditionNode = static_cast< QgsExpressionNodeCondition * >( node );
+      QList< int > jumpsToEnd;
+      for ( QgsExpressionNodeCondition::WhenThen *condition : qgsAsConst( conditionNode->mConditions ) )
+      {
+        int when = addRegister();
+        compileNode( condition->mWhenExp, when );
+        int test = addInstruction( JumpIfNotTrue, target, when );
+        compileNode( condition->mThenExp, target );
+        jumpsToEnd << addInstruction( Jump, target );
+        mInstructions[test].b = mInstructions.count();
+      }
+
+      if ( conditionNode->mElseExp )
+        compileNode( conditionNode->mElseExp, target );
+      else
+        addInstruction( LoadConstant, target, addConstant( QVariant() ) );
+
+      for ( int instruction : qgsAsConst( jumpsToEnd ) )
+        mInstructions[instruction].a = mInstructions.count();
+      return;
+    }
+
+    case QgsExpressionNode::ntLiteral:
+      break;
+  }
+
+  addInstruction( EvaluateNode, target, 0, 0, node );
+}
+
+QVariant QgsExpressionProgram::run( QgsExpression *parent, const QgsExpressionContext *context ) const
+{
+  QgsFeature feature;
+  bool hasFeature = false;
+  if ( mUsesFeature && context && context->hasFeature() )
+  {
+    feature = context->feature();
+    hasFeature = true;
+  }
+
+  // registers are local, so that copies of the expression sharing the program can be evaluated concurrently
+  QVarLengthArray< QVariant, 32 > registers( mRegisterCount );
+  const Instruction *instructions = mInstructions.constData();
+  const int count = mInstructions.count();
+  int position = 0;
+  while ( position < count )
+  {
+    const Instruction &instruction = instructions[position++];
+    QVariant &result = registers[instruction.target];
+
+    switch ( instruction.opcode )
+    {
+      case LoadConstant:
+        result = mConstants.at( instruction.a );
+        break;
+
+      case LoadField:
+        if ( hasFeature )
+          result = feature.attribute( instruction.a );
+        else
+          result = QVariant( '[' + mNames.at( instruction.b ) + ']' );
+        break;
+
+      case LoadVariable:
+        result = context ? variable( instruction.a, context ) : QVariant();
+        break;
+
+      case EvaluateNode:
+        result = instruction.node->eval( parent, context );
+        break;
+
+      case UnaryOperator:
+        result = static_cast< QgsExpressionNodeUnaryOperator * >( instruction.node )->evalOperator( registers[instruction.a], parent );
+        break;
+
+      case BinaryOperator:
+        result = static_cast< QgsExpressionNodeBinaryOperator * >( instruction.node )->evalOperator( registers[instruction.a], registers[instruction.b], parent, context );
+        break;
+
+      case InList:
+        result = inList( registers[instruction.a], mLists.at( instruction.b ), static_cast< QgsExpressionNodeInOperator * >( instruction.node )->isNotIn(), parent );
+        break;
+
+      case ContextFunction:
+      {
+        const QString &name = mNames.at( instruction.a );
+        if ( context && context->hasFunction( name ) )
+        {
+          QgsExpressionNodeFunction *functionNode = static_cast< QgsExpressionNodeFunction * >( instruction.node );
+          result = context->function( name )->run( functionNode->args(), context, parent, functionNode );
+          position = instruction.b;
+        }
+        break;
+      }
+
+      case NullArgument:
+        if ( QgsExpressionUtils::isNull( registers[instruction.a] ) )
+        {
+          result = QVariant();
+          position = instruction.b;
+        }
+        break;
+
+      case CallFunction:
+      {
+        QgsExpressionNodeFunction *functionNode = static_cast< QgsExpressionNodeFunction * >( instruction.node );
+        QVariantList args;
+        args.reserve( instruction.b );
+        for ( int i = 0; i < instruction.b; ++i )
+          args << registers[instruction.a + i];
+        result = QgsExpression::Functions()[functionNode->fnIndex()]->func( args, context, parent, functionNode );
+        break;
+      }
+
+      case JumpIfNotTrue:
+        if ( QgsExpressionUtils::getTVLValue( registers[instruction.a], parent ) != QgsExpressionUtils::True )
+          position = instruction.b;
+        break;
+
+      case Jump:
+        position = instruction.a;
+        break;
+    }
+
+    if ( parent->hasEvalError() )
+      return QVariant();
+  }
+
+  return registers[0];
+}
+
+QVariant QgsExpressionProgram::variable( int index, const QgsExpressionContext *context ) const
+{
+  Variable &cached = *mVariables[index];
+  const QgsExpressionContext::VariableHandle *handle = cached.handle.loadAcquire();
+  if ( context->isValidHandle( *handle ) )
+    return context->handleValue( *handle );
+
+  QMutexLocker locker( &cached.mutex );
+  if ( cached.retiredHandles.size() >= MAX_RETIRED_HANDLES )
+    return context->variable( handle->name() );
+
+  // the replaced handle is only deleted with the program, as a concurrent run may be reading it
+  QgsExpressionContext::VariableHandle *resolved = new QgsExpressionContext::VariableHandle( context->resolveVariable( handle->name() ) );
+  cached.retiredHandles.emplace_back( cached.handle.fetchAndStoreOrdered( resolved ) );
+  return context->handleValue( *resolved );
+}
+
+QVariant QgsExpressionProgram::inList( const QVariant &value, const QVariantList &list, bool notIn, QgsExpression *parent ) const
+{
+  if ( QgsExpressionUtils::isNull( value ) )
+    return TVL_Unknown;
+
+  bool listHasNull = false;
+  for ( const QVariant &item : list )
+  {
+    if ( QgsExpressionUtils::isNull( item ) )
+    {
+      listHasNull = true;
+      continue;
+    }
+
+    bool equal = false;
+    if ( QgsExpressionUtils::isDoubleSafe( value ) && QgsExpressionUtils::isDoubleSafe( item ) )
+    {
+      double f1 = QgsExpressionUtils::getDoubleValue( value, parent );
+      ENSURE_NO_EVAL_ERROR;
+      double f2 = QgsExpressionUtils::getDoubleValue( item, parent );
+      ENSURE_NO_EVAL_ERROR;
+      equal = qgsDoubleNear( f1, f2 );
+    }
+    else
+    {
+      QString s1 = QgsExpressionUtils::getStringValue( value, parent );
+      ENSURE_NO_EVAL_ERROR;
+      QString s2 = QgsExpressionUtils::getStringValue( item, parent );
+      ENSURE_NO_EVAL_ERROR;
+      equal = QString::compare( s1, s2 ) == 0;
+    }
+
+    if ( equal )
+      return notIn ? TVL_False : TVL_True;
+  }
+
+  if ( listHasNull )
+    return TVL_Unknown;
+  else
+    return notIn ? TVL_True : TVL_False;
+}
+
+///@endcond
@@ -0,0 +1,142 @@
+/***************************************************************************
+                               qgsexpressionprogram.h
+                             -------------------
+    begin                : October 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONPROGRAM_H
+#define QGSEXPRESSIONPROGRAM_H
+
+#define SIP_NO_FILE
+
+#include "qgsexpressioncontext.h"
+#include "qgsfields.h"
+
+#include <QAtomicPointer>
+#include <QMutex>
+#include <QVariant>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+///@cond PRIVATE
+
+class QgsExpression;
+class QgsExpressionContext;
+class QgsExpressionNode;
+
+/**
+ * Compiled form of an expression, see QgsExpression::compile().
+ *
+ * The tree of nodes is flattened to a list of instructions, which store the value of
+ * each node in a register. Static nodes are loaded as constants, columns are read from
+ * the feature by their field index and the feature is only fetched once from the context.
+ * Operators and functions use the same code as QgsExpressionNode::eval(). Nodes which
+ * are not compiled, like functions with lazy evaluation of their arguments, are evaluated
+ * with QgsExpressionNode::eval().
+ */
+class QgsExpressionProgram
+{
+  public:
+
+    /**
+     * Compiles the \a root node of an expression. The expression should already be
+     * prepared with the \a context, whose fields are used to resolve columns.
+     */
+    QgsExpressionProgram( QgsExpressionNode *root, const QgsExpressionContext *context );
+
+    /**
+     * Runs the program and returns the value of the expression. Errors are reported
+     * to the \a parent expression, and a NULL value is returned.
+     */
+    QVariant run( QgsExpression *parent, const QgsExpressionContext *context ) const;
+
+    //! Returns the number of instructions of the program
+    int instructionCount() const { return mInstructions.count(); }
+
+  private:
+
+    enum Opcode
+    {
+      LoadConstant, //!< Loads constant a
+      LoadField, //!< Loads the attribute a of the feature, column b is the name of the field
+      LoadVariable, //!< Loads the variable a
+      EvaluateNode, //!< Evaluates node with QgsExpressionNode::eval()
+      UnaryOperator, //!< Applies the unary operator node to register a
+      BinaryOperator, //!< Applies the binary operator node to registers a and b
+      InList, //!< Compares register a to the static list b of the IN operator node
+      ContextFunction, //!< Runs the function node and jumps to b if name a is a function of the context
+      NullArgument, //!< Loads NULL and jumps to b if register a is NULL
+      CallFunction, //!< Calls the function node with the b arguments stored from register a
+      JumpIfNotTrue, //!< Jumps to b if register a is not true
+      Jump, //!< Jumps to a
+    };
+
+    struct Instruction
+    {
+      Opcode opcode;
+      //! Register storing the result
+      int target;
+      int a;
+      int b;
+      QgsExpressionNode *node;
+    };
+
+    //! Compiles \a node, storing its value in the \a target register
+    void compileNode( QgsExpressionNode *node, int target );
+    //! Appends an instruction and returns its position
+    int addInstruction( Opcode opcode, int target, int a = 0, int b = 0, QgsExpressionNode *node = nullptr );
+    int addConstant( const QVariant &value );
+    int addRegister() { return mRegisterCount++; }
+    //! Returns a static \a value for \a node, if it has one
+    static bool staticValue( QgsExpressionNode *node, QVariant &value );
+    QVariant inList( const QVariant &value, const QVariantList &list, bool notIn, QgsExpression *parent ) const;
+
+    /**
+     * Variable read by the var() function through a handle. The handle is resolved in the
+     * context used to compile the program, and resolved again when the program runs in a
+     * context with other scopes, e.g. once the scopes of a symbol are added. The new handle
+     * is kept for the next runs, which may happen concurrently.
+     */
+    struct Variable
+    {
+      explicit Variable( const QgsExpressionContext::VariableHandle &resolved );
+      ~Variable();
+
+      QAtomicPointer< QgsExpressionContext::VariableHandle > handle;
+      //! Protects retiredHandles while the handle is replaced
+      QMutex mutex;
+      //! Replaced handles, which may still be read by concurrent runs
+      std::vector< std::unique_ptr< QgsExpressionContext::VariableHandle > > retiredHandles;
+    };
+
+    //! Returns the value of the variable \a index in \a context
+    QVariant variable( int index, const QgsExpressionContext *context ) const;
+
+    QVector<Instruction> mInstructions;
+    QVector<QVariant> mConstants;
+    //! Names of columns and functions used by the instructions
+    QVector<QString> mNames;
+    QVector<QVariantList> mLists;
+    //! Variables read by the var() function
+    std::vector< std::unique_ptr< Variable > > mVariables;
+    //! Register 0 stores the value of the expression
+    int mRegisterCount = 1;
+    QgsFields mFields;
+    //! Context used while compiling
+    const QgsExpressionContext *mContext = nullptr;
+    bool mUsesFeature = false;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSEXPRESSIONPROGRAM_H
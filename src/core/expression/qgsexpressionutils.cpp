@@ -16,6 +16,8 @@
 #include "qgsexpressionutils.h"
 #include "qgsexpressionnode.h"
 
+#include <QRegExp>
+
 QgsExpressionUtils::TVL QgsExpressionUtils::AND[3][3] =
 {
   // false  true    unknown
@@ -31,3 +33,36 @@ QgsExpressionUtils::TVL QgsExpressionUtils::OR[3][3] =
 };
 
 QgsExpressionUtils::TVL QgsExpressionUtils::NOT[3] = { True, False, Unknown };
+
+QString QgsExpressionUtils::likePatternToRegExp( const QString &pattern )
+{
+  QString esc_regexp = QRegExp::escape( pattern );
+  // manage escape % and _
+  if ( esc_regexp.startsWith( '%' ) )
+  {
+    esc_regexp.replace( 0, 1, QStringLiteral( ".*" ) );
+  }
+  QRegExp rx( "[^\\\\](%)" );
+  int pos = 0;
+  while ( ( pos = rx.indexIn( esc_regexp, pos ) ) != -1 )
+  {
+    esc_regexp.replace( pos + 1, 1, QStringLiteral( ".*" ) );
+    pos += 1;
+  }
+  rx.setPattern( QStringLiteral( "\\\\%" ) );
+  esc_regexp.replace( rx, QStringLiteral( "%" ) );
+  if ( esc_regexp.startsWith( '_' ) )
+  {
+    esc_regexp.replace( 0, 1, QStringLiteral( "." ) );
+  }
+  rx.setPattern( QStringLiteral( "[^\\\\](_)" ) );
+  pos = 0;
+  while ( ( pos = rx.indexIn( esc_regexp, pos ) ) != -1 )
+  {
+    esc_regexp.replace( pos + 1, 1, '.' );
+    pos += 1;
+  }
+  rx.setPattern( QStringLiteral( "\\\\_" ) );
+  esc_regexp.replace( rx, QStringLiteral( "_" ) );
+  return esc_regexp;
+}
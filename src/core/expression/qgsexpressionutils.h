@@ -381,6 +381,12 @@ class QgsExpressionUtils
         return QVariantMap();
       }
     }
+
+    /**
+     * Converts a LIKE \a pattern to the equivalent regular expression. The % and _
+     * wildcards are replaced, unless they are escaped with a backslash.
+     */
+    static QString likePatternToRegExp( const QString &pattern );
 };
 
 /// @endcond
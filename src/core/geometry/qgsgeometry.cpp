@@ -17,6 +17,7 @@ email                : morb at ozemail dot com dot au
 #include <cstdarg>
 #include <cstdio>
 #include <cmath>
+#include <limits>
 
 #include "qgis.h"
 #include "qgsgeometry.h"
@@ -32,6 +33,7 @@ email                : morb at ozemail dot com dot au
 #include "qgsmessagelog.h"
 #include "qgspointxy.h"
 #include "qgsrectangle.h"
+#include "qgswkbptr.h"
 
 #include "qgsvectorlayer.h"
 #include "qgsgeometryvalidator.h"
@@ -49,11 +51,155 @@ email                : morb at ozemail dot com dot au
 struct QgsGeometryPrivate
 {
   QgsGeometryPrivate(): ref( 1 ) {}
-  ~QgsGeometryPrivate() { delete geometry; }
+  ~QgsGeometryPrivate() { delete geom.load(); }
+
+  //! Returns the geometry, parsing the WKB it was created from on first access
+  QgsAbstractGeometry *geometry() const
+  {
+    QgsAbstractGeometry *g = geom.loadAcquire();
+    if ( !g && !wkb.isEmpty() )
+    {
+      // the geometry may be shared with other threads: the first parsed geometry wins
+      QgsConstWkbPtr ptr( wkb );
+      g = QgsGeometryFactory::geomFromWkb( ptr ).release();
+      if ( !geom.testAndSetOrdered( nullptr, g ) )
+      {
+        delete g;
+        g = geom.loadAcquire();
+      }
+    }
+    return g;
+  }
+
+  //! Sets the geometry, without deleting the previous one
+  void setGeometry( QgsAbstractGeometry *geometry )
+  {
+    geom.storeRelease( geometry );
+    wkb.clear();
+  }
+
+  //! Deletes the geometry
+  void reset()
+  {
+    delete geom.load();
+    geom.store( nullptr );
+    wkb.clear();
+  }
+
+  //! Returns true if the geometry has been created from WKB which has not been parsed yet
+  bool isLazy() const { return !wkb.isEmpty() && !geom.loadAcquire(); }
+
   QAtomicInt ref;
-  QgsAbstractGeometry *geometry = nullptr;
+  mutable QAtomicPointer<QgsAbstractGeometry> geom;
+
+  //! WKB the geometry was created from, only parsed when needed
+  QByteArray wkb;
+  //! Type and bounding box of the WKB geometry
+  QgsWkbTypes::Type wkbType = QgsWkbTypes::Unknown;
+  QgsRectangle boundingBox;
 };
 
+namespace
+{
+  // Returns the bounding box of a WKB point sequence, as QgsLineString would
+  QgsRectangle readWkbPoints( QgsConstWkbPtr &wkbPtr, int dimensions, bool &ok )
+  {
+    int nPoints = 0;
+    wkbPtr >> nPoints;
+    if ( nPoints < 0 )
+    {
+      ok = false;
+      return QgsRectangle();
+    }
+
+    double xmin = std::numeric_limits<double>::max();
+    double ymin = std::numeric_limits<double>::max();
+    double xmax = -std::numeric_limits<double>::max();
+    double ymax = -std::numeric_limits<double>::max();
+    for ( int i = 0; i < nPoints; ++i )
+    {
+      double x, y;
+      wkbPtr >> x >> y;
+      wkbPtr += ( dimensions - 2 ) * sizeof( double );
+      if ( x < xmin )
+        xmin = x;
+      if ( x > xmax )
+        xmax = x;
+      if ( y < ymin )
+        ymin = y;
+      if ( y > ymax )
+        ymax = y;
+    }
+    return QgsRectangle( xmin, ymin, xmax, ymax );
+  }
+
+  /**
+   * Reads the type and bounding box of a WKB line string, polygon, multi line string
+   * or multi polygon without building the geometry. Returns false for any other WKB,
+   * or if it is not in the native byte order, in which case the WKB has to be parsed.
+   */
+  bool scanWkb( QgsConstWkbPtr &wkbPtr, bool allowMulti, QgsWkbTypes::Type &type, QgsRectangle &boundingBox )
+  {
+    if ( wkbPtr.remaining() < 1 || static_cast< char >( *static_cast< const unsigned char * >( wkbPtr ) ) != QgsApplication::endian() )
+      return false;
+
+    type = wkbPtr.readHeader();
+    // 25D types and parts with mixed dimensions are normalized when parsed
+    if ( type != QgsWkbTypes::zmType( QgsWkbTypes::flatType( type ), QgsWkbTypes::hasZ( type ), QgsWkbTypes::hasM( type ) ) )
+      return false;
+
+    const int dimensions = 2 + QgsWkbTypes::hasZ( type ) + QgsWkbTypes::hasM( type );
+    bool ok = true;
+    switch ( QgsWkbTypes::flatType( type ) )
+    {
+      case QgsWkbTypes::LineString:
+        boundingBox = readWkbPoints( wkbPtr, dimensions, ok );
+        return ok;
+
+      case QgsWkbTypes::Polygon:
+      {
+        int nRings = 0;
+        wkbPtr >> nRings;
+        boundingBox = QgsRectangle();
+        for ( int i = 0; i < nRings && ok; ++i )
+        {
+          QgsRectangle ringBox = readWkbPoints( wkbPtr, dimensions, ok );
+          if ( i == 0 )
+            boundingBox = ringBox;
+        }
+        return ok && nRings >= 0;
+      }
+
+      case QgsWkbTypes::MultiLineString:
+      case QgsWkbTypes::MultiPolygon:
+      {
+        if ( !allowMulti )
+          return false;
+
+        int nParts = 0;
+        wkbPtr >> nParts;
+        boundingBox = QgsRectangle();
+        for ( int i = 0; i < nParts; ++i )
+        {
+          QgsWkbTypes::Type partType;
+          QgsRectangle partBox;
+          if ( !scanWkb( wkbPtr, false, partType, partBox ) || partType != QgsWkbTypes::singleType( type ) )
+            return false;
+
+          if ( i == 0 )
+            boundingBox = partBox;
+          else
+            boundingBox.combineExtentWith( partBox );
+        }
+        return nParts >= 0;
+      }
+
+      default:
+        return false;
+    }
+  }
+}
+
 QgsGeometry::QgsGeometry()
   : d( new QgsGeometryPrivate() )
 {
@@ -67,7 +213,7 @@ QgsGeometry::~QgsGeometry()
 
 QgsGeometry::QgsGeometry( QgsAbstractGeometry *geom ): d( new QgsGeometryPrivate() )
 {
-  d->geometry = geom;
+  d->setGeometry( geom );
   d->ref = QAtomicInt( 1 );
 }
 
@@ -97,42 +243,51 @@ void QgsGeometry::detach( bool cloneGeom )
   {
     ( void )d->ref.deref();
     QgsAbstractGeometry *cGeom = nullptr;
+    QgsGeometryPrivate *old = d;
 
-    if ( d->geometry && cloneGeom )
+    if ( cloneGeom && !old->isLazy() && old->geometry() )
     {
-      cGeom = d->geometry->clone();
+      cGeom = old->geometry()->clone();
     }
 
     d = new QgsGeometryPrivate();
-    d->geometry = cGeom;
+    d->setGeometry( cGeom );
+    if ( cloneGeom && old->isLazy() )
+    {
+      // parsing the WKB is cheaper than cloning the parsed geometry
+      d->wkb = old->wkb;
+    }
+  }
+
+  // the geometry is about to be modified, so the WKB it was created from is outdated
+  if ( !d->wkb.isEmpty() )
+  {
+    if ( cloneGeom )
+      d->geometry();
+    d->wkb.clear();
   }
 }
 
 QgsAbstractGeometry *QgsGeometry::geometry() const
 {
-  return d->geometry;
+  return d->geometry();
 }
 
 void QgsGeometry::setGeometry( QgsAbstractGeometry *geometry )
 {
-  if ( d->geometry == geometry )
+  if ( !d->isLazy() && d->geometry() == geometry )
   {
     return;
   }
 
   detach( false );
-  if ( d->geometry )
-  {
-    delete d->geometry;
-    d->geometry = nullptr;
-  }
-
-  d->geometry = geometry;
+  d->reset();
+  d->setGeometry( geometry );
 }
 
 bool QgsGeometry::isNull() const
 {
-  return !d->geometry;
+  return !d->isLazy() && !d->geometry();
 }
 
 QgsGeometry QgsGeometry::fromWkt( const QString &wkt )
@@ -242,92 +397,114 @@ QgsGeometry QgsGeometry::collectGeometry( const QList< QgsGeometry > &geometries
 
 void QgsGeometry::fromWkb( unsigned char *wkb, int length )
 {
-  detach( false );
-
-  if ( d->geometry )
-  {
-    delete d->geometry;
-  }
-  QgsConstWkbPtr ptr( wkb, length );
-  d->geometry = QgsGeometryFactory::geomFromWkb( ptr ).release();
+  fromWkb( QByteArray( reinterpret_cast< const char * >( wkb ), length ) );
   delete [] wkb;
 }
 
 void QgsGeometry::fromWkb( const QByteArray &wkb )
 {
   detach( false );
+  d->reset();
+
+  // line and polygon geometries are only parsed when their content is needed,
+  // their type and bounding box are read directly from the WKB
+  QgsWkbTypes::Type type = QgsWkbTypes::Unknown;
+  QgsRectangle boundingBox;
+  bool lazy = false;
+  try
+  {
+    QgsConstWkbPtr scanPtr( wkb );
+    lazy = scanWkb( scanPtr, true, type, boundingBox );
+  }
+  catch ( const QgsWkbException & )
+  {
+    lazy = false;
+  }
 
-  if ( d->geometry )
+  if ( lazy )
   {
-    delete d->geometry;
+    d->wkb = wkb;
+    d->wkbType = type;
+    d->boundingBox = boundingBox;
+    return;
   }
+
   QgsConstWkbPtr ptr( wkb );
-  d->geometry = QgsGeometryFactory::geomFromWkb( ptr ).release();
+  d->setGeometry( QgsGeometryFactory::geomFromWkb( ptr ).release() );
+}
+
+QByteArray QgsGeometry::sourceWkb() const
+{
+  return d->isLazy() ? d->wkb : QByteArray();
 }
 
 GEOSGeometry *QgsGeometry::exportToGeos( double precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  return QgsGeos::asGeos( d->geometry, precision );
+  return QgsGeos::asGeos( d->geometry(), precision );
 }
 
 
 QgsWkbTypes::Type QgsGeometry::wkbType() const
 {
-  if ( !d->geometry )
+  if ( d->isLazy() )
+  {
+    return d->wkbType;
+  }
+  else if ( !d->geometry() )
   {
     return QgsWkbTypes::Unknown;
   }
   else
   {
-    return d->geometry->wkbType();
+    return d->geometry()->wkbType();
   }
 }
 
 
 QgsWkbTypes::GeometryType QgsGeometry::type() const
 {
-  if ( !d->geometry )
+  if ( isNull() )
   {
     return QgsWkbTypes::UnknownGeometry;
   }
-  return static_cast< QgsWkbTypes::GeometryType >( QgsWkbTypes::geometryType( d->geometry->wkbType() ) );
+  return static_cast< QgsWkbTypes::GeometryType >( QgsWkbTypes::geometryType( wkbType() ) );
 }
 
 bool QgsGeometry::isEmpty() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return true;
   }
 
-  return d->geometry->isEmpty();
+  return d->geometry()->isEmpty();
 }
 
 bool QgsGeometry::isMultipart() const
 {
-  if ( !d->geometry )
+  if ( isNull() )
   {
     return false;
   }
-  return QgsWkbTypes::isMultiType( d->geometry->wkbType() );
+  return QgsWkbTypes::isMultiType( wkbType() );
 }
 
 void QgsGeometry::fromGeos( GEOSGeometry *geos )
 {
   detach( false );
-  delete d->geometry;
-  d->geometry = QgsGeos::fromGeos( geos );
+  d->reset();
+  d->setGeometry( QgsGeos::fromGeos( geos ) );
   GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), geos );
 }
 
 QgsPointXY QgsGeometry::closestVertex( const QgsPointXY &point, int &atVertex, int &beforeVertex, int &afterVertex, double &sqrDist ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     sqrDist = -1;
     return QgsPointXY( 0, 0 );
@@ -336,7 +513,7 @@ QgsPointXY QgsGeometry::closestVertex( const QgsPointXY &point, int &atVertex, i
   QgsPoint pt( point.x(), point.y() );
   QgsVertexId id;
 
-  QgsPoint vp = QgsGeometryUtils::closestVertex( *( d->geometry ), pt, id );
+  QgsPoint vp = QgsGeometryUtils::closestVertex( *( d->geometry() ), pt, id );
   if ( !id.isValid() )
   {
     sqrDist = -1;
@@ -351,7 +528,7 @@ QgsPointXY QgsGeometry::closestVertex( const QgsPointXY &point, int &atVertex, i
 
 double QgsGeometry::distanceToVertex( int vertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
@@ -362,12 +539,12 @@ double QgsGeometry::distanceToVertex( int vertex ) const
     return -1;
   }
 
-  return QgsGeometryUtils::distanceToVertex( *( d->geometry ), id );
+  return QgsGeometryUtils::distanceToVertex( *( d->geometry() ), id );
 }
 
 double QgsGeometry::angleAtVertex( int vertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0;
   }
@@ -380,26 +557,26 @@ double QgsGeometry::angleAtVertex( int vertex ) const
 
   QgsVertexId v1;
   QgsVertexId v3;
-  QgsGeometryUtils::adjacentVertices( *d->geometry, v2, v1, v3 );
+  QgsGeometryUtils::adjacentVertices( *d->geometry(), v2, v1, v3 );
   if ( v1.isValid() && v3.isValid() )
   {
-    QgsPoint p1 = d->geometry->vertexAt( v1 );
-    QgsPoint p2 = d->geometry->vertexAt( v2 );
-    QgsPoint p3 = d->geometry->vertexAt( v3 );
+    QgsPoint p1 = d->geometry()->vertexAt( v1 );
+    QgsPoint p2 = d->geometry()->vertexAt( v2 );
+    QgsPoint p3 = d->geometry()->vertexAt( v3 );
     double angle1 = QgsGeometryUtils::lineAngle( p1.x(), p1.y(), p2.x(), p2.y() );
     double angle2 = QgsGeometryUtils::lineAngle( p2.x(), p2.y(), p3.x(), p3.y() );
     return QgsGeometryUtils::averageAngle( angle1, angle2 );
   }
   else if ( v3.isValid() )
   {
-    QgsPoint p1 = d->geometry->vertexAt( v2 );
-    QgsPoint p2 = d->geometry->vertexAt( v3 );
+    QgsPoint p1 = d->geometry()->vertexAt( v2 );
+    QgsPoint p2 = d->geometry()->vertexAt( v3 );
     return QgsGeometryUtils::lineAngle( p1.x(), p1.y(), p2.x(), p2.y() );
   }
   else if ( v1.isValid() )
   {
-    QgsPoint p1 = d->geometry->vertexAt( v1 );
-    QgsPoint p2 = d->geometry->vertexAt( v2 );
+    QgsPoint p1 = d->geometry()->vertexAt( v1 );
+    QgsPoint p2 = d->geometry()->vertexAt( v2 );
     return QgsGeometryUtils::lineAngle( p1.x(), p1.y(), p2.x(), p2.y() );
   }
   return 0.0;
@@ -407,7 +584,7 @@ double QgsGeometry::angleAtVertex( int vertex ) const
 
 void QgsGeometry::adjacentVertices( int atVertex, int &beforeVertex, int &afterVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return;
   }
@@ -421,14 +598,14 @@ void QgsGeometry::adjacentVertices( int atVertex, int &beforeVertex, int &afterV
   }
 
   QgsVertexId beforeVertexId, afterVertexId;
-  QgsGeometryUtils::adjacentVertices( *( d->geometry ), id, beforeVertexId, afterVertexId );
+  QgsGeometryUtils::adjacentVertices( *( d->geometry() ), id, beforeVertexId, afterVertexId );
   beforeVertex = vertexNrFromVertexId( beforeVertexId );
   afterVertex = vertexNrFromVertexId( afterVertexId );
 }
 
 bool QgsGeometry::moveVertex( double x, double y, int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -441,12 +618,12 @@ bool QgsGeometry::moveVertex( double x, double y, int atVertex )
 
   detach( true );
 
-  return d->geometry->moveVertex( id, QgsPoint( x, y ) );
+  return d->geometry()->moveVertex( id, QgsPoint( x, y ) );
 }
 
 bool QgsGeometry::moveVertex( const QgsPoint &p, int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -459,30 +636,30 @@ bool QgsGeometry::moveVertex( const QgsPoint &p, int atVertex )
 
   detach( true );
 
-  return d->geometry->moveVertex( id, p );
+  return d->geometry()->moveVertex( id, p );
 }
 
 bool QgsGeometry::deleteVertex( int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::MultiPoint )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::MultiPoint )
   {
     detach( true );
     //delete geometry instead of point
-    return static_cast< QgsGeometryCollection * >( d->geometry )->removeGeometry( atVertex );
+    return static_cast< QgsGeometryCollection * >( d->geometry() )->removeGeometry( atVertex );
   }
 
   //if it is a point, set the geometry to nullptr
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::Point )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::Point )
   {
     detach( false );
-    delete d->geometry;
-    d->geometry = nullptr;
+    d->reset();
+    d->setGeometry( nullptr );
     return true;
   }
 
@@ -494,22 +671,22 @@ bool QgsGeometry::deleteVertex( int atVertex )
 
   detach( true );
 
-  return d->geometry->deleteVertex( id );
+  return d->geometry()->deleteVertex( id );
 }
 
 bool QgsGeometry::insertVertex( double x, double y, int beforeVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::MultiPoint )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::MultiPoint )
   {
     detach( true );
     //insert geometry instead of point
-    return static_cast< QgsGeometryCollection * >( d->geometry )->insertGeometry( new QgsPoint( x, y ), beforeVertex );
+    return static_cast< QgsGeometryCollection * >( d->geometry() )->insertGeometry( new QgsPoint( x, y ), beforeVertex );
   }
 
   QgsVertexId id;
@@ -520,22 +697,22 @@ bool QgsGeometry::insertVertex( double x, double y, int beforeVertex )
 
   detach( true );
 
-  return d->geometry->insertVertex( id, QgsPoint( x, y ) );
+  return d->geometry()->insertVertex( id, QgsPoint( x, y ) );
 }
 
 bool QgsGeometry::insertVertex( const QgsPoint &point, int beforeVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::MultiPoint )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::MultiPoint )
   {
     detach( true );
     //insert geometry instead of point
-    return static_cast< QgsGeometryCollection * >( d->geometry )->insertGeometry( new QgsPoint( point ), beforeVertex );
+    return static_cast< QgsGeometryCollection * >( d->geometry() )->insertGeometry( new QgsPoint( point ), beforeVertex );
   }
 
   QgsVertexId id;
@@ -546,12 +723,12 @@ bool QgsGeometry::insertVertex( const QgsPoint &point, int beforeVertex )
 
   detach( true );
 
-  return d->geometry->insertVertex( id, point );
+  return d->geometry()->insertVertex( id, point );
 }
 
 QgsPoint QgsGeometry::vertexAt( int atVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsPoint();
   }
@@ -562,7 +739,7 @@ QgsPoint QgsGeometry::vertexAt( int atVertex ) const
   {
     return QgsPoint();
   }
-  return d->geometry->vertexAt( vId );
+  return d->geometry()->vertexAt( vId );
 }
 
 double QgsGeometry::sqrDistToVertexAt( QgsPointXY &point, int atVertex ) const
@@ -573,7 +750,7 @@ double QgsGeometry::sqrDistToVertexAt( QgsPointXY &point, int atVertex ) const
 
 QgsGeometry QgsGeometry::nearestPoint( const QgsGeometry &other ) const
 {
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsGeometry result = geos.closestPoint( other );
   result.mLastError = mLastError;
@@ -582,7 +759,7 @@ QgsGeometry QgsGeometry::nearestPoint( const QgsGeometry &other ) const
 
 QgsGeometry QgsGeometry::shortestLine( const QgsGeometry &other ) const
 {
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsGeometry result = geos.shortestLine( other, &mLastError );
   result.mLastError = mLastError;
@@ -591,14 +768,14 @@ QgsGeometry QgsGeometry::shortestLine( const QgsGeometry &other ) const
 
 double QgsGeometry::closestVertexWithContext( const QgsPointXY &point, int &atVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
 
   QgsVertexId vId;
   QgsPoint pt( point.x(), point.y() );
-  QgsPoint closestPoint = QgsGeometryUtils::closestVertex( *( d->geometry ), pt, vId );
+  QgsPoint closestPoint = QgsGeometryUtils::closestVertex( *( d->geometry() ), pt, vId );
   if ( !vId.isValid() )
     return -1;
   atVertex = vertexNrFromVertexId( vId );
@@ -612,7 +789,7 @@ double QgsGeometry::closestSegmentWithContext(
   double *leftOf,
   double epsilon ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
@@ -621,7 +798,7 @@ double QgsGeometry::closestSegmentWithContext(
   QgsVertexId vertexAfter;
   bool leftOfBool;
 
-  double sqrDist = d->geometry->closestSegment( QgsPoint( point.x(), point.y() ), segmentPt,  vertexAfter, &leftOfBool, epsilon );
+  double sqrDist = d->geometry()->closestSegment( QgsPoint( point.x(), point.y() ), segmentPt,  vertexAfter, &leftOfBool, epsilon );
   if ( sqrDist < 0 )
     return -1;
 
@@ -645,7 +822,7 @@ QgsGeometry::OperationResult QgsGeometry::addRing( const QList<QgsPointXY> &ring
 
 QgsGeometry::OperationResult QgsGeometry::addRing( QgsCurve *ring )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     delete ring;
     return InvalidInput;
@@ -653,7 +830,7 @@ QgsGeometry::OperationResult QgsGeometry::addRing( QgsCurve *ring )
 
   detach( true );
 
-  return QgsGeometryEditUtils::addRing( d->geometry, ring );
+  return QgsGeometryEditUtils::addRing( d->geometry(), ring );
 }
 
 QgsGeometry::OperationResult QgsGeometry::addPart( const QList<QgsPointXY> &points, QgsWkbTypes::GeometryType geomType )
@@ -681,19 +858,19 @@ QgsGeometry::OperationResult QgsGeometry::addPart( const QgsPointSequence &point
 
 QgsGeometry::OperationResult QgsGeometry::addPart( QgsAbstractGeometry *part, QgsWkbTypes::GeometryType geomType )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     detach( false );
     switch ( geomType )
     {
       case QgsWkbTypes::PointGeometry:
-        d->geometry = new QgsMultiPointV2();
+        d->setGeometry( new QgsMultiPointV2() );
         break;
       case QgsWkbTypes::LineGeometry:
-        d->geometry = new QgsMultiLineString();
+        d->setGeometry( new QgsMultiLineString() );
         break;
       case QgsWkbTypes::PolygonGeometry:
-        d->geometry = new QgsMultiPolygonV2();
+        d->setGeometry( new QgsMultiPolygonV2() );
         break;
       default:
         return QgsGeometry::AddPartNotMultiGeometry;
@@ -705,31 +882,31 @@ QgsGeometry::OperationResult QgsGeometry::addPart( QgsAbstractGeometry *part, Qg
   }
 
   convertToMultiType();
-  return QgsGeometryEditUtils::addPart( d->geometry, part );
+  return QgsGeometryEditUtils::addPart( d->geometry(), part );
 }
 
 QgsGeometry::OperationResult QgsGeometry::addPart( const QgsGeometry &newPart )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry::InvalidBaseGeometry;
   }
-  if ( !newPart || !newPart.d->geometry )
+  if ( !newPart || !newPart.d->geometry() )
   {
     return QgsGeometry::AddPartNotMultiGeometry;
   }
 
-  return addPart( newPart.d->geometry->clone() );
+  return addPart( newPart.d->geometry()->clone() );
 }
 
 QgsGeometry QgsGeometry::removeInteriorRings( double minimumRingArea ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::PolygonGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::PolygonGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     const QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -751,7 +928,7 @@ QgsGeometry QgsGeometry::removeInteriorRings( double minimumRingArea ) const
   }
   else
   {
-    QgsCurvePolygon *newPoly = static_cast< QgsCurvePolygon * >( d->geometry->clone() );
+    QgsCurvePolygon *newPoly = static_cast< QgsCurvePolygon * >( d->geometry()->clone() );
     newPoly->removeInteriorRings( minimumRingArea );
     return QgsGeometry( newPoly );
   }
@@ -759,7 +936,7 @@ QgsGeometry QgsGeometry::removeInteriorRings( double minimumRingArea ) const
 
 QgsGeometry::OperationResult QgsGeometry::addPart( GEOSGeometry *newPart )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry::InvalidBaseGeometry;
   }
@@ -771,25 +948,25 @@ QgsGeometry::OperationResult QgsGeometry::addPart( GEOSGeometry *newPart )
   detach( true );
 
   QgsAbstractGeometry *geom = QgsGeos::fromGeos( newPart );
-  return QgsGeometryEditUtils::addPart( d->geometry, geom );
+  return QgsGeometryEditUtils::addPart( d->geometry(), geom );
 }
 
 QgsGeometry::OperationResult QgsGeometry::translate( double dx, double dy )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry::InvalidBaseGeometry;
   }
 
   detach( true );
 
-  d->geometry->transform( QTransform::fromTranslate( dx, dy ) );
+  d->geometry()->transform( QTransform::fromTranslate( dx, dy ) );
   return QgsGeometry::Success;
 }
 
 QgsGeometry::OperationResult QgsGeometry::rotate( double rotation, const QgsPointXY &center )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry::InvalidBaseGeometry;
   }
@@ -799,13 +976,13 @@ QgsGeometry::OperationResult QgsGeometry::rotate( double rotation, const QgsPoin
   QTransform t = QTransform::fromTranslate( center.x(), center.y() );
   t.rotate( -rotation );
   t.translate( -center.x(), -center.y() );
-  d->geometry->transform( t );
+  d->geometry()->transform( t );
   return QgsGeometry::Success;
 }
 
 QgsGeometry::OperationResult QgsGeometry::splitGeometry( const QList<QgsPointXY> &splitLine, QList<QgsGeometry> &newGeometries, bool topological, QList<QgsPointXY> &topologyTestPoints )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return InvalidBaseGeometry;
   }
@@ -814,14 +991,14 @@ QgsGeometry::OperationResult QgsGeometry::splitGeometry( const QList<QgsPointXY>
   QgsLineString splitLineString( splitLine );
   QgsPointSequence tp;
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsGeometryEngine::EngineOperationResult result = geos.splitGeometry( splitLineString, newGeoms, topological, tp, &mLastError );
 
   if ( result == QgsGeometryEngine::Success )
   {
     detach( false );
-    d->geometry = newGeoms.at( 0 );
+    d->setGeometry( newGeoms.at( 0 ) );
 
     newGeometries.clear();
     for ( int i = 1; i < newGeoms.size(); ++i )
@@ -858,20 +1035,20 @@ QgsGeometry::OperationResult QgsGeometry::splitGeometry( const QList<QgsPointXY>
 
 QgsGeometry::OperationResult QgsGeometry::reshapeGeometry( const QgsLineString &reshapeLineString )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return InvalidBaseGeometry;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsGeometryEngine::EngineOperationResult errorCode = QgsGeometryEngine::Success;
   mLastError.clear();
   QgsAbstractGeometry *geom = geos.reshapeGeometry( reshapeLineString, &errorCode, &mLastError );
   if ( errorCode == QgsGeometryEngine::Success && geom )
   {
     detach( false );
-    delete d->geometry;
-    d->geometry = geom;
+    d->reset();
+    d->setGeometry( geom );
     return Success;
   }
 
@@ -899,12 +1076,12 @@ QgsGeometry::OperationResult QgsGeometry::reshapeGeometry( const QgsLineString &
 
 int QgsGeometry::makeDifferenceInPlace( const QgsGeometry &other )
 {
-  if ( !d->geometry || !other.d->geometry )
+  if ( !d->geometry() || !other.d->geometry() )
   {
     return 0;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   mLastError.clear();
   QgsAbstractGeometry *diffGeom = geos.intersection( other.geometry(), &mLastError );
@@ -915,19 +1092,19 @@ int QgsGeometry::makeDifferenceInPlace( const QgsGeometry &other )
 
   detach( false );
 
-  delete d->geometry;
-  d->geometry = diffGeom;
+  d->reset();
+  d->setGeometry( diffGeom );
   return 0;
 }
 
 QgsGeometry QgsGeometry::makeDifference( const QgsGeometry &other ) const
 {
-  if ( !d->geometry || other.isNull() )
+  if ( !d->geometry() || other.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   mLastError.clear();
   QgsAbstractGeometry *diffGeom = geos.intersection( other.geometry(), &mLastError );
@@ -943,9 +1120,13 @@ QgsGeometry QgsGeometry::makeDifference( const QgsGeometry &other ) const
 
 QgsRectangle QgsGeometry::boundingBox() const
 {
-  if ( d->geometry )
+  if ( d->isLazy() )
+  {
+    return d->boundingBox;
+  }
+  else if ( d->geometry() )
   {
-    return d->geometry->boundingBox();
+    return d->geometry()->boundingBox();
   }
   return QgsRectangle();
 }
@@ -958,7 +1139,7 @@ QgsGeometry QgsGeometry::orientedMinimumBoundingBox( double &area, double &angle
   width = DBL_MAX;
   height = DBL_MAX;
 
-  if ( !d->geometry || d->geometry->nCoordinates() < 2 )
+  if ( !d->geometry() || d->geometry()->nCoordinates() < 2 )
     return QgsGeometry();
 
   QgsGeometry hull = convexHull();
@@ -1068,7 +1249,7 @@ QgsGeometry QgsGeometry::minimalEnclosingCircle( QgsPointXY &center, double &rad
   center = QgsPointXY( );
   radius = 0;
 
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
@@ -1113,129 +1294,129 @@ bool QgsGeometry::intersects( const QgsRectangle &r ) const
 
 bool QgsGeometry::intersects( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.intersects( geometry.d->geometry, &mLastError );
+  return geos.intersects( geometry.d->geometry(), &mLastError );
 }
 
 bool QgsGeometry::contains( const QgsPointXY *p ) const
 {
-  if ( !d->geometry || !p )
+  if ( !d->geometry() || !p )
   {
     return false;
   }
 
   QgsPoint pt( p->x(), p->y() );
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   return geos.contains( &pt, &mLastError );
 }
 
 bool QgsGeometry::contains( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.contains( geometry.d->geometry, &mLastError );
+  return geos.contains( geometry.d->geometry(), &mLastError );
 }
 
 bool QgsGeometry::disjoint( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.disjoint( geometry.d->geometry, &mLastError );
+  return geos.disjoint( geometry.d->geometry(), &mLastError );
 }
 
 bool QgsGeometry::equals( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.isEqual( geometry.d->geometry, &mLastError );
+  return geos.isEqual( geometry.d->geometry(), &mLastError );
 }
 
 bool QgsGeometry::touches( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.touches( geometry.d->geometry, &mLastError );
+  return geos.touches( geometry.d->geometry(), &mLastError );
 }
 
 bool QgsGeometry::overlaps( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.overlaps( geometry.d->geometry, &mLastError );
+  return geos.overlaps( geometry.d->geometry(), &mLastError );
 }
 
 bool QgsGeometry::within( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.within( geometry.d->geometry, &mLastError );
+  return geos.within( geometry.d->geometry(), &mLastError );
 }
 
 bool QgsGeometry::crosses( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.crosses( geometry.d->geometry, &mLastError );
+  return geos.crosses( geometry.d->geometry(), &mLastError );
 }
 
 QString QgsGeometry::exportToWkt( int precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QString();
   }
-  return d->geometry->asWkt( precision );
+  return d->geometry()->asWkt( precision );
 }
 
 QString QgsGeometry::exportToGeoJSON( int precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QStringLiteral( "null" );
   }
-  return d->geometry->asJSON( precision );
+  return d->geometry()->asJSON( precision );
 }
 
 QgsGeometry QgsGeometry::convertToType( QgsWkbTypes::GeometryType destType, bool destMultipart ) const
@@ -1258,7 +1439,7 @@ QgsGeometry QgsGeometry::convertToType( QgsWkbTypes::GeometryType destType, bool
 
 bool QgsGeometry::convertToMultiType()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -1268,7 +1449,7 @@ bool QgsGeometry::convertToMultiType()
     return true;
   }
 
-  std::unique_ptr< QgsAbstractGeometry >geom = QgsGeometryFactory::geomFromWkbType( QgsWkbTypes::multiType( d->geometry->wkbType() ) );
+  std::unique_ptr< QgsAbstractGeometry >geom = QgsGeometryFactory::geomFromWkbType( QgsWkbTypes::multiType( d->geometry()->wkbType() ) );
   QgsGeometryCollection *multiGeom = qgsgeometry_cast<QgsGeometryCollection *>( geom.get() );
   if ( !multiGeom )
   {
@@ -1276,14 +1457,14 @@ bool QgsGeometry::convertToMultiType()
   }
 
   detach( true );
-  multiGeom->addGeometry( d->geometry );
-  d->geometry = geom.release();
+  multiGeom->addGeometry( d->geometry() );
+  d->setGeometry( geom.release() );
   return true;
 }
 
 bool QgsGeometry::convertToSingleType()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -1293,24 +1474,24 @@ bool QgsGeometry::convertToSingleType()
     return true;
   }
 
-  QgsGeometryCollection *multiGeom = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *multiGeom = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry() );
   if ( !multiGeom || multiGeom->partCount() < 1 )
     return false;
 
   QgsAbstractGeometry *firstPart = multiGeom->geometryN( 0 )->clone();
   detach( false );
 
-  d->geometry = firstPart;
+  d->setGeometry( firstPart );
   return true;
 }
 
 QgsPointXY QgsGeometry::asPoint() const
 {
-  if ( !d->geometry || QgsWkbTypes::flatType( d->geometry->wkbType() ) != QgsWkbTypes::Point )
+  if ( !d->geometry() || QgsWkbTypes::flatType( d->geometry()->wkbType() ) != QgsWkbTypes::Point )
   {
     return QgsPointXY();
   }
-  QgsPoint *pt = qgsgeometry_cast<QgsPoint *>( d->geometry );
+  QgsPoint *pt = qgsgeometry_cast<QgsPoint *>( d->geometry() );
   if ( !pt )
   {
     return QgsPointXY();
@@ -1322,17 +1503,17 @@ QgsPointXY QgsGeometry::asPoint() const
 QgsPolyline QgsGeometry::asPolyline() const
 {
   QgsPolyline polyLine;
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return polyLine;
   }
 
-  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::CompoundCurve
-                          || QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::CircularString );
+  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::CompoundCurve
+                          || QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::CircularString );
   QgsLineString *line = nullptr;
   if ( doSegmentation )
   {
-    QgsCurve *curve = qgsgeometry_cast<QgsCurve *>( d->geometry );
+    QgsCurve *curve = qgsgeometry_cast<QgsCurve *>( d->geometry() );
     if ( !curve )
     {
       return polyLine;
@@ -1341,7 +1522,7 @@ QgsPolyline QgsGeometry::asPolyline() const
   }
   else
   {
-    line = qgsgeometry_cast<QgsLineString *>( d->geometry );
+    line = qgsgeometry_cast<QgsLineString *>( d->geometry() );
     if ( !line )
     {
       return polyLine;
@@ -1366,15 +1547,15 @@ QgsPolyline QgsGeometry::asPolyline() const
 
 QgsPolygon QgsGeometry::asPolygon() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return QgsPolygon();
 
-  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::CurvePolygon );
+  bool doSegmentation = ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::CurvePolygon );
 
   QgsPolygonV2 *p = nullptr;
   if ( doSegmentation )
   {
-    QgsCurvePolygon *curvePoly = qgsgeometry_cast<QgsCurvePolygon *>( d->geometry );
+    QgsCurvePolygon *curvePoly = qgsgeometry_cast<QgsCurvePolygon *>( d->geometry() );
     if ( !curvePoly )
     {
       return QgsPolygon();
@@ -1383,7 +1564,7 @@ QgsPolygon QgsGeometry::asPolygon() const
   }
   else
   {
-    p = qgsgeometry_cast<QgsPolygonV2 *>( d->geometry );
+    p = qgsgeometry_cast<QgsPolygonV2 *>( d->geometry() );
   }
 
   if ( !p )
@@ -1403,12 +1584,12 @@ QgsPolygon QgsGeometry::asPolygon() const
 
 QgsMultiPoint QgsGeometry::asMultiPoint() const
 {
-  if ( !d->geometry || QgsWkbTypes::flatType( d->geometry->wkbType() ) != QgsWkbTypes::MultiPoint )
+  if ( !d->geometry() || QgsWkbTypes::flatType( d->geometry()->wkbType() ) != QgsWkbTypes::MultiPoint )
   {
     return QgsMultiPoint();
   }
 
-  const QgsMultiPointV2 *mp = qgsgeometry_cast<QgsMultiPointV2 *>( d->geometry );
+  const QgsMultiPointV2 *mp = qgsgeometry_cast<QgsMultiPointV2 *>( d->geometry() );
   if ( !mp )
   {
     return QgsMultiPoint();
@@ -1427,12 +1608,12 @@ QgsMultiPoint QgsGeometry::asMultiPoint() const
 
 QgsMultiPolyline QgsGeometry::asMultiPolyline() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsMultiPolyline();
   }
 
-  QgsGeometryCollection *geomCollection = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *geomCollection = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry() );
   if ( !geomCollection )
   {
     return QgsMultiPolyline();
@@ -1476,12 +1657,12 @@ QgsMultiPolyline QgsGeometry::asMultiPolyline() const
 
 QgsMultiPolygon QgsGeometry::asMultiPolygon() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsMultiPolygon();
   }
 
-  QgsGeometryCollection *geomCollection = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *geomCollection = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry() );
   if ( !geomCollection )
   {
     return QgsMultiPolygon();
@@ -1519,17 +1700,17 @@ QgsMultiPolygon QgsGeometry::asMultiPolygon() const
 
 double QgsGeometry::area() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1.0;
   }
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
 
 #if 0
   //debug: compare geos area with calculation in QGIS
   double geosArea = g.area();
   double qgisArea = 0;
-  QgsSurface *surface = qgsgeometry_cast<QgsSurface *>( d->geometry );
+  QgsSurface *surface = qgsgeometry_cast<QgsSurface *>( d->geometry() );
   if ( surface )
   {
     qgisArea = surface->area();
@@ -1542,59 +1723,59 @@ double QgsGeometry::area() const
 
 double QgsGeometry::length() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1.0;
   }
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   mLastError.clear();
   return g.length( &mLastError );
 }
 
 double QgsGeometry::distance( const QgsGeometry &geom ) const
 {
-  if ( !d->geometry || !geom.d->geometry )
+  if ( !d->geometry() || !geom.d->geometry() )
   {
     return -1.0;
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   mLastError.clear();
-  return g.distance( geom.d->geometry, &mLastError );
+  return g.distance( geom.d->geometry(), &mLastError );
 }
 
 double QgsGeometry::hausdorffDistance( const QgsGeometry &geom ) const
 {
-  if ( !d->geometry || !geom.d->geometry )
+  if ( !d->geometry() || !geom.d->geometry() )
   {
     return -1.0;
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   mLastError.clear();
-  return g.hausdorffDistance( geom.d->geometry, &mLastError );
+  return g.hausdorffDistance( geom.d->geometry(), &mLastError );
 }
 
 double QgsGeometry::hausdorffDistanceDensify( const QgsGeometry &geom, double densifyFraction ) const
 {
-  if ( !d->geometry || !geom.d->geometry )
+  if ( !d->geometry() || !geom.d->geometry() )
   {
     return -1.0;
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   mLastError.clear();
-  return g.hausdorffDistanceDensify( geom.d->geometry, densifyFraction, &mLastError );
+  return g.hausdorffDistanceDensify( geom.d->geometry(), densifyFraction, &mLastError );
 }
 
 QgsGeometry QgsGeometry::buffer( double distance, int segments ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   mLastError.clear();
   std::unique_ptr<QgsAbstractGeometry> geom( g.buffer( distance, segments, &mLastError ) );
   if ( !geom )
@@ -1608,12 +1789,12 @@ QgsGeometry QgsGeometry::buffer( double distance, int segments ) const
 
 QgsGeometry QgsGeometry::buffer( double distance, int segments, EndCapStyle endCapStyle, JoinStyle joinStyle, double miterLimit ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   mLastError.clear();
   QgsAbstractGeometry *geom = g.buffer( distance, segments, endCapStyle, joinStyle, miterLimit, &mLastError );
   if ( !geom )
@@ -1627,12 +1808,12 @@ QgsGeometry QgsGeometry::buffer( double distance, int segments, EndCapStyle endC
 
 QgsGeometry QgsGeometry::offsetCurve( double distance, int segments, JoinStyle joinStyle, double miterLimit ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::LineGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::LineGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     const QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -1654,7 +1835,7 @@ QgsGeometry QgsGeometry::offsetCurve( double distance, int segments, JoinStyle j
   }
   else
   {
-    QgsGeos geos( d->geometry );
+    QgsGeos geos( d->geometry() );
     mLastError.clear();
     QgsAbstractGeometry *offsetGeom = geos.offsetCurve( distance, segments, joinStyle, miterLimit, &mLastError );
     if ( !offsetGeom )
@@ -1669,12 +1850,12 @@ QgsGeometry QgsGeometry::offsetCurve( double distance, int segments, JoinStyle j
 
 QgsGeometry QgsGeometry::singleSidedBuffer( double distance, int segments, BufferSide side, JoinStyle joinStyle, double miterLimit ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::LineGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::LineGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     const QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -1696,7 +1877,7 @@ QgsGeometry QgsGeometry::singleSidedBuffer( double distance, int segments, Buffe
   }
   else
   {
-    QgsGeos geos( d->geometry );
+    QgsGeos geos( d->geometry() );
     mLastError.clear();
     QgsAbstractGeometry *bufferGeom = geos.singleSidedBuffer( distance, segments, side,
                                       joinStyle, miterLimit, &mLastError );
@@ -1712,12 +1893,12 @@ QgsGeometry QgsGeometry::singleSidedBuffer( double distance, int segments, Buffe
 
 QgsGeometry QgsGeometry::extendLine( double startDistance, double endDistance ) const
 {
-  if ( !d->geometry || type() != QgsWkbTypes::LineGeometry )
+  if ( !d->geometry() || type() != QgsWkbTypes::LineGeometry )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::isMultiType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isMultiType( d->geometry()->wkbType() ) )
   {
     const QList<QgsGeometry> parts = asGeometryCollection();
     QList<QgsGeometry> results;
@@ -1739,7 +1920,7 @@ QgsGeometry QgsGeometry::extendLine( double startDistance, double endDistance )
   }
   else
   {
-    QgsLineString *line = qgsgeometry_cast< QgsLineString * >( d->geometry );
+    QgsLineString *line = qgsgeometry_cast< QgsLineString * >( d->geometry() );
     if ( !line )
       return QgsGeometry();
 
@@ -1751,12 +1932,12 @@ QgsGeometry QgsGeometry::extendLine( double startDistance, double endDistance )
 
 QgsGeometry QgsGeometry::simplify( double tolerance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsAbstractGeometry *simplifiedGeom = geos.simplify( tolerance, &mLastError );
   if ( !simplifiedGeom )
@@ -1784,12 +1965,12 @@ QgsGeometry QgsGeometry::densifyByDistance( double distance ) const
 
 QgsGeometry QgsGeometry::centroid() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   mLastError.clear();
   QgsGeometry result( geos.centroid( &mLastError ) );
@@ -1799,12 +1980,12 @@ QgsGeometry QgsGeometry::centroid() const
 
 QgsGeometry QgsGeometry::pointOnSurface() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   mLastError.clear();
   QgsGeometry result( geos.pointOnSurface( &mLastError ) );
@@ -1821,11 +2002,11 @@ QgsGeometry QgsGeometry::poleOfInaccessibility( double precision, double *distan
 
 QgsGeometry QgsGeometry::convexHull() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsAbstractGeometry *cHull = geos.convexHull( &mLastError );
   if ( !cHull )
@@ -1839,12 +2020,12 @@ QgsGeometry QgsGeometry::convexHull() const
 
 QgsGeometry QgsGeometry::voronoiDiagram( const QgsGeometry &extent, double tolerance, bool edgesOnly ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsGeometry result = geos.voronoiDiagram( extent.geometry(), tolerance, edgesOnly, &mLastError );
   result.mLastError = mLastError;
@@ -1853,12 +2034,12 @@ QgsGeometry QgsGeometry::voronoiDiagram( const QgsGeometry &extent, double toler
 
 QgsGeometry QgsGeometry::delaunayTriangulation( double tolerance, bool edgesOnly ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsGeometry result = geos.delaunayTriangulation( tolerance, edgesOnly );
   result.mLastError = mLastError;
@@ -1867,16 +2048,16 @@ QgsGeometry QgsGeometry::delaunayTriangulation( double tolerance, bool edgesOnly
 
 QgsGeometry QgsGeometry::subdivide( int maxNodes ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  const QgsAbstractGeometry *geom = d->geometry;
+  const QgsAbstractGeometry *geom = d->geometry();
   std::unique_ptr< QgsAbstractGeometry > segmentizedCopy;
-  if ( QgsWkbTypes::isCurvedType( d->geometry->wkbType() ) )
+  if ( QgsWkbTypes::isCurvedType( d->geometry()->wkbType() ) )
   {
-    segmentizedCopy.reset( d->geometry->segmentize() );
+    segmentizedCopy.reset( d->geometry()->segmentize() );
     geom = segmentizedCopy.get();
   }
 
@@ -1894,14 +2075,14 @@ QgsGeometry QgsGeometry::subdivide( int maxNodes ) const
 
 QgsGeometry QgsGeometry::interpolate( double distance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
   QgsGeometry line = *this;
   if ( type() == QgsWkbTypes::PolygonGeometry )
-    line = QgsGeometry( d->geometry->boundary() );
+    line = QgsGeometry( d->geometry()->boundary() );
 
   QgsGeos geos( line.geometry() );
   mLastError.clear();
@@ -1926,24 +2107,24 @@ double QgsGeometry::lineLocatePoint( const QgsGeometry &point ) const
   QgsGeometry segmentized = *this;
   if ( QgsWkbTypes::isCurvedType( wkbType() ) )
   {
-    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry )->segmentize() );
+    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry() )->segmentize() );
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.lineLocatePoint( *( static_cast< QgsPoint * >( point.d->geometry ) ), &mLastError );
+  return geos.lineLocatePoint( *( static_cast< QgsPoint * >( point.d->geometry() ) ), &mLastError );
 }
 
 double QgsGeometry::interpolateAngle( double distance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return 0.0;
 
   // always operate on segmentized geometries
   QgsGeometry segmentized = *this;
   if ( QgsWkbTypes::isCurvedType( wkbType() ) )
   {
-    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry )->segmentize() );
+    segmentized = QgsGeometry( static_cast< QgsCurve * >( d->geometry() )->segmentize() );
   }
 
   QgsVertexId previous;
@@ -1990,15 +2171,15 @@ double QgsGeometry::interpolateAngle( double distance ) const
 
 QgsGeometry QgsGeometry::intersection( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   mLastError.clear();
-  QgsAbstractGeometry *resultGeom = geos.intersection( geometry.d->geometry, &mLastError );
+  QgsAbstractGeometry *resultGeom = geos.intersection( geometry.d->geometry(), &mLastError );
 
   if ( !resultGeom )
   {
@@ -2012,14 +2193,14 @@ QgsGeometry QgsGeometry::intersection( const QgsGeometry &geometry ) const
 
 QgsGeometry QgsGeometry::combine( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  QgsAbstractGeometry *resultGeom = geos.combine( geometry.d->geometry, &mLastError );
+  QgsAbstractGeometry *resultGeom = geos.combine( geometry.d->geometry(), &mLastError );
   if ( !resultGeom )
   {
     QgsGeometry geom;
@@ -2031,18 +2212,18 @@ QgsGeometry QgsGeometry::combine( const QgsGeometry &geometry ) const
 
 QgsGeometry QgsGeometry::mergeLines() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry();
   }
 
-  if ( QgsWkbTypes::flatType( d->geometry->wkbType() ) == QgsWkbTypes::LineString )
+  if ( QgsWkbTypes::flatType( d->geometry()->wkbType() ) == QgsWkbTypes::LineString )
   {
     // special case - a single linestring was passed
     return QgsGeometry( *this );
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsGeometry result = geos.mergeLines( &mLastError );
   result.mLastError = mLastError;
@@ -2051,15 +2232,15 @@ QgsGeometry QgsGeometry::mergeLines() const
 
 QgsGeometry QgsGeometry::difference( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   mLastError.clear();
-  QgsAbstractGeometry *resultGeom = geos.difference( geometry.d->geometry, &mLastError );
+  QgsAbstractGeometry *resultGeom = geos.difference( geometry.d->geometry(), &mLastError );
   if ( !resultGeom )
   {
     QgsGeometry geom;
@@ -2071,15 +2252,15 @@ QgsGeometry QgsGeometry::difference( const QgsGeometry &geometry ) const
 
 QgsGeometry QgsGeometry::symDifference( const QgsGeometry &geometry ) const
 {
-  if ( !d->geometry || geometry.isNull() )
+  if ( !d->geometry() || geometry.isNull() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   mLastError.clear();
-  QgsAbstractGeometry *resultGeom = geos.symDifference( geometry.d->geometry, &mLastError );
+  QgsAbstractGeometry *resultGeom = geos.symDifference( geometry.d->geometry(), &mLastError );
   if ( !resultGeom )
   {
     QgsGeometry geom;
@@ -2098,18 +2279,21 @@ QgsGeometry QgsGeometry::extrude( double x, double y )
 
 QByteArray QgsGeometry::exportToWkb() const
 {
-  return d->geometry ? d->geometry->asWkb() : QByteArray();
+  if ( d->isLazy() )
+    return d->wkb;
+
+  return d->geometry() ? d->geometry()->asWkb() : QByteArray();
 }
 
 QList<QgsGeometry> QgsGeometry::asGeometryCollection() const
 {
   QList<QgsGeometry> geometryList;
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return geometryList;
   }
 
-  QgsGeometryCollection *gc = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry );
+  QgsGeometryCollection *gc = qgsgeometry_cast<QgsGeometryCollection *>( d->geometry() );
   if ( gc )
   {
     int numGeom = gc->numGeometries();
@@ -2121,7 +2305,7 @@ QList<QgsGeometry> QgsGeometry::asGeometryCollection() const
   }
   else //a singlepart geometry
   {
-    geometryList.append( QgsGeometry( d->geometry->clone() ) );
+    geometryList.append( QgsGeometry( d->geometry()->clone() ) );
   }
 
   return geometryList;
@@ -2164,19 +2348,19 @@ QPolygonF QgsGeometry::asQPolygonF() const
 
 bool QgsGeometry::deleteRing( int ringNum, int partNum )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   detach( true );
-  bool ok = QgsGeometryEditUtils::deleteRing( d->geometry, ringNum, partNum );
+  bool ok = QgsGeometryEditUtils::deleteRing( d->geometry(), ringNum, partNum );
   return ok;
 }
 
 bool QgsGeometry::deletePart( int partNum )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -2188,22 +2372,22 @@ bool QgsGeometry::deletePart( int partNum )
   }
 
   detach( true );
-  bool ok = QgsGeometryEditUtils::deletePart( d->geometry, partNum );
+  bool ok = QgsGeometryEditUtils::deletePart( d->geometry(), partNum );
   return ok;
 }
 
 int QgsGeometry::avoidIntersections( const QList<QgsVectorLayer *> &avoidIntersectionsLayers, const QHash<QgsVectorLayer *, QSet<QgsFeatureId> > &ignoreFeatures )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
-  std::unique_ptr< QgsAbstractGeometry > diffGeom = QgsGeometryEditUtils::avoidIntersections( *( d->geometry ), avoidIntersectionsLayers, ignoreFeatures );
+  std::unique_ptr< QgsAbstractGeometry > diffGeom = QgsGeometryEditUtils::avoidIntersections( *( d->geometry() ), avoidIntersectionsLayers, ignoreFeatures );
   if ( diffGeom )
   {
     detach( false );
-    d->geometry = diffGeom.release();
+    d->setGeometry( diffGeom.release() );
   }
   return 0;
 }
@@ -2211,11 +2395,11 @@ int QgsGeometry::avoidIntersections( const QList<QgsVectorLayer *> &avoidInterse
 
 QgsGeometry QgsGeometry::makeValid()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return QgsGeometry();
 
   mLastError.clear();
-  QgsAbstractGeometry *g = _qgis_lwgeom_make_valid( d->geometry, mLastError );
+  QgsAbstractGeometry *g = _qgis_lwgeom_make_valid( d->geometry(), mLastError );
 
   QgsGeometry result = QgsGeometry( g );
   result.mLastError = mLastError;
@@ -2230,36 +2414,36 @@ void QgsGeometry::validateGeometry( QList<QgsGeometry::Error> &errors, Validatio
 
 bool QgsGeometry::isGeosValid() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   return geos.isValid( &mLastError );
 }
 
 bool QgsGeometry::isSimple() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return false;
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   return geos.isSimple( &mLastError );
 }
 
 bool QgsGeometry::isGeosEqual( const QgsGeometry &g ) const
 {
-  if ( !d->geometry || !g.d->geometry )
+  if ( !d->geometry() || !g.d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
-  return geos.isEqual( g.d->geometry, &mLastError );
+  return geos.isEqual( g.d->geometry(), &mLastError );
 }
 
 QgsGeometry QgsGeometry::unaryUnion( const QList<QgsGeometry> &geometries )
@@ -2305,68 +2489,68 @@ QgsGeometry QgsGeometry::polygonize( const QList<QgsGeometry> &geometryList )
 
 void QgsGeometry::convertToStraightSegment()
 {
-  if ( !d->geometry || !requiresConversionToStraightSegments() )
+  if ( !d->geometry() || !requiresConversionToStraightSegments() )
   {
     return;
   }
 
-  QgsAbstractGeometry *straightGeom = d->geometry->segmentize();
+  QgsAbstractGeometry *straightGeom = d->geometry()->segmentize();
   detach( false );
 
-  d->geometry = straightGeom;
+  d->setGeometry( straightGeom );
 }
 
 bool QgsGeometry::requiresConversionToStraightSegments() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  return d->geometry->hasCurvedSegments();
+  return d->geometry()->hasCurvedSegments();
 }
 
 QgsGeometry::OperationResult QgsGeometry::transform( const QgsCoordinateTransform &ct )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry::InvalidBaseGeometry;
   }
 
   detach();
-  d->geometry->transform( ct );
+  d->geometry()->transform( ct );
   return QgsGeometry::Success;
 }
 
 QgsGeometry::OperationResult QgsGeometry::transform( const QTransform &ct )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsGeometry::InvalidBaseGeometry;
   }
 
   detach();
-  d->geometry->transform( ct );
+  d->geometry()->transform( ct );
   return QgsGeometry::Success;
 }
 
 void QgsGeometry::mapToPixel( const QgsMapToPixel &mtp )
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
     detach();
-    d->geometry->transform( mtp.transform() );
+    d->geometry()->transform( mtp.transform() );
   }
 }
 
 QgsGeometry QgsGeometry::clipped( const QgsRectangle &rectangle )
 {
-  if ( !d->geometry || rectangle.isNull() || rectangle.isEmpty() )
+  if ( !d->geometry() || rectangle.isNull() || rectangle.isEmpty() )
   {
     return QgsGeometry();
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   mLastError.clear();
   QgsAbstractGeometry *resultGeom = geos.clip( rectangle, &mLastError );
   if ( !resultGeom )
@@ -2380,9 +2564,9 @@ QgsGeometry QgsGeometry::clipped( const QgsRectangle &rectangle )
 
 void QgsGeometry::draw( QPainter &p ) const
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
-    d->geometry->draw( p );
+    d->geometry()->draw( p );
   }
 }
 
@@ -2465,19 +2649,19 @@ static bool vertexIndexInfo( const QgsAbstractGeometry *g, int vertexIndex, int
 
 bool QgsGeometry::vertexIdFromVertexNr( int nr, QgsVertexId &id ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   id.type = QgsVertexId::SegmentVertex;
 
-  bool res = vertexIndexInfo( d->geometry, nr, id.part, id.ring, id.vertex );
+  bool res = vertexIndexInfo( d->geometry(), nr, id.part, id.ring, id.vertex );
   if ( !res )
     return false;
 
   // now let's find out if it is a straight or circular segment
-  const QgsAbstractGeometry *g = d->geometry;
+  const QgsAbstractGeometry *g = d->geometry();
   if ( const QgsGeometryCollection *geomCollection = qgsgeometry_cast<const QgsGeometryCollection *>( g ) )
   {
     g = geomCollection->geometryN( id.part );
@@ -2501,12 +2685,12 @@ bool QgsGeometry::vertexIdFromVertexNr( int nr, QgsVertexId &id ) const
 
 int QgsGeometry::vertexNrFromVertexId( QgsVertexId id ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
 
-  QgsCoordinateSequence coords = d->geometry->coordinateSequence();
+  QgsCoordinateSequence coords = d->geometry()->coordinateSequence();
 
   int vertexCount = 0;
   for ( int part = 0; part < coords.size(); ++part )
@@ -2555,7 +2739,7 @@ void QgsGeometry::convertPointList( const QgsPointSequence &input, QList<QgsPoin
 
 QgsGeometry::operator bool() const
 {
-  return d->geometry;
+  return d->geometry();
 }
 
 void QgsGeometry::convertToPolyline( const QgsPointSequence &input, QgsPolyline &output )
@@ -2669,12 +2853,12 @@ bool QgsGeometry::compare( const QgsMultiPolygon &p1, const QgsMultiPolygon &p2,
 
 QgsGeometry QgsGeometry::smooth( const unsigned int iterations, const double offset, double minimumDistance, double maxAngle ) const
 {
-  if ( !d->geometry || d->geometry->isEmpty() )
+  if ( !d->geometry() || d->geometry()->isEmpty() )
     return QgsGeometry();
 
   QgsGeometry geom = *this;
   if ( QgsWkbTypes::isCurvedType( wkbType() ) )
-    geom = QgsGeometry( d->geometry->segmentize() );
+    geom = QgsGeometry( d->geometry()->segmentize() );
 
   switch ( QgsWkbTypes::flatType( geom.wkbType() ) )
   {
@@ -2685,13 +2869,13 @@ QgsGeometry QgsGeometry::smooth( const unsigned int iterations, const double off
 
     case QgsWkbTypes::LineString:
     {
-      QgsLineString *lineString = static_cast< QgsLineString * >( d->geometry );
+      QgsLineString *lineString = static_cast< QgsLineString * >( d->geometry() );
       return QgsGeometry( smoothLine( *lineString, iterations, offset, minimumDistance, maxAngle ) );
     }
 
     case QgsWkbTypes::MultiLineString:
     {
-      QgsMultiLineString *multiLine = static_cast< QgsMultiLineString * >( d->geometry );
+      QgsMultiLineString *multiLine = static_cast< QgsMultiLineString * >( d->geometry() );
 
       QgsMultiLineString *resultMultiline = new QgsMultiLineString();
       for ( int i = 0; i < multiLine->numGeometries(); ++i )
@@ -2703,13 +2887,13 @@ QgsGeometry QgsGeometry::smooth( const unsigned int iterations, const double off
 
     case QgsWkbTypes::Polygon:
     {
-      QgsPolygonV2 *poly = static_cast< QgsPolygonV2 * >( d->geometry );
+      QgsPolygonV2 *poly = static_cast< QgsPolygonV2 * >( d->geometry() );
       return QgsGeometry( smoothPolygon( *poly, iterations, offset, minimumDistance, maxAngle ) );
     }
 
     case QgsWkbTypes::MultiPolygon:
     {
-      QgsMultiPolygonV2 *multiPoly = static_cast< QgsMultiPolygonV2 * >( d->geometry );
+      QgsMultiPolygonV2 *multiPoly = static_cast< QgsMultiPolygonV2 * >( d->geometry() );
 
       QgsMultiPolygonV2 *resultMultiPoly = new QgsMultiPolygonV2();
       for ( int i = 0; i < multiPoly->numGeometries(); ++i )
@@ -197,10 +197,25 @@ class CORE_EXPORT QgsGeometry
 
     /**
      * Set the geometry, feeding in the buffer containing OGC Well-Known Binary
+     *
+     * Line and polygon geometries keep a reference to the WKB and are only parsed
+     * when their content is first accessed, their type and bounding box being read
+     * directly from the WKB. The buffer must therefore own its data.
      * \since QGIS 3.0
      */
     void fromWkb( const QByteArray &wkb );
 
+    /**
+     * Returns the Well-Known Binary the geometry was created from with fromWkb(),
+     * if the geometry has not been parsed yet. Returns an empty array otherwise.
+     *
+     * This allows reading the vertices of geometries fetched from providers without
+     * building the whole geometry, e.g. to simplify them for rendering.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    QByteArray sourceWkb() const SIP_SKIP;
+
     /**
      * Returns a geos geometry - caller takes ownership of the object (should be deleted with GEOSGeom_destroy_r)
      *  \param precision The precision of the grid to which to snap the geometry vertices. If 0, no snapping is performed.
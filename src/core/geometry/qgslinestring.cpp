@@ -456,6 +456,16 @@ double QgsLineString::mAt( int index ) const
     return std::numeric_limits<double>::quiet_NaN();
 }
 
+const double *QgsLineString::xData() const
+{
+  return mX.constData();
+}
+
+const double *QgsLineString::yData() const
+{
+  return mY.constData();
+}
+
 void QgsLineString::setXAt( int index, double x )
 {
   if ( index >= 0 && index < mX.size() )
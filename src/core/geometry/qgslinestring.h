@@ -101,6 +101,22 @@ class CORE_EXPORT QgsLineString: public QgsCurve
      */
     double mAt( int index ) const;
 
+    /**
+     * Returns a const pointer to the x vertex data.
+     * \note not available in Python bindings
+     * \see yData()
+     * \since QGIS 3.0
+     */
+    const double *xData() const SIP_SKIP;
+
+    /**
+     * Returns a const pointer to the y vertex data.
+     * \note not available in Python bindings
+     * \see xData()
+     * \since QGIS 3.0
+     */
+    const double *yData() const SIP_SKIP;
+
     /**
      * Sets the x-coordinate of the specified node in the line string.
      * \param index index of node, where the first node in the line is 0. Corresponding
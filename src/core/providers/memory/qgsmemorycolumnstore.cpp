@@ -0,0 +1,916 @@
+/***************************************************************************
+    qgsmemorycolumnstore.cpp
+    ---------------------
+    begin                : October 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsmemorycolumnstore.h"
+
+#include "qgsexpression.h"
+#include "qgsexpressionnodeimpl.h"
+#include "qgsexpressionutils.h"
+#include "qgsstatisticalsummary.h"
+
+#include <cmath>
+#include <cstring>
+
+///@cond PRIVATE
+
+namespace
+{
+  enum Truth
+  {
+    IsFalse,
+    IsTrue,
+    IsUnknown,
+    //! The value can't be compared without an evaluation error
+    IsError,
+  };
+
+  //! Appends a bit to a bit array
+  void appendBit( QBitArray &bits, bool value )
+  {
+    int size = bits.size();
+    bits.resize( size + 1 );
+    bits.setBit( size, value );
+  }
+
+  //! Returns true if \a op is a comparison operator handled over columns
+  bool isComparison( QgsExpressionNodeBinaryOperator::BinaryOperator op )
+  {
+    switch ( op )
+    {
+      case QgsExpressionNodeBinaryOperator::boEQ:
+      case QgsExpressionNodeBinaryOperator::boNE:
+      case QgsExpressionNodeBinaryOperator::boLT:
+      case QgsExpressionNodeBinaryOperator::boGT:
+      case QgsExpressionNodeBinaryOperator::boLE:
+      case QgsExpressionNodeBinaryOperator::boGE:
+      case QgsExpressionNodeBinaryOperator::boIs:
+      case QgsExpressionNodeBinaryOperator::boIsNot:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  //! Same as QgsExpressionNodeBinaryOperator::compare()
+  bool compareDiff( int op, double diff )
+  {
+    switch ( op )
+    {
+      case QgsExpressionNodeBinaryOperator::boEQ:
+        return qgsDoubleNear( diff, 0.0 );
+      case QgsExpressionNodeBinaryOperator::boNE:
+        return !qgsDoubleNear( diff, 0.0 );
+      case QgsExpressionNodeBinaryOperator::boLT:
+        return diff < 0;
+      case QgsExpressionNodeBinaryOperator::boGT:
+        return diff > 0;
+      case QgsExpressionNodeBinaryOperator::boLE:
+        return diff <= 0;
+      case QgsExpressionNodeBinaryOperator::boGE:
+        return diff >= 0;
+      default:
+        return false;
+    }
+  }
+
+  bool isFiniteDouble( const QVariant &value )
+  {
+    bool ok = false;
+    double x = value.toDouble( &ok );
+    return ok && std::isfinite( x );
+  }
+
+  /**
+   * Compares two non list values with the same rules as QgsExpressionNodeBinaryOperator::evalNode(),
+   * for comparison and IS operators.
+   */
+  Truth compareValues( int op, const QVariant &vL, const QVariant &vR )
+  {
+    bool isOp = op == QgsExpressionNodeBinaryOperator::boIs || op == QgsExpressionNodeBinaryOperator::boIsNot;
+    if ( isOp )
+    {
+      bool expected = op == QgsExpressionNodeBinaryOperator::boIs;
+      if ( vL.isNull() && vR.isNull() )
+        return expected ? IsTrue : IsFalse;
+      else if ( vL.isNull() || vR.isNull() )
+        return expected ? IsFalse : IsTrue;
+    }
+    else if ( vL.isNull() || vR.isNull() )
+    {
+      return IsUnknown;
+    }
+
+    if ( QgsExpressionUtils::isDoubleSafe( vL ) && QgsExpressionUtils::isDoubleSafe( vR ) &&
+         ( vL.type() != QVariant::String || vR.type() != QVariant::String ) )
+    {
+      if ( !isFiniteDouble( vL ) || !isFiniteDouble( vR ) )
+        return IsError;
+
+      double fL = vL.toDouble();
+      double fR = vR.toDouble();
+      if ( isOp )
+        return qgsDoubleNear( fL, fR ) == ( op == QgsExpressionNodeBinaryOperator::boIs ) ? IsTrue : IsFalse;
+      return compareDiff( op, fL - fR ) ? IsTrue : IsFalse;
+    }
+
+    int diff = QString::compare( vL.toString(), vR.toString() );
+    if ( isOp )
+      return ( diff == 0 ) == ( op == QgsExpressionNodeBinaryOperator::boIs ) ? IsTrue : IsFalse;
+    return compareDiff( op, diff ) ? IsTrue : IsFalse;
+  }
+
+  //! Same as QgsExpressionNodeInOperator::evalNode(), for a value and a list of literals
+  Truth containsValue( const QVariant &value, const QVariantList &literals, bool notIn )
+  {
+    if ( literals.isEmpty() )
+      return notIn ? IsTrue : IsFalse;
+    if ( value.isNull() )
+      return IsUnknown;
+
+    bool listHasNull = false;
+    for ( const QVariant &literal : literals )
+    {
+      if ( literal.isNull() )
+      {
+        listHasNull = true;
+        continue;
+      }
+
+      bool equal = false;
+      if ( QgsExpressionUtils::isDoubleSafe( value ) && QgsExpressionUtils::isDoubleSafe( literal ) )
+      {
+        if ( !isFiniteDouble( value ) || !isFiniteDouble( literal ) )
+          return IsError;
+        equal = qgsDoubleNear( value.toDouble(), literal.toDouble() );
+      }
+      else
+      {
+        equal = QString::compare( value.toString(), literal.toString() ) == 0;
+      }
+
+      if ( equal )
+        return notIn ? IsFalse : IsTrue;
+    }
+
+    if ( listHasNull )
+      return IsUnknown;
+    return notIn ? IsTrue : IsFalse;
+  }
+
+  //! Returns the value of a literal node, accepting negated numeric literals
+  bool literalValue( const QgsExpressionNode *node, QVariant &value )
+  {
+    if ( node->nodeType() == QgsExpressionNode::ntLiteral )
+    {
+      value = static_cast< const QgsExpressionNodeLiteral * >( node )->value();
+      return true;
+    }
+
+    if ( node->nodeType() == QgsExpressionNode::ntUnaryOperator )
+    {
+      const QgsExpressionNodeUnaryOperator *unary = static_cast< const QgsExpressionNodeUnaryOperator * >( node );
+      if ( unary->op() != QgsExpressionNodeUnaryOperator::uoMinus || unary->operand()->nodeType() != QgsExpressionNode::ntLiteral )
+        return false;
+
+      QVariant v = static_cast< const QgsExpressionNodeLiteral * >( unary->operand() )->value();
+      if ( v.isNull() )
+      {
+        value = QVariant();
+        return true;
+      }
+      if ( v.type() == QVariant::Int || v.type() == QVariant::LongLong )
+      {
+        value = -v.toLongLong();
+        return true;
+      }
+      if ( v.type() == QVariant::Double )
+      {
+        value = -v.toDouble();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  //! Returns the statistic matching a numeric aggregate, same as QgsAggregateCalculator
+  bool numericStatistic( QgsAggregateCalculator::Aggregate aggregate, QgsStatisticalSummary::Statistic &stat )
+  {
+    switch ( aggregate )
+    {
+      case QgsAggregateCalculator::Count:
+        stat = QgsStatisticalSummary::Count;
+        return true;
+      case QgsAggregateCalculator::CountDistinct:
+        stat = QgsStatisticalSummary::Variety;
+        return true;
+      case QgsAggregateCalculator::CountMissing:
+        stat = QgsStatisticalSummary::CountMissing;
+        return true;
+      case QgsAggregateCalculator::Min:
+        stat = QgsStatisticalSummary::Min;
+        return true;
+      case QgsAggregateCalculator::Max:
+        stat = QgsStatisticalSummary::Max;
+        return true;
+      case QgsAggregateCalculator::Sum:
+        stat = QgsStatisticalSummary::Sum;
+        return true;
+      case QgsAggregateCalculator::Mean:
+        stat = QgsStatisticalSummary::Mean;
+        return true;
+      case QgsAggregateCalculator::Median:
+        stat = QgsStatisticalSummary::Median;
+        return true;
+      case QgsAggregateCalculator::StDev:
+        stat = QgsStatisticalSummary::StDev;
+        return true;
+      case QgsAggregateCalculator::StDevSample:
+        stat = QgsStatisticalSummary::StDevSample;
+        return true;
+      case QgsAggregateCalculator::Range:
+        stat = QgsStatisticalSummary::Range;
+        return true;
+      case QgsAggregateCalculator::Minority:
+        stat = QgsStatisticalSummary::Minority;
+        return true;
+      case QgsAggregateCalculator::Majority:
+        stat = QgsStatisticalSummary::Majority;
+        return true;
+      case QgsAggregateCalculator::FirstQuartile:
+        stat = QgsStatisticalSummary::FirstQuartile;
+        return true;
+      case QgsAggregateCalculator::ThirdQuartile:
+        stat = QgsStatisticalSummary::ThirdQuartile;
+        return true;
+      case QgsAggregateCalculator::InterQuartileRange:
+        stat = QgsStatisticalSummary::InterQuartileRange;
+        return true;
+      case QgsAggregateCalculator::StringMinimumLength:
+      case QgsAggregateCalculator::StringMaximumLength:
+      case QgsAggregateCalculator::StringConcatenate:
+      case QgsAggregateCalculator::GeometryCollect:
+      case QgsAggregateCalculator::ArrayAggregate:
+        return false;
+    }
+    return false;
+  }
+}
+
+QgsMemoryColumnStore::QgsMemoryColumnStore( const QgsFields &fields )
+{
+  for ( const QgsField &field : fields )
+    addColumn( field );
+}
+
+void QgsMemoryColumnStore::addFeature( const QgsFeature &feature )
+{
+  int row = mFeatureIds.count();
+  mFeatureIds.append( feature.id() );
+  mRows.insert( feature.id(), row );
+  appendBit( mDeleted, false );
+
+  const QgsAttributes attributes = feature.attributes();
+  for ( int i = 0; i < mColumns.count(); ++i )
+    appendValue( mColumns[i], i < attributes.count() ? attributes.at( i ) : QVariant() );
+
+  mGeometryOffsets.append( 0 );
+  mGeometrySizes.append( 0 );
+  mBoundingBoxes.append( QgsRectangle() );
+  if ( feature.hasGeometry() )
+  {
+    storeWkb( row, feature.geometry().exportToWkb() );
+    mBoundingBoxes[row] = feature.geometry().boundingBox();
+  }
+}
+
+bool QgsMemoryColumnStore::deleteFeature( QgsFeatureId fid )
+{
+  int row = mRows.value( fid, -1 );
+  if ( row < 0 )
+    return false;
+
+  mRows.remove( fid );
+  mDeleted.setBit( row );
+  mDeletedCount++;
+  mUnusedGeometryData += mGeometrySizes.at( row );
+  mGeometrySizes[row] = 0;
+
+  if ( mDeletedCount * 2 > rowCount() )
+    compact();
+  return true;
+}
+
+void QgsMemoryColumnStore::addColumn( const QgsField &field )
+{
+  Column column;
+  column.type = field.type();
+  switch ( field.type() )
+  {
+    case QVariant::Int:
+      column.storage = Int;
+      column.ints.fill( 0, rowCount() );
+      break;
+    case QVariant::LongLong:
+      column.storage = LongLong;
+      column.longLongs.fill( 0, rowCount() );
+      break;
+    case QVariant::Double:
+      column.storage = Double;
+      column.doubles.fill( 0, rowCount() );
+      break;
+    case QVariant::String:
+      column.storage = String;
+      column.codes.fill( -1, rowCount() );
+      break;
+    default:
+      column.storage = Variant;
+      column.variants.fill( QVariant(), rowCount() );
+      break;
+  }
+  column.nulls.fill( true, rowCount() );
+  mColumns.append( column );
+}
+
+void QgsMemoryColumnStore::removeColumn( int column )
+{
+  mColumns.remove( column );
+}
+
+QVariant QgsMemoryColumnStore::value( int row, int column ) const
+{
+  const Column &c = mColumns.at( column );
+  if ( c.storage == Variant )
+    return c.variants.at( row );
+  if ( c.nulls.testBit( row ) )
+    return QVariant( c.type );
+
+  switch ( c.storage )
+  {
+    case Int:
+      return c.ints.at( row );
+    case LongLong:
+      return static_cast< qlonglong >( c.longLongs.at( row ) );
+    case Double:
+      return c.doubles.at( row );
+    case String:
+      return c.dictionary.at( c.codes.at( row ) );
+    case Variant:
+      break;
+  }
+  return QVariant();
+}
+
+void QgsMemoryColumnStore::setValue( int row, int column, const QVariant &value )
+{
+  storeValue( mColumns[column], row, value );
+}
+
+void QgsMemoryColumnStore::appendValue( Column &column, const QVariant &value )
+{
+  switch ( column.storage )
+  {
+    case Int:
+      column.ints.append( 0 );
+      break;
+    case LongLong:
+      column.longLongs.append( 0 );
+      break;
+    case Double:
+      column.doubles.append( 0 );
+      break;
+    case String:
+      column.codes.append( -1 );
+      break;
+    case Variant:
+      column.variants.append( QVariant() );
+      break;
+  }
+  appendBit( column.nulls, true );
+  storeValue( column, column.nulls.size() - 1, value );
+}
+
+void QgsMemoryColumnStore::storeValue( Column &column, int row, const QVariant &value )
+{
+  bool ok = !value.isNull();
+  switch ( column.storage )
+  {
+    case Int:
+      column.ints[row] = ok ? value.toInt( &ok ) : 0;
+      break;
+    case LongLong:
+      column.longLongs[row] = ok ? value.toLongLong( &ok ) : 0;
+      break;
+    case Double:
+      column.doubles[row] = ok ? value.toDouble( &ok ) : 0;
+      break;
+    case String:
+    {
+      int code = -1;
+      if ( ok )
+      {
+        const QString string = value.toString();
+        QHash<QString, int>::const_iterator it = column.dictionaryIndex.constFind( string );
+        if ( it != column.dictionaryIndex.constEnd() )
+        {
+          code = it.value();
+        }
+        else
+        {
+          code = column.dictionary.count();
+          column.dictionary.append( string );
+          column.dictionaryIndex.insert( string, code );
+        }
+      }
+      column.codes[row] = code;
+      break;
+    }
+    case Variant:
+      column.variants[row] = value;
+      break;
+  }
+  column.nulls.setBit( row, !ok );
+}
+
+QgsGeometry QgsMemoryColumnStore::geometry( int row ) const
+{
+  QgsGeometry geometry;
+  int size = mGeometrySizes.at( row );
+  if ( size > 0 )
+    geometry.fromWkb( QByteArray( mGeometryData.constData() + mGeometryOffsets.at( row ), size ) );
+  return geometry;
+}
+
+void QgsMemoryColumnStore::setGeometry( int row, const QgsGeometry &geometry )
+{
+  if ( geometry.isNull() )
+  {
+    mUnusedGeometryData += mGeometrySizes.at( row );
+    mGeometrySizes[row] = 0;
+    mBoundingBoxes[row] = QgsRectangle();
+  }
+  else
+  {
+    storeWkb( row, geometry.exportToWkb() );
+    mBoundingBoxes[row] = geometry.boundingBox();
+  }
+
+  if ( mUnusedGeometryData * 2 > mGeometryData.size() )
+    compact();
+}
+
+void QgsMemoryColumnStore::storeWkb( int row, const QByteArray &wkb )
+{
+  int previousSize = mGeometrySizes.at( row );
+  if ( wkb.size() <= previousSize )
+  {
+    std::memcpy( mGeometryData.data() + mGeometryOffsets.at( row ), wkb.constData(), wkb.size() );
+    mUnusedGeometryData += previousSize - wkb.size();
+  }
+  else
+  {
+    mUnusedGeometryData += previousSize;
+    mGeometryOffsets[row] = mGeometryData.size();
+    mGeometryData.append( wkb );
+  }
+  mGeometrySizes[row] = wkb.size();
+}
+
+QgsRectangle QgsMemoryColumnStore::extent() const
+{
+  QgsRectangle extent;
+  extent.setMinimal();
+  for ( int row = 0; row < rowCount(); ++row )
+  {
+    if ( hasGeometry( row ) )
+      extent.combineExtentWith( mBoundingBoxes.at( row ) );
+  }
+  return extent;
+}
+
+void QgsMemoryColumnStore::readFeature( int row, QgsFeature &feature, bool fetchGeometry, const QgsAttributeList *attributes ) const
+{
+  feature.setId( mFeatureIds.at( row ) );
+
+  if ( fetchGeometry && hasGeometry( row ) )
+    feature.setGeometry( geometry( row ) );
+  else
+    feature.clearGeometry();
+
+  QgsAttributes values( mColumns.count() );
+  if ( attributes )
+  {
+    for ( int column : *attributes )
+    {
+      if ( column >= 0 && column < mColumns.count() )
+        values[column] = value( row, column );
+    }
+  }
+  else
+  {
+    for ( int column = 0; column < mColumns.count(); ++column )
+      values[column] = value( row, column );
+  }
+  feature.setAttributes( values );
+  feature.setValid( true );
+}
+
+void QgsMemoryColumnStore::compact()
+{
+  QgsMemoryColumnStore compacted;
+  for ( const Column &column : qgsAsConst( mColumns ) )
+  {
+    Column c;
+    c.storage = column.storage;
+    c.type = column.type;
+    compacted.mColumns.append( c );
+  }
+
+  compacted.mFeatureIds.reserve( featureCount() );
+  for ( int row = 0; row < rowCount(); ++row )
+  {
+    if ( mDeleted.testBit( row ) )
+      continue;
+
+    int newRow = compacted.mFeatureIds.count();
+    compacted.mFeatureIds.append( mFeatureIds.at( row ) );
+    compacted.mRows.insert( mFeatureIds.at( row ), newRow );
+
+    for ( int i = 0; i < mColumns.count(); ++i )
+      compacted.appendValue( compacted.mColumns[i], value( row, i ) );
+
+    compacted.mGeometryOffsets.append( 0 );
+    compacted.mGeometrySizes.append( 0 );
+    compacted.mBoundingBoxes.append( mBoundingBoxes.at( row ) );
+    if ( hasGeometry( row ) )
+      compacted.storeWkb( newRow, QByteArray::fromRawData( mGeometryData.constData() + mGeometryOffsets.at( row ), mGeometrySizes.at( row ) ) );
+  }
+  compacted.mDeleted.fill( false, compacted.mFeatureIds.count() );
+
+  mColumns = compacted.mColumns;
+  mFeatureIds = compacted.mFeatureIds;
+  mRows = compacted.mRows;
+  mDeleted = compacted.mDeleted;
+  mDeletedCount = 0;
+  mGeometryData = compacted.mGeometryData;
+  mGeometryOffsets = compacted.mGeometryOffsets;
+  mGeometrySizes = compacted.mGeometrySizes;
+  mBoundingBoxes = compacted.mBoundingBoxes;
+  mUnusedGeometryData = 0;
+}
+
+bool QgsMemoryColumnStore::filter( const QgsExpression &expression, const QgsFields &fields, QBitArray &rows ) const
+{
+  if ( expression.hasParserError() || !expression.rootNode() )
+    return false;
+
+  Predicate result;
+  if ( !evaluate( expression.rootNode(), fields, result ) )
+    return false;
+
+  rows = result.isTrue;
+  return true;
+}
+
+bool QgsMemoryColumnStore::evaluate( const QgsExpressionNode *node, const QgsFields &fields, Predicate &result ) const
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpressionNode::ntUnaryOperator:
+    {
+      const QgsExpressionNodeUnaryOperator *unary = static_cast< const QgsExpressionNodeUnaryOperator * >( node );
+      if ( unary->op() != QgsExpressionNodeUnaryOperator::uoNot )
+        return false;
+
+      Predicate operand;
+      if ( !evaluate( unary->operand(), fields, operand ) )
+        return false;
+
+      result.isTrue = ~( operand.isTrue | operand.isNull );
+      result.isNull = operand.isNull;
+      return true;
+    }
+
+    case QgsExpressionNode::ntBinaryOperator:
+    {
+      const QgsExpressionNodeBinaryOperator *binary = static_cast< const QgsExpressionNodeBinaryOperator * >( node );
+      if ( binary->op() == QgsExpressionNodeBinaryOperator::boAnd || binary->op() == QgsExpressionNodeBinaryOperator::boOr )
+      {
+        Predicate left;
+        Predicate right;
+        if ( !evaluate( binary->opLeft(), fields, left ) || !evaluate( binary->opRight(), fields, right ) )
+          return false;
+
+        QBitArray leftFalse = ~( left.isTrue | left.isNull );
+        QBitArray rightFalse = ~( right.isTrue | right.isNull );
+        QBitArray isFalse;
+        if ( binary->op() == QgsExpressionNodeBinaryOperator::boAnd )
+        {
+          result.isTrue = left.isTrue & right.isTrue;
+          isFalse = leftFalse | rightFalse;
+        }
+        else
+        {
+          result.isTrue = left.isTrue | right.isTrue;
+          isFalse = leftFalse & rightFalse;
+        }
+        result.isNull = ~( result.isTrue | isFalse );
+        return true;
+      }
+
+      if ( !isComparison( binary->op() ) )
+        return false;
+
+      bool columnOnLeft = binary->opLeft()->nodeType() == QgsExpressionNode::ntColumnRef;
+      const QgsExpressionNode *columnNode = columnOnLeft ? binary->opLeft() : binary->opRight();
+      const QgsExpressionNode *literalNode = columnOnLeft ? binary->opRight() : binary->opLeft();
+      if ( columnNode->nodeType() != QgsExpressionNode::ntColumnRef )
+        return false;
+
+      QVariant literal;
+      if ( !literalValue( literalNode, literal ) )
+        return false;
+
+      int column = fields.lookupField( static_cast< const QgsExpressionNodeColumnRef * >( columnNode )->name() );
+      if ( column < 0 || column >= mColumns.count() )
+        return false;
+
+      return compare( column, binary->op(), literal, columnOnLeft, result );
+    }
+
+    case QgsExpressionNode::ntInOperator:
+    {
+      const QgsExpressionNodeInOperator *in = static_cast< const QgsExpressionNodeInOperator * >( node );
+      if ( in->node()->nodeType() != QgsExpressionNode::ntColumnRef )
+        return false;
+
+      int column = fields.lookupField( static_cast< const QgsExpressionNodeColumnRef * >( in->node() )->name() );
+      if ( column < 0 || column >= mColumns.count() )
+        return false;
+
+      QVariantList literals;
+      const QList< QgsExpressionNode * > nodeList = in->list()->list();
+      for ( const QgsExpressionNode *n : nodeList )
+      {
+        QVariant literal;
+        if ( !literalValue( n, literal ) )
+          return false;
+        literals << literal;
+      }
+
+      return contains( column, literals, in->isNotIn(), result );
+    }
+
+    case QgsExpressionNode::ntFunction:
+    case QgsExpressionNode::ntLiteral:
+    case QgsExpressionNode::ntColumnRef:
+    case QgsExpressionNode::ntCondition:
+      return false;
+  }
+  return false;
+}
+
+bool QgsMemoryColumnStore::compare( int column, int op, const QVariant &literal, bool columnOnLeft, Predicate &result ) const
+{
+  const Column &c = mColumns.at( column );
+  int rows = rowCount();
+  result.isTrue = QBitArray( rows );
+  result.isNull = QBitArray( rows );
+
+  bool isOp = op == QgsExpressionNodeBinaryOperator::boIs || op == QgsExpressionNodeBinaryOperator::boIsNot;
+  if ( literal.isNull() )
+  {
+    // NULL literals only depend on the null bitmap
+    if ( !isOp )
+      result.isNull.fill( true );
+    else if ( op == QgsExpressionNodeBinaryOperator::boIs )
+      result.isTrue = c.nulls;
+    else
+      result.isTrue = ~c.nulls;
+    return true;
+  }
+
+  switch ( c.storage )
+  {
+    case Int:
+    case LongLong:
+    case Double:
+    {
+      // column values are numbers, so the comparison is numeric as long as the literal is
+      if ( !QgsExpressionUtils::isDoubleSafe( literal ) || !isFiniteDouble( literal ) )
+        return false;
+
+      const double lit = literal.toDouble();
+      for ( int row = 0; row < rows; ++row )
+      {
+        if ( c.nulls.testBit( row ) )
+        {
+          if ( isOp )
+            result.isTrue.setBit( row, op == QgsExpressionNodeBinaryOperator::boIsNot );
+          else
+            result.isNull.setBit( row );
+          continue;
+        }
+
+        double v = c.storage == Int ? c.ints.at( row ) : c.storage == LongLong ? static_cast< double >( c.longLongs.at( row ) ) : c.doubles.at( row );
+        if ( !std::isfinite( v ) )
+          return false;
+
+        bool matches;
+        if ( isOp )
+          matches = qgsDoubleNear( v, lit ) == ( op == QgsExpressionNodeBinaryOperator::boIs );
+        else
+          matches = compareDiff( op, columnOnLeft ? v - lit : lit - v );
+        result.isTrue.setBit( row, matches );
+      }
+      return true;
+    }
+
+    case String:
+    {
+      // each distinct string is compared once
+      QVector<Truth> dictionaryTruth( c.dictionary.count() );
+      for ( int code = 0; code < c.dictionary.count(); ++code )
+      {
+        QVariant v( c.dictionary.at( code ) );
+        Truth truth = columnOnLeft ? compareValues( op, v, literal ) : compareValues( op, literal, v );
+        if ( truth == IsError )
+          return false;
+        dictionaryTruth[code] = truth;
+      }
+
+      for ( int row = 0; row < rows; ++row )
+      {
+        if ( c.nulls.testBit( row ) )
+        {
+          if ( isOp )
+            result.isTrue.setBit( row, op == QgsExpressionNodeBinaryOperator::boIsNot );
+          else
+            result.isNull.setBit( row );
+          continue;
+        }
+
+        Truth truth = dictionaryTruth.at( c.codes.at( row ) );
+        result.isTrue.setBit( row, truth == IsTrue );
+        result.isNull.setBit( row, truth == IsUnknown );
+      }
+      return true;
+    }
+
+    case Variant:
+      return false;
+  }
+  return false;
+}
+
+bool QgsMemoryColumnStore::contains( int column, const QVariantList &literals, bool notIn, Predicate &result ) const
+{
+  const Column &c = mColumns.at( column );
+  int rows = rowCount();
+  result.isTrue = QBitArray( rows );
+  result.isNull = QBitArray( rows );
+
+  if ( literals.isEmpty() )
+  {
+    result.isTrue.fill( notIn );
+    return true;
+  }
+
+  switch ( c.storage )
+  {
+    case Int:
+    case LongLong:
+    case Double:
+    {
+      QVector<double> values;
+      bool listHasNull = false;
+      for ( const QVariant &literal : literals )
+      {
+        if ( literal.isNull() )
+          listHasNull = true;
+        else if ( QgsExpressionUtils::isDoubleSafe( literal ) && isFiniteDouble( literal ) )
+          values << literal.toDouble();
+        else
+          return false;
+      }
+
+      for ( int row = 0; row < rows; ++row )
+      {
+        if ( c.nulls.testBit( row ) )
+        {
+          result.isNull.setBit( row );
+          continue;
+        }
+
+        double v = c.storage == Int ? c.ints.at( row ) : c.storage == LongLong ? static_cast< double >( c.longLongs.at( row ) ) : c.doubles.at( row );
+        if ( !std::isfinite( v ) )
+          return false;
+
+        bool found = false;
+        for ( double value : qgsAsConst( values ) )
+        {
+          if ( qgsDoubleNear( v, value ) )
+          {
+            found = true;
+            break;
+          }
+        }
+
+        if ( found )
+          result.isTrue.setBit( row, !notIn );
+        else if ( listHasNull )
+          result.isNull.setBit( row );
+        else
+          result.isTrue.setBit( row, notIn );
+      }
+      return true;
+    }
+
+    case String:
+    {
+      QVector<Truth> dictionaryTruth( c.dictionary.count() );
+      for ( int code = 0; code < c.dictionary.count(); ++code )
+      {
+        Truth truth = containsValue( QVariant( c.dictionary.at( code ) ), literals, notIn );
+        if ( truth == IsError )
+          return false;
+        dictionaryTruth[code] = truth;
+      }
+
+      for ( int row = 0; row < rows; ++row )
+      {
+        if ( c.nulls.testBit( row ) )
+        {
+          result.isNull.setBit( row );
+          continue;
+        }
+
+        Truth truth = dictionaryTruth.at( c.codes.at( row ) );
+        result.isTrue.setBit( row, truth == IsTrue );
+        result.isNull.setBit( row, truth == IsUnknown );
+      }
+      return true;
+    }
+
+    case Variant:
+      return false;
+  }
+  return false;
+}
+
+QVariant QgsMemoryColumnStore::aggregate( QgsAggregateCalculator::Aggregate aggregate, int column, const QBitArray *rows, bool &ok ) const
+{
+  ok = false;
+  if ( column < 0 || column >= mColumns.count() )
+    return QVariant();
+
+  const Column &c = mColumns.at( column );
+  QgsStatisticalSummary::Statistic stat;
+  if ( ( c.storage != Int && c.storage != LongLong && c.storage != Double ) || !numericStatistic( aggregate, stat ) )
+    return QVariant();
+
+  QgsStatisticalSummary s( stat );
+  for ( int row = 0; row < rowCount(); ++row )
+  {
+    if ( mDeleted.testBit( row ) || ( rows && !rows->testBit( row ) ) )
+      continue;
+
+    if ( c.nulls.testBit( row ) )
+    {
+      s.addVariant( QVariant() );
+      continue;
+    }
+
+    switch ( c.storage )
+    {
+      case Int:
+        s.addValue( c.ints.at( row ) );
+        break;
+      case LongLong:
+        s.addValue( c.longLongs.at( row ) );
+        break;
+      case Double:
+        s.addValue( c.doubles.at( row ) );
+        break;
+      case String:
+      case Variant:
+        break;
+    }
+  }
+  s.finalize();
+
+  ok = true;
+  double val = s.statistic( stat );
+  return std::isnan( val ) ? QVariant() : val;
+}
+
+///@endcond PRIVATE
@@ -0,0 +1,191 @@
+/***************************************************************************
+    qgsmemorycolumnstore.h
+    ---------------------
+    begin                : October 2017
+    copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSMEMORYCOLUMNSTORE_H
+#define QGSMEMORYCOLUMNSTORE_H
+
+#define SIP_NO_FILE
+
+#include "qgsaggregatecalculator.h"
+#include "qgsfeature.h"
+#include "qgsfields.h"
+#include "qgsgeometry.h"
+#include "qgsrectangle.h"
+
+#include <QBitArray>
+#include <QHash>
+#include <QSharedData>
+#include <QVector>
+
+///@cond PRIVATE
+
+class QgsExpression;
+class QgsExpressionNode;
+
+/**
+ * Column oriented storage of the features of a memory layer, used when the layer
+ * is created with the "storage=columnar" uri parameter.
+ *
+ * Each attribute is stored in a typed array with a null bitmap. Integer and double
+ * fields are stored as native numbers and strings are dictionary encoded; other
+ * field types are kept as QVariant. Values which cannot be converted to the type of
+ * their field are stored as NULL. Geometries are stored as WKB in a single packed
+ * buffer, along with their bounding boxes.
+ *
+ * Features are identified by their row. Deleted rows are only flagged, until enough
+ * of them are present to compact the store. Copies of the store are implicitly
+ * shared, so that feature sources can read a snapshot while the provider is edited.
+ */
+class QgsMemoryColumnStore : public QSharedData
+{
+  public:
+
+    explicit QgsMemoryColumnStore( const QgsFields &fields = QgsFields() );
+
+    //! Returns the number of rows, including deleted rows
+    int rowCount() const { return mFeatureIds.count(); }
+
+    //! Returns the number of features
+    int featureCount() const { return mRows.count(); }
+
+    //! Returns true if a \a row has been deleted
+    bool isDeleted( int row ) const { return mDeleted.testBit( row ); }
+
+    //! Returns the row storing the feature \a fid, or -1
+    int row( QgsFeatureId fid ) const { return mRows.value( fid, -1 ); }
+
+    //! Returns the id of the feature stored in a \a row
+    QgsFeatureId featureId( int row ) const { return mFeatureIds.at( row ); }
+
+    //! Appends a \a feature, using the feature id as key
+    void addFeature( const QgsFeature &feature );
+
+    //! Deletes the feature \a fid. Returns false if the feature does not exist
+    bool deleteFeature( QgsFeatureId fid );
+
+    //! Appends a column for \a field, filled with NULL values
+    void addColumn( const QgsField &field );
+
+    //! Removes a \a column
+    void removeColumn( int column );
+
+    //! Returns the value of a \a column in a \a row
+    QVariant value( int row, int column ) const;
+
+    //! Sets the value of a \a column in a \a row
+    void setValue( int row, int column, const QVariant &value );
+
+    //! Returns true if a geometry is stored in a \a row
+    bool hasGeometry( int row ) const { return mGeometrySizes.at( row ) > 0; }
+
+    //! Returns the geometry stored in a \a row
+    QgsGeometry geometry( int row ) const;
+
+    //! Sets the geometry stored in a \a row
+    void setGeometry( int row, const QgsGeometry &geometry );
+
+    //! Returns the bounding box of the geometry stored in a \a row
+    QgsRectangle boundingBox( int row ) const { return mBoundingBoxes.at( row ); }
+
+    //! Returns the combined bounding box of all geometries
+    QgsRectangle extent() const;
+
+    /**
+     * Reads the feature stored in a \a row. Only the geometry if \a fetchGeometry is true
+     * and the \a attributes from the list are read, or all attributes if the list is nullptr.
+     */
+    void readFeature( int row, QgsFeature &feature, bool fetchGeometry, const QgsAttributeList *attributes = nullptr ) const;
+
+    /**
+     * Evaluates \a expression over whole columns. \a rows is set to the rows for which the
+     * expression is true. Only comparisons, IN and IS operators between \a fields and literals,
+     * combined with AND, OR and NOT are supported: returns false for other expressions, which
+     * must then be evaluated feature by feature.
+     */
+    bool filter( const QgsExpression &expression, const QgsFields &fields, QBitArray &rows ) const;
+
+    /**
+     * Calculates an \a aggregate over a numeric \a column, for the \a rows set in the
+     * bitmap, or all rows if it is nullptr. \a ok is set to false for unsupported aggregates
+     * and columns.
+     */
+    QVariant aggregate( QgsAggregateCalculator::Aggregate aggregate, int column, const QBitArray *rows, bool &ok ) const;
+
+  private:
+
+    enum Storage
+    {
+      Int,
+      LongLong,
+      Double,
+      String,
+      Variant,
+    };
+
+    struct Column
+    {
+      Storage storage = Variant;
+      QVariant::Type type = QVariant::Invalid;
+      //! Set bits are NULL values
+      QBitArray nulls;
+      QVector<int> ints;
+      QVector<qint64> longLongs;
+      QVector<double> doubles;
+      //! Index of string values in the dictionary
+      QVector<int> codes;
+      QVector<QString> dictionary;
+      QHash<QString, int> dictionaryIndex;
+      QVector<QVariant> variants;
+    };
+
+    //! Result of a predicate over all rows, in three-valued logic
+    struct Predicate
+    {
+      QBitArray isTrue;
+      QBitArray isNull;
+    };
+
+    //! Appends \a value to \a column
+    void appendValue( Column &column, const QVariant &value );
+    //! Stores \a value in a \a row of \a column
+    void storeValue( Column &column, int row, const QVariant &value );
+    //! Stores \a wkb in a \a row, reusing its previous space when large enough
+    void storeWkb( int row, const QByteArray &wkb );
+
+    bool evaluate( const QgsExpressionNode *node, const QgsFields &fields, Predicate &result ) const;
+    bool compare( int column, int op, const QVariant &literal, bool columnOnLeft, Predicate &result ) const;
+    bool contains( int column, const QVariantList &literals, bool notIn, Predicate &result ) const;
+
+    //! Removes deleted rows and unused geometry data
+    void compact();
+
+    QVector<Column> mColumns;
+
+    QVector<QgsFeatureId> mFeatureIds;
+    QHash<QgsFeatureId, int> mRows;
+    QBitArray mDeleted;
+    int mDeletedCount = 0;
+
+    //! WKB of the geometries, packed one after the other
+    QByteArray mGeometryData;
+    QVector<int> mGeometryOffsets;
+    //! Size of the WKB of each row, 0 for rows without geometry
+    QVector<int> mGeometrySizes;
+    QVector<QgsRectangle> mBoundingBoxes;
+    //! Number of bytes of the geometry data which are not used anymore
+    int mUnusedGeometryData = 0;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSMEMORYCOLUMNSTORE_H
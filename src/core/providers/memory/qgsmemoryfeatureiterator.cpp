@@ -22,6 +22,9 @@
 #include "qgsmessagelog.h"
 #include "qgsproject.h"
 #include "qgsexception.h"
+#include "qgssettings.h"
+
+#include <algorithm>
 
 ///@cond PRIVATE
 
@@ -43,10 +46,67 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource *sour
     return;
   }
 
+  mColumnStore = mSource->mColumnStore.constData();
+
   if ( !mSource->mSubsetString.isEmpty() )
   {
     mSubsetExpression = new QgsExpression( mSource->mSubsetString );
-    mSubsetExpression->prepare( &mSource->mExpressionContext );
+    if ( mColumnStore && mColumnStore->filter( *mSubsetExpression, mSource->mFields, mRowFilter ) )
+    {
+      // subset string evaluated over whole columns
+      delete mSubsetExpression;
+      mSubsetExpression = nullptr;
+      mUsingRowFilter = true;
+    }
+    else
+    {
+      mSubsetExpression->prepare( &mSource->mExpressionContext );
+    }
+  }
+
+  if ( mColumnStore && mRequest.filterType() == QgsFeatureRequest::FilterExpression
+       && QgsSettings().value( QStringLiteral( "qgis/compileExpressions" ), true ).toBool() )
+  {
+    QBitArray rows;
+    if ( mColumnStore->filter( *mRequest.filterExpression(), mSource->mFields, rows ) )
+    {
+      mRowFilter = mUsingRowFilter ? mRowFilter & rows : rows;
+      mUsingRowFilter = true;
+      mExpressionCompiled = true;
+      mCompileStatus = Compiled;
+    }
+  }
+
+  if ( mColumnStore )
+  {
+    // only the requested attributes and geometries are read from the columns, as well as
+    // those needed to evaluate the filter expression and the order by clauses
+    mFetchGeometry = !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
+    mFetchAllAttributes = !( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes );
+    if ( !mFetchAllAttributes )
+    {
+      mAttributes = mRequest.subsetOfAttributes();
+
+      QSet<QString> columns = mRequest.orderBy().usedAttributes();
+      if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && !mExpressionCompiled )
+        columns.unite( mRequest.filterExpression()->referencedColumns() );
+
+      if ( columns.contains( QgsFeatureRequest::ALL_ATTRIBUTES ) )
+      {
+        mFetchAllAttributes = true;
+      }
+      else
+      {
+        for ( const QString &column : qgsAsConst( columns ) )
+        {
+          int index = mSource->mFields.lookupField( column );
+          if ( index >= 0 && !mAttributes.contains( index ) )
+            mAttributes.append( index );
+        }
+      }
+    }
+    if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && !mExpressionCompiled && mRequest.filterExpression()->needsGeometry() )
+      mFetchGeometry = true;
   }
 
   if ( !mFilterRect.isNull() && mRequest.flags() & QgsFeatureRequest::ExactIntersect )
@@ -63,14 +123,45 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource *sour
     mUsingFeatureIdList = true;
     mFeatureIdList = mSource->mSpatialIndex->intersects( mFilterRect );
     QgsDebugMsg( "Features returned by spatial index: " + QString::number( mFeatureIdList.count() ) );
+
+    // the list must only contain the requested features
+    if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
+    {
+      bool found = mFeatureIdList.contains( mRequest.filterFid() );
+      mFeatureIdList.clear();
+      if ( found )
+        mFeatureIdList.append( mRequest.filterFid() );
+    }
+    else if ( mRequest.filterType() == QgsFeatureRequest::FilterFids )
+    {
+      const QgsFeatureIds filterFids = mRequest.filterFids();
+      QList<QgsFeatureId> ids;
+      for ( QgsFeatureId id : qgsAsConst( mFeatureIdList ) )
+      {
+        if ( filterFids.contains( id ) )
+          ids.append( id );
+      }
+      mFeatureIdList = ids;
+    }
   }
   else if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
     mUsingFeatureIdList = true;
-    QgsFeatureMap::const_iterator it = mSource->mFeatures.constFind( mRequest.filterFid() );
-    if ( it != mSource->mFeatures.constEnd() )
+    if ( featureExists( mRequest.filterFid() ) )
       mFeatureIdList.append( mRequest.filterFid() );
   }
+  else if ( mRequest.filterType() == QgsFeatureRequest::FilterFids )
+  {
+    // look the requested features up instead of testing every feature of the layer
+    mUsingFeatureIdList = true;
+    const QgsFeatureIds filterFids = mRequest.filterFids();
+    for ( QgsFeatureId id : filterFids )
+    {
+      if ( featureExists( id ) )
+        mFeatureIdList.append( id );
+    }
+    std::sort( mFeatureIdList.begin(), mFeatureIdList.end() );
+  }
   else
   {
     mUsingFeatureIdList = false;
@@ -94,12 +185,33 @@ bool QgsMemoryFeatureIterator::fetchFeature( QgsFeature &feature )
   if ( mClosed )
     return false;
 
-  if ( mUsingFeatureIdList )
+  if ( mColumnStore )
+    return nextFeatureFromColumnStore( feature );
+  else if ( mUsingFeatureIdList )
     return nextFeatureUsingList( feature );
   else
     return nextFeatureTraverseAll( feature );
 }
 
+bool QgsMemoryFeatureIterator::nextFeatureFilterExpression( QgsFeature &feature )
+{
+  if ( !mExpressionCompiled )
+    return QgsAbstractFeatureIterator::nextFeatureFilterExpression( feature );
+  else
+    return fetchFeature( feature );
+}
+
+bool QgsMemoryFeatureIterator::nextFeatureFilterFids( QgsFeature &feature )
+{
+  // the list of features only contains the requested ids
+  return fetchFeature( feature );
+}
+
+bool QgsMemoryFeatureIterator::featureExists( QgsFeatureId id ) const
+{
+  return mColumnStore ? mColumnStore->row( id ) >= 0 : mSource->mFeatures.contains( id );
+}
+
 
 bool QgsMemoryFeatureIterator::nextFeatureUsingList( QgsFeature &feature )
 {
@@ -108,14 +220,27 @@ bool QgsMemoryFeatureIterator::nextFeatureUsingList( QgsFeature &feature )
   // option 1: we have a list of features to traverse
   while ( mFeatureIdListIterator != mFeatureIdList.constEnd() )
   {
-    if ( !mFilterRect.isNull() && mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+    if ( mFilterRect.isNull() )
     {
-      // do exact check in case we're doing intersection
-      if ( mSource->mFeatures.value( *mFeatureIdListIterator ).hasGeometry() && mSelectRectEngine->intersects( mSource->mFeatures.value( *mFeatureIdListIterator ).geometry().geometry() ) )
-        hasFeature = true;
+      hasFeature = true;
     }
     else
-      hasFeature = true;
+    {
+      // the list does not come from the spatial index when features are requested by id
+      const QgsFeature candidate = mSource->mFeatures.value( *mFeatureIdListIterator );
+      if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+      {
+        // do exact check in case we're doing intersection
+        if ( candidate.hasGeometry() && mSelectRectEngine->intersects( candidate.geometry().geometry() ) )
+          hasFeature = true;
+      }
+      else
+      {
+        // check just bounding box against rect when not using intersection
+        if ( candidate.hasGeometry() && candidate.geometry().boundingBox().intersects( mFilterRect ) )
+          hasFeature = true;
+      }
+    }
 
     if ( mSubsetExpression )
     {
@@ -205,6 +330,79 @@ bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature &feature )
   return hasFeature;
 }
 
+bool QgsMemoryFeatureIterator::nextFeatureFromColumnStore( QgsFeature &feature )
+{
+  // option 3: reading rows of the column store, from the list of features or all rows
+  int row = -1;
+  if ( mUsingFeatureIdList )
+  {
+    while ( mFeatureIdListIterator != mFeatureIdList.constEnd() )
+    {
+      int candidate = mColumnStore->row( *mFeatureIdListIterator );
+      ++mFeatureIdListIterator;
+      if ( candidate >= 0 && acceptRow( candidate ) )
+      {
+        row = candidate;
+        break;
+      }
+    }
+  }
+  else
+  {
+    while ( mRow < mColumnStore->rowCount() )
+    {
+      int candidate = mRow++;
+      if ( !mColumnStore->isDeleted( candidate ) && acceptRow( candidate ) )
+      {
+        row = candidate;
+        break;
+      }
+    }
+  }
+
+  if ( row < 0 )
+  {
+    close();
+    return false;
+  }
+
+  mColumnStore->readFeature( row, feature, mFetchGeometry, mFetchAllAttributes ? nullptr : &mAttributes );
+  feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+  geometryToDestinationCrs( feature, mTransform );
+  return true;
+}
+
+bool QgsMemoryFeatureIterator::acceptRow( int row )
+{
+  if ( mUsingRowFilter && !mRowFilter.testBit( row ) )
+    return false;
+
+  if ( !mFilterRect.isNull() )
+  {
+    // bounding boxes are stored next to the geometries, no need to read them for the first check
+    if ( !mColumnStore->hasGeometry( row ) || !mColumnStore->boundingBox( row ).intersects( mFilterRect ) )
+      return false;
+
+    if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+    {
+      QgsGeometry geometry = mColumnStore->geometry( row );
+      if ( !mSelectRectEngine->intersects( geometry.geometry() ) )
+        return false;
+    }
+  }
+
+  if ( mSubsetExpression )
+  {
+    QgsFeature feature( mSource->mFields );
+    mColumnStore->readFeature( row, feature, true );
+    mSource->mExpressionContext.setFeature( feature );
+    if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
+      return false;
+  }
+
+  return true;
+}
+
 bool QgsMemoryFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -212,6 +410,8 @@ bool QgsMemoryFeatureIterator::rewind()
 
   if ( mUsingFeatureIdList )
     mFeatureIdListIterator = mFeatureIdList.constBegin();
+  else if ( mColumnStore )
+    mRow = 0;
   else
     mSelectIterator = mSource->mFeatures.constBegin();
 
@@ -234,6 +434,7 @@ bool QgsMemoryFeatureIterator::close()
 QgsMemoryFeatureSource::QgsMemoryFeatureSource( const QgsMemoryProvider *p )
   : mFields( p->mFields )
   , mFeatures( p->mFeatures )
+  , mColumnStore( p->mColumnStore )
   , mSpatialIndex( p->mSpatialIndex ? new QgsSpatialIndex( *p->mSpatialIndex ) : nullptr )  // just shallow copy
   , mSubsetString( p->mSubsetString )
   , mCrs( p->mCrs )
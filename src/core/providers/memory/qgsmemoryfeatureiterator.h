@@ -21,6 +21,9 @@
 #include "qgsexpressioncontext.h"
 #include "qgsfields.h"
 #include "qgsgeometry.h"
+#include "qgsmemorycolumnstore.h"
+
+#include <QBitArray>
 
 ///@cond PRIVATE
 
@@ -41,6 +44,7 @@ class QgsMemoryFeatureSource : public QgsAbstractFeatureSource
   private:
     QgsFields mFields;
     QgsFeatureMap mFeatures;
+    QSharedDataPointer< QgsMemoryColumnStore > mColumnStore;
     std::unique_ptr< QgsSpatialIndex > mSpatialIndex;
     QString mSubsetString;
     QgsExpressionContext mExpressionContext;
@@ -64,9 +68,17 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
 
     virtual bool fetchFeature( QgsFeature &feature ) override;
 
+    virtual bool nextFeatureFilterExpression( QgsFeature &feature ) override;
+    virtual bool nextFeatureFilterFids( QgsFeature &feature ) override;
+
   private:
     bool nextFeatureUsingList( QgsFeature &feature );
     bool nextFeatureTraverseAll( QgsFeature &feature );
+    bool nextFeatureFromColumnStore( QgsFeature &feature );
+    bool featureExists( QgsFeatureId id ) const;
+
+    //! Returns true if the feature stored in a \a row of the column store matches the request
+    bool acceptRow( int row );
 
     QgsGeometry mSelectRectGeom;
     std::unique_ptr< QgsGeometryEngine > mSelectRectEngine;
@@ -78,6 +90,18 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
     QgsExpression *mSubsetExpression = nullptr;
     QgsCoordinateTransform mTransform;
 
+    //! Column store of the source, or nullptr if features are stored in the map
+    const QgsMemoryColumnStore *mColumnStore = nullptr;
+    int mRow = 0;
+    //! Rows matching the subset string and the filter expression, when evaluated over the columns
+    QBitArray mRowFilter;
+    bool mUsingRowFilter = false;
+    bool mExpressionCompiled = false;
+    bool mFetchGeometry = true;
+    //! Attributes read from the column store, or all attributes if mFetchAllAttributes is true
+    QgsAttributeList mAttributes;
+    bool mFetchAllAttributes = true;
+
 };
 
 ///@endcond PRIVATE
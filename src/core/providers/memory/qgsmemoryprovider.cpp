@@ -22,6 +22,7 @@
 #include "qgslogger.h"
 #include "qgsspatialindex.h"
 #include "qgscoordinatereferencesystem.h"
+#include "qgsexpression.h"
 
 #include <QUrl>
 #include <QRegExp>
@@ -31,6 +32,9 @@
 static const QString TEXT_PROVIDER_KEY = QStringLiteral( "memory" );
 static const QString TEXT_PROVIDER_DESCRIPTION = QStringLiteral( "Memory provider" );
 
+// Number of features from which layers are indexed automatically
+static const int AUTOMATIC_SPATIAL_INDEX_THRESHOLD = 1000;
+
 QgsMemoryProvider::QgsMemoryProvider( const QString &uri )
   : QgsVectorDataProvider( uri )
 
@@ -65,6 +69,11 @@ QgsMemoryProvider::QgsMemoryProvider( const QString &uri )
 
   mNextFeatureId = 1;
 
+  if ( url.hasQueryItem( QStringLiteral( "storage" ) ) && url.queryItemValue( QStringLiteral( "storage" ) ) == QLatin1String( "columnar" ) )
+  {
+    mColumnStore = new QgsMemoryColumnStore();
+  }
+
   setNativeTypes( QList< NativeType >()
                   << QgsVectorDataProvider::NativeType( tr( "Whole number (integer)" ), QStringLiteral( "integer" ), QVariant::Int, 0, 10 )
                   // Decimal number from OGR/Shapefile/dbf may come with length up to 32 and
@@ -183,6 +192,10 @@ QgsMemoryProvider::QgsMemoryProvider( const QString &uri )
   {
     createSpatialIndex();
   }
+  else if ( url.hasQueryItem( QStringLiteral( "index" ) ) && url.queryItemValue( QStringLiteral( "index" ) ) == QLatin1String( "no" ) )
+  {
+    mAutomaticSpatialIndex = false;
+  }
 
 }
 
@@ -241,10 +254,18 @@ QString QgsMemoryProvider::dataSourceUri( bool expandAuthConfig ) const
     }
     uri.addQueryItem( QStringLiteral( "crs" ), crsDef );
   }
-  if ( mSpatialIndex )
+  if ( mSpatialIndexRequested )
   {
     uri.addQueryItem( QStringLiteral( "index" ), QStringLiteral( "yes" ) );
   }
+  else if ( !mAutomaticSpatialIndex )
+  {
+    uri.addQueryItem( QStringLiteral( "index" ), QStringLiteral( "no" ) );
+  }
+  if ( mColumnStore )
+  {
+    uri.addQueryItem( QStringLiteral( "storage" ), QStringLiteral( "columnar" ) );
+  }
 
   QgsAttributeList attrs = const_cast<QgsMemoryProvider *>( this )->attributeIndexes();
   for ( int i = 0; i < attrs.size(); i++ )
@@ -272,6 +293,13 @@ QgsFeatureIterator QgsMemoryProvider::getFeatures( const QgsFeatureRequest &requ
 
 QgsRectangle QgsMemoryProvider::extent() const
 {
+  if ( mColumnStore )
+  {
+    if ( mExtent.isEmpty() && mColumnStore->featureCount() > 0 )
+      mExtent = mColumnStore->extent();
+    return mExtent;
+  }
+
   if ( mExtent.isEmpty() && !mFeatures.isEmpty() )
   {
     mExtent.setMinimal();
@@ -293,7 +321,19 @@ QgsWkbTypes::Type QgsMemoryProvider::wkbType() const
 long QgsMemoryProvider::featureCount() const
 {
   if ( mSubsetString.isEmpty() )
-    return mFeatures.count();
+    return mColumnStore ? mColumnStore->featureCount() : mFeatures.count();
+
+  QBitArray rows;
+  if ( mColumnStore && mColumnStore->filter( QgsExpression( mSubsetString ), mFields, rows ) )
+  {
+    int count = 0;
+    for ( int row = 0; row < mColumnStore->rowCount(); ++row )
+    {
+      if ( rows.testBit( row ) && !mColumnStore->isDeleted( row ) )
+        count++;
+    }
+    return count;
+  }
 
   // subset string set, no alternative but testing each feature
   QgsFeatureIterator fit = QgsFeatureIterator( new QgsMemoryFeatureIterator( new QgsMemoryFeatureSource( this ), true,  QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) ) );
@@ -326,7 +366,7 @@ QgsCoordinateReferenceSystem QgsMemoryProvider::crs() const
 bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags )
 {
   // whether or not to update the layer extent on the fly as we add features
-  bool updateExtent = mFeatures.isEmpty() || !mExtent.isEmpty();
+  bool updateExtent = ( mColumnStore ? mColumnStore->featureCount() == 0 : mFeatures.isEmpty() ) || !mExtent.isEmpty();
 
   // TODO: sanity checks of fields and geometries
   for ( QgsFeatureList::iterator it = flist.begin(); it != flist.end(); ++it )
@@ -334,7 +374,10 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags )
     it->setId( mNextFeatureId );
     it->setValid( true );
 
-    mFeatures.insert( mNextFeatureId, *it );
+    if ( mColumnStore )
+      mColumnStore->addFeature( *it );
+    else
+      mFeatures.insert( mNextFeatureId, *it );
 
     if ( it->hasGeometry() )
     {
@@ -349,6 +392,13 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList &flist, Flags )
     mNextFeatureId++;
   }
 
+  // full scans of large layers are costly, index them even if no index was requested
+  if ( !mSpatialIndex && mAutomaticSpatialIndex && mWkbType != QgsWkbTypes::NoGeometry
+       && ( mColumnStore ? mColumnStore->featureCount() : mFeatures.count() ) >= AUTOMATIC_SPATIAL_INDEX_THRESHOLD )
+  {
+    buildSpatialIndex();
+  }
+
   return true;
 }
 
@@ -356,6 +406,25 @@ bool QgsMemoryProvider::deleteFeatures( const QgsFeatureIds &id )
 {
   for ( QgsFeatureIds::const_iterator it = id.begin(); it != id.end(); ++it )
   {
+    if ( mColumnStore )
+    {
+      int row = mColumnStore->row( *it );
+      if ( row < 0 )
+        continue;
+
+      // update spatial index
+      if ( mSpatialIndex && mColumnStore->hasGeometry( row ) )
+      {
+        QgsFeature feature;
+        const QgsAttributeList noAttributes;
+        mColumnStore->readFeature( row, feature, true, &noAttributes );
+        mSpatialIndex->deleteFeature( feature );
+      }
+
+      mColumnStore->deleteFeature( *it );
+      continue;
+    }
+
     QgsFeatureMap::iterator fit = mFeatures.find( *it );
 
     // check whether such feature exists
@@ -397,6 +466,12 @@ bool QgsMemoryProvider::addAttributes( const QList<QgsField> &attributes )
     // add new field as a last one
     mFields.append( *it );
 
+    if ( mColumnStore )
+    {
+      mColumnStore->addColumn( *it );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature &f = fit.value();
@@ -443,6 +518,12 @@ bool QgsMemoryProvider::deleteAttributes( const QgsAttributeIds &attributes )
     int idx = *it;
     mFields.remove( idx );
 
+    if ( mColumnStore )
+    {
+      mColumnStore->removeColumn( idx );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature &f = fit.value();
@@ -458,6 +539,21 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &at
 {
   for ( QgsChangedAttributesMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it )
   {
+    if ( mColumnStore )
+    {
+      int row = mColumnStore->row( it.key() );
+      if ( row < 0 )
+        continue;
+
+      const QgsAttributeMap &attrs = it.value();
+      for ( QgsAttributeMap::const_iterator it2 = attrs.constBegin(); it2 != attrs.constEnd(); ++it2 )
+      {
+        if ( it2.key() >= 0 && it2.key() < mFields.count() )
+          mColumnStore->setValue( row, it2.key(), it2.value() );
+      }
+      continue;
+    }
+
     QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
     if ( fit == mFeatures.end() )
       continue;
@@ -473,6 +569,29 @@ bool QgsMemoryProvider::changeGeometryValues( const QgsGeometryMap &geometry_map
 {
   for ( QgsGeometryMap::const_iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
   {
+    if ( mColumnStore )
+    {
+      int row = mColumnStore->row( it.key() );
+      if ( row < 0 )
+        continue;
+
+      // update spatial index
+      if ( mSpatialIndex && mColumnStore->hasGeometry( row ) )
+      {
+        QgsFeature feature;
+        const QgsAttributeList noAttributes;
+        mColumnStore->readFeature( row, feature, true, &noAttributes );
+        mSpatialIndex->deleteFeature( feature );
+      }
+
+      mColumnStore->setGeometry( row, it.value() );
+
+      // update spatial index
+      if ( mSpatialIndex && !it.value().isNull() )
+        mSpatialIndex->insertFeature( it.key(), it.value().boundingBox() );
+      continue;
+    }
+
     QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
     if ( fit == mFeatures.end() )
       continue;
@@ -517,18 +636,32 @@ bool QgsMemoryProvider::setSubsetString( const QString &theSQL, bool updateFeatu
 }
 
 bool QgsMemoryProvider::createSpatialIndex()
+{
+  mSpatialIndexRequested = true;
+  buildSpatialIndex();
+  return true;
+}
+
+void QgsMemoryProvider::buildSpatialIndex()
 {
   if ( !mSpatialIndex )
   {
     mSpatialIndex = new QgsSpatialIndex();
 
     // add existing features to index
+    if ( mColumnStore )
+    {
+      for ( int row = 0; row < mColumnStore->rowCount(); ++row )
+      {
+        if ( !mColumnStore->isDeleted( row ) && mColumnStore->hasGeometry( row ) )
+          mSpatialIndex->insertFeature( mColumnStore->featureId( row ), mColumnStore->boundingBox( row ) );
+      }
+    }
     for ( QgsFeatureMap::const_iterator it = mFeatures.constBegin(); it != mFeatures.constEnd(); ++it )
     {
       mSpatialIndex->insertFeature( *it );
     }
   }
-  return true;
 }
 
 QgsVectorDataProvider::Capabilities QgsMemoryProvider::capabilities() const
@@ -538,6 +671,36 @@ QgsVectorDataProvider::Capabilities QgsMemoryProvider::capabilities() const
          SelectAtId | CircularGeometries;
 }
 
+QVariant QgsMemoryProvider::aggregate( QgsAggregateCalculator::Aggregate aggregate, int index,
+                                       const QgsAggregateCalculator::AggregateParameters &parameters,
+                                       QgsExpressionContext *context, bool &ok ) const
+{
+  Q_UNUSED( context );
+  ok = false;
+
+  // aggregates are calculated over whole columns when the subset string and the
+  // filter can be evaluated without reading each feature
+  if ( !mColumnStore )
+    return QVariant();
+
+  QBitArray rows;
+  bool filtered = false;
+  const QStringList filters = QStringList() << mSubsetString << parameters.filter;
+  for ( const QString &filter : filters )
+  {
+    if ( filter.isEmpty() )
+      continue;
+
+    QBitArray filterRows;
+    if ( !mColumnStore->filter( QgsExpression( filter ), mFields, filterRows ) )
+      return QVariant();
+
+    rows = filtered ? rows & filterRows : filterRows;
+    filtered = true;
+  }
+
+  return mColumnStore->aggregate( aggregate, index, filtered ? &rows : nullptr, ok );
+}
 
 void QgsMemoryProvider::updateExtents()
 {
@@ -18,6 +18,7 @@
 #include "qgsvectordataprovider.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsfields.h"
+#include "qgsmemorycolumnstore.h"
 
 ///@cond PRIVATE
 typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
@@ -64,6 +65,9 @@ class QgsMemoryProvider : public QgsVectorDataProvider
     virtual bool supportsSubsetString() const override { return true; }
     virtual bool createSpatialIndex() override;
     virtual QgsVectorDataProvider::Capabilities capabilities() const override;
+    virtual QVariant aggregate( QgsAggregateCalculator::Aggregate aggregate, int index,
+                                const QgsAggregateCalculator::AggregateParameters &parameters,
+                                QgsExpressionContext *context, bool &ok ) const override;
 
     /* Implementation of functions from QgsDataProvider */
 
@@ -75,6 +79,10 @@ class QgsMemoryProvider : public QgsVectorDataProvider
     virtual QgsCoordinateReferenceSystem crs() const override;
 
   private:
+
+    //! Builds the spatial index from the existing features
+    void buildSpatialIndex();
+
     // Coordinate reference system
     QgsCoordinateReferenceSystem mCrs;
 
@@ -87,8 +95,15 @@ class QgsMemoryProvider : public QgsVectorDataProvider
     QgsFeatureMap mFeatures;
     QgsFeatureId mNextFeatureId;
 
+    // features stored by columns instead of mFeatures, for "storage=columnar" layers
+    QSharedDataPointer< QgsMemoryColumnStore > mColumnStore;
+
     // indexing
     QgsSpatialIndex *mSpatialIndex = nullptr;
+    // true if the index was requested with "index=yes" or createSpatialIndex()
+    bool mSpatialIndexRequested = false;
+    // false if automatic indexing of large layers is disabled with "index=no"
+    bool mAutomaticSpatialIndex = true;
 
     QString mSubsetString;
 
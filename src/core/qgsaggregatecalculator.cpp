@@ -22,6 +22,8 @@
 #include "qgsgeometry.h"
 #include "qgsvectorlayer.h"
 
+#include <vector>
+
 
 
 QgsAggregateCalculator::QgsAggregateCalculator( const QgsVectorLayer *layer )
@@ -118,6 +120,133 @@ QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate ag
   return calculate( aggregate, fit, resultType, attrNum, expression.get(), mDelimiter, context, ok );
 }
 
+QVariantMap QgsAggregateCalculator::calculateGrouped( QgsAggregateCalculator::Aggregate aggregate, const QString &fieldOrExpression,
+    const QStringList &groupBy, QgsExpressionContext *context, bool *ok ) const
+{
+  if ( ok )
+    *ok = false;
+
+  if ( !mLayer )
+    return QVariantMap();
+
+  QgsExpressionContext defaultContext = mLayer->createExpressionContext();
+  context = context ? context : &defaultContext;
+  context->setFields( mLayer->fields() );
+
+  QSet<QString> lst;
+  bool needsGeometry = false;
+
+  // prepares a field or expression, returns false if it is an invalid expression
+  auto prepare = [this, context, &lst, &needsGeometry]( const QString & source, int &attrNum, std::unique_ptr<QgsExpression> &expression )
+  {
+    attrNum = mLayer->fields().lookupField( source );
+    if ( attrNum >= 0 )
+    {
+      lst.insert( source );
+      return true;
+    }
+
+    expression.reset( new QgsExpression( source ) );
+    if ( expression->hasParserError() || !expression->prepare( context ) )
+      return false;
+
+    lst.unite( expression->referencedColumns() );
+    needsGeometry = needsGeometry || expression->needsGeometry();
+    return true;
+  };
+
+  int attrNum = -1;
+  std::unique_ptr<QgsExpression> expression;
+  if ( !prepare( fieldOrExpression, attrNum, expression ) )
+    return QVariantMap();
+
+  QVector<int> groupByAttrNums( groupBy.count(), -1 );
+  std::vector< std::unique_ptr<QgsExpression> > groupByExpressions( groupBy.count() );
+  for ( int i = 0; i < groupBy.count(); ++i )
+  {
+    if ( !prepare( groupBy.at( i ), groupByAttrNums[i], groupByExpressions[i] ) )
+      return QVariantMap();
+  }
+
+  QgsFeatureRequest request = QgsFeatureRequest()
+                              .setFlags( needsGeometry ? QgsFeatureRequest::NoFlags : QgsFeatureRequest::NoGeometry )
+                              .setSubsetOfAttributes( lst, mLayer->fields() );
+  if ( !mFilterExpression.isEmpty() )
+    request.setFilterExpression( mFilterExpression );
+  request.setExpressionContext( *context );
+
+  // collect the values of each group
+  struct GroupValues
+  {
+    QVariant::Type resultType = QVariant::Invalid;
+    QVariantList values;
+  };
+  QHash<QString, GroupValues> groups;
+
+  QgsFeature f;
+  QVariantList keyValues;
+  QgsFeatureIterator fit = mLayer->getFeatures( request );
+  while ( fit.nextFeature( f ) )
+  {
+    context->setFeature( f );
+
+    keyValues.clear();
+    for ( int i = 0; i < groupBy.count(); ++i )
+    {
+      keyValues << ( groupByExpressions[i] ? groupByExpressions[i]->evaluate( context ) : f.attribute( groupByAttrNums.at( i ) ) );
+    }
+
+    GroupValues &group = groups[ groupKey( keyValues )];
+    const QVariant value = expression ? expression->evaluate( context ) : f.attribute( attrNum );
+    if ( group.resultType == QVariant::Invalid )
+    {
+      // as for calculate(), the type of an expression is determined from its first value
+      group.resultType = expression ? value.type() : mLayer->fields().at( attrNum ).type();
+    }
+    group.values << value;
+  }
+
+  QVariantMap results;
+  for ( auto it = groups.constBegin(); it != groups.constEnd(); ++it )
+  {
+    bool groupOk = false;
+    QVariant result = calculate( aggregate, it.value().values, it.value().resultType, mDelimiter, &groupOk );
+    if ( !groupOk )
+      return QVariantMap();
+
+    results.insert( it.key(), result );
+  }
+
+  if ( ok )
+    *ok = true;
+  return results;
+}
+
+QVariant QgsAggregateCalculator::emptyAggregate( QgsAggregateCalculator::Aggregate aggregate, const QString &fieldOrExpression ) const
+{
+  if ( !mLayer )
+    return QVariant();
+
+  // consistent with calculate(), which only knows the type of fields when there is no feature
+  int attrNum = mLayer->fields().lookupField( fieldOrExpression );
+  if ( attrNum == -1 )
+    return defaultValue( aggregate );
+
+  return calculate( aggregate, QVariantList(), mLayer->fields().at( attrNum ).type(), mDelimiter );
+}
+
+QString QgsAggregateCalculator::groupKey( const QVariantList &values )
+{
+  QString key;
+  for ( const QVariant &value : values )
+  {
+    // values are quoted, so that they cannot be mistaken for the separator or the null marker
+    key += value.isNull() ? QStringLiteral( "\\N" ) : QStringLiteral( "'%1'" ).arg( value.toString().replace( '\'', QLatin1String( "''" ) ) );
+    key += ',';
+  }
+  return key;
+}
+
 QgsAggregateCalculator::Aggregate QgsAggregateCalculator::stringToAggregate( const QString &string, bool *ok )
 {
   QString normalized = string.trimmed().toLower();
@@ -259,6 +388,113 @@ QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate ag
 #endif
 }
 
+QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate aggregate, const QVariantList &values, QVariant::Type resultType,
+    const QString &delimiter, bool *ok )
+{
+  if ( ok )
+    *ok = false;
+
+  if ( aggregate == QgsAggregateCalculator::ArrayAggregate )
+  {
+    if ( ok )
+      *ok = true;
+    return values;
+  }
+
+  switch ( resultType )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+    {
+      bool statOk = false;
+      QgsStatisticalSummary::Statistic stat = numericStatFromAggregate( aggregate, &statOk );
+      if ( !statOk )
+        return QVariant();
+
+      QgsStatisticalSummary s( stat );
+      for ( const QVariant &v : values )
+        s.addVariant( v );
+      s.finalize();
+      double val = s.statistic( stat );
+      if ( ok )
+        *ok = true;
+      return std::isnan( val ) ? QVariant() : val;
+    }
+
+    case QVariant::Date:
+    case QVariant::DateTime:
+    {
+      bool statOk = false;
+      QgsDateTimeStatisticalSummary::Statistic stat = dateTimeStatFromAggregate( aggregate, &statOk );
+      if ( !statOk )
+        return QVariant();
+
+      QgsDateTimeStatisticalSummary s( stat );
+      for ( const QVariant &v : values )
+        s.addValue( v );
+      s.finalize();
+      if ( ok )
+        *ok = true;
+      return s.statistic( stat );
+    }
+
+    case QVariant::UserType:
+    {
+      if ( aggregate != GeometryCollect )
+        return QVariant();
+
+      QList< QgsGeometry > geometries;
+      for ( const QVariant &v : values )
+      {
+        if ( v.canConvert<QgsGeometry>() )
+          geometries << v.value<QgsGeometry>();
+      }
+      if ( ok )
+        *ok = true;
+      return QVariant::fromValue( QgsGeometry::collectGeometry( geometries ) );
+    }
+
+    default:
+    {
+      // treat as string
+      if ( aggregate == StringConcatenate )
+      {
+        //special case
+        QString result;
+        for ( const QVariant &v : values )
+        {
+          if ( !result.isEmpty() )
+            result += delimiter;
+          result += v.toString();
+        }
+        if ( ok )
+          *ok = true;
+        return result;
+      }
+
+      bool statOk = false;
+      QgsStringStatisticalSummary::Statistic stat = stringStatFromAggregate( aggregate, &statOk );
+      if ( !statOk )
+        return QVariant();
+
+      QgsStringStatisticalSummary s( stat );
+      for ( const QVariant &v : values )
+        s.addValue( v );
+      s.finalize();
+      if ( ok )
+        *ok = true;
+      return s.statistic( stat );
+    }
+  }
+
+#ifndef _MSC_VER
+  return QVariant();
+#endif
+}
+
 QgsStatisticalSummary::Statistic QgsAggregateCalculator::numericStatFromAggregate( QgsAggregateCalculator::Aggregate aggregate, bool *ok )
 {
   if ( ok )
@@ -510,7 +746,7 @@ QVariant QgsAggregateCalculator::concatenateStrings( QgsFeatureIterator &fit, in
   return result;
 }
 
-QVariant QgsAggregateCalculator::defaultValue( QgsAggregateCalculator::Aggregate aggregate ) const
+QVariant QgsAggregateCalculator::defaultValue( QgsAggregateCalculator::Aggregate aggregate )
 {
   // value to return when NO features are aggregated:
   switch ( aggregate )
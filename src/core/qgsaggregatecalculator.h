@@ -22,6 +22,7 @@
 #include "qgsstatisticalsummary.h"
 #include "qgsdatetimestatisticalsummary.h"
 #include "qgsstringstatisticalsummary.h"
+#include <QStringList>
 #include <QVariant>
 
 
@@ -147,6 +148,41 @@ class CORE_EXPORT QgsAggregateCalculator
     QVariant calculate( Aggregate aggregate, const QString &fieldOrExpression,
                         QgsExpressionContext *context = nullptr, bool *ok = nullptr ) const;
 
+    /**
+     * Calculates the value of an aggregate for each group of features sharing the same
+     * values for a list of fields or expressions. All the groups are calculated with a single
+     * iteration over the layer features, which is much faster than calculating the aggregate
+     * for each group with a filter when there are many groups.
+     * \param aggregate aggregate to calculate
+     * \param fieldOrExpression source field or expression to use as basis for aggregated values.
+     * \param groupBy list of fields or expressions defining the groups
+     * \param context expression context for evaluating expressions
+     * \param ok if specified, will be set to true if aggregate calculation was successful
+     * \returns calculated aggregate values by group, with keys created by groupKey() from the
+     * values of the \a groupBy fields or expressions. Groups without any feature are not included,
+     * their aggregate value is returned by emptyAggregate().
+     * \since QGIS 3.0
+     */
+    QVariantMap calculateGrouped( Aggregate aggregate, const QString &fieldOrExpression, const QStringList &groupBy,
+                                   QgsExpressionContext *context = nullptr, bool *ok = nullptr ) const;
+
+    /**
+     * Returns the key identifying a group of features for calculateGrouped(), from the
+     * \a values of the fields or expressions defining the group. Values which are equal
+     * when compared in an expression (e.g. 1 and 1.0) give the same key.
+     * \since QGIS 3.0
+     */
+    static QString groupKey( const QVariantList &values );
+
+    /**
+     * Returns the value of an \a aggregate calculated over no features.
+     * \param aggregate aggregate to calculate
+     * \param fieldOrExpression source field or expression to use as basis for aggregated values.
+     * \see calculateGrouped()
+     * \since QGIS 3.0
+     */
+    QVariant emptyAggregate( Aggregate aggregate, const QString &fieldOrExpression ) const;
+
     /**
      * Converts a string to a aggregate type.
      * \param string string to convert
@@ -190,7 +226,11 @@ class CORE_EXPORT QgsAggregateCalculator
     static QVariant concatenateStrings( QgsFeatureIterator &fit, int attr, QgsExpression *expression,
                                         QgsExpressionContext *context, const QString &delimiter );
 
-    QVariant defaultValue( Aggregate aggregate ) const;
+    static QVariant defaultValue( Aggregate aggregate );
+
+    //! Calculates an aggregate from a list of values
+    static QVariant calculate( Aggregate aggregate, const QVariantList &values, QVariant::Type resultType,
+                               const QString &delimiter, bool *ok = nullptr );
 };
 
 #endif //QGSAGGREGATECALCULATOR_H
@@ -19,6 +19,7 @@
 #include "qgsclipper.h"
 #include "qgsgeometry.h"
 #include "qgscurve.h"
+#include "qgslinestring.h"
 #include "qgslogger.h"
 
 // Where has all the code gone?
@@ -42,6 +43,29 @@ QPolygonF QgsClipper::clippedLine( const QgsCurve &curve, const QgsRectangle &cl
 {
   const int nPoints = curve.numPoints();
 
+  // read line strings directly from their coordinate arrays, other curves are copied once
+  QVector<double> curveX;
+  QVector<double> curveY;
+  const double *x = nullptr;
+  const double *y = nullptr;
+  if ( const QgsLineString *lineString = qgsgeometry_cast< const QgsLineString * >( &curve ) )
+  {
+    x = lineString->xData();
+    y = lineString->yData();
+  }
+  else
+  {
+    curveX.resize( nPoints );
+    curveY.resize( nPoints );
+    for ( int i = 0; i < nPoints; ++i )
+    {
+      curveX[i] = curve.xAt( i );
+      curveY[i] = curve.yAt( i );
+    }
+    x = curveX.constData();
+    y = curveY.constData();
+  }
+
   double p0x, p0y, p1x = 0.0, p1y = 0.0; //original coordinates
   double p1x_c, p1y_c; //clipped end coordinates
   double lastClipX = 0.0, lastClipY = 0.0; //last successfully clipped coords
@@ -53,8 +77,8 @@ QPolygonF QgsClipper::clippedLine( const QgsCurve &curve, const QgsRectangle &cl
   {
     if ( i == 0 )
     {
-      p1x = curve.xAt( i );
-      p1y = curve.yAt( i );
+      p1x = x[i];
+      p1y = y[i];
       continue;
     }
     else
@@ -62,8 +86,8 @@ QPolygonF QgsClipper::clippedLine( const QgsCurve &curve, const QgsRectangle &cl
       p0x = p1x;
       p0y = p1y;
 
-      p1x = curve.xAt( i );
-      p1y = curve.yAt( i );
+      p1x = x[i];
+      p1y = y[i];
 
       p1x_c = p1x;
       p1y_c = p1y;
@@ -33,6 +33,7 @@
 #include "qgsprocessingalgorithm.h"
 #include "qgslayout.h"
 
+#include <QAtomicInt>
 #include <QSettings>
 #include <QDir>
 
@@ -52,6 +53,12 @@ const QString QgsExpressionContext::EXPR_CLUSTER_COLOR( QStringLiteral( "cluster
 // QgsExpressionContextScope
 //
 
+int QgsExpressionContextScope::nextRevision()
+{
+  static QAtomicInt sRevision;
+  return sRevision.fetchAndAddRelaxed( 1 ) + 1;
+}
+
 QgsExpressionContextScope::QgsExpressionContextScope( const QString &name )
   : mName( name )
 {
@@ -61,6 +68,7 @@ QgsExpressionContextScope::QgsExpressionContextScope( const QString &name )
 QgsExpressionContextScope::QgsExpressionContextScope( const QgsExpressionContextScope &other )
   : mName( other.mName )
   , mVariables( other.mVariables )
+  , mVariableIndexes( other.mVariableIndexes )
   , mHasFeature( other.mHasFeature )
   , mFeature( other.mFeature )
 {
@@ -75,6 +83,8 @@ QgsExpressionContextScope &QgsExpressionContextScope::operator=( const QgsExpres
 {
   mName = other.mName;
   mVariables = other.mVariables;
+  mVariableIndexes = other.mVariableIndexes;
+  mRevision = nextRevision();
   mHasFeature = other.mHasFeature;
   mFeature = other.mFeature;
 
@@ -96,12 +106,12 @@ QgsExpressionContextScope::~QgsExpressionContextScope()
 
 void QgsExpressionContextScope::setVariable( const QString &name, const QVariant &value, bool isStatic )
 {
-  if ( mVariables.contains( name ) )
+  QHash<QString, int>::const_iterator it = mVariableIndexes.constFind( name );
+  if ( it != mVariableIndexes.constEnd() )
   {
-    StaticVariable existing = mVariables.value( name );
+    StaticVariable &existing = mVariables[ it.value()];
     existing.value = value;
     existing.isStatic = isStatic;
-    addVariable( existing );
   }
   else
   {
@@ -111,27 +121,53 @@ void QgsExpressionContextScope::setVariable( const QString &name, const QVariant
 
 void QgsExpressionContextScope::addVariable( const QgsExpressionContextScope::StaticVariable &variable )
 {
-  mVariables.insert( variable.name, variable );
+  QHash<QString, int>::const_iterator it = mVariableIndexes.constFind( variable.name );
+  if ( it != mVariableIndexes.constEnd() )
+  {
+    // only the value changes, variable handles stay valid
+    mVariables[ it.value()] = variable;
+  }
+  else
+  {
+    mVariableIndexes.insert( variable.name, mVariables.count() );
+    mVariables << variable;
+    mRevision = nextRevision();
+  }
 }
 
 bool QgsExpressionContextScope::removeVariable( const QString &name )
 {
-  return mVariables.remove( name ) > 0;
+  const int index = mVariableIndexes.value( name, -1 );
+  if ( index < 0 )
+    return false;
+
+  // the last variable takes the slot of the removed one
+  mVariableIndexes.remove( name );
+  if ( index < mVariables.count() - 1 )
+  {
+    mVariables[index] = mVariables.last();
+    mVariableIndexes[ mVariables.at( index ).name ] = index;
+  }
+  mVariables.removeLast();
+
+  mRevision = nextRevision();
+  return true;
 }
 
 bool QgsExpressionContextScope::hasVariable( const QString &name ) const
 {
-  return mVariables.contains( name );
+  return mVariableIndexes.contains( name );
 }
 
 QVariant QgsExpressionContextScope::variable( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).value : QVariant();
+  QHash<QString, int>::const_iterator it = mVariableIndexes.constFind( name );
+  return it != mVariableIndexes.constEnd() ? mVariables.at( it.value() ).value : QVariant();
 }
 
 QStringList QgsExpressionContextScope::variableNames() const
 {
-  QStringList names = mVariables.keys();
+  QStringList names = mVariableIndexes.keys();
   return names;
 }
 
@@ -164,7 +200,7 @@ class QgsExpressionContextVariableCompare
 
 QStringList QgsExpressionContextScope::filteredVariableNames() const
 {
-  QStringList allVariables = mVariables.keys();
+  QStringList allVariables = mVariableIndexes.keys();
   QStringList filtered;
   Q_FOREACH ( const QString &variable, allVariables )
   {
@@ -181,17 +217,17 @@ QStringList QgsExpressionContextScope::filteredVariableNames() const
 
 bool QgsExpressionContextScope::isReadOnly( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).readOnly : false;
+  return hasVariable( name ) ? mVariables.at( mVariableIndexes.value( name ) ).readOnly : false;
 }
 
 bool QgsExpressionContextScope::isStatic( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).isStatic : false;
+  return hasVariable( name ) ? mVariables.at( mVariableIndexes.value( name ) ).isStatic : false;
 }
 
 QString QgsExpressionContextScope::description( const QString &name ) const
 {
-  return hasVariable( name ) ? mVariables.value( name ).description : QString();
+  return hasVariable( name ) ? mVariables.at( mVariableIndexes.value( name ) ).description : QString();
 }
 
 bool QgsExpressionContextScope::hasFunction( const QString &name ) const
@@ -324,6 +360,54 @@ const QgsExpressionContextScope *QgsExpressionContext::activeScopeForVariable( c
   return nullptr;
 }
 
+QgsExpressionContext::VariableHandle QgsExpressionContext::resolveVariable( const QString &name ) const
+{
+  VariableHandle handle;
+  handle.mName = name;
+  handle.mScopeCount = mStack.count();
+
+  //iterate through stack backwards, so that higher priority variables take precedence
+  for ( int i = mStack.count() - 1; i >= 0; --i )
+  {
+    const QgsExpressionContextScope *scope = mStack.at( i );
+    handle.mScopes << qMakePair( scope, scope->mRevision );
+    QHash<QString, int>::const_iterator it = scope->mVariableIndexes.constFind( name );
+    if ( it != scope->mVariableIndexes.constEnd() )
+    {
+      handle.mScopeIndex = i;
+      handle.mSlot = it.value();
+      break;
+    }
+  }
+  return handle;
+}
+
+bool QgsExpressionContext::isValidHandle( const VariableHandle &handle ) const
+{
+  if ( handle.mScopeCount != mStack.count() )
+    return false;
+
+  int i = mStack.count() - 1;
+  for ( auto it = handle.mScopes.constBegin(); it != handle.mScopes.constEnd(); ++it, --i )
+  {
+    // the scope is only dereferenced once known to still be part of the context
+    if ( mStack.at( i ) != it->first || it->first->mRevision != it->second )
+      return false;
+  }
+  return true;
+}
+
+QVariant QgsExpressionContext::variable( const VariableHandle &handle ) const
+{
+  return isValidHandle( handle ) ? handleValue( handle ) : variable( handle.mName );
+}
+
+QVariant QgsExpressionContext::handleValue( const VariableHandle &handle ) const
+{
+  // the slot of the variable is unchanged as long as the revision of the scope is
+  return handle.mScopeIndex >= 0 ? mStack.at( handle.mScopeIndex )->mVariables.at( handle.mSlot ).value : QVariant();
+}
+
 QgsExpressionContextScope *QgsExpressionContext::activeScopeForVariable( const QString &name )
 {
   //iterate through stack backwards, so that higher priority variables take precedence
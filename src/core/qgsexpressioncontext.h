@@ -23,6 +23,8 @@
 #include <QString>
 #include <QStringList>
 #include <QSet>
+#include <QPair>
+#include <QVector>
 #include "qgsfeature.h"
 #include "qgsexpression.h"
 #include "qgsexpressionfunction.h"
@@ -349,12 +351,25 @@ class CORE_EXPORT QgsExpressionContextScope
 
   private:
     QString mName;
-    QHash<QString, StaticVariable> mVariables;
+    //! Variables of the scope, whose position is the slot used by variable handles
+    QVector<StaticVariable> mVariables;
+    //! Position of each variable in mVariables
+    QHash<QString, int> mVariableIndexes;
     QHash<QString, QgsScopedExpressionFunction * > mFunctions;
     bool mHasFeature = false;
     QgsFeature mFeature;
 
+    /**
+     * Unique number identifying the scope and its set of variable names. It changes when a
+     * variable is added or removed, but not when the value of a variable is changed.
+     */
+    int mRevision = nextRevision();
+
+    static int nextRevision();
+
     bool variableNameSort( const QString &a, const QString &b );
+
+    friend class QgsExpressionContext;
 };
 
 /**
@@ -457,6 +472,69 @@ class CORE_EXPORT QgsExpressionContext
      */
     const QgsExpressionContextScope *activeScopeForVariable( const QString &name ) const SIP_SKIP;
 
+#ifndef SIP_RUN
+
+    /**
+     * \ingroup core
+     * Handle to a variable of an expression context, see resolveVariable().
+     *
+     * The handle remembers the scope holding the variable. It stays valid as long as the
+     * scopes of the context are the same and no variable is added to or removed from these
+     * scopes, even if the values of the variables change. Invalid handles are resolved again
+     * by name when used.
+     *
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    class VariableHandle
+    {
+      public:
+
+        //! Returns the name of the variable
+        QString name() const { return mName; }
+
+      private:
+        QString mName;
+        //! Number of scopes of the context when the handle was resolved
+        int mScopeCount = -1;
+        //! Index of the scope holding the variable, or -1 if no scope holds it
+        int mScopeIndex = -1;
+        //! Position of the variable in the scope holding it
+        int mSlot = -1;
+        //! Scopes from the last one to the scope holding the variable, with their revision
+        QVector< QPair< const QgsExpressionContextScope *, int > > mScopes;
+
+        friend class QgsExpressionContext;
+    };
+
+    /**
+     * Resolves the variable \a name to a handle, which can be used to fetch the value of the
+     * variable many times with variable() without searching the scopes again. This is faster
+     * for variables which change for each feature, like the geometry part number.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    VariableHandle resolveVariable( const QString &name ) const;
+
+    /**
+     * Returns true if the \a handle still designates the variable in this context, i.e.
+     * if the scopes searched when resolving the handle are unchanged. Invalid handles
+     * have to be resolved again with resolveVariable() to avoid a lookup by name.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    bool isValidHandle( const VariableHandle &handle ) const;
+
+    /**
+     * Fetches the value of the variable of a \a handle, see resolveVariable(). The result is
+     * the same as calling variable() with the name of the variable.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    QVariant variable( const VariableHandle &handle ) const;
+
+#endif
+
     /**
      * Returns the scope at the specified index within the context.
      * \param index index of scope
@@ -705,6 +783,12 @@ class CORE_EXPORT QgsExpressionContext
     // Cache is mutable because we want to be able to add cached values to const contexts
     mutable QMap< QString, QVariant > mCachedValues;
 
+#ifndef SIP_RUN
+    //! Value of the variable of a valid \a handle
+    QVariant handleValue( const VariableHandle &handle ) const;
+#endif
+
+    friend class QgsExpressionProgram;
 };
 
 /**
@@ -0,0 +1,588 @@
+/***************************************************************************
+  qgslazyvectordataprovider.cpp
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgslazyvectordataprovider_p.h"
+
+#include "qgsfeatureiterator.h"
+#include "qgslogger.h"
+#include "qgsmessagelog.h"
+#include "qgsproviderregistry.h"
+
+#include <QDomDocument>
+#include <QMutexLocker>
+#include <memory>
+
+///@cond PRIVATE
+
+//! Feature source of a layer whose provider could not be created
+class QgsLazyVectorDataProviderEmptySource : public QgsAbstractFeatureSource
+{
+  public:
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest &request ) override
+    {
+      Q_UNUSED( request );
+      return QgsFeatureIterator();
+    }
+};
+
+QgsLazyVectorDataProvider::QgsLazyVectorDataProvider( const QString &providerKey, const QString &uri, const QDomElement &metadataElement,
+    const QgsCoordinateReferenceSystem &crs, const QgsRectangle &extent )
+  : QgsVectorDataProvider( uri )
+  , mProviderKey( providerKey )
+  , mCrs( crs )
+  , mExtent( extent )
+{
+  mWkbType = QgsWkbTypes::parseType( metadataElement.attribute( QStringLiteral( "wkbType" ) ) );
+  mCapabilities = static_cast< QgsVectorDataProvider::Capabilities >( metadataElement.attribute( QStringLiteral( "capabilities" ), QStringLiteral( "0" ) ).toInt() );
+
+  QDomElement fieldElem = metadataElement.firstChildElement( QStringLiteral( "field" ) );
+  while ( !fieldElem.isNull() )
+  {
+    QgsField field( fieldElem.attribute( QStringLiteral( "name" ) ),
+                    static_cast< QVariant::Type >( fieldElem.attribute( QStringLiteral( "type" ) ).toInt() ),
+                    fieldElem.attribute( QStringLiteral( "typeName" ) ),
+                    fieldElem.attribute( QStringLiteral( "length" ) ).toInt(),
+                    fieldElem.attribute( QStringLiteral( "precision" ) ).toInt(),
+                    fieldElem.attribute( QStringLiteral( "comment" ) ),
+                    static_cast< QVariant::Type >( fieldElem.attribute( QStringLiteral( "subType" ) ).toInt() ) );
+
+    const int constraints = fieldElem.attribute( QStringLiteral( "constraints" ), QStringLiteral( "0" ) ).toInt();
+    QgsFieldConstraints fieldConstraints;
+    if ( constraints & QgsFieldConstraints::ConstraintNotNull )
+      fieldConstraints.setConstraint( QgsFieldConstraints::ConstraintNotNull, QgsFieldConstraints::ConstraintOriginProvider );
+    if ( constraints & QgsFieldConstraints::ConstraintUnique )
+      fieldConstraints.setConstraint( QgsFieldConstraints::ConstraintUnique, QgsFieldConstraints::ConstraintOriginProvider );
+    field.setConstraints( fieldConstraints );
+
+    mFields.append( field, QgsFields::OriginProvider );
+    fieldElem = fieldElem.nextSiblingElement( QStringLiteral( "field" ) );
+  }
+
+  mMetadataValid = mWkbType != QgsWkbTypes::Unknown;
+}
+
+QgsLazyVectorDataProvider::~QgsLazyVectorDataProvider()
+{
+  delete mProvider;
+}
+
+QDomElement QgsLazyVectorDataProvider::writeMetadata( const QgsVectorDataProvider *provider, QDomDocument &document )
+{
+  QDomElement metadataElem = document.createElement( QStringLiteral( "providerMetadata" ) );
+  metadataElem.setAttribute( QStringLiteral( "wkbType" ), QgsWkbTypes::displayString( provider->wkbType() ) );
+  metadataElem.setAttribute( QStringLiteral( "capabilities" ), static_cast< int >( provider->capabilities() ) );
+
+  const QgsFields fields = provider->fields();
+  for ( int i = 0; i < fields.count(); ++i )
+  {
+    const QgsField field = fields.at( i );
+    QDomElement fieldElem = document.createElement( QStringLiteral( "field" ) );
+    fieldElem.setAttribute( QStringLiteral( "name" ), field.name() );
+    fieldElem.setAttribute( QStringLiteral( "type" ), static_cast< int >( field.type() ) );
+    fieldElem.setAttribute( QStringLiteral( "typeName" ), field.typeName() );
+    fieldElem.setAttribute( QStringLiteral( "length" ), field.length() );
+    fieldElem.setAttribute( QStringLiteral( "precision" ), field.precision() );
+    fieldElem.setAttribute( QStringLiteral( "comment" ), field.comment() );
+    fieldElem.setAttribute( QStringLiteral( "subType" ), static_cast< int >( field.subType() ) );
+
+    // only the constraints enforced by the data source
+    int constraints = 0;
+    const QgsFieldConstraints fieldConstraints = field.constraints();
+    if ( fieldConstraints.constraintOrigin( QgsFieldConstraints::ConstraintNotNull ) == QgsFieldConstraints::ConstraintOriginProvider )
+      constraints |= QgsFieldConstraints::ConstraintNotNull;
+    if ( fieldConstraints.constraintOrigin( QgsFieldConstraints::ConstraintUnique ) == QgsFieldConstraints::ConstraintOriginProvider )
+      constraints |= QgsFieldConstraints::ConstraintUnique;
+    fieldElem.setAttribute( QStringLiteral( "constraints" ), constraints );
+
+    metadataElem.appendChild( fieldElem );
+  }
+  return metadataElem;
+}
+
+QgsVectorDataProvider *QgsLazyVectorDataProvider::createdProvider() const
+{
+  QMutexLocker locker( &mMutex );
+  return mProvider;
+}
+
+QgsVectorDataProvider *QgsLazyVectorDataProvider::provider() const
+{
+  QMutexLocker locker( &mMutex );
+  if ( mProvider || mProviderFailed )
+    return mProvider;
+
+  QgsDebugMsg( "Creating the data provider of " + dataSourceUri() );
+  std::unique_ptr< QgsVectorDataProvider > provider( qobject_cast< QgsVectorDataProvider * >( QgsProviderRegistry::instance()->createProvider( mProviderKey, dataSourceUri() ) ) );
+  if ( !provider || !provider->isValid() )
+  {
+    QgsMessageLog::logMessage( tr( "Unable to create the data provider of %1" ).arg( dataSourceUri() ) );
+    mProviderFailed = true;
+    return nullptr;
+  }
+
+  // the layer fields were read from the project, the features must match them
+  if ( provider->fields().names() != mFields.names() )
+  {
+    QgsMessageLog::logMessage( tr( "The fields of %1 changed since the project was saved" ).arg( dataSourceUri() ) );
+    mProviderFailed = true;
+    return nullptr;
+  }
+
+  // the data may first be accessed from another thread than the one of the layer
+  provider->moveToThread( thread() );
+
+  if ( !mEncodingName.isEmpty() )
+    provider->setEncoding( mEncodingName );
+  provider->setProviderProperty( QgsDataProvider::EvaluateDefaultValues, providerProperty( QgsDataProvider::EvaluateDefaultValues, false ) );
+  if ( mListening )
+    provider->setListening( true );
+
+  QgsLazyVectorDataProvider *self = const_cast< QgsLazyVectorDataProvider * >( this );
+  connect( provider.get(), &QgsVectorDataProvider::dataChanged, self, &QgsVectorDataProvider::dataChanged );
+  connect( provider.get(), &QgsVectorDataProvider::fullExtentCalculated, self, &QgsVectorDataProvider::fullExtentCalculated );
+  connect( provider.get(), &QgsVectorDataProvider::notify, self, &QgsVectorDataProvider::notify );
+  connect( provider.get(), &QgsVectorDataProvider::raiseError, self, &QgsVectorDataProvider::raiseError );
+
+  self->setNativeTypes( provider->nativeTypes() );
+  mProvider = provider.release();
+  return mProvider;
+}
+
+QgsAbstractFeatureSource *QgsLazyVectorDataProvider::featureSource() const
+{
+  QgsVectorDataProvider *p = provider();
+  if ( !p )
+    return new QgsLazyVectorDataProviderEmptySource();
+  return p->featureSource();
+}
+
+QString QgsLazyVectorDataProvider::storageType() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->storageType() : QgsVectorDataProvider::storageType();
+}
+
+QgsFeatureIterator QgsLazyVectorDataProvider::getFeatures( const QgsFeatureRequest &request ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->getFeatures( request ) : QgsFeatureIterator();
+}
+
+QgsWkbTypes::Type QgsLazyVectorDataProvider::wkbType() const
+{
+  return mWkbType;
+}
+
+long QgsLazyVectorDataProvider::featureCount() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->featureCount() : 0;
+}
+
+QgsFields QgsLazyVectorDataProvider::fields() const
+{
+  return mFields;
+}
+
+QString QgsLazyVectorDataProvider::dataComment() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->dataComment() : QgsVectorDataProvider::dataComment();
+}
+
+QVariant QgsLazyVectorDataProvider::minimumValue( int index ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->minimumValue( index ) : QVariant();
+}
+
+QVariant QgsLazyVectorDataProvider::maximumValue( int index ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->maximumValue( index ) : QVariant();
+}
+
+QSet<QVariant> QgsLazyVectorDataProvider::uniqueValues( int fieldIndex, int limit ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->uniqueValues( fieldIndex, limit ) : QSet<QVariant>();
+}
+
+QStringList QgsLazyVectorDataProvider::uniqueStringsMatching( int index, const QString &substring, int limit, QgsFeedback *feedback ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->uniqueStringsMatching( index, substring, limit, feedback ) : QStringList();
+}
+
+QVariant QgsLazyVectorDataProvider::aggregate( QgsAggregateCalculator::Aggregate aggregate, int index,
+    const QgsAggregateCalculator::AggregateParameters &parameters,
+    QgsExpressionContext *context, bool &ok ) const
+{
+  QgsVectorDataProvider *p = provider();
+  if ( !p )
+  {
+    ok = false;
+    return QVariant();
+  }
+  return p->aggregate( aggregate, index, parameters, context, ok );
+}
+
+void QgsLazyVectorDataProvider::enumValues( int index, QStringList &enumList ) const
+{
+  enumList.clear();
+  if ( QgsVectorDataProvider *p = provider() )
+    p->enumValues( index, enumList );
+}
+
+bool QgsLazyVectorDataProvider::addFeatures( QgsFeatureList &flist, QgsFeatureSink::Flags flags )
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->addFeatures( flist, flags );
+}
+
+bool QgsLazyVectorDataProvider::deleteFeatures( const QgsFeatureIds &id )
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->deleteFeatures( id );
+}
+
+bool QgsLazyVectorDataProvider::truncate()
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->truncate();
+}
+
+bool QgsLazyVectorDataProvider::addAttributes( const QList<QgsField> &attributes )
+{
+  QgsVectorDataProvider *p = provider();
+  if ( !p || !p->addAttributes( attributes ) )
+    return false;
+
+  mFields = p->fields();
+  return true;
+}
+
+bool QgsLazyVectorDataProvider::deleteAttributes( const QgsAttributeIds &attributes )
+{
+  QgsVectorDataProvider *p = provider();
+  if ( !p || !p->deleteAttributes( attributes ) )
+    return false;
+
+  mFields = p->fields();
+  return true;
+}
+
+bool QgsLazyVectorDataProvider::renameAttributes( const QgsFieldNameMap &renamedAttributes )
+{
+  QgsVectorDataProvider *p = provider();
+  if ( !p || !p->renameAttributes( renamedAttributes ) )
+    return false;
+
+  mFields = p->fields();
+  return true;
+}
+
+bool QgsLazyVectorDataProvider::changeAttributeValues( const QgsChangedAttributesMap &attr_map )
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->changeAttributeValues( attr_map );
+}
+
+bool QgsLazyVectorDataProvider::changeFeatures( const QgsChangedAttributesMap &attr_map, const QgsGeometryMap &geometry_map )
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->changeFeatures( attr_map, geometry_map );
+}
+
+QVariant QgsLazyVectorDataProvider::defaultValue( int fieldIndex ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->defaultValue( fieldIndex ) : QVariant();
+}
+
+QString QgsLazyVectorDataProvider::defaultValueClause( int fieldIndex ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->defaultValueClause( fieldIndex ) : QString();
+}
+
+bool QgsLazyVectorDataProvider::skipConstraintCheck( int fieldIndex, QgsFieldConstraints::Constraint constraint, const QVariant &value ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->skipConstraintCheck( fieldIndex, constraint, value );
+}
+
+bool QgsLazyVectorDataProvider::changeGeometryValues( const QgsGeometryMap &geometry_map )
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->changeGeometryValues( geometry_map );
+}
+
+bool QgsLazyVectorDataProvider::createSpatialIndex()
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->createSpatialIndex();
+}
+
+bool QgsLazyVectorDataProvider::createAttributeIndex( int field )
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->createAttributeIndex( field );
+}
+
+QgsVectorDataProvider::Capabilities QgsLazyVectorDataProvider::capabilities() const
+{
+  // the stored capabilities until the data is accessed
+  QgsVectorDataProvider *p = createdProvider();
+  return p ? p->capabilities() : mCapabilities;
+}
+
+void QgsLazyVectorDataProvider::setEncoding( const QString &e )
+{
+  QgsVectorDataProvider::setEncoding( e );
+  mEncodingName = e;
+  if ( QgsVectorDataProvider *p = createdProvider() )
+    p->setEncoding( e );
+}
+
+QgsAttributeList QgsLazyVectorDataProvider::attributeIndexes() const
+{
+  return mFields.allAttributesList();
+}
+
+QgsAttributeList QgsLazyVectorDataProvider::pkAttributeIndexes() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->pkAttributeIndexes() : QgsAttributeList();
+}
+
+QgsAttrPalIndexNameHash QgsLazyVectorDataProvider::palAttributeIndexNames() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->palAttributeIndexNames() : QgsAttrPalIndexNameHash();
+}
+
+bool QgsLazyVectorDataProvider::doesStrictFeatureTypeCheck() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->doesStrictFeatureTypeCheck() : true;
+}
+
+bool QgsLazyVectorDataProvider::isSaveAndLoadStyleToDatabaseSupported() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->isSaveAndLoadStyleToDatabaseSupported();
+}
+
+bool QgsLazyVectorDataProvider::isDeleteStyleFromDatabaseSupported() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->isDeleteStyleFromDatabaseSupported();
+}
+
+QgsTransaction *QgsLazyVectorDataProvider::transaction() const
+{
+  QgsVectorDataProvider *p = createdProvider();
+  return p ? p->transaction() : nullptr;
+}
+
+void QgsLazyVectorDataProvider::forceReload()
+{
+  if ( QgsVectorDataProvider *p = createdProvider() )
+    p->forceReload();
+}
+
+QSet<QgsMapLayerDependency> QgsLazyVectorDataProvider::dependencies() const
+{
+  // metadata are only stored for providers without dependencies
+  QgsVectorDataProvider *p = createdProvider();
+  return p ? p->dependencies() : QSet<QgsMapLayerDependency>();
+}
+
+QList<QgsRelation> QgsLazyVectorDataProvider::discoverRelations( const QgsVectorLayer *self, const QList<QgsVectorLayer *> &layers ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->discoverRelations( self, layers ) : QList<QgsRelation>();
+}
+
+QVariantMap QgsLazyVectorDataProvider::metadata() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->metadata() : QVariantMap();
+}
+
+QString QgsLazyVectorDataProvider::translateMetadataKey( const QString &mdKey ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->translateMetadataKey( mdKey ) : mdKey;
+}
+
+QString QgsLazyVectorDataProvider::translateMetadataValue( const QString &mdKey, const QVariant &value ) const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->translateMetadataValue( mdKey, value ) : value.toString();
+}
+
+bool QgsLazyVectorDataProvider::hasMetadata() const
+{
+  QgsVectorDataProvider *p = createdProvider();
+  return p ? p->hasMetadata() : true;
+}
+
+QgsCoordinateReferenceSystem QgsLazyVectorDataProvider::crs() const
+{
+  return mCrs;
+}
+
+void QgsLazyVectorDataProvider::setDataSourceUri( const QString &uri )
+{
+  QgsVectorDataProvider::setDataSourceUri( uri );
+  if ( QgsVectorDataProvider *p = createdProvider() )
+    p->setDataSourceUri( uri );
+}
+
+QgsRectangle QgsLazyVectorDataProvider::extent() const
+{
+  if ( !mExtent.isNull() && !createdProvider() )
+    return mExtent;
+
+  QgsVectorDataProvider *p = provider();
+  return p ? p->extent() : mExtent;
+}
+
+bool QgsLazyVectorDataProvider::isValid() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMetadataValid && !mProviderFailed;
+}
+
+void QgsLazyVectorDataProvider::updateExtents()
+{
+  if ( QgsVectorDataProvider *p = createdProvider() )
+    p->updateExtents();
+}
+
+bool QgsLazyVectorDataProvider::setSubsetString( const QString &subset, bool updateFeatureCount )
+{
+  QgsVectorDataProvider *p = provider();
+  if ( !p || !p->setSubsetString( subset, updateFeatureCount ) )
+    return false;
+
+  QgsVectorDataProvider::setDataSourceUri( p->dataSourceUri() );
+  return true;
+}
+
+bool QgsLazyVectorDataProvider::supportsSubsetString() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->supportsSubsetString();
+}
+
+QString QgsLazyVectorDataProvider::subsetString() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->subsetString() : QString();
+}
+
+QStringList QgsLazyVectorDataProvider::subLayers() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->subLayers() : QStringList();
+}
+
+QStringList QgsLazyVectorDataProvider::subLayerStyles() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->subLayerStyles() : QStringList();
+}
+
+uint QgsLazyVectorDataProvider::subLayerCount() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->subLayerCount() : 0;
+}
+
+void QgsLazyVectorDataProvider::setLayerOrder( const QStringList &layers )
+{
+  if ( QgsVectorDataProvider *p = provider() )
+    p->setLayerOrder( layers );
+}
+
+void QgsLazyVectorDataProvider::setSubLayerVisibility( const QString &name, bool vis )
+{
+  if ( QgsVectorDataProvider *p = provider() )
+    p->setSubLayerVisibility( name, vis );
+}
+
+QString QgsLazyVectorDataProvider::name() const
+{
+  return mProviderKey;
+}
+
+QString QgsLazyVectorDataProvider::description() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->description() : QString();
+}
+
+void QgsLazyVectorDataProvider::reloadData()
+{
+  if ( QgsVectorDataProvider *p = createdProvider() )
+    p->reloadData();
+}
+
+QDateTime QgsLazyVectorDataProvider::timestamp() const
+{
+  QgsVectorDataProvider *p = createdProvider();
+  return p ? p->timestamp() : QgsVectorDataProvider::timestamp();
+}
+
+QDateTime QgsLazyVectorDataProvider::dataTimestamp() const
+{
+  QgsVectorDataProvider *p = provider();
+  return p ? p->dataTimestamp() : QDateTime();
+}
+
+QgsError QgsLazyVectorDataProvider::error() const
+{
+  QgsVectorDataProvider *p = createdProvider();
+  return p ? p->error() : QgsVectorDataProvider::error();
+}
+
+void QgsLazyVectorDataProvider::invalidateConnections( const QString &connection )
+{
+  if ( QgsVectorDataProvider *p = createdProvider() )
+    p->invalidateConnections( connection );
+}
+
+bool QgsLazyVectorDataProvider::enterUpdateMode()
+{
+  QgsVectorDataProvider *p = provider();
+  return p && p->enterUpdateMode();
+}
+
+bool QgsLazyVectorDataProvider::leaveUpdateMode()
+{
+  QgsVectorDataProvider *p = createdProvider();
+  return !p || p->leaveUpdateMode();
+}
+
+void QgsLazyVectorDataProvider::setListening( bool isListening )
+{
+  mListening = isListening;
+  if ( QgsVectorDataProvider *p = createdProvider() )
+    p->setListening( isListening );
+}
+
+///@endcond
@@ -0,0 +1,158 @@
+/***************************************************************************
+  qgslazyvectordataprovider_p.h
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSLAZYVECTORDATAPROVIDER_P_H
+#define QGSLAZYVECTORDATAPROVIDER_P_H
+
+#define SIP_NO_FILE
+
+#include "qgsvectordataprovider.h"
+#include "qgscoordinatereferencesystem.h"
+#include "qgsfields.h"
+#include "qgsrectangle.h"
+
+#include <QDomElement>
+#include <QMutex>
+
+///@cond PRIVATE
+
+/**
+ * A vector data provider which answers the geometry type, fields, capabilities,
+ * CRS and extent of a layer from the metadata stored in a project, and creates
+ * the actual provider of the layer the first time its data is accessed.
+ * All the other calls are forwarded to the actual provider.
+ */
+class QgsLazyVectorDataProvider : public QgsVectorDataProvider
+{
+    Q_OBJECT
+
+  public:
+
+    /**
+     * Constructor for a provider of type \a providerKey for the data source \a uri.
+     * The metadata of the layer are read from \a metadataElement, as written by
+     * writeMetadata(). The provider is invalid if they cannot be read.
+     */
+    QgsLazyVectorDataProvider( const QString &providerKey, const QString &uri, const QDomElement &metadataElement,
+                               const QgsCoordinateReferenceSystem &crs, const QgsRectangle &extent );
+
+    ~QgsLazyVectorDataProvider();
+
+    /**
+     * Writes the metadata needed to create a QgsLazyVectorDataProvider for
+     * the data source of \a provider.
+     */
+    static QDomElement writeMetadata( const QgsVectorDataProvider *provider, QDomDocument &document );
+
+    virtual QgsAbstractFeatureSource *featureSource() const override;
+    virtual QString storageType() const override;
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest &request = QgsFeatureRequest() ) const override;
+    virtual QgsWkbTypes::Type wkbType() const override;
+    virtual long featureCount() const override;
+    virtual QgsFields fields() const override;
+    virtual QString dataComment() const override;
+    virtual QVariant minimumValue( int index ) const override;
+    virtual QVariant maximumValue( int index ) const override;
+    virtual QSet<QVariant> uniqueValues( int fieldIndex, int limit = -1 ) const override;
+    virtual QStringList uniqueStringsMatching( int index, const QString &substring, int limit = -1,
+        QgsFeedback *feedback = nullptr ) const override;
+    virtual QVariant aggregate( QgsAggregateCalculator::Aggregate aggregate, int index,
+                                const QgsAggregateCalculator::AggregateParameters &parameters,
+                                QgsExpressionContext *context, bool &ok ) const override;
+    virtual void enumValues( int index, QStringList &enumList ) const override;
+    virtual bool addFeatures( QgsFeatureList &flist, QgsFeatureSink::Flags flags = 0 ) override;
+    virtual bool deleteFeatures( const QgsFeatureIds &id ) override;
+    virtual bool truncate() override;
+    virtual bool addAttributes( const QList<QgsField> &attributes ) override;
+    virtual bool deleteAttributes( const QgsAttributeIds &attributes ) override;
+    virtual bool renameAttributes( const QgsFieldNameMap &renamedAttributes ) override;
+    virtual bool changeAttributeValues( const QgsChangedAttributesMap &attr_map ) override;
+    virtual bool changeFeatures( const QgsChangedAttributesMap &attr_map, const QgsGeometryMap &geometry_map ) override;
+    virtual QVariant defaultValue( int fieldIndex ) const override;
+    virtual QString defaultValueClause( int fieldIndex ) const override;
+    virtual bool skipConstraintCheck( int fieldIndex, QgsFieldConstraints::Constraint constraint, const QVariant &value = QVariant() ) const override;
+    virtual bool changeGeometryValues( const QgsGeometryMap &geometry_map ) override;
+    virtual bool createSpatialIndex() override;
+    virtual bool createAttributeIndex( int field ) override;
+    virtual QgsVectorDataProvider::Capabilities capabilities() const override;
+    virtual void setEncoding( const QString &e ) override;
+    virtual QgsAttributeList attributeIndexes() const override;
+    virtual QgsAttributeList pkAttributeIndexes() const override;
+    virtual QgsAttrPalIndexNameHash palAttributeIndexNames() const override;
+    virtual bool doesStrictFeatureTypeCheck() const override;
+    virtual bool isSaveAndLoadStyleToDatabaseSupported() const override;
+    virtual bool isDeleteStyleFromDatabaseSupported() const override;
+    virtual QgsTransaction *transaction() const override;
+    virtual void forceReload() override;
+    virtual QSet<QgsMapLayerDependency> dependencies() const override;
+    virtual QList<QgsRelation> discoverRelations( const QgsVectorLayer *self, const QList<QgsVectorLayer *> &layers ) const override;
+    virtual QVariantMap metadata() const override;
+    virtual QString translateMetadataKey( const QString &mdKey ) const override;
+    virtual QString translateMetadataValue( const QString &mdKey, const QVariant &value ) const override;
+    virtual bool hasMetadata() const override;
+
+    virtual QgsCoordinateReferenceSystem crs() const override;
+    virtual void setDataSourceUri( const QString &uri ) override;
+    virtual QgsRectangle extent() const override;
+    virtual bool isValid() const override;
+    virtual void updateExtents() override;
+    virtual bool setSubsetString( const QString &subset, bool updateFeatureCount = true ) override;
+    virtual bool supportsSubsetString() const override;
+    virtual QString subsetString() const override;
+    virtual QStringList subLayers() const override;
+    virtual QStringList subLayerStyles() const override;
+    virtual uint subLayerCount() const override;
+    virtual void setLayerOrder( const QStringList &layers ) override;
+    virtual void setSubLayerVisibility( const QString &name, bool vis ) override;
+    virtual QString name() const override;
+    virtual QString description() const override;
+    virtual void reloadData() override;
+    virtual QDateTime timestamp() const override;
+    virtual QDateTime dataTimestamp() const override;
+    virtual QgsError error() const override;
+    virtual void invalidateConnections( const QString &connection ) override;
+    virtual bool enterUpdateMode() override;
+    virtual bool leaveUpdateMode() override;
+    virtual void setListening( bool isListening ) override;
+
+  private:
+
+    /**
+     * Returns the actual provider, creating it if needed. Returns nullptr if
+     * it cannot be created or does not match the stored metadata.
+     */
+    QgsVectorDataProvider *provider() const;
+
+    //! Returns the actual provider if it has already been created, or nullptr
+    QgsVectorDataProvider *createdProvider() const;
+
+    QString mProviderKey;
+    QgsCoordinateReferenceSystem mCrs;
+    QgsRectangle mExtent;
+    QgsWkbTypes::Type mWkbType = QgsWkbTypes::Unknown;
+    QgsFields mFields;
+    QgsVectorDataProvider::Capabilities mCapabilities = QgsVectorDataProvider::NoCapabilities;
+    bool mMetadataValid = false;
+
+    QString mEncodingName;
+    bool mListening = false;
+
+    mutable QMutex mMutex;
+    mutable QgsVectorDataProvider *mProvider = nullptr;
+    mutable bool mProviderFailed = false;
+};
+
+///@endcond
+
+#endif // QGSLAZYVECTORDATAPROVIDER_P_H
@@ -451,6 +451,17 @@ class CORE_EXPORT QgsMapLayer : public QObject
      */
     bool readLayerXml( const QDomElement &layerElement, const QgsReadWriteContext &context );
 
+    /**
+     * Returns the data source of a layer as stored in a project file, with
+     * paths resolved through the \a context (e.g. relative paths made absolute).
+     * \param source data source as stored in the project file
+     * \param provider provider key of the layer
+     * \param context reading context
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    static QString decodedSource( const QString &source, const QString &provider, const QgsReadWriteContext &context ) SIP_SKIP;
+
     /**
      * Stores state in Dom node
      * \param layerElement is a Dom element corresponding to ``maplayer'' tag
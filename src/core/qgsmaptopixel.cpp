@@ -250,6 +250,57 @@ void QgsMapToPixel::transformInPlace( float &x, float &y ) const
   y = my;
 }
 
+void QgsMapToPixel::transformCoordinates( const double *x, const double *y, int count, QPointF *out ) const
+{
+  if ( mMatrix.type() == QTransform::TxProject )
+  {
+    for ( int i = 0; i < count; ++i )
+    {
+      qreal mx, my;
+      mMatrix.map( x[i], y[i], &mx, &my );
+      out[i] = QPointF( mx, my );
+    }
+    return;
+  }
+
+  // the matrix is affine, so apply it without the per point type dispatch of QTransform::map
+  const double m11 = mMatrix.m11();
+  const double m12 = mMatrix.m12();
+  const double m21 = mMatrix.m21();
+  const double m22 = mMatrix.m22();
+  const double dx = mMatrix.dx();
+  const double dy = mMatrix.dy();
+  for ( int i = 0; i < count; ++i )
+  {
+    out[i] = QPointF( m11 * x[i] + m21 * y[i] + dx, m12 * x[i] + m22 * y[i] + dy );
+  }
+}
+
+void QgsMapToPixel::transformInPlace( QPolygonF &poly ) const
+{
+  if ( mMatrix.type() == QTransform::TxProject )
+  {
+    poly = mMatrix.map( poly );
+    return;
+  }
+
+  const double m11 = mMatrix.m11();
+  const double m12 = mMatrix.m12();
+  const double m21 = mMatrix.m21();
+  const double m22 = mMatrix.m22();
+  const double dx = mMatrix.dx();
+  const double dy = mMatrix.dy();
+  QPointF *ptr = poly.data();
+  const int count = poly.size();
+  for ( int i = 0; i < count; ++i, ++ptr )
+  {
+    const double x = ptr->x();
+    const double y = ptr->y();
+    ptr->setX( m11 * x + m21 * y + dx );
+    ptr->setY( m12 * x + m22 * y + dy );
+  }
+}
+
 QTransform QgsMapToPixel::transform() const
 {
   // NOTE: operations are done in the reverse order in which
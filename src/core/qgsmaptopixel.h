@@ -117,6 +117,21 @@ class CORE_EXPORT QgsMapToPixel
     }
 #endif
 
+    /**
+     * Transforms \a count points, read from the contiguous \a x and \a y coordinate arrays,
+     * from map (world) coordinates to device coordinates and stores them in \a out.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    void transformCoordinates( const double *x, const double *y, int count, QPointF *out ) const SIP_SKIP;
+
+    /**
+     * Transforms all points of \a poly from map (world) coordinates to device coordinates in place.
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    void transformInPlace( QPolygonF &poly ) const SIP_SKIP;
+
     QgsPointXY toMapCoordinates( int x, int y ) const;
 
     //! Transform device coordinates to map (world) coordinates
@@ -14,6 +14,7 @@
  *                                                                         *
  ***************************************************************************/
 
+#include <cstring>
 #include <limits>
 #include <memory>
 
@@ -26,6 +27,7 @@
 #include "qgslinestring.h"
 #include "qgspolygon.h"
 #include "qgsgeometrycollection.h"
+#include "qgsgeometryfactory.h"
 
 QgsMapToPixelSimplifier::QgsMapToPixelSimplifier( int simplifyFlags, double tolerance, SimplifyAlgorithm simplifyAlgorithm )
   : mSimplifyFlags( simplifyFlags )
@@ -68,9 +70,10 @@ bool QgsMapToPixelSimplifier::equalSnapToGrid( double x1, double y1, double x2,
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 //! Generalize the WKB-geometry using the BBOX of the original geometry
+template<class T>
 static QgsGeometry generalizeWkbGeometryByBoundingBox(
   QgsWkbTypes::Type wkbType,
-  const QgsAbstractGeometry &geometry,
+  const T &geometry,
   const QgsRectangle &envelope )
 {
   unsigned int geometryType = QgsWkbTypes::singleType( QgsWkbTypes::flatType( wkbType ) );
@@ -112,158 +115,291 @@ static T *createEmptySameTypeGeom( const T &geom )
   return output;
 }
 
-QgsGeometry QgsMapToPixelSimplifier::simplifyGeometry(
+namespace
+{
+
+  /**
+   * Read-only view over the vertices of a WKB line string (or polygon ring) in native
+   * byte order. It provides the subset of the QgsCurve interface used by the simplifier,
+   * so that lazily parsed geometries can be simplified without building them first.
+   */
+  class WkbCurve
+  {
+    public:
+      WkbCurve( QgsWkbTypes::Type wkbType, QgsConstWkbPtr &wkbPtr )
+        : mHasZ( QgsWkbTypes::hasZ( wkbType ) )
+        , mHasM( QgsWkbTypes::hasM( wkbType ) )
+        , mStride( ( 2 + mHasZ + mHasM ) * sizeof( double ) )
+      {
+        wkbPtr >> mNumPoints;
+        mData = wkbPtr;
+        wkbPtr += mNumPoints * mStride;
+      }
+
+      int numPoints() const { return mNumPoints; }
+      int nCoordinates() const { return mNumPoints; }
+      bool is3D() const { return mHasZ; }
+      double xAt( int i ) const { return coordinate( i, 0 ); }
+      double yAt( int i ) const { return coordinate( i, 1 ); }
+
+      void points( QgsPointSequence &points ) const
+      {
+        const QgsWkbTypes::Type pointType = QgsWkbTypes::zmType( QgsWkbTypes::Point, mHasZ, mHasM );
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        points.clear();
+        points.reserve( mNumPoints );
+        for ( int i = 0; i < mNumPoints; ++i )
+        {
+          points << QgsPoint( pointType, xAt( i ), yAt( i ),
+                              mHasZ ? coordinate( i, 2 ) : nan,
+                              mHasM ? coordinate( i, mHasZ ? 3 : 2 ) : nan );
+        }
+      }
+
+      QgsLineString *clone() const
+      {
+        QVector<double> x( mNumPoints ), y( mNumPoints ), z, m;
+        if ( mHasZ )
+          z.resize( mNumPoints );
+        if ( mHasM )
+          m.resize( mNumPoints );
+        for ( int i = 0; i < mNumPoints; ++i )
+        {
+          x[i] = xAt( i );
+          y[i] = yAt( i );
+          if ( mHasZ )
+            z[i] = coordinate( i, 2 );
+          if ( mHasM )
+            m[i] = coordinate( i, mHasZ ? 3 : 2 );
+        }
+        return new QgsLineString( x, y, z, m );
+      }
+
+      QgsLineString *createEmpty() const
+      {
+        QgsLineString *output = new QgsLineString();
+        if ( mHasZ )
+          output->addZValue();
+        if ( mHasM )
+          output->addMValue();
+        return output;
+      }
+
+    private:
+      double coordinate( int i, int offset ) const
+      {
+        double value;
+        memcpy( &value, mData + i * mStride + offset * sizeof( double ), sizeof( double ) );
+        return value;
+      }
+
+      bool mHasZ;
+      bool mHasM;
+      int mStride;
+      int mNumPoints = 0;
+      const unsigned char *mData = nullptr;
+  };
+
+  QgsLineString *createEmptySameTypeGeom( const WkbCurve &curve )
+  {
+    return curve.createEmpty();
+  }
+
+  //! Returns the number of vertices of the WKB geometry at the current position of \a wkbPtr and moves past it
+  int wkbCoordinateCount( QgsConstWkbPtr &wkbPtr )
+  {
+    const QgsWkbTypes::Type wkbType = wkbPtr.readHeader();
+    const int pointSize = ( 2 + QgsWkbTypes::hasZ( wkbType ) + QgsWkbTypes::hasM( wkbType ) ) * sizeof( double );
+    int count = 0;
+    int numItems;
+    wkbPtr >> numItems;
+
+    switch ( QgsWkbTypes::flatType( wkbType ) )
+    {
+      case QgsWkbTypes::LineString:
+        wkbPtr += numItems * pointSize;
+        return numItems;
+
+      case QgsWkbTypes::Polygon:
+        for ( int i = 0; i < numItems; ++i )
+        {
+          int numPoints;
+          wkbPtr >> numPoints;
+          wkbPtr += numPoints * pointSize;
+          count += numPoints;
+        }
+        return count;
+
+      default:
+        for ( int i = 0; i < numItems; ++i )
+          count += wkbCoordinateCount( wkbPtr );
+        return count;
+    }
+  }
+
+}
+
+template<class T>
+QgsGeometry QgsMapToPixelSimplifier::simplifyCurve(
   int simplifyFlags,
   SimplifyAlgorithm simplifyAlgorithm,
   QgsWkbTypes::Type wkbType,
-  const QgsAbstractGeometry &geometry,
+  const T &srcCurve,
   const QgsRectangle &envelope, double map2pixelTol,
   bool isaLinearRing )
 {
-  bool isGeneralizable = true;
+  bool isGeneralizable = ( simplifyFlags & QgsMapToPixelSimplifier::SimplifyGeometry );
 
-  // Can replace the geometry by its BBOX ?
-  if ( ( simplifyFlags & QgsMapToPixelSimplifier::SimplifyEnvelope ) &&
-       isGeneralizableByMapBoundingBox( envelope, map2pixelTol ) )
-  {
-    return generalizeWkbGeometryByBoundingBox( wkbType, geometry, envelope );
-  }
+  std::unique_ptr<QgsCurve> output( createEmptySameTypeGeom( srcCurve ) );
+  double x = 0.0, y = 0.0, lastX = 0.0, lastY = 0.0;
+  QgsRectangle r;
+  r.setMinimal();
+
+  const int numPoints = srcCurve.numPoints();
 
-  if ( !( simplifyFlags & QgsMapToPixelSimplifier::SimplifyGeometry ) )
+  if ( numPoints <= ( isaLinearRing ? 4 : 2 ) )
     isGeneralizable = false;
 
-  const QgsWkbTypes::Type flatType = QgsWkbTypes::flatType( wkbType );
+  bool isLongSegment;
+  bool hasLongSegments = false; //-> To avoid replace the simplified geometry by its BBOX when there are 'long' segments.
 
-  // Write the geometry
-  if ( flatType == QgsWkbTypes::LineString || flatType == QgsWkbTypes::CircularString )
+  // Check whether the LinearRing is really closed.
+  if ( isaLinearRing )
   {
-    const QgsCurve &srcCurve = dynamic_cast<const QgsCurve &>( geometry );
-    std::unique_ptr<QgsCurve> output( createEmptySameTypeGeom( srcCurve ) );
-    double x = 0.0, y = 0.0, lastX = 0.0, lastY = 0.0;
-    QgsRectangle r;
-    r.setMinimal();
-
-    const int numPoints = srcCurve.numPoints();
-
-    if ( numPoints <= ( isaLinearRing ? 4 : 2 ) )
-      isGeneralizable = false;
-
-    bool isLongSegment;
-    bool hasLongSegments = false; //-> To avoid replace the simplified geometry by its BBOX when there are 'long' segments.
+    isaLinearRing = qgsDoubleNear( srcCurve.xAt( 0 ), srcCurve.xAt( numPoints - 1 ) ) &&
+                    qgsDoubleNear( srcCurve.yAt( 0 ), srcCurve.yAt( numPoints - 1 ) );
+  }
 
-    // Check whether the LinearRing is really closed.
-    if ( isaLinearRing )
+  // Process each vertex...
+  switch ( simplifyAlgorithm )
+  {
+    case SnapToGrid:
     {
-      isaLinearRing = qgsDoubleNear( srcCurve.xAt( 0 ), srcCurve.xAt( numPoints - 1 ) ) &&
-                      qgsDoubleNear( srcCurve.yAt( 0 ), srcCurve.yAt( numPoints - 1 ) );
-    }
+      double gridOriginX = envelope.xMinimum();
+      double gridOriginY = envelope.yMinimum();
 
-    // Process each vertex...
-    switch ( simplifyAlgorithm )
-    {
-      case SnapToGrid:
-      {
-        double gridOriginX = envelope.xMinimum();
-        double gridOriginY = envelope.yMinimum();
+      // Use a factor for the maximum displacement distance for simplification, similar as GeoServer does
+      float gridInverseSizeXY = map2pixelTol != 0 ? ( float )( 1.0f / ( 0.8 * map2pixelTol ) ) : 0.0f;
 
-        // Use a factor for the maximum displacement distance for simplification, similar as GeoServer does
-        float gridInverseSizeXY = map2pixelTol != 0 ? ( float )( 1.0f / ( 0.8 * map2pixelTol ) ) : 0.0f;
+      for ( int i = 0; i < numPoints; ++i )
+      {
+        x = srcCurve.xAt( i );
+        y = srcCurve.yAt( i );
 
-        for ( int i = 0; i < numPoints; ++i )
+        if ( i == 0 ||
+             !isGeneralizable ||
+             !equalSnapToGrid( x, y, lastX, lastY, gridOriginX, gridOriginY, gridInverseSizeXY ) ||
+             ( !isaLinearRing && ( i == 1 || i >= numPoints - 2 ) ) )
         {
-          x = srcCurve.xAt( i );
-          y = srcCurve.yAt( i );
-
-          if ( i == 0 ||
-               !isGeneralizable ||
-               !equalSnapToGrid( x, y, lastX, lastY, gridOriginX, gridOriginY, gridInverseSizeXY ) ||
-               ( !isaLinearRing && ( i == 1 || i >= numPoints - 2 ) ) )
-          {
-            output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), QgsPoint( x, y ) );
-            lastX = x;
-            lastY = y;
-          }
-
-          r.combineExtentWith( x, y );
+          output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), QgsPoint( x, y ) );
+          lastX = x;
+          lastY = y;
         }
-        break;
+
+        r.combineExtentWith( x, y );
       }
+      break;
+    }
 
-      case Visvalingam:
-      {
-        map2pixelTol *= map2pixelTol; //-> Use mappixelTol for 'Area' calculations.
+    case Visvalingam:
+    {
+      map2pixelTol *= map2pixelTol; //-> Use mappixelTol for 'Area' calculations.
 
-        EFFECTIVE_AREAS ea( srcCurve );
+      EFFECTIVE_AREAS ea( srcCurve );
 
-        int set_area = 0;
-        ptarray_calc_areas( &ea, isaLinearRing ? 4 : 2, set_area, map2pixelTol );
+      int set_area = 0;
+      ptarray_calc_areas( &ea, isaLinearRing ? 4 : 2, set_area, map2pixelTol );
 
-        for ( int i = 0; i < numPoints; ++i )
+      for ( int i = 0; i < numPoints; ++i )
+      {
+        if ( ea.res_arealist[ i ] > map2pixelTol )
         {
-          if ( ea.res_arealist[ i ] > map2pixelTol )
-          {
-            output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), ea.inpts.at( i ) );
-          }
+          output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), ea.inpts.at( i ) );
         }
-        break;
       }
+      break;
+    }
 
-      case Distance:
-      {
-        map2pixelTol *= map2pixelTol; //-> Use mappixelTol for 'LengthSquare' calculations.
-
-        for ( int i = 0; i < numPoints; ++i )
-        {
-          x = srcCurve.xAt( i );
-          y = srcCurve.yAt( i );
+    case Distance:
+    {
+      map2pixelTol *= map2pixelTol; //-> Use mappixelTol for 'LengthSquare' calculations.
 
-          isLongSegment = false;
+      for ( int i = 0; i < numPoints; ++i )
+      {
+        x = srcCurve.xAt( i );
+        y = srcCurve.yAt( i );
 
-          if ( i == 0 ||
-               !isGeneralizable ||
-               ( isLongSegment = ( calculateLengthSquared2D( x, y, lastX, lastY ) > map2pixelTol ) ) ||
-               ( !isaLinearRing && ( i == 1 || i >= numPoints - 2 ) ) )
-          {
-            output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), QgsPoint( x, y ) );
-            lastX = x;
-            lastY = y;
+        isLongSegment = false;
 
-            hasLongSegments |= isLongSegment;
-          }
+        if ( i == 0 ||
+             !isGeneralizable ||
+             ( isLongSegment = ( calculateLengthSquared2D( x, y, lastX, lastY ) > map2pixelTol ) ) ||
+             ( !isaLinearRing && ( i == 1 || i >= numPoints - 2 ) ) )
+        {
+          output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), QgsPoint( x, y ) );
+          lastX = x;
+          lastY = y;
 
-          r.combineExtentWith( x, y );
+          hasLongSegments |= isLongSegment;
         }
+
+        r.combineExtentWith( x, y );
       }
     }
+  }
 
-    if ( output->numPoints() < ( isaLinearRing ? 4 : 2 ) )
+  if ( output->numPoints() < ( isaLinearRing ? 4 : 2 ) )
+  {
+    // we simplified the geometry too much!
+    if ( !hasLongSegments )
     {
-      // we simplified the geometry too much!
-      if ( !hasLongSegments )
-      {
-        // approximate the geometry's shape by its bounding box
-        // (rect for linear ring / one segment for line string)
-        return generalizeWkbGeometryByBoundingBox( wkbType, geometry, r );
-      }
-      else
-      {
-        // Bad luck! The simplified geometry is invalid and approximation by bounding box
-        // would create artifacts due to long segments.
-        // We will return the original geometry
-        return QgsGeometry( geometry.clone() );
-      }
+      // approximate the geometry's shape by its bounding box
+      // (rect for linear ring / one segment for line string)
+      return generalizeWkbGeometryByBoundingBox( wkbType, srcCurve, r );
     }
+    else
+    {
+      // Bad luck! The simplified geometry is invalid and approximation by bounding box
+      // would create artifacts due to long segments.
+      // We will return the original geometry
+      return QgsGeometry( srcCurve.clone() );
+    }
+  }
 
-    if ( isaLinearRing )
+  if ( isaLinearRing )
+  {
+    // make sure we keep the linear ring closed
+    if ( !qgsDoubleNear( lastX, output->xAt( 0 ) ) || !qgsDoubleNear( lastY, output->yAt( 0 ) ) )
     {
-      // make sure we keep the linear ring closed
-      if ( !qgsDoubleNear( lastX, output->xAt( 0 ) ) || !qgsDoubleNear( lastY, output->yAt( 0 ) ) )
-      {
-        output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), QgsPoint( output->xAt( 0 ), output->yAt( 0 ) ) );
-      }
+      output->insertVertex( QgsVertexId( 0, 0, output->numPoints() ), QgsPoint( output->xAt( 0 ), output->yAt( 0 ) ) );
     }
+  }
+
+  return QgsGeometry( output.release() );
+}
 
-    return QgsGeometry( output.release() );
+QgsGeometry QgsMapToPixelSimplifier::simplifyGeometry(
+  int simplifyFlags,
+  SimplifyAlgorithm simplifyAlgorithm,
+  QgsWkbTypes::Type wkbType,
+  const QgsAbstractGeometry &geometry,
+  const QgsRectangle &envelope, double map2pixelTol,
+  bool isaLinearRing )
+{
+  // Can replace the geometry by its BBOX ?
+  if ( ( simplifyFlags & QgsMapToPixelSimplifier::SimplifyEnvelope ) &&
+       isGeneralizableByMapBoundingBox( envelope, map2pixelTol ) )
+  {
+    return generalizeWkbGeometryByBoundingBox( wkbType, geometry, envelope );
+  }
+
+  const QgsWkbTypes::Type flatType = QgsWkbTypes::flatType( wkbType );
+
+  // Write the geometry
+  if ( flatType == QgsWkbTypes::LineString || flatType == QgsWkbTypes::CircularString )
+  {
+    const QgsCurve &srcCurve = dynamic_cast<const QgsCurve &>( geometry );
+    return simplifyCurve( simplifyFlags, simplifyAlgorithm, wkbType, srcCurve, envelope, map2pixelTol, isaLinearRing );
   }
   else if ( flatType == QgsWkbTypes::Polygon )
   {
@@ -292,6 +428,52 @@ QgsGeometry QgsMapToPixelSimplifier::simplifyGeometry(
   return QgsGeometry( geometry.clone() );
 }
 
+QgsGeometry QgsMapToPixelSimplifier::simplifyWkbGeometry(
+  int simplifyFlags,
+  SimplifyAlgorithm simplifyAlgorithm,
+  QgsConstWkbPtr &wkbPtr,
+  const QgsRectangle &envelope, double map2pixelTol )
+{
+  const QgsWkbTypes::Type wkbType = wkbPtr.readHeader();
+  const QgsWkbTypes::Type flatType = QgsWkbTypes::flatType( wkbType );
+
+  if ( flatType == QgsWkbTypes::LineString )
+  {
+    const WkbCurve srcCurve( wkbType, wkbPtr );
+    return simplifyCurve( simplifyFlags, simplifyAlgorithm, wkbType, srcCurve, envelope, map2pixelTol, false );
+  }
+  else if ( flatType == QgsWkbTypes::Polygon )
+  {
+    const QgsWkbTypes::Type ringType = QgsWkbTypes::zmType( QgsWkbTypes::LineString, QgsWkbTypes::hasZ( wkbType ), QgsWkbTypes::hasM( wkbType ) );
+    int numRings;
+    wkbPtr >> numRings;
+    std::unique_ptr<QgsPolygonV2> polygon( new QgsPolygonV2() );
+    for ( int i = 0; i < numRings; ++i )
+    {
+      const WkbCurve ring( ringType, wkbPtr );
+      QgsCurve *simplifiedRing = qgsgeometry_cast<QgsCurve *>( simplifyCurve( simplifyFlags, simplifyAlgorithm, ringType, ring, envelope, map2pixelTol, true ).geometry()->clone() );
+      if ( i == 0 )
+        polygon->setExteriorRing( simplifiedRing );
+      else
+        polygon->addInteriorRing( simplifiedRing );
+    }
+    return QgsGeometry( polygon.release() );
+  }
+  else
+  {
+    // only multi line strings and multi polygons are kept unparsed by QgsGeometry::fromWkb
+    int numGeoms;
+    wkbPtr >> numGeoms;
+    std::unique_ptr<QgsGeometryCollection> collection( qgsgeometry_cast<QgsGeometryCollection *>( QgsGeometryFactory::geomFromWkbType( wkbType ).release() ) );
+    Q_ASSERT( collection );
+    for ( int i = 0; i < numGeoms; ++i )
+    {
+      collection->addGeometry( simplifyWkbGeometry( simplifyFlags, simplifyAlgorithm, wkbPtr, envelope, map2pixelTol ).geometry()->clone() );
+    }
+    return QgsGeometry( collection.release() );
+  }
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////
 
 bool QgsMapToPixelSimplifier::isGeneralizableByMapBoundingBox( const QgsRectangle &envelope, double map2pixelTol )
@@ -319,8 +501,21 @@ QgsGeometry QgsMapToPixelSimplifier::simplify( const QgsGeometry &geometry ) con
     return geometry;
   }
 
+  // geometries read from providers may not have been parsed yet, in which case
+  // they are simplified straight from their WKB
+  const QByteArray wkb = geometry.sourceWkb();
+
   const bool isaLinearRing = flatType == QgsWkbTypes::Polygon;
-  const int numPoints = geometry.geometry()->nCoordinates();
+  int numPoints = 0;
+  if ( !wkb.isEmpty() )
+  {
+    QgsConstWkbPtr wkbPtr( wkb );
+    numPoints = wkbCoordinateCount( wkbPtr );
+  }
+  else
+  {
+    numPoints = geometry.geometry()->nCoordinates();
+  }
 
   if ( numPoints <= ( isaLinearRing ? 6 : 3 ) )
   {
@@ -335,5 +530,26 @@ QgsGeometry QgsMapToPixelSimplifier::simplify( const QgsGeometry &geometry ) con
     return geometry;
   }
 
-  return simplifyGeometry( mSimplifyFlags, mSimplifyAlgorithm, geometry.wkbType(), *geometry.geometry(), envelope, mTolerance, false );
+  if ( wkb.isEmpty() )
+  {
+    return simplifyGeometry( mSimplifyFlags, mSimplifyAlgorithm, geometry.wkbType(), *geometry.geometry(), envelope, mTolerance, false );
+  }
+
+  // Can replace the geometry by its BBOX ?
+  if ( ( mSimplifyFlags & QgsMapToPixelSimplifier::SimplifyEnvelope ) &&
+       isGeneralizableByMapBoundingBox( envelope, mTolerance ) )
+  {
+    // the geometry is not minimal, see the early exit above
+    if ( flatType == QgsWkbTypes::LineString )
+    {
+      QgsLineString *lineString = new QgsLineString();
+      lineString->addVertex( QgsPoint( envelope.xMinimum(), envelope.yMinimum() ) );
+      lineString->addVertex( QgsPoint( envelope.xMaximum(), envelope.yMaximum() ) );
+      return QgsGeometry( lineString );
+    }
+    return QgsGeometry::fromRect( envelope );
+  }
+
+  QgsConstWkbPtr wkbPtr( wkb );
+  return simplifyWkbGeometry( mSimplifyFlags, mSimplifyAlgorithm, wkbPtr, envelope, mTolerance );
 }
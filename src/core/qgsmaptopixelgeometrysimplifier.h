@@ -60,6 +60,13 @@ class CORE_EXPORT QgsMapToPixelSimplifier : public QgsAbstractGeometrySimplifier
     //! Simplify the geometry using the specified tolerance
     static QgsGeometry simplifyGeometry( int simplifyFlags, SimplifyAlgorithm simplifyAlgorithm, QgsWkbTypes::Type wkbType, const QgsAbstractGeometry &geometry, const QgsRectangle &envelope, double map2pixelTol, bool isaLinearRing );
 
+    //! Simplify a curve (either a QgsCurve or the vertices of a WKB line string) using the specified tolerance
+    template<class T>
+    static QgsGeometry simplifyCurve( int simplifyFlags, SimplifyAlgorithm simplifyAlgorithm, QgsWkbTypes::Type wkbType, const T &srcCurve, const QgsRectangle &envelope, double map2pixelTol, bool isaLinearRing );
+
+    //! Simplify the WKB geometry at the current position of \a wkbPtr without building the source geometry
+    static QgsGeometry simplifyWkbGeometry( int simplifyFlags, SimplifyAlgorithm simplifyAlgorithm, QgsConstWkbPtr &wkbPtr, const QgsRectangle &envelope, double map2pixelTol );
+
   protected:
     //! Current simplification flags
     int mSimplifyFlags;
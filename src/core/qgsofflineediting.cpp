@@ -268,6 +268,9 @@ void QgsOfflineEditing::synchronize()
       {
         remoteLayer->startEditing();
 
+        // offline -> remote feature id lookup, read once for the whole replay
+        const QHash<QgsFeatureId, QgsFeatureId> fidLookup = remoteFidLookup( db, layerId );
+
         // TODO: only get commitNos of this layer?
         int commitNo = getCommitNo( db );
         QgsDebugMsgLevel( QString( "Found %1 commits" ).arg( commitNo ), 4 );
@@ -276,19 +279,20 @@ void QgsOfflineEditing::synchronize()
           QgsDebugMsgLevel( "Apply commits chronologically", 4 );
           // apply commits chronologically
           applyAttributesAdded( remoteLayer, db, layerId, i );
-          applyAttributeValueChanges( offlineLayer, remoteLayer, db, layerId, i );
-          applyGeometryChanges( remoteLayer, db, layerId, i );
+          applyAttributeValueChanges( offlineLayer, remoteLayer, db, layerId, i, fidLookup );
+          applyGeometryChanges( remoteLayer, db, layerId, i, fidLookup );
         }
 
         applyFeaturesAdded( offlineLayer, remoteLayer, db, layerId );
-        applyFeaturesRemoved( remoteLayer, db, layerId );
+        applyFeaturesRemoved( remoteLayer, db, layerId, fidLookup );
 
         if ( remoteLayer->commitChanges() )
         {
           // update fid lookup
-          updateFidLookup( remoteLayer, db, layerId );
+          updateFidLookup( remoteLayer, db, layerId, fidLookup );
 
           // clear edit log for this layer
+          sqlExec( db, QStringLiteral( "BEGIN" ) );
           sql = QStringLiteral( "DELETE FROM 'log_added_attrs' WHERE \"layer_id\" = %1" ).arg( layerId );
           sqlExec( db, sql );
           sql = QStringLiteral( "DELETE FROM 'log_added_features' WHERE \"layer_id\" = %1" ).arg( layerId );
@@ -299,6 +303,7 @@ void QgsOfflineEditing::synchronize()
           sqlExec( db, sql );
           sql = QStringLiteral( "DELETE FROM 'log_geometry_updates' WHERE \"layer_id\" = %1" ).arg( layerId );
           sqlExec( db, sql );
+          sqlExec( db, QStringLiteral( "COMMIT" ) );
 
           // reset commitNo
           QString sql = QStringLiteral( "UPDATE 'log_indices' SET 'last_index' = 0 WHERE \"name\" = 'commit_no'" );
@@ -526,6 +531,7 @@ QgsVectorLayer *QgsOfflineEditing::copyVectorLayer( QgsVectorLayer *layer, sqlit
   int rc = sqlExec( db, sql );
 
   // add geometry column
+  QString geometryExpression;
   if ( layer->isSpatial() )
   {
     QString geomType;
@@ -553,24 +559,44 @@ QgsVectorLayer *QgsOfflineEditing::copyVectorLayer( QgsVectorLayer *layer, sqlit
         showWarning( tr( "QGIS wkbType %1 not supported" ).arg( layer->wkbType() ) );
         break;
     };
+    long srid = layer->crs().authid().startsWith( QLatin1String( "EPSG:" ), Qt::CaseInsensitive ) ? layer->crs().authid().mid( 5 ).toLong() : 0;
     QString sqlAddGeom = QStringLiteral( "SELECT AddGeometryColumn('%1', 'Geometry', %2, '%3', 2)" )
                          .arg( tableName )
-                         .arg( layer->crs().authid().startsWith( QLatin1String( "EPSG:" ), Qt::CaseInsensitive ) ? layer->crs().authid().mid( 5 ).toLong() : 0 )
+                         .arg( srid )
                          .arg( geomType );
 
-    // create spatial index
-    QString sqlCreateIndex = QStringLiteral( "SELECT CreateSpatialIndex('%1', 'Geometry')" ).arg( tableName );
-
     if ( rc == SQLITE_OK )
     {
       rc = sqlExec( db, sqlAddGeom );
-      if ( rc == SQLITE_OK )
-      {
-        rc = sqlExec( db, sqlCreateIndex );
-      }
+    }
+
+    // provider WKB is converted by SpatiaLite itself, matching the XY column created above
+    geometryExpression = QStringLiteral( "CastToXY(GeomFromWKB(?, %1))" ).arg( srid );
+    if ( QgsWkbTypes::isMultiType( layer->wkbType() ) )
+    {
+      geometryExpression = QStringLiteral( "CastToMulti(%1)" ).arg( geometryExpression );
     }
   }
 
+  if ( rc != SQLITE_OK )
+    return nullptr;
+
+  // copy features
+  QList<QgsFeatureId> remoteFeatureIds;
+  QList<QgsFeatureId> offlineFeatureIds;
+  if ( !copyFeatures( layer, db, tableName, geometryExpression, onlySelected, remoteFeatureIds, offlineFeatureIds ) )
+  {
+    showWarning( tr( "Feature cannot be copied to the offline layer, please check if the online layer '%1' is still accessible." ).arg( layer->name() ) );
+    return nullptr;
+  }
+
+  // create spatial index once all rows are in place, rather than updating it on every insert
+  if ( layer->isSpatial() )
+  {
+    QString sqlCreateIndex = QStringLiteral( "SELECT CreateSpatialIndex('%1', 'Geometry')" ).arg( tableName );
+    rc = sqlExec( db, sqlCreateIndex );
+  }
+
   if ( rc == SQLITE_OK )
   {
     // add new layer
@@ -581,90 +607,13 @@ QgsVectorLayer *QgsOfflineEditing::copyVectorLayer( QgsVectorLayer *layer, sqlit
         layer->name() + " (offline)", QStringLiteral( "spatialite" ) );
     if ( newLayer->isValid() )
     {
+      emit progressModeSet( QgsOfflineEditing::ProcessFeatures, remoteFeatureIds.size() );
 
-      // copy features
-      newLayer->startEditing();
-      QgsFeature f;
-
-      QgsFeatureRequest req;
-
-      if ( onlySelected )
-      {
-        QgsFeatureIds selectedFids = layer->selectedFeatureIds();
-        if ( !selectedFids.isEmpty() )
-          req.setFilterFids( selectedFids );
-      }
-
-      QgsFeatureIterator fit = layer->dataProvider()->getFeatures( req );
-
-      if ( req.filterType() == QgsFeatureRequest::FilterFids )
-      {
-        emit progressModeSet( QgsOfflineEditing::CopyFeatures, layer->selectedFeatureIds().size() );
-      }
-      else
-      {
-        emit progressModeSet( QgsOfflineEditing::CopyFeatures, layer->dataProvider()->featureCount() );
-      }
-      int featureCount = 1;
-
-      QList<QgsFeatureId> remoteFeatureIds;
-      while ( fit.nextFeature( f ) )
-      {
-        remoteFeatureIds << f.id();
-
-        // NOTE: SpatiaLite provider ignores position of geometry column
-        // fill gap in QgsAttributeMap if geometry column is not last (WORKAROUND)
-        int column = 0;
-        QgsAttributes attrs = f.attributes();
-        QgsAttributes newAttrs( attrs.count() );
-        for ( int it = 0; it < attrs.count(); ++it )
-        {
-          newAttrs[column++] = attrs.at( it );
-        }
-        f.setAttributes( newAttrs );
+      // update feature id lookup
+      int layerId = getOrCreateLayerId( db, newLayer->id() );
+      addFidLookups( db, layerId, offlineFeatureIds, remoteFeatureIds );
 
-        newLayer->addFeature( f );
-
-        emit progressUpdated( featureCount++ );
-      }
-      if ( newLayer->commitChanges() )
-      {
-        emit progressModeSet( QgsOfflineEditing::ProcessFeatures, layer->dataProvider()->featureCount() );
-        featureCount = 1;
-
-        // update feature id lookup
-        int layerId = getOrCreateLayerId( db, newLayer->id() );
-        QList<QgsFeatureId> offlineFeatureIds;
-
-        QgsFeatureIterator fit = newLayer->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( QgsAttributeList() ) );
-        while ( fit.nextFeature( f ) )
-        {
-          offlineFeatureIds << f.id();
-        }
-
-        // NOTE: insert fids in this loop, as the db is locked during newLayer->nextFeature()
-        sqlExec( db, QStringLiteral( "BEGIN" ) );
-        int remoteCount = remoteFeatureIds.size();
-        for ( int i = 0; i < remoteCount; i++ )
-        {
-          // Check if the online feature has been fetched (WFS download aborted for some reason)
-          if ( i < offlineFeatureIds.count() )
-          {
-            addFidLookup( db, layerId, offlineFeatureIds.at( i ), remoteFeatureIds.at( i ) );
-          }
-          else
-          {
-            showWarning( tr( "Feature cannot be copied to the offline layer, please check if the online layer '%1' is still accessible." ).arg( layer->name() ) );
-            return nullptr;
-          }
-          emit progressUpdated( featureCount++ );
-        }
-        sqlExec( db, QStringLiteral( "COMMIT" ) );
-      }
-      else
-      {
-        showWarning( newLayer->commitErrors().join( QStringLiteral( "\n" ) ) );
-      }
+      emit progressUpdated( remoteFeatureIds.size() );
 
       // mark as offline layer
       newLayer->setCustomProperty( CUSTOM_PROPERTY_IS_OFFLINE_EDITABLE, true );
@@ -713,6 +662,121 @@ QgsVectorLayer *QgsOfflineEditing::copyVectorLayer( QgsVectorLayer *layer, sqlit
   return nullptr;
 }
 
+bool QgsOfflineEditing::copyFeatures( QgsVectorLayer *layer, sqlite3 *db, const QString &tableName, const QString &geometryExpression, bool onlySelected, QList<QgsFeatureId> &remoteFeatureIds, QList<QgsFeatureId> &offlineFeatureIds )
+{
+  const QgsFields providerFields = layer->dataProvider()->fields();
+
+  // rows are written with a single prepared statement, bypassing the edit buffer of the offline layer
+  QString sql = QStringLiteral( "INSERT INTO '%1' (" ).arg( tableName );
+  QString values;
+  QString delim;
+  for ( const auto &field : providerFields )
+  {
+    sql += delim + QStringLiteral( "'%1'" ).arg( field.name() );
+    values += delim + '?';
+    delim = ',';
+  }
+  if ( !geometryExpression.isEmpty() )
+  {
+    sql += delim + QStringLiteral( "'Geometry'" );
+    values += delim + geometryExpression;
+  }
+  sql += QStringLiteral( ") VALUES (%1)" ).arg( values );
+
+  sqlite3_stmt *stmt = nullptr;
+  if ( sqlite3_prepare_v2( db, sql.toUtf8().constData(), -1, &stmt, nullptr ) != SQLITE_OK )
+  {
+    showWarning( sqlite3_errmsg( db ) );
+    return false;
+  }
+
+  QgsFeatureRequest req;
+
+  if ( onlySelected )
+  {
+    QgsFeatureIds selectedFids = layer->selectedFeatureIds();
+    if ( !selectedFids.isEmpty() )
+      req.setFilterFids( selectedFids );
+  }
+
+  QgsFeatureIterator fit = layer->dataProvider()->getFeatures( req );
+
+  if ( req.filterType() == QgsFeatureRequest::FilterFids )
+  {
+    emit progressModeSet( QgsOfflineEditing::CopyFeatures, layer->selectedFeatureIds().size() );
+  }
+  else
+  {
+    emit progressModeSet( QgsOfflineEditing::CopyFeatures, layer->dataProvider()->featureCount() );
+  }
+  int featureCount = 1;
+
+  bool ok = sqlExec( db, QStringLiteral( "BEGIN" ) ) == SQLITE_OK;
+  QgsFeature f;
+  while ( ok && fit.nextFeature( f ) )
+  {
+    sqlite3_reset( stmt );
+    sqlite3_clear_bindings( stmt );
+
+    const QgsAttributes attrs = f.attributes();
+    int column = 0;
+    for ( ; column < providerFields.count(); ++column )
+    {
+      const QVariant v = attrs.value( column );
+      if ( v.isNull() )
+      {
+        sqlite3_bind_null( stmt, column + 1 );
+        continue;
+      }
+
+      switch ( providerFields.at( column ).type() )
+      {
+        case QVariant::Int:
+        case QVariant::LongLong:
+          sqlite3_bind_int64( stmt, column + 1, v.toLongLong() );
+          break;
+        case QVariant::Double:
+          sqlite3_bind_double( stmt, column + 1, v.toDouble() );
+          break;
+        default:
+        {
+          const QByteArray ba = v.toString().toUtf8();
+          sqlite3_bind_text( stmt, column + 1, ba.constData(), ba.size(), SQLITE_TRANSIENT );
+          break;
+        }
+      }
+    }
+
+    // geometries are passed on as provider WKB, without being parsed
+    QByteArray wkb;
+    if ( !geometryExpression.isEmpty() )
+    {
+      wkb = f.geometry().exportToWkb();
+      if ( wkb.isEmpty() )
+        sqlite3_bind_null( stmt, column + 1 );
+      else
+        sqlite3_bind_blob( stmt, column + 1, wkb.constData(), wkb.size(), SQLITE_STATIC );
+    }
+
+    if ( sqlite3_step( stmt ) != SQLITE_DONE )
+    {
+      showWarning( sqlite3_errmsg( db ) );
+      ok = false;
+      break;
+    }
+
+    remoteFeatureIds << f.id();
+    offlineFeatureIds << sqlite3_last_insert_rowid( db );
+
+    emit progressUpdated( featureCount++ );
+  }
+  sqlite3_finalize( stmt );
+
+  sqlExec( db, ok ? QStringLiteral( "COMMIT" ) : QStringLiteral( "ROLLBACK" ) );
+
+  return ok;
+}
+
 void QgsOfflineEditing::applyAttributesAdded( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo )
 {
   QString sql = QStringLiteral( "SELECT \"name\", \"type\", \"length\", \"precision\", \"comment\" FROM 'log_added_attrs' WHERE \"layer_id\" = %1 AND \"commit_no\" = %2" ).arg( layerId ).arg( commitNo );
@@ -776,11 +840,13 @@ void QgsOfflineEditing::applyFeaturesAdded( QgsVectorLayer *offlineLayer, QgsVec
 
   int i = 1;
   int newAttrsCount = remoteLayer->fields().count();
+  // NOTE: SpatiaLite provider ignores position of geometry column
+  // restore gap in QgsAttributeMap if geometry column is not last (WORKAROUND)
+  QMap<int, int> attrLookup = attributeLookup( offlineLayer, remoteLayer );
+  QgsFeatureList newFeatures;
+  newFeatures.reserve( features.size() );
   for ( QgsFeatureList::iterator it = features.begin(); it != features.end(); ++it )
   {
-    // NOTE: SpatiaLite provider ignores position of geometry column
-    // restore gap in QgsAttributeMap if geometry column is not last (WORKAROUND)
-    QMap<int, int> attrLookup = attributeLookup( offlineLayer, remoteLayer );
     QgsAttributes newAttrs( newAttrsCount );
     QgsAttributes attrs = it->attributes();
     for ( int it = 0; it < attrs.count(); ++it )
@@ -789,14 +855,15 @@ void QgsOfflineEditing::applyFeaturesAdded( QgsVectorLayer *offlineLayer, QgsVec
     }
 
     // respect constraints and provider default values
-    QgsFeature f = QgsVectorLayerUtils::createFeature( remoteLayer, it->geometry(), newAttrs.toMap(), &context );
-    remoteLayer->addFeature( f );
+    newFeatures << QgsVectorLayerUtils::createFeature( remoteLayer, it->geometry(), newAttrs.toMap(), &context );
 
     emit progressUpdated( i++ );
   }
+
+  remoteLayer->addFeatures( newFeatures );
 }
 
-void QgsOfflineEditing::applyFeaturesRemoved( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId )
+void QgsOfflineEditing::applyFeaturesRemoved( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup )
 {
   QString sql = QStringLiteral( "SELECT \"fid\" FROM 'log_removed_features' WHERE \"layer_id\" = %1" ).arg( layerId );
   QgsFeatureIds values = sqlQueryFeaturesRemoved( db, sql );
@@ -806,14 +873,14 @@ void QgsOfflineEditing::applyFeaturesRemoved( QgsVectorLayer *remoteLayer, sqlit
   int i = 1;
   for ( QgsFeatureIds::const_iterator it = values.constBegin(); it != values.constEnd(); ++it )
   {
-    QgsFeatureId fid = remoteFid( db, layerId, *it );
+    QgsFeatureId fid = fidLookup.value( *it, -1 );
     remoteLayer->deleteFeature( fid );
 
     emit progressUpdated( i++ );
   }
 }
 
-void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer *offlineLayer, QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo )
+void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer *offlineLayer, QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup )
 {
   QString sql = QStringLiteral( "SELECT \"fid\", \"attr\", \"value\" FROM 'log_feature_updates' WHERE \"layer_id\" = %1 AND \"commit_no\" = %2 " ).arg( layerId ).arg( commitNo );
   AttributeValueChanges values = sqlQueryAttributeValueChanges( db, sql );
@@ -824,7 +891,7 @@ void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer *offlineLayer
 
   for ( int i = 0; i < values.size(); i++ )
   {
-    QgsFeatureId fid = remoteFid( db, layerId, values.at( i ).fid );
+    QgsFeatureId fid = fidLookup.value( values.at( i ).fid, -1 );
     QgsDebugMsgLevel( QString( "Offline changeAttributeValue %1 = %2" ).arg( QString( attrLookup[ values.at( i ).attr ] ), values.at( i ).value ), 4 );
     remoteLayer->changeAttributeValue( fid, attrLookup[ values.at( i ).attr ], values.at( i ).value );
 
@@ -832,7 +899,7 @@ void QgsOfflineEditing::applyAttributeValueChanges( QgsVectorLayer *offlineLayer
   }
 }
 
-void QgsOfflineEditing::applyGeometryChanges( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo )
+void QgsOfflineEditing::applyGeometryChanges( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup )
 {
   QString sql = QStringLiteral( "SELECT \"fid\", \"geom_wkt\" FROM 'log_geometry_updates' WHERE \"layer_id\" = %1 AND \"commit_no\" = %2" ).arg( layerId ).arg( commitNo );
   GeometryChanges values = sqlQueryGeometryChanges( db, sql );
@@ -841,7 +908,7 @@ void QgsOfflineEditing::applyGeometryChanges( QgsVectorLayer *remoteLayer, sqlit
 
   for ( int i = 0; i < values.size(); i++ )
   {
-    QgsFeatureId fid = remoteFid( db, layerId, values.at( i ).fid );
+    QgsFeatureId fid = fidLookup.value( values.at( i ).fid, -1 );
     QgsGeometry newGeom = QgsGeometry::fromWkt( values.at( i ).geom_wkt );
     remoteLayer->changeGeometry( fid, newGeom );
 
@@ -849,10 +916,18 @@ void QgsOfflineEditing::applyGeometryChanges( QgsVectorLayer *remoteLayer, sqlit
   }
 }
 
-void QgsOfflineEditing::updateFidLookup( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId )
+void QgsOfflineEditing::updateFidLookup( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup )
 {
   // update fid lookup for added features
 
+  // remote fids known before the sync
+  QSet<QgsFeatureId> knownRemoteFids;
+  knownRemoteFids.reserve( fidLookup.size() );
+  for ( auto it = fidLookup.constBegin(); it != fidLookup.constEnd(); ++it )
+  {
+    knownRemoteFids.insert( it.value() );
+  }
+
   // get remote added fids
   // NOTE: use QMap for sorted fids
   QMap < QgsFeatureId, bool /*dummy*/ > newRemoteFids;
@@ -865,7 +940,7 @@ void QgsOfflineEditing::updateFidLookup( QgsVectorLayer *remoteLayer, sqlite3 *d
   int i = 1;
   while ( fit.nextFeature( f ) )
   {
-    if ( offlineFid( db, layerId, f.id() ) == -1 )
+    if ( !knownRemoteFids.contains( f.id() ) )
     {
       newRemoteFids[ f.id()] = true;
     }
@@ -885,13 +960,13 @@ void QgsOfflineEditing::updateFidLookup( QgsVectorLayer *remoteLayer, sqlite3 *d
   else
   {
     // add new fid lookups
-    i = 0;
-    sqlExec( db, QStringLiteral( "BEGIN" ) );
-    for ( QMap<QgsFeatureId, bool>::const_iterator it = newRemoteFids.constBegin(); it != newRemoteFids.constEnd(); ++it )
+    QList<QgsFeatureId> offlineFids;
+    offlineFids.reserve( newOfflineFids.size() );
+    for ( int fid : qgsAsConst( newOfflineFids ) )
     {
-      addFidLookup( db, layerId, newOfflineFids.at( i++ ), it.key() );
+      offlineFids << fid;
     }
-    sqlExec( db, QStringLiteral( "COMMIT" ) );
+    addFidLookups( db, layerId, offlineFids, newRemoteFids.keys() );
   }
 }
 
@@ -1064,22 +1139,55 @@ void QgsOfflineEditing::increaseCommitNo( sqlite3 *db )
   sqlExec( db, sql );
 }
 
-void QgsOfflineEditing::addFidLookup( sqlite3 *db, int layerId, QgsFeatureId offlineFid, QgsFeatureId remoteFid )
+void QgsOfflineEditing::addFidLookups( sqlite3 *db, int layerId, const QList<QgsFeatureId> &offlineFids, const QList<QgsFeatureId> &remoteFids )
 {
-  QString sql = QStringLiteral( "INSERT INTO 'log_fids' VALUES ( %1, %2, %3 )" ).arg( layerId ).arg( offlineFid ).arg( remoteFid );
-  sqlExec( db, sql );
-}
+  sqlite3_stmt *stmt = nullptr;
+  if ( sqlite3_prepare_v2( db, "INSERT INTO 'log_fids' VALUES ( ?, ?, ? )", -1, &stmt, nullptr ) != SQLITE_OK )
+  {
+    showWarning( sqlite3_errmsg( db ) );
+    return;
+  }
 
-QgsFeatureId QgsOfflineEditing::remoteFid( sqlite3 *db, int layerId, QgsFeatureId offlineFid )
-{
-  QString sql = QStringLiteral( "SELECT \"remote_fid\" FROM 'log_fids' WHERE \"layer_id\" = %1 AND \"offline_fid\" = %2" ).arg( layerId ).arg( offlineFid );
-  return sqlQueryInt( db, sql, -1 );
+  sqlExec( db, QStringLiteral( "BEGIN" ) );
+  int count = std::min( offlineFids.size(), remoteFids.size() );
+  for ( int i = 0; i < count; i++ )
+  {
+    sqlite3_reset( stmt );
+    sqlite3_bind_int( stmt, 1, layerId );
+    sqlite3_bind_int64( stmt, 2, offlineFids.at( i ) );
+    sqlite3_bind_int64( stmt, 3, remoteFids.at( i ) );
+    if ( sqlite3_step( stmt ) != SQLITE_DONE )
+    {
+      showWarning( sqlite3_errmsg( db ) );
+      break;
+    }
+  }
+  sqlite3_finalize( stmt );
+  sqlExec( db, QStringLiteral( "COMMIT" ) );
 }
 
-QgsFeatureId QgsOfflineEditing::offlineFid( sqlite3 *db, int layerId, QgsFeatureId remoteFid )
+QHash<QgsFeatureId, QgsFeatureId> QgsOfflineEditing::remoteFidLookup( sqlite3 *db, int layerId )
 {
-  QString sql = QStringLiteral( "SELECT \"offline_fid\" FROM 'log_fids' WHERE \"layer_id\" = %1 AND \"remote_fid\" = %2" ).arg( layerId ).arg( remoteFid );
-  return sqlQueryInt( db, sql, -1 );
+  QHash<QgsFeatureId, QgsFeatureId> lookup;
+
+  QString sql = QStringLiteral( "SELECT \"offline_fid\", \"remote_fid\" FROM 'log_fids' WHERE \"layer_id\" = %1" ).arg( layerId );
+  sqlite3_stmt *stmt = nullptr;
+  if ( sqlite3_prepare_v2( db, sql.toUtf8().constData(), -1, &stmt, nullptr ) != SQLITE_OK )
+  {
+    showWarning( sqlite3_errmsg( db ) );
+    return lookup;
+  }
+
+  int ret = sqlite3_step( stmt );
+  while ( ret == SQLITE_ROW )
+  {
+    lookup.insert( sqlite3_column_int64( stmt, 0 ), sqlite3_column_int64( stmt, 1 ) );
+
+    ret = sqlite3_step( stmt );
+  }
+  sqlite3_finalize( stmt );
+
+  return lookup;
 }
 
 bool QgsOfflineEditing::isAddedFeature( sqlite3 *db, int layerId, QgsFeatureId fid )
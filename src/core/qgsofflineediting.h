@@ -25,6 +25,7 @@
 
 #include <QObject>
 #include <QString>
+#include <QHash>
 
 class QgsMapLayer;
 class QgsVectorLayer;
@@ -111,12 +112,21 @@ class CORE_EXPORT QgsOfflineEditing : public QObject
     void createLoggingTables( sqlite3 *db );
     QgsVectorLayer *copyVectorLayer( QgsVectorLayer *layer, sqlite3 *db, const QString &offlineDbPath, bool onlySelected );
 
+    /**
+     * Inserts the features of \a layer into the offline table \a tableName using a single prepared statement
+     * inside one transaction. \a geometryExpression is the SQL used to convert the bound WKB, or empty
+     * for layers without geometry. The ids of the copied features are appended to \a remoteFeatureIds
+     * and \a offlineFeatureIds in insertion order.
+     */
+    bool copyFeatures( QgsVectorLayer *layer, sqlite3 *db, const QString &tableName, const QString &geometryExpression, bool onlySelected,
+                       QList<QgsFeatureId> &remoteFeatureIds, QList<QgsFeatureId> &offlineFeatureIds );
+
     void applyAttributesAdded( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo );
     void applyFeaturesAdded( QgsVectorLayer *offlineLayer, QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId );
-    void applyFeaturesRemoved( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId );
-    void applyAttributeValueChanges( QgsVectorLayer *offlineLayer, QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo );
-    void applyGeometryChanges( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo );
-    void updateFidLookup( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId );
+    void applyFeaturesRemoved( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup );
+    void applyAttributeValueChanges( QgsVectorLayer *offlineLayer, QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup );
+    void applyGeometryChanges( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, int commitNo, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup );
+    void updateFidLookup( QgsVectorLayer *remoteLayer, sqlite3 *db, int layerId, const QHash<QgsFeatureId, QgsFeatureId> &fidLookup );
     void copySymbology( QgsVectorLayer *sourceLayer, QgsVectorLayer *targetLayer );
 
     /**
@@ -142,9 +152,9 @@ class CORE_EXPORT QgsOfflineEditing : public QObject
     int getOrCreateLayerId( sqlite3 *db, const QString &qgisLayerId );
     int getCommitNo( sqlite3 *db );
     void increaseCommitNo( sqlite3 *db );
-    void addFidLookup( sqlite3 *db, int layerId, QgsFeatureId offlineFid, QgsFeatureId remoteFid );
-    QgsFeatureId remoteFid( sqlite3 *db, int layerId, QgsFeatureId offlineFid );
-    QgsFeatureId offlineFid( sqlite3 *db, int layerId, QgsFeatureId remoteFid );
+    void addFidLookups( sqlite3 *db, int layerId, const QList<QgsFeatureId> &offlineFids, const QList<QgsFeatureId> &remoteFids );
+    //! Returns the offline to remote feature id lookup of a layer
+    QHash<QgsFeatureId, QgsFeatureId> remoteFidLookup( sqlite3 *db, int layerId );
     bool isAddedFeature( sqlite3 *db, int layerId, QgsFeatureId fid );
 
     int sqlExec( sqlite3 *db, const QString &sql );
@@ -217,8 +217,10 @@ QgsGeometry QgsOgrUtils::ogrGeometryToQgsGeometry( OGRGeometryH geom )
     return QgsGeometry();
 
   // get the wkb representation
+  // export directly to the buffer kept by the geometry
   int memorySize = OGR_G_WkbSize( geom );
-  unsigned char *wkb = new unsigned char[memorySize];
+  QByteArray wkbArray( memorySize, Qt::Uninitialized );
+  unsigned char *wkb = reinterpret_cast< unsigned char * >( wkbArray.data() );
   OGR_G_ExportToWkb( geom, ( OGRwkbByteOrder ) QgsApplication::endian(), wkb );
 
   // Read original geometry type
@@ -280,7 +282,7 @@ QgsGeometry QgsOgrUtils::ogrGeometryToQgsGeometry( OGRGeometryH geom )
   }
 
   QgsGeometry g;
-  g.fromWkb( wkb, memorySize );
+  g.fromWkb( wkbArray );
   return g;
 }
 
@@ -22,27 +22,10 @@
 #include "qgis.h"
 #include "qgslogger.h"
 
-#include <SpatialIndex.h>
+#include <QVarLengthArray>
 
-#include <QLinkedListIterator>
-
-using namespace SpatialIndex;
-
-
-
-static SpatialIndex::Point point2point( const QgsPointXY &point )
-{
-  double plow[2] = { point.x(), point.y() };
-  return Point( plow, 2 );
-}
-
-
-static SpatialIndex::Region rect2region( const QgsRectangle &rect )
-{
-  double pLow[2] = { rect.xMinimum(), rect.yMinimum() };
-  double pHigh[2] = { rect.xMaximum(), rect.yMaximum() };
-  return SpatialIndex::Region( pLow, pHigh, 2 );
-}
+#include <algorithm>
+#include <limits>
 
 
 // Ahh.... another magic number. Taken from QgsVectorLayer::snapToGeometry() call to closestSegmentWithContext().
@@ -56,28 +39,245 @@ static const double POINT_LOC_EPSILON = 1e-12;
 
 /**
  * \ingroup core
- * Helper class for bulk loading of R-trees.
+ * Packed R-tree of the bounding boxes of the indexed geometries.
+ *
+ * The tree is bulk loaded in a single pass: the boxes are sorted along a Hilbert curve
+ * and grouped bottom-up in nodes of NODE_SIZE children. Leaves and nodes are stored in
+ * contiguous arrays (leaves first, then each level of nodes, the root being the last
+ * box), which is much more compact and faster to build than a dynamic R-tree.
+ *
+ * Features added after the tree has been built are kept in an unsorted list, and
+ * deleted features are disabled in place. The locator rebuilds the tree from its
+ * cached geometries once too many features have been added.
  * \note not available in Python bindings
 */
-class QgsPointLocator_Stream : public IDataStream
+class QgsPointLocator_Tree
 {
   public:
-    explicit QgsPointLocator_Stream( const QLinkedList<RTree::Data *> &dataList )
-      : mDataList( dataList )
-      , mIt( mDataList )
-    { }
+    explicit QgsPointLocator_Tree( const QHash<QgsFeatureId, QgsGeometry> &geometries );
+
+    //! Adds a feature to the tree
+    void insert( QgsFeatureId id, const QgsRectangle &rect );
+
+    //! Removes a feature, \a rect has to be the bounding box the feature was inserted with
+    void remove( QgsFeatureId id, const QgsRectangle &rect );
 
-    IData *getNext() override { return mIt.next(); }
-    bool hasNext() override { return mIt.hasNext(); }
+    //! Returns true if too many features were added since the tree was built
+    bool needsRebuild() const { return mExtraIds.size() > std::max( 256, mNumLeaves / 16 ); }
 
-    uint32_t size() override { Q_ASSERT( false && "not available" ); return 0; }
-    void rewind() override { Q_ASSERT( false && "not available" ); }
+    //! Calls visitor.visitData() with the id of each feature whose bounding box intersects \a rect
+    template<class Visitor>
+    void intersects( const QgsRectangle &rect, Visitor &visitor ) const
+    {
+      const Box query = toBox( rect );
+      visitPacked( query, [this, &visitor]( int pos ) { visitor.visitData( mIndices.at( pos ) ); } );
+      for ( int i = 0; i < mExtraIds.size(); ++i )
+      {
+        if ( boxesIntersect( mExtraBoxes.at( i ), query ) )
+          visitor.visitData( mExtraIds.at( i ) );
+      }
+    }
 
   private:
-    QLinkedList<RTree::Data *> mDataList;
-    QLinkedListIterator<RTree::Data *> mIt;
+    struct Box
+    {
+      double xMin;
+      double yMin;
+      double xMax;
+      double yMax;
+    };
+
+    static const int NODE_SIZE = 16;
+
+    static Box toBox( const QgsRectangle &rect )
+    {
+      Box box = { rect.xMinimum(), rect.yMinimum(), rect.xMaximum(), rect.yMaximum() };
+      return box;
+    }
+
+    static bool boxesIntersect( const Box &a, const Box &b )
+    {
+      return a.xMin <= b.xMax && a.xMax >= b.xMin && a.yMin <= b.yMax && a.yMax >= b.yMin;
+    }
+
+    //! Calls callback() with the position of each leaf whose box intersects \a query
+    template<class Callback>
+    void visitPacked( const Box &query, Callback callback ) const
+    {
+      if ( mBoxes.isEmpty() )
+        return;
+
+      const int root = mBoxes.size() - 1;
+      const int rootLevel = mLevelEnds.size() - 1;
+      if ( !boxesIntersect( mBoxes.at( root ), query ) )
+        return;
+      if ( rootLevel == 0 )
+      {
+        callback( root );
+        return;
+      }
+
+      // nodes to visit, as ( position, level ) pairs
+      QVarLengthArray< QPair< int, int >, 64 > stack;
+      stack.append( qMakePair( root, rootLevel ) );
+      while ( !stack.isEmpty() )
+      {
+        const QPair< int, int > node = stack.last();
+        stack.removeLast();
+
+        const int childLevel = node.second - 1;
+        const int firstChild = static_cast< int >( mIndices.at( node.first ) );
+        const int endChild = std::min( firstChild + NODE_SIZE, mLevelEnds.at( childLevel ) );
+        for ( int pos = firstChild; pos < endChild; ++pos )
+        {
+          if ( !boxesIntersect( mBoxes.at( pos ), query ) )
+            continue;
+
+          if ( childLevel == 0 )
+            callback( pos );
+          else
+            stack.append( qMakePair( pos, childLevel ) );
+        }
+      }
+    }
+
+    //! Boxes of the leaves then of the nodes of each level
+    QVector<Box> mBoxes;
+    //! Feature id for leaves, position of the first child for nodes
+    QVector<qint64> mIndices;
+    //! End position of each level in mBoxes, starting with the leaves
+    QVector<int> mLevelEnds;
+    int mNumLeaves = 0;
+
+    //! Features added after the tree was built
+    QVector<Box> mExtraBoxes;
+    QVector<QgsFeatureId> mExtraIds;
 };
 
+//! Returns the index of a cell of a 2^16 x 2^16 grid along the Hilbert curve
+static quint64 hilbertIndex( quint32 x, quint32 y )
+{
+  const quint32 n = 1 << 16;
+  quint64 d = 0;
+  for ( quint32 s = n / 2; s > 0; s /= 2 )
+  {
+    const quint32 rx = ( x & s ) > 0;
+    const quint32 ry = ( y & s ) > 0;
+    d += static_cast< quint64 >( s ) * s * ( ( 3 * rx ) ^ ry );
+    if ( ry == 0 )
+    {
+      if ( rx == 1 )
+      {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap( x, y );
+    }
+  }
+  return d;
+}
+
+QgsPointLocator_Tree::QgsPointLocator_Tree( const QHash<QgsFeatureId, QgsGeometry> &geometries )
+{
+  const int count = geometries.size();
+  QVector<Box> boxes;
+  QVector<QgsFeatureId> ids;
+  boxes.reserve( count );
+  ids.reserve( count );
+
+  Box extent = { std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                 -std::numeric_limits<double>::max(), -std::numeric_limits<double>::max()
+               };
+  for ( QHash<QgsFeatureId, QgsGeometry>::const_iterator it = geometries.constBegin(); it != geometries.constEnd(); ++it )
+  {
+    const Box box = toBox( it.value().boundingBox() );
+    extent.xMin = std::min( extent.xMin, box.xMin );
+    extent.yMin = std::min( extent.yMin, box.yMin );
+    extent.xMax = std::max( extent.xMax, box.xMax );
+    extent.yMax = std::max( extent.yMax, box.yMax );
+    boxes << box;
+    ids << it.key();
+  }
+
+  // sort the boxes along a Hilbert curve, so that nearby boxes end up in the same nodes
+  const double scaleX = extent.xMax > extent.xMin ? 0xffff / ( extent.xMax - extent.xMin ) : 0;
+  const double scaleY = extent.yMax > extent.yMin ? 0xffff / ( extent.yMax - extent.yMin ) : 0;
+  QVector< QPair< quint64, int > > order;
+  order.reserve( count );
+  for ( int i = 0; i < count; ++i )
+  {
+    const Box &box = boxes.at( i );
+    const quint32 x = static_cast< quint32 >( ( ( box.xMin + box.xMax ) / 2 - extent.xMin ) * scaleX );
+    const quint32 y = static_cast< quint32 >( ( ( box.yMin + box.yMax ) / 2 - extent.yMin ) * scaleY );
+    order << qMakePair( hilbertIndex( x, y ), i );
+  }
+  std::sort( order.begin(), order.end() );
+
+  // leaves
+  const int capacity = count + count / ( NODE_SIZE - 1 ) + 1;
+  mBoxes.reserve( capacity );
+  mIndices.reserve( capacity );
+  for ( const QPair< quint64, int > &item : qgsAsConst( order ) )
+  {
+    mBoxes << boxes.at( item.second );
+    mIndices << ids.at( item.second );
+  }
+  mNumLeaves = count;
+  mLevelEnds << count;
+
+  // nodes, level by level up to the root
+  int levelStart = 0;
+  int levelEnd = count;
+  while ( levelEnd - levelStart > 1 )
+  {
+    for ( int pos = levelStart; pos < levelEnd; pos += NODE_SIZE )
+    {
+      Box node = mBoxes.at( pos );
+      const int end = std::min( pos + NODE_SIZE, levelEnd );
+      for ( int child = pos + 1; child < end; ++child )
+      {
+        const Box &box = mBoxes.at( child );
+        node.xMin = std::min( node.xMin, box.xMin );
+        node.yMin = std::min( node.yMin, box.yMin );
+        node.xMax = std::max( node.xMax, box.xMax );
+        node.yMax = std::max( node.yMax, box.yMax );
+      }
+      mBoxes << node;
+      mIndices << pos;
+    }
+    levelStart = levelEnd;
+    levelEnd = mBoxes.size();
+    mLevelEnds << levelEnd;
+  }
+}
+
+void QgsPointLocator_Tree::insert( QgsFeatureId id, const QgsRectangle &rect )
+{
+  mExtraBoxes << toBox( rect );
+  mExtraIds << id;
+}
+
+void QgsPointLocator_Tree::remove( QgsFeatureId id, const QgsRectangle &rect )
+{
+  const int extraIndex = mExtraIds.indexOf( id );
+  if ( extraIndex >= 0 )
+  {
+    mExtraBoxes.remove( extraIndex );
+    mExtraIds.remove( extraIndex );
+    return;
+  }
+
+  // disable the leaf with a box which intersects nothing (all comparisons with NaN fail),
+  // the parent boxes just get larger than needed
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const Box empty = { nan, nan, nan, nan };
+  visitPacked( toBox( rect ), [this, id, &empty]( int pos )
+  {
+    if ( mIndices.at( pos ) == id )
+      mBoxes[pos] = empty;
+  } );
+}
+
 
 ////////////////////////////////////////////////////////////////////////////
 
@@ -87,7 +287,7 @@ class QgsPointLocator_Stream : public IDataStream
  * Helper class used when traversing the index looking for vertices - builds a list of matches.
  * \note not available in Python bindings
 */
-class QgsPointLocator_VisitorNearestVertex : public IVisitor
+class QgsPointLocator_VisitorNearestVertex
 {
   public:
     QgsPointLocator_VisitorNearestVertex( QgsPointLocator *pl, QgsPointLocator::Match &m, const QgsPointXY &srcPoint, QgsPointLocator::MatchFilter *filter = nullptr )
@@ -97,17 +297,13 @@ class QgsPointLocator_VisitorNearestVertex : public IVisitor
       , mFilter( filter )
     {}
 
-    void visitNode( const INode &n ) override { Q_UNUSED( n ); }
-    void visitData( std::vector<const IData *> &v ) override { Q_UNUSED( v ); }
-
-    void visitData( const IData &d ) override
+    void visitData( QgsFeatureId id )
     {
-      QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      const QgsGeometry geom = mLocator->mGeoms.value( id );
       int vertexIndex, beforeVertex, afterVertex;
       double sqrDist;
 
-      QgsPointXY pt = geom->closestVertex( mSrcPoint, vertexIndex, beforeVertex, afterVertex, sqrDist );
+      QgsPointXY pt = geom.closestVertex( mSrcPoint, vertexIndex, beforeVertex, afterVertex, sqrDist );
       if ( sqrDist < 0 )
         return;  // probably empty geometry
 
@@ -136,7 +332,7 @@ class QgsPointLocator_VisitorNearestVertex : public IVisitor
  * Helper class used when traversing the index looking for edges - builds a list of matches.
  * \note not available in Python bindings
 */
-class QgsPointLocator_VisitorNearestEdge : public IVisitor
+class QgsPointLocator_VisitorNearestEdge
 {
   public:
     QgsPointLocator_VisitorNearestEdge( QgsPointLocator *pl, QgsPointLocator::Match &m, const QgsPointXY &srcPoint, QgsPointLocator::MatchFilter *filter = nullptr )
@@ -146,22 +342,18 @@ class QgsPointLocator_VisitorNearestEdge : public IVisitor
       , mFilter( filter )
     {}
 
-    void visitNode( const INode &n ) override { Q_UNUSED( n ); }
-    void visitData( std::vector<const IData *> &v ) override { Q_UNUSED( v ); }
-
-    void visitData( const IData &d ) override
+    void visitData( QgsFeatureId id )
     {
-      QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      const QgsGeometry geom = mLocator->mGeoms.value( id );
       QgsPointXY pt;
       int afterVertex;
-      double sqrDist = geom->closestSegmentWithContext( mSrcPoint, pt, afterVertex, nullptr, POINT_LOC_EPSILON );
+      double sqrDist = geom.closestSegmentWithContext( mSrcPoint, pt, afterVertex, nullptr, POINT_LOC_EPSILON );
       if ( sqrDist < 0 )
         return;
 
       QgsPointXY edgePoints[2];
-      edgePoints[0] = geom->vertexAt( afterVertex - 1 );
-      edgePoints[1] = geom->vertexAt( afterVertex );
+      edgePoints[0] = geom.vertexAt( afterVertex - 1 );
+      edgePoints[1] = geom.vertexAt( afterVertex );
       QgsPointLocator::Match m( QgsPointLocator::Edge, mLocator->mLayer, id, std::sqrt( sqrDist ), pt, afterVertex - 1, edgePoints );
       // in range queries the filter may reject some matches
       if ( mFilter && !mFilter->acceptMatch( m ) )
@@ -187,7 +379,7 @@ class QgsPointLocator_VisitorNearestEdge : public IVisitor
  * Helper class used when traversing the index with areas - builds a list of matches.
  * \note not available in Python bindings
 */
-class QgsPointLocator_VisitorArea : public IVisitor
+class QgsPointLocator_VisitorArea
 {
   public:
     //! constructor
@@ -197,14 +389,10 @@ class QgsPointLocator_VisitorArea : public IVisitor
       , mGeomPt( QgsGeometry::fromPoint( origPt ) )
     {}
 
-    void visitNode( const INode &n ) override { Q_UNUSED( n ); }
-    void visitData( std::vector<const IData *> &v ) override { Q_UNUSED( v ); }
-
-    void visitData( const IData &d ) override
+    void visitData( QgsFeatureId id )
     {
-      QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *g = mLocator->mGeoms.value( id );
-      if ( g->intersects( mGeomPt ) )
+      const QgsGeometry g = mLocator->mGeoms.value( id );
+      if ( g.intersects( mGeomPt ) )
         mList << QgsPointLocator::Match( QgsPointLocator::Area, mLocator->mLayer, id, 0, QgsPointXY() );
     }
   private:
@@ -325,13 +513,13 @@ struct _CohenSutherland
 };
 
 
-static QgsPointLocator::MatchList _geometrySegmentsInRect( QgsGeometry *geom, const QgsRectangle &rect, QgsVectorLayer *vl, QgsFeatureId fid )
+static QgsPointLocator::MatchList _geometrySegmentsInRect( const QgsGeometry &geom, const QgsRectangle &rect, QgsVectorLayer *vl, QgsFeatureId fid )
 {
   // this code is stupidly based on QgsGeometry::closestSegmentWithContext
   // we need iterator for segments...
 
   QgsPointLocator::MatchList lst;
-  QByteArray wkb( geom->exportToWkb() );
+  QByteArray wkb( geom.exportToWkb() );
   if ( wkb.isEmpty() )
     return lst;
 
@@ -340,7 +528,7 @@ static QgsPointLocator::MatchList _geometrySegmentsInRect( QgsGeometry *geom, co
   QgsConstWkbPtr wkbPtr( wkb );
   wkbPtr.readHeader();
 
-  QgsWkbTypes::Type wkbType = geom->wkbType();
+  QgsWkbTypes::Type wkbType = geom.wkbType();
 
   bool hasZValue = false;
   switch ( wkbType )
@@ -529,7 +717,7 @@ static QgsPointLocator::MatchList _geometrySegmentsInRect( QgsGeometry *geom, co
  * Helper class used when traversing the index looking for edges - builds a list of matches.
  * \note not available in Python bindings
 */
-class QgsPointLocator_VisitorEdgesInRect : public IVisitor
+class QgsPointLocator_VisitorEdgesInRect
 {
   public:
     QgsPointLocator_VisitorEdgesInRect( QgsPointLocator *pl, QgsPointLocator::MatchList &lst, const QgsRectangle &srcRect, QgsPointLocator::MatchFilter *filter = nullptr )
@@ -539,13 +727,9 @@ class QgsPointLocator_VisitorEdgesInRect : public IVisitor
       , mFilter( filter )
     {}
 
-    void visitNode( const INode &n ) override { Q_UNUSED( n ); }
-    void visitData( std::vector<const IData *> &v ) override { Q_UNUSED( v ); }
-
-    void visitData( const IData &d ) override
+    void visitData( QgsFeatureId id )
     {
-      QgsFeatureId id = d.getIdentifier();
-      QgsGeometry *geom = mLocator->mGeoms.value( id );
+      const QgsGeometry geom = mLocator->mGeoms.value( id );
 
       Q_FOREACH ( const QgsPointLocator::Match &m, _geometrySegmentsInRect( geom, mSrcRect, mLocator->mLayer, id ) )
       {
@@ -566,57 +750,6 @@ class QgsPointLocator_VisitorEdgesInRect : public IVisitor
 
 
 
-////////////////////////////////////////////////////////////////////////////
-#include <QStack>
-
-/**
- * \ingroup core
- * Helper class to dump the R-index nodes and their content
- * \note not available in Python bindings
-*/
-class QgsPointLocator_DumpTree : public SpatialIndex::IQueryStrategy
-{
-  private:
-    QStack<id_type> ids;
-
-  public:
-
-    void getNextEntry( const IEntry &entry, id_type &nextEntry, bool &hasNext ) override
-    {
-      const INode *n = dynamic_cast<const INode *>( &entry );
-      if ( !n )
-        return;
-
-      QgsDebugMsg( QString( "NODE: %1" ).arg( n->getIdentifier() ) );
-      if ( n->getLevel() > 0 )
-      {
-        // inner nodes
-        for ( uint32_t cChild = 0; cChild < n->getChildrenCount(); cChild++ )
-        {
-          QgsDebugMsg( QString( "- CH: %1" ).arg( n->getChildIdentifier( cChild ) ) );
-          ids.push( n->getChildIdentifier( cChild ) );
-        }
-      }
-      else
-      {
-        // leaves
-        for ( uint32_t cChild = 0; cChild < n->getChildrenCount(); cChild++ )
-        {
-          QgsDebugMsg( QString( "- L: %1" ).arg( n->getChildIdentifier( cChild ) ) );
-        }
-      }
-
-      if ( ! ids.empty() )
-      {
-        nextEntry = ids.back();
-        ids.pop();
-        hasNext = true;
-      }
-      else
-        hasNext = false;
-    }
-};
-
 ////////////////////////////////////////////////////////////////////////////
 
 
@@ -631,8 +764,6 @@ QgsPointLocator::QgsPointLocator( QgsVectorLayer *layer, const QgsCoordinateRefe
 
   setExtent( extent );
 
-  mStorage = StorageManager::createNewMemoryStorageManager();
-
   connect( mLayer, &QgsVectorLayer::featureAdded, this, &QgsPointLocator::onFeatureAdded );
   connect( mLayer, &QgsVectorLayer::featureDeleted, this, &QgsPointLocator::onFeatureDeleted );
   connect( mLayer, &QgsVectorLayer::geometryChanged, this, &QgsPointLocator::onGeometryChanged );
@@ -643,7 +774,6 @@ QgsPointLocator::QgsPointLocator( QgsVectorLayer *layer, const QgsCoordinateRefe
 QgsPointLocator::~QgsPointLocator()
 {
   destroyIndex();
-  delete mStorage;
   delete mExtent;
 }
 
@@ -671,7 +801,7 @@ bool QgsPointLocator::init( int maxFeaturesToIndex )
 
 bool QgsPointLocator::hasIndex() const
 {
-  return mRTree || mIsEmptyLayer;
+  return mTree || mIsEmptyLayer;
 }
 
 
@@ -679,7 +809,6 @@ bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
 {
   destroyIndex();
 
-  QLinkedList<RTree::Data *> dataList;
   QgsFeature f;
   QgsWkbTypes::GeometryType geomType = mLayer->geometryType();
   if ( geomType == QgsWkbTypes::NullGeometry )
@@ -729,58 +858,41 @@ bool QgsPointLocator::rebuildIndex( int maxFeaturesToIndex )
       }
     }
 
-    SpatialIndex::Region r( rect2region( f.geometry().boundingBox() ) );
-    dataList << new RTree::Data( 0, nullptr, r, f.id() );
-
-    if ( mGeoms.contains( f.id() ) )
-      delete mGeoms.take( f.id() );
-    mGeoms[f.id()] = new QgsGeometry( f.geometry() );
+    // the geometry is shared with the feature, it does not get parsed before it is queried
+    mGeoms.insert( f.id(), f.geometry() );
     ++indexedCount;
 
     if ( maxFeaturesToIndex != -1 && indexedCount > maxFeaturesToIndex )
     {
-      qDeleteAll( dataList );
       destroyIndex();
       return false;
     }
   }
 
-  // R-Tree parameters
-  double fillFactor = 0.7;
-  unsigned long indexCapacity = 10;
-  unsigned long leafCapacity = 10;
-  unsigned long dimension = 2;
-  RTree::RTreeVariant variant = RTree::RV_RSTAR;
-  SpatialIndex::id_type indexId;
-
-  if ( dataList.isEmpty() )
+  if ( mGeoms.isEmpty() )
   {
     mIsEmptyLayer = true;
     return true; // no features
   }
 
-  QgsPointLocator_Stream stream( dataList );
-  mRTree = RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, *mStorage, fillFactor, indexCapacity,
-           leafCapacity, dimension, variant, indexId );
+  mTree = new QgsPointLocator_Tree( mGeoms );
   return true;
 }
 
 
 void QgsPointLocator::destroyIndex()
 {
-  delete mRTree;
-  mRTree = nullptr;
+  delete mTree;
+  mTree = nullptr;
 
   mIsEmptyLayer = false;
 
-  qDeleteAll( mGeoms );
-
   mGeoms.clear();
 }
 
 void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
 {
-  if ( !mRTree )
+  if ( !mTree )
   {
     if ( mIsEmptyLayer )
       rebuildIndex(); // first feature - let's built the index
@@ -813,25 +925,33 @@ void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
     QgsRectangle bbox = f.geometry().boundingBox();
     if ( !bbox.isNull() )
     {
-      SpatialIndex::Region r( rect2region( bbox ) );
-      mRTree->insertData( 0, nullptr, r, f.id() );
+      if ( mGeoms.contains( fid ) )
+        mTree->remove( fid, mGeoms.value( fid ).boundingBox() );
+      mGeoms.insert( fid, f.geometry() );
 
-      if ( mGeoms.contains( f.id() ) )
-        delete mGeoms.take( f.id() );
-      mGeoms[fid] = new QgsGeometry( f.geometry() );
+      if ( mTree->needsRebuild() )
+      {
+        // pack the added features in the tree, without fetching the features again
+        delete mTree;
+        mTree = new QgsPointLocator_Tree( mGeoms );
+      }
+      else
+      {
+        mTree->insert( fid, bbox );
+      }
     }
   }
 }
 
 void QgsPointLocator::onFeatureDeleted( QgsFeatureId fid )
 {
-  if ( !mRTree )
+  if ( !mTree )
     return; // nothing to do if we are not initialized yet
 
   if ( mGeoms.contains( fid ) )
   {
-    mRTree->deleteData( rect2region( mGeoms[fid]->boundingBox() ), fid );
-    delete mGeoms.take( fid );
+    mTree->remove( fid, mGeoms.value( fid ).boundingBox() );
+    mGeoms.remove( fid );
   }
 }
 
@@ -845,17 +965,17 @@ void QgsPointLocator::onGeometryChanged( QgsFeatureId fid, const QgsGeometry &ge
 
 QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPointXY &point, double tolerance, MatchFilter *filter )
 {
-  if ( !mRTree )
+  if ( !mTree )
   {
     init();
-    if ( !mRTree ) // still invalid?
+    if ( !mTree ) // still invalid?
       return Match();
   }
 
   Match m;
   QgsPointLocator_VisitorNearestVertex visitor( this, m, point, filter );
   QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
-  mRTree->intersectsWithQuery( rect2region( rect ), visitor );
+  mTree->intersects( rect, visitor );
   if ( m.isValid() && m.distance() > tolerance )
     return Match(); // make sure that only match strictly within the tolerance is returned
   return m;
@@ -863,10 +983,10 @@ QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPointXY &point,
 
 QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPointXY &point, double tolerance, MatchFilter *filter )
 {
-  if ( !mRTree )
+  if ( !mTree )
   {
     init();
-    if ( !mRTree ) // still invalid?
+    if ( !mTree ) // still invalid?
       return Match();
   }
 
@@ -877,7 +997,7 @@ QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPointXY &point, do
   Match m;
   QgsPointLocator_VisitorNearestEdge visitor( this, m, point, filter );
   QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
-  mRTree->intersectsWithQuery( rect2region( rect ), visitor );
+  mTree->intersects( rect, visitor );
   if ( m.isValid() && m.distance() > tolerance )
     return Match(); // make sure that only match strictly within the tolerance is returned
   return m;
@@ -885,10 +1005,10 @@ QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPointXY &point, do
 
 QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsRectangle &rect, QgsPointLocator::MatchFilter *filter )
 {
-  if ( !mRTree )
+  if ( !mTree )
   {
     init();
-    if ( !mRTree ) // still invalid?
+    if ( !mTree ) // still invalid?
       return MatchList();
   }
 
@@ -898,7 +1018,7 @@ QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsRectangle &rec
 
   MatchList lst;
   QgsPointLocator_VisitorEdgesInRect visitor( this, lst, rect, filter );
-  mRTree->intersectsWithQuery( rect2region( rect ), visitor );
+  mTree->intersects( rect, visitor );
 
   return lst;
 }
@@ -912,10 +1032,10 @@ QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsPointXY &point
 
 QgsPointLocator::MatchList QgsPointLocator::pointInPolygon( const QgsPointXY &point )
 {
-  if ( !mRTree )
+  if ( !mTree )
   {
     init();
-    if ( !mRTree ) // still invalid?
+    if ( !mTree ) // still invalid?
       return MatchList();
   }
 
@@ -925,6 +1045,6 @@ QgsPointLocator::MatchList QgsPointLocator::pointInPolygon( const QgsPointXY &po
 
   MatchList lst;
   QgsPointLocator_VisitorArea visitor( this, point, lst );
-  mRTree->intersectsWithQuery( point2point( point ), visitor );
+  mTree->intersects( QgsRectangle( point.x(), point.y(), point.x(), point.y() ), visitor );
   return lst;
 }
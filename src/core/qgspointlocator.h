@@ -29,12 +29,7 @@ class QgsPointLocator_VisitorNearestVertex;
 class QgsPointLocator_VisitorNearestEdge;
 class QgsPointLocator_VisitorArea;
 class QgsPointLocator_VisitorEdgesInRect;
-
-namespace SpatialIndex SIP_SKIP
-{
-  class IStorageManager;
-  class ISpatialIndex;
-}
+class QgsPointLocator_Tree;
 
 /**
  * \ingroup core
@@ -258,16 +253,15 @@ class CORE_EXPORT QgsPointLocator : public QObject
     void onGeometryChanged( QgsFeatureId fid, const QgsGeometry &geom );
 
   private:
-    //! Storage manager
-    SpatialIndex::IStorageManager *mStorage = nullptr;
+    //! Indexed geometries, implicitly shared with the features they were read from
+    QHash<QgsFeatureId, QgsGeometry> mGeoms;
 
-    QHash<QgsFeatureId, QgsGeometry *> mGeoms;
-    SpatialIndex::ISpatialIndex *mRTree = nullptr;
+    //! Packed R-tree containing spatial index
+    QgsPointLocator_Tree *mTree = nullptr;
 
-    //! flag whether the layer is currently empty (i.e. mRTree is null but it is not necessary to rebuild it)
+    //! flag whether the layer is currently empty (i.e. mTree is null but it is not necessary to rebuild it)
     bool mIsEmptyLayer;
 
-    //! R-tree containing spatial index
     QgsCoordinateTransform mTransform;
     QgsVectorLayer *mLayer = nullptr;
     QgsRectangle *mExtent = nullptr;
@@ -50,8 +50,12 @@
 #include "qgsmaplayerstore.h"
 #include "qgsziputils.h"
 #include "qgsauxiliarystorage.h"
+#include "qgsapplication.h"
+#include "qgsproviderregistry.h"
+#include "qgsruntimeprofiler.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
 #include <QFileInfo>
 #include <QDomNode>
 #include <QObject>
@@ -479,6 +483,7 @@ void QgsProject::clear()
   mEvaluateDefaultValues = false;
   mDirty = false;
   mTrustLayerMetadata = false;
+  mLazyDataProviders = false;
   mCustomVariables.clear();
 
   mEmbeddedLayers.clear();
@@ -678,6 +683,14 @@ bool QgsProject::_getMapLayers( const QDomDocument &doc, QList<QDomNode> &broken
 
   QVector<QDomNode> sortedLayerNodes = depSorter.sortedLayerNodes();
 
+  // open the data sources concurrently, the layers then pick up their
+  // provider while being read one after another in dependency order
+  QgsProviderRegistry::PreloadedProviders preloadedProviders;
+  const QHash<QString, double> providerTimes = preloadLayerProviders( sortedLayerNodes, preloadedProviders );
+
+  QgsRuntimeProfiler *profiler = QgsApplication::profiler();
+  profiler->beginGroup( QStringLiteral( "projectload" ) );
+
   int i = 0;
   Q_FOREACH ( const QDomNode &node, sortedLayerNodes )
   {
@@ -694,20 +707,98 @@ bool QgsProject::_getMapLayers( const QDomDocument &doc, QList<QDomNode> &broken
     }
     else
     {
+      QElapsedTimer layerTimer;
+      layerTimer.start();
+
       QgsReadWriteContext context;
       context.setPathResolver( pathResolver() );
-      if ( !addLayer( element, brokenNodes, context ) )
+
+      // only the layers of this project get the preloaded providers
+      QgsProviderRegistry::instance()->setPreloadedProviders( &preloadedProviders );
+      bool added = addLayer( element, brokenNodes, context );
+      QgsProviderRegistry::instance()->setPreloadedProviders( nullptr );
+      if ( !added )
       {
         returnStatus = false;
       }
+
+      const QString layerId = node.namedItem( QStringLiteral( "id" ) ).toElement().text();
+      profiler->record( tr( "Loading layer %1" ).arg( name ), providerTimes.value( layerId ) + layerTimer.elapsed() / 1000.0 );
     }
     emit layerLoaded( i + 1, nl.count() );
     i++;
   }
 
+  profiler->endGroup();
+
+  // providers of layers which failed to load
+  qDeleteAll( preloadedProviders );
+
   return returnStatus;
 }
 
+QHash<QString, double> QgsProject::preloadLayerProviders( const QVector<QDomNode> &layerNodes, QMultiHash< QPair< QString, QString >, QgsDataProvider * > &providers ) const
+{
+  QHash<QString, double> times;
+
+  QgsSettings settings;
+  if ( !settings.value( QStringLiteral( "qgis/parallelLayerLoading" ), true ).toBool() )
+    return times;
+
+  // providers known to be safe to create outside of the main thread. GDAL
+  // providers update the skipped drivers of QgsApplication on creation when
+  // drivers are skipped, which must not happen concurrently. Postgres
+  // providers are not preloaded: connections opened outside of the main
+  // thread are not shared, so each layer would get its own connection
+  QStringList parallelProviders;
+  parallelProviders << QStringLiteral( "ogr" );
+  if ( settings.value( QStringLiteral( "gdal/skipList" ), QString() ).toString().isEmpty() )
+    parallelProviders << QStringLiteral( "gdal" );
+
+  QgsReadWriteContext context;
+  context.setPathResolver( pathResolver() );
+
+  QList< QPair< QString, QString > > sources;
+  QStringList layerIds;
+  Q_FOREACH ( const QDomNode &node, layerNodes )
+  {
+    const QDomElement element = node.toElement();
+    if ( element.attribute( QStringLiteral( "embedded" ) ) == QLatin1String( "1" ) )
+      continue;
+
+    const QString type = element.attribute( QStringLiteral( "type" ) );
+    const QString provider = node.namedItem( QStringLiteral( "provider" ) ).toElement().text();
+    if ( ( type != QLatin1String( "vector" ) && type != QLatin1String( "raster" ) ) || !parallelProviders.contains( provider ) )
+      continue;
+
+    // lazy providers of vector layers are created on first use
+    if ( type == QLatin1String( "vector" ) && mLazyDataProviders && !element.namedItem( QStringLiteral( "providerMetadata" ) ).isNull() )
+      continue;
+
+    // layers requiring authentication may have to ask for the master password
+    QString dataSource = node.namedItem( QStringLiteral( "datasource" ) ).toElement().text();
+    if ( dataSource.contains( QLatin1String( "authcfg=" ) ) )
+      continue;
+
+    // the data source has to match the one used by the layer to create its provider
+    dataSource = QgsMapLayer::decodedSource( dataSource, provider, context );
+
+    sources << qMakePair( provider, dataSource );
+    layerIds << node.namedItem( QStringLiteral( "id" ) ).toElement().text();
+  }
+
+  // nothing to gain from a single data source
+  if ( sources.size() < 2 )
+    return times;
+
+  const QList<double> providerTimes = QgsProviderRegistry::instance()->preloadProviders( sources, providers );
+  for ( int i = 0; i < layerIds.size(); ++i )
+  {
+    times.insert( layerIds.at( i ), providerTimes.at( i ) );
+  }
+  return times;
+}
+
 bool QgsProject::addLayer( const QDomElement &layerElem, QList<QDomNode> &brokenNodes, const QgsReadWriteContext &context )
 {
   QString type = layerElem.attribute( QStringLiteral( "type" ) );
@@ -722,6 +813,7 @@ bool QgsProject::addLayer( const QDomElement &layerElem, QList<QDomNode> &broken
     if ( QgsVectorLayer *vl = qobject_cast<QgsVectorLayer *>( mapLayer ) )
     {
       vl->setReadExtentFromXml( mTrustLayerMetadata );
+      vl->setReadProviderMetadataFromXml( mLazyDataProviders );
     }
   }
   else if ( type == QLatin1String( "raster" ) )
@@ -764,33 +856,33 @@ bool QgsProject::addLayer( const QDomElement &layerElem, QList<QDomNode> &broken
   }
 }
 
-bool QgsProject::read( const QString &filename )
+bool QgsProject::read( const QString &filename, QgsProject::ReadFlags flags )
 {
   mFile.setFileName( filename );
 
-  return read();
+  return read( flags );
 }
 
-bool QgsProject::read()
+bool QgsProject::read( QgsProject::ReadFlags flags )
 {
   QString filename = mFile.fileName();
   bool rc;
 
   if ( QgsZipUtils::isZipFile( mFile.fileName() ) )
   {
-    rc = unzip( mFile.fileName() );
+    rc = unzip( mFile.fileName(), flags );
   }
   else
   {
     mAuxiliaryStorage.reset( new QgsAuxiliaryStorage( *this ) );
-    rc = readProjectFile( mFile.fileName() );
+    rc = readProjectFile( mFile.fileName(), flags );
   }
 
   mFile.setFileName( filename );
   return rc;
 }
 
-bool QgsProject::readProjectFile( const QString &filename )
+bool QgsProject::readProjectFile( const QString &filename, QgsProject::ReadFlags flags )
 {
   QFile projectFile( filename );
   clearError();
@@ -912,6 +1004,11 @@ bool QgsProject::readProjectFile( const QString &filename )
     if ( trustElement.attribute( QStringLiteral( "active" ), QStringLiteral( "0" ) ).toInt() == 1 )
       mTrustLayerMetadata = true;
   }
+  if ( flags & QgsProject::FlagTrustLayerMetadata )
+    mTrustLayerMetadata = true;
+
+  // the transaction groups need the actual providers of the layers
+  mLazyDataProviders = ( flags & QgsProject::FlagLazyDataProviders ) && !mAutoTransaction;
 
   // read the layer tree from project file
 
@@ -2134,7 +2231,7 @@ QList<QgsMapLayer *> QgsProject::mapLayersByName( const QString &layerName ) con
   return mLayerStore->mapLayersByName( layerName );
 }
 
-bool QgsProject::unzip( const QString &filename )
+bool QgsProject::unzip( const QString &filename, QgsProject::ReadFlags flags )
 {
   clearError();
   std::unique_ptr<QgsProjectArchive> archive( new QgsProjectArchive() );
@@ -2166,7 +2263,7 @@ bool QgsProject::unzip( const QString &filename )
   }
 
   // read the project file
-  if ( ! readProjectFile( archive->projectFile() ) )
+  if ( ! readProjectFile( archive->projectFile(), flags ) )
   {
     setError( tr( "Cannot read unzipped qgs project file" ) );
     return false;
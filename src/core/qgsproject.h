@@ -31,6 +31,7 @@
 #include <QPair>
 #include <QFileInfo>
 #include <QStringList>
+#include <QVector>
 
 #include "qgsunittypes.h"
 #include "qgssnappingconfig.h"
@@ -62,6 +63,7 @@ class QgsLayoutManager;
 class QgsLayerTree;
 class QgsLabelingEngineSettings;
 class QgsAuxiliaryStorage;
+class QgsDataProvider;
 
 /**
  * \ingroup core
@@ -92,6 +94,18 @@ class CORE_EXPORT QgsProject : public QObject, public QgsExpressionContextGenera
     Q_PROPERTY( QList<QgsVectorLayer *> avoidIntersectionsLayers READ avoidIntersectionsLayers WRITE setAvoidIntersectionsLayers NOTIFY avoidIntersectionsLayersChanged )
 
   public:
+
+    /**
+     * Flags which control how a project is read.
+     * \since QGIS 3.0
+     */
+    enum ReadFlag
+    {
+      FlagTrustLayerMetadata = 1 << 0, //!< Trust the layer metadata (see setTrustLayerMetadata()), whatever the option stored in the project
+      FlagLazyDataProviders = 1 << 1, //!< Create the data providers of vector layers when their data is first accessed, from the metadata stored in the project (see QgsVectorLayer::setReadProviderMetadataFromXml())
+    };
+    Q_DECLARE_FLAGS( ReadFlags, ReadFlag )
+
     //! Returns the QgsProject singleton instance
     static QgsProject *instance();
 
@@ -187,15 +201,17 @@ class CORE_EXPORT QgsProject : public QObject, public QgsExpressionContextGenera
     /**
      * Reads given project file from the given file.
      * \param filename name of project file to read
+     * \param flags optional flags which control the read behavior of projects (since QGIS 3.0)
      * \returns true if project file has been read successfully
      */
-    bool read( const QString &filename );
+    bool read( const QString &filename, QgsProject::ReadFlags flags = QgsProject::ReadFlags() );
 
     /**
      * Reads the project from its currently associated file (see fileName() ).
+     * \param flags optional flags which control the read behavior of projects (since QGIS 3.0)
      * \returns true if project file has been read successfully
      */
-    bool read();
+    bool read( QgsProject::ReadFlags flags = QgsProject::ReadFlags() );
 
     /**
      * Reads the layer described in the associated DOM node.
@@ -1089,6 +1105,13 @@ class CORE_EXPORT QgsProject : public QObject, public QgsExpressionContextGenera
     */
     bool _getMapLayers( const QDomDocument &doc, QList<QDomNode> &brokenNodes );
 
+    /**
+     * Creates concurrently the data providers of the given map layer nodes in
+     * \a providers. They are then picked up by the layers when they are read.
+     * \returns the time in seconds spent creating the provider of each layer, by layer id
+     */
+    QHash<QString, double> preloadLayerProviders( const QVector<QDomNode> &layerNodes, QMultiHash< QPair< QString, QString >, QgsDataProvider * > &providers ) const;
+
     /**
      * Set error message from read/write operation
      * \note not available in Python bindings
@@ -1114,13 +1137,13 @@ class CORE_EXPORT QgsProject : public QObject, public QgsExpressionContextGenera
     void loadEmbeddedNodes( QgsLayerTreeGroup *group ) SIP_SKIP;
 
     //! Read .qgs file
-    bool readProjectFile( const QString &filename );
+    bool readProjectFile( const QString &filename, QgsProject::ReadFlags flags = QgsProject::ReadFlags() );
 
     //! Write .qgs file
     bool writeProjectFile( const QString &filename );
 
     //! Unzip .qgz file then read embedded .qgs file
-    bool unzip( const QString &filename );
+    bool unzip( const QString &filename, QgsProject::ReadFlags flags = QgsProject::ReadFlags() );
 
     //! Zip project
     bool zip( const QString &filename );
@@ -1173,8 +1196,11 @@ class CORE_EXPORT QgsProject : public QObject, public QgsExpressionContextGenera
     QgsCoordinateReferenceSystem mCrs;
     bool mDirty = false;                 // project has been modified since it has been read or saved
     bool mTrustLayerMetadata = false;
+    bool mLazyDataProviders = false;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS( QgsProject::ReadFlags )
+
 /**
  * Return the version string found in the given DOM document
    \returns the version string or an empty string if none found
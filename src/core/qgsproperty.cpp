@@ -366,7 +366,7 @@ bool QgsProperty::prepare( const QgsExpressionContext &context ) const
     case ExpressionBasedProperty:
     {
       d.detach();
-      if ( !d->expression.prepare( &context ) )
+      if ( !d->expression.compile( &context ) )
       {
         d->expressionReferencedCols.clear();
         d->expressionPrepared = false;
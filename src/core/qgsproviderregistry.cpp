@@ -20,7 +20,11 @@
 
 #include <QString>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QLibrary>
+#include <QSet>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include "qgis.h"
 #include "qgsdataprovider.h"
@@ -231,6 +235,8 @@ void QgsProviderRegistry::clean()
 {
   QgsProject::instance()->removeAllMapLayers();
 
+  clearPreloadedProviders();
+
   Providers::const_iterator it = mProviders.begin();
 
   while ( it != mProviders.end() )
@@ -347,6 +353,9 @@ QDir QgsProviderRegistry::libraryDirectory() const
 // typedef for the QgsDataProvider class factory
 typedef QgsDataProvider *classFactoryFunction_t( const QString * );
 
+// providers handed over to createProvider() in the current thread, see setPreloadedProviders()
+static thread_local QgsProviderRegistry::PreloadedProviders *sPreloadedProviders = nullptr;
+
 
 /* Copied from QgsVectorLayer::setDataProvider
  *  TODO: Make it work in the generic environment
@@ -360,6 +369,17 @@ QgsDataProvider *QgsProviderRegistry::createProvider( QString const &providerKey
   // XXX should I check for and possibly delete any pre-existing providers?
   // XXX How often will that scenario occur?
 
+  if ( sPreloadedProviders )
+  {
+    auto it = sPreloadedProviders->find( qMakePair( providerKey, dataSource ) );
+    if ( it != sPreloadedProviders->end() )
+    {
+      QgsDataProvider *dataProvider = it.value();
+      sPreloadedProviders->erase( it );
+      return dataProvider;
+    }
+  }
+
   const QgsProviderMetadata *metadata = providerMetadata( providerKey );
   if ( !metadata )
   {
@@ -421,6 +441,73 @@ QgsDataProvider *QgsProviderRegistry::createProvider( QString const &providerKey
   return dataProvider;
 } // QgsProviderRegistry::setDataProvider
 
+QList<double> QgsProviderRegistry::preloadProviders( const QList< QPair< QString, QString > > &sources, PreloadedProviders &preloadedProviders )
+{
+  struct PreloadedProvider
+  {
+    QString providerKey;
+    QString dataSource;
+    QgsDataProvider *provider;
+    double time;
+  };
+
+  QThread *targetThread = QThread::currentThread();
+  auto createPreloadedProvider = [this, targetThread]( PreloadedProvider & preloaded )
+  {
+    QElapsedTimer timer;
+    timer.start();
+    preloaded.provider = createProvider( preloaded.providerKey, preloaded.dataSource );
+    // providers have to live in the thread of the layers they are handed over to
+    if ( preloaded.provider )
+      preloaded.provider->moveToThread( targetThread );
+    preloaded.time = timer.elapsed() / 1000.0;
+  };
+
+  // the first provider of each kind loads the provider library and registers
+  // drivers, which is not safe to do concurrently
+  QSet<QString> initializedKeys;
+  QList< PreloadedProvider > firstProviders;
+  QList< PreloadedProvider > providers;
+  for ( int i = 0; i < sources.size(); ++i )
+  {
+    PreloadedProvider preloaded = { sources.at( i ).first, sources.at( i ).second, nullptr, 0 };
+    if ( !initializedKeys.contains( preloaded.providerKey ) )
+    {
+      initializedKeys << preloaded.providerKey;
+      createPreloadedProvider( preloaded );
+      firstProviders << preloaded;
+    }
+    else
+    {
+      providers << preloaded;
+    }
+  }
+
+  QtConcurrent::blockingMap( providers, createPreloadedProvider );
+  providers = firstProviders + providers;
+
+  QHash< QPair< QString, QString >, double > times;
+  Q_FOREACH ( const PreloadedProvider &preloaded, providers )
+  {
+    const QPair< QString, QString > source = qMakePair( preloaded.providerKey, preloaded.dataSource );
+    times.insert( source, preloaded.time );
+    if ( preloaded.provider )
+      preloadedProviders.insert( source, preloaded.provider );
+  }
+
+  QList<double> result;
+  for ( int i = 0; i < sources.size(); ++i )
+  {
+    result << times.value( sources.at( i ) );
+  }
+  return result;
+}
+
+void QgsProviderRegistry::setPreloadedProviders( PreloadedProviders *providers )
+{
+  sPreloadedProviders = providers;
+}
+
 int QgsProviderRegistry::providerCapabilities( const QString &providerKey ) const
 {
   std::unique_ptr< QLibrary > library( createProviderLibrary( providerKey ) );
@@ -22,7 +22,9 @@
 #include <map>
 
 #include <QDir>
+#include <QHash>
 #include <QLibrary>
+#include <QPair>
 #include <QString>
 
 #include "qgis_core.h"
@@ -98,6 +100,40 @@ class CORE_EXPORT QgsProviderRegistry
     QgsDataProvider *createProvider( const QString &providerKey,
                                      const QString &dataSource ) SIP_FACTORY;
 
+#ifndef SIP_RUN
+    //! Providers created by preloadProviders(), by provider key and data source
+    typedef QMultiHash< QPair< QString, QString >, QgsDataProvider * > PreloadedProviders;
+#endif
+
+    /**
+     * Creates providers for a list of (provider key, data source) pairs on the
+     * global thread pool, so that data sources are opened concurrently. The
+     * created providers are stored in \a providers, which is owned by the caller.
+     *
+     * Only providers which can safely be created outside of the main thread,
+     * and which do not share connections between the providers of the main
+     * thread, should be preloaded. The first provider of each provider key is
+     * created in the calling thread so that provider libraries and drivers are
+     * initialized before going concurrent.
+     *
+     * \returns the time in seconds spent creating each provider, in the order of \a sources
+     * \see setPreloadedProviders()
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    QList<double> preloadProviders( const QList< QPair< QString, QString > > &sources, PreloadedProviders &providers ) SIP_SKIP;
+
+    /**
+     * Sets the \a providers which are handed over to the calls to createProvider()
+     * made from the calling thread with the same provider key and data source.
+     * Calls from other threads never get these providers. Pass a null pointer
+     * once the providers are not to be handed over anymore.
+     * \see preloadProviders()
+     * \note not available in Python bindings
+     * \since QGIS 3.0
+     */
+    void setPreloadedProviders( PreloadedProviders *providers ) SIP_SKIP;
+
     /**
      * Return the provider capabilities
         \param providerKey identificator of the provider
@@ -33,11 +33,15 @@ void QgsRuntimeProfiler::start( const QString &name )
 
 void QgsRuntimeProfiler::end()
 {
-  QString name = mCurrentName;
-  name.prepend( mGroupPrefix );
-  double timing = mProfileTime.elapsed() / 1000.0;
-  mProfileTimes.append( QPair<QString, double>( name, timing ) );
-  QgsDebugMsg( QStringLiteral( "PROFILE: %1 - %2" ).arg( name ).arg( timing ) );
+  record( mCurrentName, mProfileTime.elapsed() / 1000.0 );
+}
+
+void QgsRuntimeProfiler::record( const QString &name, double time )
+{
+  QString fullName = name;
+  fullName.prepend( mGroupPrefix );
+  mProfileTimes.append( QPair<QString, double>( fullName, time ) );
+  QgsDebugMsg( QStringLiteral( "PROFILE: %1 - %2" ).arg( fullName ).arg( time ) );
 }
 
 void QgsRuntimeProfiler::clear()
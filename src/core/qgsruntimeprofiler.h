@@ -45,6 +45,15 @@ class CORE_EXPORT QgsRuntimeProfiler
      */
     void end();
 
+    /**
+     * \brief Record a profile event timed outside of the profiler, e.g. in another thread.
+     * \param name The name of the profile event. Will have the name of
+     * the active group appended.
+     * \param time The time taken by the event, in seconds.
+     * \since QGIS 3.0
+     */
+    void record( const QString &name, double time );
+
     /**
      * \brief Return all the current profile times.
      * \returns A list of profile event names and times.
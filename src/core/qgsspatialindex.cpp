@@ -186,7 +186,7 @@ class QgsSpatialIndexData : public QSharedData
       initTree();
 
       // copy R-tree data one by one (is there a faster way??)
-      double low[]  = { DBL_MIN, DBL_MIN };
+      double low[]  = { -DBL_MAX, -DBL_MAX };
       double high[] = { DBL_MAX, DBL_MAX };
       SpatialIndex::Region query( low, high, 2 );
       QgsSpatialIndexCopyVisitor visitor( mRTree );
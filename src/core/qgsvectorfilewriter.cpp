@@ -624,6 +624,8 @@ void QgsVectorFileWriter::init( QString vectorFileName,
     }
   }
 
+  updateAttributeMapping();
+
   QgsDebugMsg( "Done creating fields" );
 
   mWkbType = geometryType;
@@ -1998,12 +2000,13 @@ OGRFeatureH QgsVectorFileWriter::createFeature( const QgsFeature &feature )
   }
 
   // attribute handling
-  for ( QMap<int, int>::const_iterator it = mAttrIdxToOgrIdx.constBegin(); it != mAttrIdxToOgrIdx.constEnd(); ++it )
+  const QgsAttributes attributes = feature.attributes();
+  for ( const QPair< int, int > &mapping : qgsAsConst( mAttributeMapping ) )
   {
-    int fldIdx = it.key();
-    int ogrField = it.value();
+    int fldIdx = mapping.first;
+    int ogrField = mapping.second;
 
-    QVariant attrValue = feature.attribute( fldIdx );
+    QVariant attrValue = attributes.value( fldIdx );
 
     if ( !attrValue.isValid() || attrValue.isNull() )
     {
@@ -2202,10 +2205,63 @@ void QgsVectorFileWriter::resetMap( const QgsAttributeList &attributes )
     if ( omap.find( i ) != omap.end() )
       mAttrIdxToOgrIdx.insert( attributes[i], omap[i] );
   }
+  updateAttributeMapping();
+}
+
+void QgsVectorFileWriter::updateAttributeMapping()
+{
+  mAttributeMapping.clear();
+  mAttributeMapping.reserve( mAttrIdxToOgrIdx.size() );
+  for ( QMap<int, int>::const_iterator it = mAttrIdxToOgrIdx.constBegin(); it != mAttrIdxToOgrIdx.constEnd(); ++it )
+  {
+    mAttributeMapping << qMakePair( it.key(), it.value() );
+  }
+}
+
+bool QgsVectorFileWriter::startTransaction()
+{
+  if ( mTransactionActive || !mTransactionsSupported )
+    return true;
+
+  if ( OGRERR_NONE != OGR_L_StartTransaction( mLayer ) )
+  {
+    QgsDebugMsg( "Error when trying to enable transactions on OGRLayer." );
+    mTransactionsSupported = false;
+    return true;
+  }
+
+  mTransactionActive = true;
+  mTransactionFeatureCount = 0;
+  return true;
+}
+
+bool QgsVectorFileWriter::commitTransaction()
+{
+  if ( !mTransactionActive )
+    return true;
+
+  mTransactionActive = false;
+  if ( OGRERR_NONE != OGR_L_CommitTransaction( mLayer ) )
+  {
+    mErrorMessage = QObject::tr( "Error while committing transaction (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
+    mError = ErrFeatureWriteFailed;
+    QgsMessageLog::logMessage( mErrorMessage, QObject::tr( "OGR" ) );
+    return false;
+  }
+  return true;
+}
+
+bool QgsVectorFileWriter::flushBuffer()
+{
+  return commitTransaction();
 }
 
 bool QgsVectorFileWriter::writeFeature( OGRLayerH layer, OGRFeatureH feature )
 {
+  // committing each feature is very slow on database formats, so features are written in batches
+  if ( layer == mLayer )
+    startTransaction();
+
   if ( OGR_L_CreateFeature( layer, feature ) != OGRERR_NONE )
   {
     mErrorMessage = QObject::tr( "Feature creation error (OGR error: %1)" ).arg( QString::fromUtf8( CPLGetLastErrorMsg() ) );
@@ -2214,11 +2270,22 @@ bool QgsVectorFileWriter::writeFeature( OGRLayerH layer, OGRFeatureH feature )
     OGR_F_Destroy( feature );
     return false;
   }
+
+  if ( mTransactionActive && mTransactionBatchSize > 0 && ++mTransactionFeatureCount >= mTransactionBatchSize )
+  {
+    if ( !commitTransaction() )
+    {
+      OGR_F_Destroy( feature );
+      return false;
+    }
+  }
   return true;
 }
 
 QgsVectorFileWriter::~QgsVectorFileWriter()
 {
+  commitTransaction();
+
   if ( mDS )
   {
     OGR_DS_Destroy( mDS );
@@ -2545,15 +2612,6 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer *layer,
 
   writer->startRender( layer );
 
-  // enabling transaction on databases that support it
-  bool transactionsEnabled = true;
-
-  if ( OGRERR_NONE != OGR_L_StartTransaction( writer->mLayer ) )
-  {
-    QgsDebugMsg( "Error when trying to enable transactions on OGRLayer." );
-    transactionsEnabled = false;
-  }
-
   writer->resetMap( attributes );
   // Reset mFields to layer fields, and not just exported fields
   writer->mFields = layer->fields();
@@ -2641,12 +2699,9 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer *layer,
     n++;
   }
 
-  if ( transactionsEnabled )
+  if ( !writer->flushBuffer() )
   {
-    if ( OGRERR_NONE != OGR_L_CommitTransaction( writer->mLayer ) )
-    {
-      QgsDebugMsg( "Error while committing transaction on OGRLayer." );
-    }
+    QgsDebugMsg( "Error while committing transaction on OGRLayer." );
   }
 
   writer->stopRender( layer );
@@ -546,6 +546,33 @@ class CORE_EXPORT QgsVectorFileWriter : public QgsFeatureSink
      */
     bool addFeatureWithStyle( QgsFeature &feature, QgsFeatureRenderer *renderer, QgsUnitTypes::DistanceUnit outputUnit = QgsUnitTypes::DistanceMeters );
 
+    /**
+     * Commits the features written since the last commit, if the data source
+     * supports transactions.
+     * \see setTransactionBatchSize()
+     */
+    bool flushBuffer() override;
+
+    /**
+     * Returns the maximum number of features written within a single transaction.
+     * \see setTransactionBatchSize()
+     * \since QGIS 3.0
+     */
+    int transactionBatchSize() const { return mTransactionBatchSize; }
+
+    /**
+     * Sets the maximum number of features written within a single transaction.
+     *
+     * Features are written within transactions on data sources which support them
+     * (e.g. GeoPackage or SpatiaLite), which is much faster than committing each
+     * feature. The transaction is committed each time \a size features have been
+     * written, when flushBuffer() is called and when the writer is destroyed.
+     * A \a size of 0 or less writes all features within a single transaction.
+     * \see transactionBatchSize()
+     * \since QGIS 3.0
+     */
+    void setTransactionBatchSize( int size ) { mTransactionBatchSize = size; }
+
     //! \note not available in Python bindings
     QMap<int, int> attrIdxToOgrIdx() { return mAttrIdxToOgrIdx; } SIP_SKIP
 
@@ -674,8 +701,22 @@ class CORE_EXPORT QgsVectorFileWriter : public QgsFeatureSink
                QgsVectorFileWriter::ActionOnExistingFile action );
     void resetMap( const QgsAttributeList &attributes );
 
+    //! Builds the list of attribute index and OGR field index pairs from mAttrIdxToOgrIdx
+    void updateAttributeMapping();
+
     QgsRenderContext mRenderContext;
 
+    //! Attribute index and OGR field index pairs used to convert the features
+    QVector< QPair< int, int > > mAttributeMapping;
+
+    int mTransactionBatchSize = 10000;
+    int mTransactionFeatureCount = 0;
+    bool mTransactionActive = false;
+    bool mTransactionsSupported = true;
+
+    bool startTransaction();
+    bool commitTransaction();
+
     static QMap<QString, MetaData> initMetaData();
     void createSymbolLayerTable( QgsVectorLayer *vl, const QgsCoordinateTransform &ct, OGRDataSourceH ds );
     OGRFeatureH createFeature( const QgsFeature &feature );
@@ -52,6 +52,7 @@
 #include "qgsfields.h"
 #include "qgsgeometry.h"
 #include "qgslayermetadataformatter.h"
+#include "qgslazyvectordataprovider_p.h"
 #include "qgslogger.h"
 #include "qgsmaplayerlegend.h"
 #include "qgsmaptopixel.h"
@@ -72,6 +73,7 @@
 #include "qgsvectorlayerjoinbuffer.h"
 #include "qgsvectorlayerlabeling.h"
 #include "qgsvectorlayerrenderer.h"
+#include "qgsvectorlayertilecache.h"
 #include "qgsvectorlayerundocommand.h"
 #include "qgsvectorlayerfeaturecounter.h"
 #include "qgspoint.h"
@@ -927,6 +929,16 @@ bool QgsVectorLayer::setSubsetString( const QString &subset )
   return res;
 }
 
+void QgsVectorLayer::setRenderingTileCache( QgsVectorLayerTileCache *cache )
+{
+  mRenderingTileCache.reset( cache );
+}
+
+QgsVectorLayerTileCache *QgsVectorLayer::renderingTileCache() const
+{
+  return mRenderingTileCache.get();
+}
+
 bool QgsVectorLayer::simplifyDrawingCanbeApplied( const QgsRenderContext &renderContext, QgsVectorSimplifyMethod::SimplifyHint simplifyHint ) const
 {
   if ( mValid && mDataProvider && !mEditBuffer && ( isSpatial() && geometryType() != QgsWkbTypes::PointGeometry ) && ( mSimplifyMethod.simplifyHints() & simplifyHint ) && renderContext.useRenderingOptimization() )
@@ -1406,7 +1418,7 @@ bool QgsVectorLayer::readXml( const QDomNode &layer_node, const QgsReadWriteCont
     mProviderKey = QStringLiteral( "ogr" );
   }
 
-  if ( !setDataProvider( mProviderKey ) )
+  if ( !setDataProvider( mProviderKey, mReadProviderMetadataFromXml ? layer_node : QDomNode() ) )
   {
     return false;
   }
@@ -1509,7 +1521,7 @@ void QgsVectorLayer::setDataSource( const QString &dataSource, const QString &ba
 }
 
 
-bool QgsVectorLayer::setDataProvider( QString const &provider )
+bool QgsVectorLayer::setDataProvider( QString const &provider, const QDomNode &layerNode )
 {
   mProviderKey = provider;     // XXX is this necessary?  Usually already set
 
@@ -1533,7 +1545,20 @@ bool QgsVectorLayer::setDataProvider( QString const &provider )
   //XXX - This was a dynamic cast but that kills the Windows
   //      version big-time with an abnormal termination error
   delete mDataProvider;
-  mDataProvider = ( QgsVectorDataProvider * )( QgsProviderRegistry::instance()->createProvider( provider, dataSource ) );
+  mDataProvider = nullptr;
+
+  // create the provider on first use from the metadata stored with the layer
+  const QDomElement providerMetadataElem = layerNode.namedItem( QStringLiteral( "providerMetadata" ) ).toElement();
+  if ( !providerMetadataElem.isNull() )
+  {
+    const QgsRectangle extent = QgsXmlUtils::readRectangle( layerNode.namedItem( QStringLiteral( "extent" ) ).toElement() );
+    std::unique_ptr< QgsLazyVectorDataProvider > lazyProvider( new QgsLazyVectorDataProvider( provider, dataSource, providerMetadataElem, crs(), extent ) );
+    if ( lazyProvider->isValid() )
+      mDataProvider = lazyProvider.release();
+  }
+
+  if ( !mDataProvider )
+    mDataProvider = ( QgsVectorDataProvider * )( QgsProviderRegistry::instance()->createProvider( provider, dataSource ) );
   if ( !mDataProvider )
   {
     QgsDebugMsg( " unable to get data provider" );
@@ -1650,6 +1675,10 @@ bool QgsVectorLayer::writeXml( QDomNode &layer_node,
     QDomText providerText = document.createTextNode( providerType() );
     provider.appendChild( providerText );
     layer_node.appendChild( provider );
+
+    // metadata allowing to create the provider on first use, see setReadProviderMetadataFromXml()
+    if ( mDataProvider->dependencies().isEmpty() )
+      layer_node.appendChild( QgsLazyVectorDataProvider::writeMetadata( mDataProvider, document ) );
   }
 
   //save joins
@@ -2588,6 +2617,11 @@ bool QgsVectorLayer::commitChanges()
     delete mEditBuffer;
     mEditBuffer = nullptr;
     undoStack()->clear();
+
+    // the cached features are now outdated
+    if ( mRenderingTileCache )
+      mRenderingTileCache->clear();
+
     emit editingStopped();
   }
   else
@@ -4575,3 +4609,13 @@ bool QgsVectorLayer::readExtentFromXml() const
   return mReadExtentFromXml;
 }
 
+void QgsVectorLayer::setReadProviderMetadataFromXml( bool readProviderMetadataFromXml )
+{
+  mReadProviderMetadataFromXml = readProviderMetadataFromXml;
+}
+
+bool QgsVectorLayer::readProviderMetadataFromXml() const
+{
+  return mReadProviderMetadataFromXml;
+}
+
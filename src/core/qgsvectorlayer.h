@@ -72,6 +72,7 @@ class QgsPoint;
 class QgsFeedback;
 class QgsAuxiliaryStorage;
 class QgsAuxiliaryLayer;
+class QgsVectorLayerTileCache;
 
 typedef QList<int> QgsAttributeList;
 typedef QSet<int> QgsAttributeIds;
@@ -117,6 +118,15 @@ typedef QSet<int> QgsAttributeIds;
  * - index=yes
  *   Specifies that the layer will be constructed with a spatial index
  *
+ * - index=no
+ *   Specifies that no spatial index will be built automatically. By default, layers
+ *   are indexed once they contain 1000 features
+ *
+ * - storage=columnar
+ *   Specifies that the features are stored by columns, with typed attribute arrays
+ *   and packed geometries. This reduces the memory used by large layers and speeds up
+ *   aggregates and simple filter expressions, at the cost of slower access to single features
+ *
  * - field=name:type(length,precision)
  *   Defines an attribute of the layer. Multiple field parameters can be added
  *   to the data provider definition. type is one of "integer", "double", "string".
@@ -1670,6 +1680,24 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
      */
     inline const QgsVectorSimplifyMethod &simplifyMethod() const { return mSimplifyMethod; }
 
+    /**
+     * Sets a \a cache of pre-generalized features, used instead of the data provider when
+     * rendering the layer at small scales. Ownership of the cache is transferred to the layer.
+     * Pass nullptr to stop using a cache. The cache is cleared when changes are committed
+     * to the layer.
+     * \see renderingTileCache()
+     * \since QGIS 3.0
+     */
+    void setRenderingTileCache( QgsVectorLayerTileCache *cache SIP_TRANSFER );
+
+    /**
+     * Returns the cache of pre-generalized features used when rendering the layer, or
+     * nullptr if none is set.
+     * \see setRenderingTileCache()
+     * \since QGIS 3.0
+     */
+    QgsVectorLayerTileCache *renderingTileCache() const;
+
     /**
      * Returns whether the VectorLayer can apply the specified simplification hint
      *  \note Do not use in 3rd party code - may be removed in future version!
@@ -1756,6 +1784,25 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
      */
     bool readExtentFromXml() const;
 
+    /**
+     * Flag allowing to indicate if the data provider is only created when the
+     * data of the layer is first accessed, the geometry type, fields and
+     * capabilities of the layer being read from the XML document. The data
+     * provider is created when the layer is read if the XML document does not
+     * hold these metadata.
+     *
+     * \since QGIS 3.0
+     */
+    void setReadProviderMetadataFromXml( bool readProviderMetadataFromXml );
+
+    /**
+     * Returns true if the data provider is only created when the data of the
+     * layer is first accessed, its metadata being read from the XML document.
+     *
+     * \since QGIS 3.0
+     */
+    bool readProviderMetadataFromXml() const;
+
     /**
      * Test if an edit command is active
      *
@@ -2083,9 +2130,11 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
     /**
      * Bind layer to a specific data provider
      * \param provider should be "postgres", "ogr", or ??
+     * \param layerNode if not null, the provider is created on first use from
+     * the metadata stored in the layer node, when available
      * @todo XXX should this return bool?  Throw exceptions?
      */
-    bool setDataProvider( QString const &provider );
+    bool setDataProvider( QString const &provider, const QDomNode &layerNode = QDomNode() );
 
     //! Read labeling from SLD
     void readSldLabeling( const QDomNode &node );
@@ -2165,6 +2214,9 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
     //! Simplification object which holds the information about how to simplify the features for fast rendering
     QgsVectorSimplifyMethod mSimplifyMethod;
 
+    //! Cache of pre-generalized features used for rendering at small scales
+    std::unique_ptr<QgsVectorLayerTileCache> mRenderingTileCache;
+
     //! Labeling configuration
     QgsAbstractVectorLayerLabeling *mLabeling = nullptr;
 
@@ -2219,6 +2271,8 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer, public QgsExpressionConte
     bool mReadExtentFromXml;
     QgsRectangle mXmlExtent;
 
+    bool mReadProviderMetadataFromXml = false;
+
     QgsFeatureIds mDeletedFids;
 
     QgsAttributeTableConfig mAttributeTableConfig;
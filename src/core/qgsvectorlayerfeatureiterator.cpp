@@ -26,6 +26,12 @@
 #include "qgsproject.h"
 #include "qgsmessagelog.h"
 #include "qgsexception.h"
+#include "qgsexpression.h"
+
+///@cond PRIVATE
+//! Number of provider features for which the filter expression is evaluated at once
+static const int FILTER_BATCH_SIZE = 256;
+///@endcond
 
 QgsVectorLayerFeatureSource::QgsVectorLayerFeatureSource( const QgsVectorLayer *layer )
 {
@@ -327,30 +333,16 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature &f )
     mProviderIterator.setInterruptionChecker( mInterruptionChecker );
   }
 
-  while ( mProviderIterator.nextFeature( f ) )
+  const bool filterFeatures = mRequest.filterType() == QgsFeatureRequest::FilterExpression && mProviderRequest.filterType() != QgsFeatureRequest::FilterExpression;
+  while ( filterFeatures ? nextFilteredProviderFeature( f ) : nextProviderFeature( f ) )
   {
-    if ( mFetchConsidered.contains( f.id() ) )
-      continue;
-
-    // TODO[MD]: just one resize of attributes
-    f.setFields( mSource->mFields );
-
-    // update attributes
-    if ( mSource->mHasEditBuffer )
-      updateChangedAttributes( f );
-
-    if ( mHasVirtualAttributes )
-      addVirtualAttributes( f );
-
-    if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && mProviderRequest.filterType() != QgsFeatureRequest::FilterExpression )
+    // filtered features have already been prepared
+    if ( !filterFeatures )
     {
-      //filtering by expression, and couldn't do it on the provider side
-      mRequest.expressionContext()->setFeature( f );
-      if ( !mRequest.filterExpression()->evaluate( mRequest.expressionContext() ).toBool() )
-      {
-        //feature did not match filter
+      if ( mFetchConsidered.contains( f.id() ) )
         continue;
-      }
+
+      prepareProviderFeature( f );
     }
 
     // update geometry
@@ -371,6 +363,53 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature &f )
 
 
 
+void QgsVectorLayerFeatureIterator::prepareProviderFeature( QgsFeature &f )
+{
+  // TODO[MD]: just one resize of attributes
+  f.setFields( mSource->mFields );
+
+  // update attributes
+  if ( mSource->mHasEditBuffer )
+    updateChangedAttributes( f );
+
+  if ( mHasVirtualAttributes )
+    addVirtualAttributes( f );
+}
+
+bool QgsVectorLayerFeatureIterator::nextFilteredProviderFeature( QgsFeature &f )
+{
+  while ( mFilterBatchIndex >= mFilterBatch.size() )
+  {
+    mFilterBatch.clear();
+    mFilterBatchIndex = 0;
+
+    QgsFeatureList batch;
+    QgsFeature feature;
+    while ( batch.size() < FILTER_BATCH_SIZE && nextProviderFeature( feature ) )
+    {
+      if ( mFetchConsidered.contains( feature.id() ) )
+        continue;
+
+      prepareProviderFeature( feature );
+      batch << feature;
+    }
+
+    if ( batch.isEmpty() )
+      return false;
+
+    //filtering by expression, and couldn't do it on the provider side
+    const QVariantList results = mRequest.filterExpression()->evaluateBatch( batch, mRequest.expressionContext() );
+    for ( int i = 0; i < batch.size(); ++i )
+    {
+      if ( results.at( i ).toBool() )
+        mFilterBatch << batch.at( i );
+    }
+  }
+
+  f = mFilterBatch.at( mFilterBatchIndex++ );
+  return true;
+}
+
 bool QgsVectorLayerFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -383,6 +422,10 @@ bool QgsVectorLayerFeatureIterator::rewind()
   else
   {
     mProviderIterator.rewind();
+    mProviderBatch.clear();
+    mProviderBatchIndex = 0;
+    mFilterBatch.clear();
+    mFilterBatchIndex = 0;
     rewindEditBuffer();
   }
 
@@ -395,6 +438,11 @@ bool QgsVectorLayerFeatureIterator::close()
     return false;
 
   mProviderIterator.close();
+  mProviderBatch.clear();
+  mProviderBatchIndex = 0;
+  mFilterBatch.clear();
+  mFilterBatchIndex = 0;
+  mJoinedAttributesCache.clear();
 
   iteratorClosed();
 
@@ -652,6 +700,7 @@ void QgsVectorLayerFeatureIterator::prepareFields()
   mFieldsToPrepare.clear();
   mFetchJoinInfo.clear();
   mOrderedJoinInfoList.clear();
+  mJoinedAttributesCache.clear();
 
   mExpressionContext.reset( new QgsExpressionContext() );
   mExpressionContext->appendScope( QgsExpressionContextUtils::globalScope() );
@@ -674,6 +723,15 @@ void QgsVectorLayerFeatureIterator::prepareFields()
   if ( !mFetchJoinInfo.empty() )
   {
     createOrderedJoinList();
+
+    // joins without memory cache, driven by a provider field, are fetched in batches
+    QList< FetchJoinInfo >::const_iterator joinIt = mOrderedJoinInfoList.constBegin();
+    for ( ; joinIt != mOrderedJoinInfoList.constEnd(); ++joinIt )
+    {
+      if ( joinIt->joinInfo->cachedAttributes.isEmpty() && joinIt->joinField >= 0
+           && mSource->mFields.fieldOrigin( joinIt->targetField ) == QgsFields::OriginProvider )
+        mJoinedAttributesCache.insert( joinIt->joinInfo, QHash< QString, QgsAttributes >() );
+    }
   }
 }
 
@@ -816,10 +874,28 @@ void QgsVectorLayerFeatureIterator::addJoinedAttributes( QgsFeature &f )
       continue;
 
     const QHash< QString, QgsAttributes> &memoryCache = joinIt->joinInfo->cachedAttributes;
-    if ( memoryCache.isEmpty() )
-      joinIt->addJoinedAttributesDirect( f, targetFieldValue );
-    else
+    if ( !memoryCache.isEmpty() )
+    {
       joinIt->addJoinedAttributesCached( f, targetFieldValue );
+      continue;
+    }
+
+    // values prefetched for the current batch of features
+    QHash< const QgsVectorLayerJoinInfo *, QHash< QString, QgsAttributes > >::const_iterator batchIt = mJoinedAttributesCache.constFind( joinIt->joinInfo );
+    if ( batchIt != mJoinedAttributesCache.constEnd() && !targetFieldValue.isNull() )
+    {
+      QHash< QString, QgsAttributes >::const_iterator it = batchIt->constFind( targetFieldValue.toString() );
+      if ( it != batchIt->constEnd() )
+      {
+        int index = joinIt->indexOffset;
+        const QgsAttributes &joinedAttributes = it.value();
+        for ( int i = 0; i < joinedAttributes.count(); ++i )
+          f.setAttribute( index++, joinedAttributes.at( i ) );
+        continue;
+      }
+    }
+
+    joinIt->addJoinedAttributesDirect( f, targetFieldValue );
   }
 }
 
@@ -892,6 +968,173 @@ bool QgsVectorLayerFeatureIterator::providerCanSimplify( QgsSimplifyMethod::Meth
 }
 
 
+///@cond PRIVATE
+
+//! Maximum number of provider features read ahead when fetching joined attributes in batches
+static const int JOIN_BATCH_SIZE = 1000;
+//! Maximum number of join values kept per join between batches
+static const int JOIN_CACHE_SIZE = 10000;
+
+//! Returns \a joinValue as a literal for the filter expressions used to query joined layers
+static QString joinValueLiteral( const QVariant &joinValue )
+{
+  QString v = joinValue.toString();
+  switch ( joinValue.type() )
+  {
+    case QVariant::Int:
+    case QVariant::LongLong:
+    case QVariant::Double:
+      break;
+
+    default:
+    case QVariant::String:
+      v.replace( '\'', QLatin1String( "''" ) );
+      v.prepend( '\'' ).append( '\'' );
+      break;
+  }
+  return v;
+}
+
+//! Returns the attributes of a \a joinFeature which are added to the target features
+static QgsAttributes joinedAttributes( const QgsVectorLayerFeatureIterator::FetchJoinInfo &info, const QgsAttributes &joinAttributes, const QVector<int> &subsetIndices )
+{
+  QgsAttributes result;
+  if ( info.joinInfo->hasSubset() )
+  {
+    result.reserve( subsetIndices.count() );
+    for ( int i = 0; i < subsetIndices.count(); ++i )
+      result << joinAttributes.at( subsetIndices.at( i ) );
+  }
+  else
+  {
+    // use all fields except for the one used for join (has same value as exiting field in target layer)
+    result.reserve( joinAttributes.count() - 1 );
+    for ( int i = 0; i < joinAttributes.count(); ++i )
+    {
+      if ( i == info.joinField )
+        continue;
+
+      result << joinAttributes.at( i );
+    }
+  }
+  return result;
+}
+
+//! Returns the indices of the joined layer fields added to the target features, if the join uses a subset of fields
+static QVector<int> joinSubsetIndices( const QgsVectorLayerFeatureIterator::FetchJoinInfo &info )
+{
+  QVector<int> subsetIndices;
+  if ( info.joinInfo->hasSubset() )
+  {
+    const QStringList subsetNames = QgsVectorLayerJoinInfo::joinFieldNamesSubset( *info.joinInfo );
+    subsetIndices = QgsVectorLayerJoinBuffer::joinSubsetIndices( info.joinLayer, subsetNames );
+  }
+  return subsetIndices;
+}
+
+///@endcond
+
+bool QgsVectorLayerFeatureIterator::nextProviderFeature( QgsFeature &f )
+{
+  if ( mJoinedAttributesCache.isEmpty() )
+    return mProviderIterator.nextFeature( f );
+
+  if ( mProviderBatchIndex >= mProviderBatch.size() )
+  {
+    mProviderBatch.clear();
+    mProviderBatchIndex = 0;
+
+    QgsFeature feature;
+    while ( mProviderBatch.size() < JOIN_BATCH_SIZE && mProviderIterator.nextFeature( feature ) )
+    {
+      if ( mFetchConsidered.contains( feature.id() ) )
+        continue;
+
+      mProviderBatch << feature;
+    }
+
+    if ( mProviderBatch.isEmpty() )
+      return false;
+
+    prefetchJoinedAttributes();
+  }
+
+  f = mProviderBatch.at( mProviderBatchIndex++ );
+  return true;
+}
+
+void QgsVectorLayerFeatureIterator::prefetchJoinedAttributes()
+{
+  QList< FetchJoinInfo >::const_iterator joinIt = mOrderedJoinInfoList.constBegin();
+  for ( ; joinIt != mOrderedJoinInfoList.constEnd(); ++joinIt )
+  {
+    QHash< const QgsVectorLayerJoinInfo *, QHash< QString, QgsAttributes > >::iterator cacheIt = mJoinedAttributesCache.find( joinIt->joinInfo );
+    if ( cacheIt == mJoinedAttributesCache.end() )
+      continue;
+
+    QHash< QString, QgsAttributes > &cache = cacheIt.value();
+    if ( cache.size() > JOIN_CACHE_SIZE )
+      cache.clear();
+
+    // collect the join values of the batch which are not cached yet
+    QSet< QString > keys;
+    QStringList literals;
+    Q_FOREACH ( const QgsFeature &feature, mProviderBatch )
+    {
+      const QVariant targetFieldValue = feature.attribute( joinIt->targetField );
+      if ( targetFieldValue.isNull() )
+        continue;
+
+      const QString key = targetFieldValue.toString();
+      if ( cache.contains( key ) || keys.contains( key ) )
+        continue;
+
+      keys << key;
+      literals << joinValueLiteral( targetFieldValue );
+    }
+
+    if ( keys.isEmpty() )
+      continue;
+
+    QgsAttributeList attributes = joinIt->attributes;
+    if ( !attributes.contains( joinIt->joinField ) )
+      attributes << joinIt->joinField;
+
+    QgsFeatureRequest request;
+    request.setFlags( QgsFeatureRequest::NoGeometry );
+    request.setSubsetOfAttributes( attributes );
+    request.setFilterExpression( QStringLiteral( "%1 IN (%2)" ).arg( QgsExpression::quotedColumnRef( joinIt->joinInfo->joinFieldName() ),
+                                 literals.join( QStringLiteral( "," ) ) ) );
+
+    const QVector<int> subsetIndices = joinSubsetIndices( *joinIt );
+    const QVariant::Type targetType = mSource->mFields.at( joinIt->targetField ).type();
+
+    QgsFeatureIterator fi = joinIt->joinLayer->getFeatures( request );
+    QgsFeature joinFeature;
+    while ( fi.nextFeature( joinFeature ) )
+    {
+      // compare join values as values of the target field, like the filter expression does
+      QVariant joinValue = joinFeature.attribute( joinIt->joinField );
+      if ( !joinValue.convert( targetType ) )
+        continue;
+
+      const QString key = joinValue.toString();
+      // the first matching feature is used, as for non batched joins
+      if ( !keys.contains( key ) || cache.contains( key ) )
+        continue;
+
+      cache.insert( key, joinedAttributes( *joinIt, joinFeature.attributes(), subsetIndices ) );
+    }
+
+    // no suitable join feature found, keeping empty (null) attributes
+    Q_FOREACH ( const QString &key, keys )
+    {
+      if ( !cache.contains( key ) )
+        cache.insert( key, QgsAttributes() );
+    }
+  }
+}
+
 void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesCached( QgsFeature &f, const QVariant &joinValue ) const
 {
   const QHash<QString, QgsAttributes> &memoryCache = joinInfo->cachedAttributes;
@@ -925,30 +1168,7 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( Qg
   }
   else
   {
-    QString v = joinValue.toString();
-    switch ( joinValue.type() )
-    {
-      case QVariant::Int:
-      case QVariant::LongLong:
-      case QVariant::Double:
-        break;
-
-      default:
-      case QVariant::String:
-        v.replace( '\'', QLatin1String( "''" ) );
-        v.prepend( '\'' ).append( '\'' );
-        break;
-    }
-    subsetString += '=' + v;
-  }
-
-  // maybe user requested just a subset of layer's attributes
-  // so we do not have to cache everything
-  QVector<int> subsetIndices;
-  if ( joinInfo->hasSubset() )
-  {
-    const QStringList subsetNames = QgsVectorLayerJoinInfo::joinFieldNamesSubset( *joinInfo );
-    subsetIndices = QgsVectorLayerJoinBuffer::joinSubsetIndices( joinLayer, subsetNames );
+    subsetString += '=' + joinValueLiteral( joinValue );
   }
 
   // select (no geometry)
@@ -963,24 +1183,12 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( Qg
   QgsFeature fet;
   if ( fi.nextFeature( fet ) )
   {
+    // maybe user requested just a subset of layer's attributes
+    // so we do not have to cache everything
     int index = indexOffset;
-    QgsAttributes attr = fet.attributes();
-    if ( joinInfo->hasSubset() )
-    {
-      for ( int i = 0; i < subsetIndices.count(); ++i )
-        f.setAttribute( index++, attr.at( subsetIndices.at( i ) ) );
-    }
-    else
-    {
-      // use all fields except for the one used for join (has same value as exiting field in target layer)
-      for ( int i = 0; i < attr.count(); ++i )
-      {
-        if ( i == joinField )
-          continue;
-
-        f.setAttribute( index++, attr.at( i ) );
-      }
-    }
+    const QgsAttributes attr = joinedAttributes( *this, fet.attributes(), joinSubsetIndices( *this ) );
+    for ( int i = 0; i < attr.count(); ++i )
+      f.setAttribute( index++, attr.at( i ) );
   }
   else
   {
@@ -22,6 +22,7 @@
 #include "qgscoordinatereferencesystem.h"
 #include "qgsfeaturesource.h"
 
+#include <QHash>
 #include <QSet>
 #include <memory>
 
@@ -253,6 +254,39 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     //! Join list sorted by dependency
     QList< FetchJoinInfo > mOrderedJoinInfoList;
 
+    /**
+     * Joined attributes prefetched for joins without memory cache, keyed by join and by
+     * the string representation of the join value. Only contains entries for the joins
+     * whose values are fetched in batches.
+     */
+    QHash< const QgsVectorLayerJoinInfo *, QHash< QString, QgsAttributes > > mJoinedAttributesCache;
+
+    //! Provider features read ahead to batch the queries of joined attributes
+    QgsFeatureList mProviderBatch;
+    int mProviderBatchIndex = 0;
+
+    /**
+     * Returns the next feature from the provider iterator. Features are read ahead in batches
+     * when joined attributes can be fetched for the whole batch at once.
+     */
+    bool nextProviderFeature( QgsFeature &f );
+
+    //! Fetches the joined attributes of the features in the current provider batch
+    void prefetchJoinedAttributes();
+
+    //! Provider features matching the filter expression, when it is evaluated locally
+    QgsFeatureList mFilterBatch;
+    int mFilterBatchIndex = 0;
+
+    //! Adds changed and virtual attributes to a feature returned by the provider
+    void prepareProviderFeature( QgsFeature &f );
+
+    /**
+     * Returns the next prepared provider feature matching the filter expression. The expression
+     * is evaluated for batches of provider features at once.
+     */
+    bool nextFilteredProviderFeature( QgsFeature &f );
+
     /**
      * Will always return true. We assume that ordering has been done on provider level already.
      *
@@ -30,6 +30,8 @@
 #include "qgsvectorlayerfeatureiterator.h"
 #include "qgsvectorlayerlabeling.h"
 #include "qgsvectorlayerlabelprovider.h"
+#include "qgsvectorlayertilecache.h"
+#include "qgsvectorlayertilecache_p.h"
 #include "qgspainteffect.h"
 #include "qgsfeaturefilterprovider.h"
 #include "qgsexception.h"
@@ -50,6 +52,12 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer *layer, QgsRender
 {
   mSource = new QgsVectorLayerFeatureSource( layer );
 
+  // the tile cache only holds the provider features and fields
+  if ( layer->renderingTileCache() && !layer->editBuffer() && mFields.count() == layer->dataProvider()->fields().count() )
+  {
+    mTileCacheSource = layer->renderingTileCache()->createFeatureSource();
+  }
+
   mRenderer = layer->renderer() ? layer->renderer()->clone() : nullptr;
   mSelectedFeatureIds = layer->selectedFeatureIds();
 
@@ -104,6 +112,7 @@ QgsVectorLayerRenderer::~QgsVectorLayerRenderer()
 {
   delete mRenderer;
   delete mSource;
+  delete mTileCacheSource;
 }
 
 
@@ -159,6 +168,8 @@ bool QgsVectorLayerRenderer::render()
     featureRequest.combineFilterExpression( rendererFilter );
   }
 
+  int tileCacheLevel = -1;
+
   // enable the simplification of the geometries (Using the current map2pixel context) before send it to renderer engine.
   if ( mSimplifyGeometry )
   {
@@ -219,6 +230,10 @@ bool QgsVectorLayerRenderer::render()
       QgsVectorSimplifyMethod vectorMethod = mSimplifyMethod;
       vectorMethod.setTolerance( map2pixelTol );
       mContext.setVectorSimplifyMethod( vectorMethod );
+
+      // at small scales, read the features already generalized for this tolerance
+      if ( mTileCacheSource )
+        tileCacheLevel = mTileCacheSource->levelForTolerance( map2pixelTol );
     }
     else
     {
@@ -234,7 +249,17 @@ bool QgsVectorLayerRenderer::render()
     mContext.setVectorSimplifyMethod( vectorMethod );
   }
 
-  QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
+  QgsFeatureIterator fit;
+  if ( tileCacheLevel >= 0 )
+  {
+    QgsDebugMsgLevel( QString( "Reading level %1 of the tile cache" ).arg( tileCacheLevel ), 3 );
+    mTileCacheSource->setLevel( tileCacheLevel );
+    fit = mTileCacheSource->getFeatures( featureRequest );
+  }
+  else
+  {
+    fit = mSource->getFeatures( featureRequest );
+  }
   // Attach an interruption checker so that iterators that have potentially
   // slow fetchFeature() implementations, such as in the WFS provider, can
   // check it, instead of relying on just the mContext.renderingStopped() check
@@ -20,6 +20,7 @@ class QgsFeatureRenderer;
 class QgsRenderContext;
 class QgsVectorLayer;
 class QgsVectorLayerFeatureSource;
+class QgsVectorLayerTileCacheFeatureSource;
 
 class QgsDiagramRenderer;
 class QgsDiagramLayerSettings;
@@ -114,6 +115,9 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     QgsVectorLayerFeatureSource *mSource = nullptr;
 
+    //! Source for the pre-generalized features of the layer's rendering tile cache, if any
+    QgsVectorLayerTileCacheFeatureSource *mTileCacheSource = nullptr;
+
     QgsFeatureRenderer *mRenderer = nullptr;
 
     bool mDrawVertexMarkers;
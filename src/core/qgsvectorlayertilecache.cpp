@@ -0,0 +1,639 @@
+/***************************************************************************
+  qgsvectorlayertilecache.cpp
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsvectorlayertilecache.h"
+#include "qgsvectorlayertilecache_p.h"
+
+#include "qgsdatasourceuri.h"
+#include "qgsexception.h"
+#include "qgsfeedback.h"
+#include "qgslogger.h"
+#include "qgsmaptopixelgeometrysimplifier.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTemporaryFile>
+
+#include <cmath>
+#include <vector>
+
+///@cond PRIVATE
+
+//! Magic number at the start of cache files ("QVTC")
+static const quint32 TILE_CACHE_MAGIC = 0x51565443;
+static const qint32 TILE_CACHE_VERSION = 1;
+//! Size in pixels of the single tile of level 0
+static const int TILE_SIZE = 256;
+//! Maximum number of levels, the last one has 2^(TILE_CACHE_MAX_LEVELS - 1) tiles per side
+static const int TILE_CACHE_MAX_LEVELS = 12;
+//! Size in bytes of the header of a tile in cache files
+static const qint64 TILE_HEADER_SIZE = 4 * sizeof( double ) + 2 * sizeof( qint64 ) + sizeof( qint32 );
+//! Maximum number of features kept in memory for recently read tiles
+static const int TILE_CACHE_MAX_FEATURES = 200000;
+//! Size of the per tile buffers used when sorting features into tiles
+static const int TILE_WRITE_BUFFER_SIZE = 64 * 1024;
+
+std::shared_ptr< QgsVectorLayerTileCacheData > QgsVectorLayerTileCacheData::open( const QString &filePath, const QString &key )
+{
+  std::shared_ptr< QgsVectorLayerTileCacheData > data( new QgsVectorLayerTileCacheData() );
+  data->mFile.setFileName( filePath );
+  if ( !data->mFile.open( QIODevice::ReadOnly ) )
+    return nullptr;
+
+  QDataStream in( &data->mFile );
+  in.setVersion( QDataStream::Qt_5_0 );
+
+  quint32 magic;
+  qint32 version;
+  in >> magic >> version;
+  if ( magic != TILE_CACHE_MAGIC || version != TILE_CACHE_VERSION )
+    return nullptr;
+
+  QString crsWkt;
+  double xMin, yMin, xMax, yMax;
+  qint32 levelCount;
+  in >> data->key >> data->fields >> crsWkt >> xMin >> yMin >> xMax >> yMax >> levelCount;
+  if ( in.status() != QDataStream::Ok || data->key != key || levelCount < 1 || levelCount > TILE_CACHE_MAX_LEVELS )
+    return nullptr;
+  if ( std::isnan( xMin ) || std::isnan( yMin ) || std::isnan( xMax ) || std::isnan( yMax ) )
+    return nullptr;
+
+  data->crs = QgsCoordinateReferenceSystem::fromWkt( crsWkt );
+  data->extent = QgsRectangle( xMin, yMin, xMax, yMax );
+  data->levels.resize( levelCount );
+  for ( int z = 0; z < levelCount; ++z )
+  {
+    QgsVectorLayerTileCacheLevel &level = data->levels[z];
+
+    // levels are written with the layout of build(), which is checked before
+    // allocating the tiles so that a corrupted file cannot request any size
+    qint32 columns, rows;
+    in >> level.tolerance >> columns >> rows;
+    if ( in.status() != QDataStream::Ok || columns != ( 1 << z ) || rows != ( 1 << z ) || !std::isfinite( level.tolerance ) || level.tolerance < 0 )
+      return nullptr;
+    // each level halves the tolerance of the previous one
+    if ( z > 0 && !qgsDoubleNear( level.tolerance * columns, data->levels.at( 0 ).tolerance, 1e-9 * data->levels.at( 0 ).tolerance ) )
+      return nullptr;
+    if ( data->mFile.size() - data->mFile.pos() < static_cast< qint64 >( columns ) * rows * TILE_HEADER_SIZE )
+      return nullptr;
+
+    level.columns = columns;
+    level.rows = rows;
+    level.tiles.resize( columns * rows );
+    for ( QgsVectorLayerTileCacheTile &tile : level.tiles )
+    {
+      qint32 featureCount;
+      in >> xMin >> yMin >> xMax >> yMax >> tile.offset >> tile.size >> featureCount;
+      // each feature record takes more than a byte
+      if ( tile.offset < 0 || tile.size < 0 || featureCount < 0 || featureCount > tile.size )
+        return nullptr;
+      tile.extent = QgsRectangle( xMin, yMin, xMax, yMax );
+      tile.featureCount = featureCount;
+    }
+  }
+  if ( in.status() != QDataStream::Ok )
+    return nullptr;
+
+  // the tile data has to be within the file
+  const qint64 dataSize = data->mFile.size() - data->mFile.pos();
+  for ( const QgsVectorLayerTileCacheLevel &level : qgsAsConst( data->levels ) )
+  {
+    for ( const QgsVectorLayerTileCacheTile &tile : level.tiles )
+    {
+      if ( tile.size > dataSize || tile.offset > dataSize - tile.size )
+        return nullptr;
+    }
+  }
+
+  data->mDataStart = data->mFile.pos();
+  data->mTiles.setMaxCost( TILE_CACHE_MAX_FEATURES );
+  return data;
+}
+
+int QgsVectorLayerTileCacheData::levelForTolerance( double tolerance ) const
+{
+  // levels go from coarse to detailed
+  for ( int i = 0; i < levels.size(); ++i )
+  {
+    if ( levels.at( i ).tolerance <= tolerance )
+      return i;
+  }
+  return -1;
+}
+
+QgsFeatureList QgsVectorLayerTileCacheData::tileFeatures( int level, int tile )
+{
+  if ( level < 0 || level >= levels.size() || tile < 0 || tile >= levels.at( level ).tiles.size() )
+    return QgsFeatureList();
+
+  const QgsVectorLayerTileCacheTile &tileInfo = levels.at( level ).tiles.at( tile );
+  if ( tileInfo.featureCount == 0 )
+    return QgsFeatureList();
+
+  QMutexLocker locker( &mMutex );
+
+  const qint64 tileKey = ( static_cast< qint64 >( level ) << 32 ) | tile;
+  if ( QgsFeatureList *features = mTiles.object( tileKey ) )
+    return *features;
+
+  if ( !mFile.seek( mDataStart + tileInfo.offset ) )
+    return QgsFeatureList();
+
+  const QByteArray tileData = mFile.read( tileInfo.size );
+  QDataStream in( tileData );
+  in.setVersion( QDataStream::Qt_5_0 );
+
+  QgsFeatureList *features = new QgsFeatureList();
+  features->reserve( tileInfo.featureCount );
+  for ( int i = 0; i < tileInfo.featureCount && in.status() == QDataStream::Ok; ++i )
+  {
+    QgsFeature feature;
+    in >> feature;
+    feature.setFields( fields, false );
+    features->append( feature );
+  }
+
+  const QgsFeatureList result = *features;
+  mTiles.insert( tileKey, features, result.size() );
+  return result;
+}
+
+
+QgsVectorLayerTileCacheFeatureSource::QgsVectorLayerTileCacheFeatureSource( const std::shared_ptr< QgsVectorLayerTileCacheData > &data, int level )
+  : mData( data )
+  , mLevel( level )
+{
+}
+
+int QgsVectorLayerTileCacheFeatureSource::levelForTolerance( double tolerance ) const
+{
+  return mData->levelForTolerance( tolerance );
+}
+
+QgsFeatureIterator QgsVectorLayerTileCacheFeatureSource::getFeatures( const QgsFeatureRequest &request )
+{
+  return QgsFeatureIterator( new QgsVectorLayerTileCacheFeatureIterator( this, false, request ) );
+}
+
+
+QgsVectorLayerTileCacheFeatureIterator::QgsVectorLayerTileCacheFeatureIterator( QgsVectorLayerTileCacheFeatureSource *source, bool ownSource, const QgsFeatureRequest &request )
+  : QgsAbstractFeatureIteratorFromSource<QgsVectorLayerTileCacheFeatureSource>( source, ownSource, request )
+{
+  if ( mSource->mLevel < 0 || mSource->mLevel >= mSource->mData->levels.size() )
+  {
+    mClosed = true;
+    return;
+  }
+
+  if ( mRequest.destinationCrs().isValid() && mRequest.destinationCrs() != mSource->mData->crs )
+  {
+    mTransform = QgsCoordinateTransform( mSource->mData->crs, mRequest.destinationCrs() );
+  }
+  try
+  {
+    mFilterRect = filterRectToSourceCrs( mTransform );
+  }
+  catch ( QgsCsException & )
+  {
+    // can't reproject mFilterRect
+    mClosed = true;
+    return;
+  }
+
+  if ( !mFilterRect.isNull() && mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+  {
+    mSelectRectGeom = QgsGeometry::fromRect( mFilterRect );
+  }
+
+  // only visit the tiles whose features can intersect the filter rectangle
+  const QgsVectorLayerTileCacheLevel &level = mSource->mData->levels.at( mSource->mLevel );
+  for ( int i = 0; i < level.tiles.size(); ++i )
+  {
+    const QgsVectorLayerTileCacheTile &tile = level.tiles.at( i );
+    if ( tile.featureCount > 0 && ( mFilterRect.isNull() || tile.extent.intersects( mFilterRect ) ) )
+      mTileIds << i;
+  }
+
+  rewind();
+}
+
+QgsVectorLayerTileCacheFeatureIterator::~QgsVectorLayerTileCacheFeatureIterator()
+{
+  close();
+}
+
+bool QgsVectorLayerTileCacheFeatureIterator::fetchFeature( QgsFeature &feature )
+{
+  feature.setValid( false );
+
+  if ( mClosed )
+    return false;
+
+  while ( true )
+  {
+    while ( mFeatureIndex < mTileFeatures.size() )
+    {
+      const QgsFeature &candidate = mTileFeatures.at( mFeatureIndex++ );
+      if ( !mFilterRect.isNull() )
+      {
+        if ( !candidate.geometry().boundingBox().intersects( mFilterRect ) )
+          continue;
+        if ( !mSelectRectGeom.isNull() && !candidate.geometry().intersects( mSelectRectGeom ) )
+          continue;
+      }
+
+      feature = candidate;
+      feature.setValid( true );
+      geometryToDestinationCrs( feature, mTransform );
+      return true;
+    }
+
+    if ( mTileIndex >= mTileIds.size() )
+      break;
+
+    mTileFeatures = mSource->mData->tileFeatures( mSource->mLevel, mTileIds.at( mTileIndex++ ) );
+    mFeatureIndex = 0;
+  }
+
+  close();
+  return false;
+}
+
+bool QgsVectorLayerTileCacheFeatureIterator::rewind()
+{
+  if ( mClosed )
+    return false;
+
+  mTileIndex = 0;
+  mTileFeatures.clear();
+  mFeatureIndex = 0;
+  return true;
+}
+
+bool QgsVectorLayerTileCacheFeatureIterator::close()
+{
+  if ( mClosed )
+    return false;
+
+  iteratorClosed();
+
+  mClosed = true;
+  return true;
+}
+
+///@endcond PRIVATE
+
+
+QgsVectorLayerTileCache::QgsVectorLayerTileCache( QgsVectorLayer *layer, const QString &directory )
+  : mLayer( layer )
+  , mDirectory( directory )
+{
+}
+
+QgsVectorLayerTileCache::~QgsVectorLayerTileCache() = default;
+
+QString QgsVectorLayerTileCache::filePath() const
+{
+  return QDir( mDirectory ).filePath( key() + QStringLiteral( ".qvtc" ) );
+}
+
+void QgsVectorLayerTileCache::setLevelCount( int count )
+{
+  mLevelCount = qBound( 1, count, TILE_CACHE_MAX_LEVELS );
+}
+
+QString QgsVectorLayerTileCache::dataRevision() const
+{
+  // file based sources, e.g. OGR and spatialite layers
+  const QStringList paths = QStringList() << mLayer->source().split( '|' ).first() << QgsDataSourceUri( mLayer->source() ).database();
+  for ( const QString &path : paths )
+  {
+    const QFileInfo fileInfo( path );
+    if ( !path.isEmpty() && fileInfo.isFile() )
+      return QStringLiteral( "%1 %2" ).arg( fileInfo.lastModified().toMSecsSinceEpoch() ).arg( fileInfo.size() );
+  }
+
+  // other sources are only identified by their feature count and extent
+  QgsVectorDataProvider *provider = mLayer->dataProvider();
+  if ( !provider )
+    return QString();
+  return QStringLiteral( "%1 %2" ).arg( provider->featureCount() ).arg( provider->extent().toString( 17 ) );
+}
+
+QString QgsVectorLayerTileCache::key() const
+{
+  // the features of memory layers can change without any revision of their data,
+  // and they do not outlive the layer anyway
+  if ( !mLayer || mLayer->providerType() == QLatin1String( "memory" ) )
+    return QString();
+
+  const QgsVectorSimplifyMethod &simplifyMethod = mLayer->simplifyMethod();
+  const QString keySource = QStringLiteral( "%1\n%2\n%3\n%4\n%5\n%6\n%7" ).arg( mLayer->id(),
+                            mLayer->providerType(),
+                            mLayer->source(),
+                            mLayer->subsetString(),
+                            dataRevision() )
+                            .arg( simplifyMethod.threshold() )
+                            .arg( simplifyMethod.simplifyAlgorithm() );
+  return QString::fromLatin1( QCryptographicHash::hash( keySource.toUtf8(), QCryptographicHash::Sha1 ).toHex() );
+}
+
+std::shared_ptr< QgsVectorLayerTileCacheData > QgsVectorLayerTileCache::data() const
+{
+  const QString currentKey = key();
+  if ( currentKey.isEmpty() )
+    return nullptr;
+
+  // the layer settings may have changed since the cache file was opened, or the
+  // file may have been cleared by another cache for the same layer
+  if ( !mData || mData->key != currentKey || !QFile::exists( filePath() ) )
+  {
+    mData = QgsVectorLayerTileCacheData::open( filePath(), currentKey );
+  }
+  return mData;
+}
+
+bool QgsVectorLayerTileCache::isValid() const
+{
+  return static_cast< bool >( data() );
+}
+
+void QgsVectorLayerTileCache::clear()
+{
+  mData.reset();
+  if ( !key().isEmpty() )
+    QFile::remove( filePath() );
+}
+
+double QgsVectorLayerTileCache::levelTolerance( int level ) const
+{
+  std::shared_ptr< QgsVectorLayerTileCacheData > cacheData = data();
+  if ( !cacheData || level < 0 || level >= cacheData->levels.size() )
+    return -1;
+
+  return cacheData->levels.at( level ).tolerance;
+}
+
+int QgsVectorLayerTileCache::levelForTolerance( double tolerance ) const
+{
+  std::shared_ptr< QgsVectorLayerTileCacheData > cacheData = data();
+  return cacheData ? cacheData->levelForTolerance( tolerance ) : -1;
+}
+
+QgsFeatureIterator QgsVectorLayerTileCache::getFeatures( int level, const QgsFeatureRequest &request ) const
+{
+  std::shared_ptr< QgsVectorLayerTileCacheData > cacheData = data();
+  if ( !cacheData )
+    return QgsFeatureIterator();
+
+  return QgsFeatureIterator( new QgsVectorLayerTileCacheFeatureIterator( new QgsVectorLayerTileCacheFeatureSource( cacheData, level ), true, request ) );
+}
+
+QgsVectorLayerTileCacheFeatureSource *QgsVectorLayerTileCache::createFeatureSource() const
+{
+  std::shared_ptr< QgsVectorLayerTileCacheData > cacheData = data();
+  return cacheData ? new QgsVectorLayerTileCacheFeatureSource( cacheData ) : nullptr;
+}
+
+bool QgsVectorLayerTileCache::build( QgsFeedback *feedback )
+{
+  mErrorMessage.clear();
+
+  if ( !mLayer || !mLayer->dataProvider() )
+  {
+    mErrorMessage = QObject::tr( "Layer has no data provider" );
+    return false;
+  }
+
+  if ( key().isEmpty() )
+  {
+    mErrorMessage = QObject::tr( "Memory layers cannot be cached" );
+    return false;
+  }
+
+  if ( !QDir().mkpath( mDirectory ) )
+  {
+    mErrorMessage = QObject::tr( "Could not create cache directory %1" ).arg( mDirectory );
+    return false;
+  }
+
+  QgsVectorDataProvider *provider = mLayer->dataProvider();
+  const QgsVectorSimplifyMethod &simplifyMethod = mLayer->simplifyMethod();
+  const QgsMapToPixelSimplifier::SimplifyAlgorithm algorithm = static_cast< QgsMapToPixelSimplifier::SimplifyAlgorithm >( simplifyMethod.simplifyAlgorithm() );
+  const QString cacheKey = key();
+
+  const QgsRectangle extent = provider->extent();
+  double side = std::max( extent.width(), extent.height() );
+  if ( side <= 0 || !std::isfinite( side ) )
+    side = 1;
+
+  QVector<QgsVectorLayerTileCacheLevel> levels( mLevelCount );
+  for ( int z = 0; z < levels.size(); ++z )
+  {
+    QgsVectorLayerTileCacheLevel &level = levels[z];
+    level.columns = 1 << z;
+    level.rows = 1 << z;
+    level.tolerance = simplifyMethod.threshold() * side / ( TILE_SIZE * level.columns );
+    level.tiles.resize( level.columns * level.rows );
+  }
+
+  // generalized features are first spilled to one file per level in reading order,
+  // each record prefixed with its tile index, and sorted into tiles afterwards
+  std::vector< std::unique_ptr< QTemporaryFile > > spillFiles;
+  std::vector< std::unique_ptr< QDataStream > > spillStreams;
+  for ( int z = 0; z < levels.size(); ++z )
+  {
+    std::unique_ptr< QTemporaryFile > spillFile( new QTemporaryFile( QDir( mDirectory ).filePath( QStringLiteral( "XXXXXX.spill" ) ) ) );
+    if ( !spillFile->open() )
+    {
+      mErrorMessage = QObject::tr( "Could not create temporary file in %1" ).arg( mDirectory );
+      return false;
+    }
+    std::unique_ptr< QDataStream > stream( new QDataStream( spillFile.get() ) );
+    stream->setVersion( QDataStream::Qt_5_0 );
+    spillFiles.push_back( std::move( spillFile ) );
+    spillStreams.push_back( std::move( stream ) );
+  }
+
+  const long featureCount = provider->featureCount();
+  long processed = 0;
+
+  QgsFeatureIterator fit = provider->getFeatures( QgsFeatureRequest() );
+  QgsFeature feature;
+  while ( fit.nextFeature( feature ) )
+  {
+    if ( feedback && feedback->isCanceled() )
+    {
+      mErrorMessage = QObject::tr( "Canceled" );
+      return false;
+    }
+
+    if ( feedback && featureCount > 0 && ++processed % 1000 == 0 )
+      feedback->setProgress( 90.0 * processed / featureCount );
+
+    if ( !feature.hasGeometry() )
+      continue;
+
+    const QgsGeometry geometry = feature.geometry();
+    const QgsRectangle bbox = geometry.boundingBox();
+    const QgsPointXY center = bbox.center();
+
+    for ( int z = 0; z < levels.size(); ++z )
+    {
+      QgsVectorLayerTileCacheLevel &level = levels[z];
+      const QgsMapToPixelSimplifier simplifier( QgsMapToPixelSimplifier::SimplifyGeometry | QgsMapToPixelSimplifier::SimplifyEnvelope, level.tolerance, algorithm );
+
+      QgsFeature generalized( feature );
+      generalized.setGeometry( simplifier.simplify( geometry ) );
+      if ( !generalized.hasGeometry() )
+        continue;
+
+      const double tileSize = side / level.columns;
+      const int column = qBound( 0, static_cast< int >( ( center.x() - extent.xMinimum() ) / tileSize ), level.columns - 1 );
+      const int row = qBound( 0, static_cast< int >( ( center.y() - extent.yMinimum() ) / tileSize ), level.rows - 1 );
+      const qint32 tileIndex = row * level.columns + column;
+
+      QByteArray record;
+      QDataStream recordStream( &record, QIODevice::WriteOnly );
+      recordStream.setVersion( QDataStream::Qt_5_0 );
+      recordStream << generalized;
+
+      *spillStreams[z] << tileIndex << record;
+
+      QgsVectorLayerTileCacheTile &tile = level.tiles[tileIndex];
+      if ( tile.featureCount == 0 )
+        tile.extent = bbox;
+      else
+        tile.extent.combineExtentWith( bbox );
+      tile.size += record.size();
+      tile.featureCount++;
+    }
+  }
+
+  // tiles are stored level by level, in tile order
+  qint64 offset = 0;
+  for ( QgsVectorLayerTileCacheLevel &level : levels )
+  {
+    for ( QgsVectorLayerTileCacheTile &tile : level.tiles )
+    {
+      tile.offset = offset;
+      offset += tile.size;
+    }
+  }
+
+  QSaveFile out( filePath() );
+  if ( !out.open( QIODevice::WriteOnly ) )
+  {
+    mErrorMessage = QObject::tr( "Could not write cache file %1" ).arg( out.fileName() );
+    return false;
+  }
+
+  QDataStream header( &out );
+  header.setVersion( QDataStream::Qt_5_0 );
+  header << TILE_CACHE_MAGIC << TILE_CACHE_VERSION << cacheKey << provider->fields() << mLayer->crs().toWkt()
+         << extent.xMinimum() << extent.yMinimum() << extent.xMaximum() << extent.yMaximum()
+         << static_cast< qint32 >( levels.size() );
+  for ( const QgsVectorLayerTileCacheLevel &level : qgsAsConst( levels ) )
+  {
+    header << level.tolerance << static_cast< qint32 >( level.columns ) << static_cast< qint32 >( level.rows );
+    for ( const QgsVectorLayerTileCacheTile &tile : level.tiles )
+    {
+      header << tile.extent.xMinimum() << tile.extent.yMinimum() << tile.extent.xMaximum() << tile.extent.yMaximum()
+             << tile.offset << tile.size << static_cast< qint32 >( tile.featureCount );
+    }
+  }
+  const qint64 dataStart = out.pos();
+
+  // scatter the spilled records into their tiles, through small per tile buffers
+  for ( int z = 0; z < levels.size(); ++z )
+  {
+    const QgsVectorLayerTileCacheLevel &level = levels.at( z );
+    QVector<qint64> tileWritePos( level.tiles.size() );
+    for ( int i = 0; i < level.tiles.size(); ++i )
+      tileWritePos[i] = dataStart + level.tiles.at( i ).offset;
+    QVector<QByteArray> tileBuffers( level.tiles.size() );
+
+    auto flushTile = [&out, &tileWritePos, &tileBuffers]( int tileIndex ) -> bool
+    {
+      QByteArray &buffer = tileBuffers[tileIndex];
+      if ( buffer.isEmpty() )
+        return true;
+      if ( !out.seek( tileWritePos.at( tileIndex ) ) || out.write( buffer ) != buffer.size() )
+        return false;
+      tileWritePos[tileIndex] += buffer.size();
+      buffer.clear();
+      return true;
+    };
+
+    QTemporaryFile *spillFile = spillFiles[z].get();
+    spillFile->flush();
+    spillFile->seek( 0 );
+    QDataStream spill( spillFile );
+    spill.setVersion( QDataStream::Qt_5_0 );
+
+    bool ok = true;
+    while ( ok && !spill.atEnd() )
+    {
+      qint32 tileIndex;
+      QByteArray record;
+      spill >> tileIndex >> record;
+      if ( spill.status() != QDataStream::Ok || tileIndex < 0 || tileIndex >= tileBuffers.size() )
+      {
+        ok = false;
+        break;
+      }
+
+      tileBuffers[tileIndex].append( record );
+      if ( tileBuffers.at( tileIndex ).size() >= TILE_WRITE_BUFFER_SIZE )
+        ok = flushTile( tileIndex );
+    }
+
+    for ( int i = 0; ok && i < tileBuffers.size(); ++i )
+      ok = flushTile( i );
+
+    if ( !ok )
+    {
+      out.cancelWriting();
+      mErrorMessage = QObject::tr( "Could not write cache file %1" ).arg( out.fileName() );
+      return false;
+    }
+
+    if ( feedback )
+      feedback->setProgress( 90.0 + 10.0 * ( z + 1 ) / levels.size() );
+  }
+
+  // release the previous cache file before replacing it
+  mData.reset();
+
+  if ( !out.commit() )
+  {
+    mErrorMessage = QObject::tr( "Could not write cache file %1" ).arg( out.fileName() );
+    return false;
+  }
+
+  mData = QgsVectorLayerTileCacheData::open( filePath(), cacheKey );
+  if ( !mData )
+  {
+    mErrorMessage = QObject::tr( "Could not read cache file %1" ).arg( filePath() );
+    return false;
+  }
+
+  QgsDebugMsgLevel( QString( "Built tile cache %1 for layer %2" ).arg( filePath(), mLayer->id() ), 2 );
+  return true;
+}
@@ -0,0 +1,153 @@
+/***************************************************************************
+  qgsvectorlayertilecache.h
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSVECTORLAYERTILECACHE_H
+#define QGSVECTORLAYERTILECACHE_H
+
+#include "qgis_core.h"
+#include "qgis_sip.h"
+#include "qgsfeatureiterator.h"
+#include "qgsfeaturerequest.h"
+
+#include <QString>
+#include <memory>
+
+class QgsFeedback;
+class QgsVectorLayer;
+class QgsVectorLayerTileCacheData;
+class QgsVectorLayerTileCacheFeatureSource;
+
+/**
+ * \ingroup core
+ * A file based cache of pre-generalized features, used to speed up the rendering
+ * of large static vector layers at small scales.
+ *
+ * The cache holds a pyramid of levels. Level 0 covers the layer extent with a single
+ * tile of 256 pixels, and each following level doubles the number of tile columns and rows.
+ * Features are simplified with the layer's simplification settings at the resolution of
+ * each level and stored in the tile containing the center of their bounding box.
+ *
+ * The cache is written to a single file in the cache directory, keyed by the layer's id, provider,
+ * source, subset string, data revision and simplification settings. The data revision is the
+ * modification time and size of the file holding the data, or the feature count and extent of
+ * sources which are not files. Changes keeping them unchanged require calling build() again.
+ * Memory layers cannot be cached.
+ *
+ * \see QgsVectorLayer::setRenderingTileCache()
+ * \since QGIS 3.0
+ */
+class CORE_EXPORT QgsVectorLayerTileCache
+{
+  public:
+
+    /**
+     * Constructor for QgsVectorLayerTileCache, for the specified \a layer. Cache files
+     * are stored in \a directory. An existing cache file matching the layer is used
+     * without building it again.
+     */
+    QgsVectorLayerTileCache( QgsVectorLayer *layer, const QString &directory );
+
+    ~QgsVectorLayerTileCache();
+
+    //! QgsVectorLayerTileCache cannot be copied
+    QgsVectorLayerTileCache( const QgsVectorLayerTileCache &rh ) = delete;
+    //! QgsVectorLayerTileCache cannot be copied
+    QgsVectorLayerTileCache &operator=( const QgsVectorLayerTileCache &rh ) = delete;
+
+    /**
+     * Returns the directory containing the cache files.
+     */
+    QString directory() const { return mDirectory; }
+
+    /**
+     * Returns the path of the cache file matching the current layer settings.
+     */
+    QString filePath() const;
+
+    /**
+     * Returns the number of levels created by build().
+     * \see setLevelCount()
+     */
+    int levelCount() const { return mLevelCount; }
+
+    /**
+     * Sets the number of levels created by build(), between 1 and 12. Takes effect on the next build.
+     * \see levelCount()
+     */
+    void setLevelCount( int count );
+
+    /**
+     * Builds the cache from all features of the layer's data provider, replacing
+     * any existing cache file. The optional \a feedback can be used to report progress
+     * and cancel the build. Returns false if the cache could not be built, see errorMessage().
+     */
+    bool build( QgsFeedback *feedback = nullptr );
+
+    /**
+     * Returns true if the cache has been built for the current layer settings.
+     */
+    bool isValid() const;
+
+    /**
+     * Removes the cache file matching the current layer settings.
+     */
+    void clear();
+
+    /**
+     * Returns the simplification tolerance, in layer units, of the specified \a level,
+     * or -1 if the cache is not valid.
+     */
+    double levelTolerance( int level ) const;
+
+    /**
+     * Returns the coarsest level whose geometries are at least as detailed as required by a
+     * simplification \a tolerance in layer units, or -1 if no level is detailed enough.
+     */
+    int levelForTolerance( double tolerance ) const;
+
+    /**
+     * Returns an iterator over the generalized features stored at a \a level, matching the \a request.
+     */
+    QgsFeatureIterator getFeatures( int level, const QgsFeatureRequest &request = QgsFeatureRequest() ) const;
+
+    /**
+     * Returns the message of the last error which occurred while building the cache.
+     */
+    QString errorMessage() const { return mErrorMessage; }
+
+    /**
+     * Creates a feature source for the cache, which can be used from another thread.
+     * Returns nullptr if the cache is not valid. The caller takes ownership.
+     * \note not available in Python bindings
+     */
+    QgsVectorLayerTileCacheFeatureSource *createFeatureSource() const SIP_SKIP;
+
+  private:
+#ifdef SIP_RUN
+    QgsVectorLayerTileCache( const QgsVectorLayerTileCache &rh );
+#endif
+
+    QString key() const;
+    QString dataRevision() const;
+    std::shared_ptr< QgsVectorLayerTileCacheData > data() const;
+
+    QgsVectorLayer *mLayer = nullptr;
+    QString mDirectory;
+    int mLevelCount = 6;
+    QString mErrorMessage;
+
+    mutable std::shared_ptr< QgsVectorLayerTileCacheData > mData;
+};
+
+#endif // QGSVECTORLAYERTILECACHE_H
@@ -0,0 +1,139 @@
+/***************************************************************************
+  qgsvectorlayertilecache_p.h
+  --------------------------------------
+  Date                 : October 2017
+  Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSVECTORLAYERTILECACHE_P_H
+#define QGSVECTORLAYERTILECACHE_P_H
+
+#define SIP_NO_FILE
+
+#include "qgsfeatureiterator.h"
+#include "qgscoordinatereferencesystem.h"
+#include "qgscoordinatetransform.h"
+#include "qgsfields.h"
+#include "qgsgeometry.h"
+#include "qgsrectangle.h"
+
+#include <QCache>
+#include <QFile>
+#include <QMutex>
+#include <QVector>
+#include <memory>
+
+///@cond PRIVATE
+
+//! A tile of a level of the cache
+struct QgsVectorLayerTileCacheTile
+{
+  //! Union of the bounding boxes of the features in the tile
+  QgsRectangle extent;
+  //! Offset of the tile data, from the start of the data section
+  qint64 offset = 0;
+  //! Size of the tile data in bytes
+  qint64 size = 0;
+  int featureCount = 0;
+};
+
+//! A level of the cache, covering the cache extent with a grid of tiles
+struct QgsVectorLayerTileCacheLevel
+{
+  //! Simplification tolerance in layer units
+  double tolerance = 0;
+  int columns = 0;
+  int rows = 0;
+  QVector<QgsVectorLayerTileCacheTile> tiles;
+};
+
+/**
+ * The contents of an opened cache file. It is shared between the cache and its feature
+ * sources, and can be read from several threads.
+ */
+class QgsVectorLayerTileCacheData
+{
+  public:
+
+    /**
+     * Opens the cache file at \a filePath. Returns nullptr if the file does not exist,
+     * cannot be read or was not written for \a key.
+     */
+    static std::shared_ptr< QgsVectorLayerTileCacheData > open( const QString &filePath, const QString &key );
+
+    //! Returns the coarsest level at least as detailed as \a tolerance, or -1
+    int levelForTolerance( double tolerance ) const;
+
+    //! Returns the features stored in a \a tile of a \a level, reading them from the cache file if needed
+    QgsFeatureList tileFeatures( int level, int tile );
+
+    QString key;
+    QgsFields fields;
+    QgsCoordinateReferenceSystem crs;
+    QgsRectangle extent;
+    QVector<QgsVectorLayerTileCacheLevel> levels;
+
+  private:
+    QgsVectorLayerTileCacheData() = default;
+
+    QMutex mMutex;
+    QFile mFile;
+    qint64 mDataStart = 0;
+    //! Recently read tiles, keyed by level and tile index
+    QCache<qint64, QgsFeatureList> mTiles;
+};
+
+class QgsVectorLayerTileCacheFeatureSource : public QgsAbstractFeatureSource
+{
+  public:
+    QgsVectorLayerTileCacheFeatureSource( const std::shared_ptr< QgsVectorLayerTileCacheData > &data, int level = -1 );
+
+    //! Returns the coarsest level at least as detailed as \a tolerance, or -1
+    int levelForTolerance( double tolerance ) const;
+
+    //! Sets the level read by the iterators of the source
+    void setLevel( int level ) { mLevel = level; }
+
+    virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest &request ) override;
+
+  private:
+    std::shared_ptr< QgsVectorLayerTileCacheData > mData;
+    int mLevel = -1;
+
+    friend class QgsVectorLayerTileCacheFeatureIterator;
+};
+
+class QgsVectorLayerTileCacheFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsVectorLayerTileCacheFeatureSource>
+{
+  public:
+    QgsVectorLayerTileCacheFeatureIterator( QgsVectorLayerTileCacheFeatureSource *source, bool ownSource, const QgsFeatureRequest &request );
+
+    ~QgsVectorLayerTileCacheFeatureIterator();
+
+    virtual bool rewind() override;
+    virtual bool close() override;
+
+  protected:
+
+    virtual bool fetchFeature( QgsFeature &feature ) override;
+
+  private:
+    QgsRectangle mFilterRect;
+    QgsGeometry mSelectRectGeom;
+    QgsCoordinateTransform mTransform;
+    QList<int> mTileIds;
+    int mTileIndex = 0;
+    QgsFeatureList mTileFeatures;
+    int mFeatureIndex = 0;
+};
+
+///@endcond PRIVATE
+
+#endif // QGSVECTORLAYERTILECACHE_P_H
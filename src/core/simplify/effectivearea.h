@@ -72,7 +72,8 @@ struct MINHEAP
  */
 struct EFFECTIVE_AREAS
 {
-  EFFECTIVE_AREAS( const QgsCurve &curve )
+  template<class T>
+  EFFECTIVE_AREAS( const T &curve )
     : is3d( curve.is3D() )
   {
     curve.points( inpts );
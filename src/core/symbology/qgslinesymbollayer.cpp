@@ -804,11 +804,14 @@ void QgsMarkerLineSymbolLayer::startRender( QgsSymbolRenderContext &context )
   mMarker->setRenderHints( hints );
 
   mMarker->startRender( context.renderContext(), context.fields() );
+
+  mExpressionScope.reset( new QgsExpressionContextScope() );
 }
 
 void QgsMarkerLineSymbolLayer::stopRender( QgsSymbolRenderContext &context )
 {
   mMarker->stopRender( context.renderContext() );
+  mExpressionScope.reset();
 }
 
 void QgsMarkerLineSymbolLayer::renderPolyline( const QPolygonF &points, QgsSymbolRenderContext &context )
@@ -928,8 +931,13 @@ void QgsMarkerLineSymbolLayer::renderPolylineInterval( const QPolygonF &points,
   QgsRenderContext &rc = context.renderContext();
   double interval = mInterval;
 
-  QgsExpressionContextScope *scope = new QgsExpressionContextScope();
-  context.renderContext().expressionContext().appendScope( scope );
+  // the scope is reused for all lines, so the variables set for the previous line are removed.
+  // The point number is overwritten before each marker is rendered, it is only removed when
+  // expressions are evaluated before, so that variable handles stay valid from line to line
+  mExpressionScope->removeVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_COUNT );
+  if ( mDataDefinedProperties.isActive( QgsSymbolLayer::PropertyInterval ) || mDataDefinedProperties.isActive( QgsSymbolLayer::PropertyOffsetAlongLine ) )
+    mExpressionScope->removeVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM );
+  context.renderContext().expressionContext().appendScope( mExpressionScope.get() );
 
   if ( mDataDefinedProperties.isActive( QgsSymbolLayer::PropertyInterval ) )
   {
@@ -981,7 +989,7 @@ void QgsMarkerLineSymbolLayer::renderPolylineInterval( const QPolygonF &points,
       // "c" is 1 for regular point or in interval (0,1] for begin of line segment
       lastPt += c * diff;
       lengthLeft -= painterUnitInterval;
-      scope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM, ++pointNum, true ) );
+      mExpressionScope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM, ++pointNum, true ) );
       mMarker->renderPoint( lastPt, context.feature(), rc, -1, context.selected() );
       c = 1; // reset c (if wasn't 1 already)
     }
@@ -989,7 +997,7 @@ void QgsMarkerLineSymbolLayer::renderPolylineInterval( const QPolygonF &points,
     lastPt = pt;
   }
 
-  delete context.renderContext().expressionContext().popScope();
+  context.renderContext().expressionContext().popScope();
 }
 
 static double _averageAngle( QPointF prevPt, QPointF pt, QPointF nextPt )
@@ -1013,13 +1021,14 @@ void QgsMarkerLineSymbolLayer::renderPolylineVertex( const QPolygonF &points, Qg
   int i, maxCount;
   bool isRing = false;
 
-  QgsExpressionContextScope *scope = new QgsExpressionContextScope();
-  context.renderContext().expressionContext().appendScope( scope );
-  scope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_COUNT, points.size(), true ) );
+  context.renderContext().expressionContext().appendScope( mExpressionScope.get() );
+  mExpressionScope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_COUNT, points.size(), true ) );
 
   double offsetAlongLine = mOffsetAlongLine;
   if ( mDataDefinedProperties.isActive( QgsSymbolLayer::PropertyOffsetAlongLine ) )
   {
+    // the point number of the previous line must not be visible
+    mExpressionScope->removeVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM );
     context.setOriginalValueVariable( mOffsetAlongLine );
     offsetAlongLine = mDataDefinedProperties.valueAsDouble( QgsSymbolLayer::PropertyOffsetAlongLine, context.renderContext().expressionContext(), mOffsetAlongLine );
   }
@@ -1042,7 +1051,7 @@ void QgsMarkerLineSymbolLayer::renderPolylineVertex( const QPolygonF &points, Qg
     int pointNum = 0;
     while ( context.renderContext().geometry()->nextVertex( vId, vPoint ) )
     {
-      scope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM, ++pointNum, true ) );
+      mExpressionScope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM, ++pointNum, true ) );
 
       if ( ( placement == Vertex && vId.type == QgsVertexId::SegmentVertex )
            || ( placement == CurvePoint && vId.type == QgsVertexId::CurveVertex ) )
@@ -1066,7 +1075,7 @@ void QgsMarkerLineSymbolLayer::renderPolylineVertex( const QPolygonF &points, Qg
       }
     }
 
-    delete context.renderContext().expressionContext().popScope();
+    context.renderContext().expressionContext().popScope();
     return;
   }
 
@@ -1089,26 +1098,28 @@ void QgsMarkerLineSymbolLayer::renderPolylineVertex( const QPolygonF &points, Qg
   }
   else
   {
-    delete context.renderContext().expressionContext().popScope();
+    context.renderContext().expressionContext().popScope();
     return;
   }
 
   if ( offsetAlongLine > 0 && ( placement == FirstVertex || placement == LastVertex ) )
   {
+    // markers rendered along the line have no point number
+    mExpressionScope->removeVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM );
     double distance;
     distance = placement == FirstVertex ? offsetAlongLine : -offsetAlongLine;
     renderOffsetVertexAlongLine( points, i, distance, context );
     // restore original rotation
     mMarker->setAngle( origAngle );
 
-    delete context.renderContext().expressionContext().popScope();
+    context.renderContext().expressionContext().popScope();
     return;
   }
 
   int pointNum = 0;
   for ( ; i < maxCount; ++i )
   {
-    scope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM, ++pointNum, true ) );
+    mExpressionScope->addVariable( QgsExpressionContextScope::StaticVariable( QgsExpressionContext::EXPR_GEOMETRY_POINT_NUM, ++pointNum, true ) );
 
     if ( isRing && placement == Vertex && i == points.count() - 1 )
     {
@@ -1127,7 +1138,7 @@ void QgsMarkerLineSymbolLayer::renderPolylineVertex( const QPolygonF &points, Qg
   // restore original rotation
   mMarker->setAngle( origAngle );
 
-  delete context.renderContext().expressionContext().popScope();
+  context.renderContext().expressionContext().popScope();
 }
 
 double QgsMarkerLineSymbolLayer::markerAngle( const QPolygonF &points, bool isRing, int vertex )
@@ -366,6 +366,9 @@ class CORE_EXPORT QgsMarkerLineSymbolLayer : public QgsLineSymbolLayer
     QgsMarkerLineSymbolLayer( const QgsMarkerLineSymbolLayer &other );
 #endif
 
+    //! Scope for the point variables, reused for all the lines rendered between startRender() and stopRender()
+    std::unique_ptr< QgsExpressionContextScope > mExpressionScope;
+
     /**
      * Renders a marker by offsetting a vertex along the line by a specified distance.
      * \param points vertices making up the line
@@ -18,14 +18,13 @@
 #include "qgspointdistancerenderer.h"
 #include "qgsgeometry.h"
 #include "qgssymbollayerutils.h"
-#include "qgsspatialindex.h"
-#include "qgsmultipoint.h"
 #include "qgslogger.h"
 
 #include <QDomElement>
 #include <QPainter>
 
 #include <cmath>
+#include <limits>
 
 QgsPointDistanceRenderer::QgsPointDistanceRenderer( const QString &rendererName, const QString &labelAttributeName )
   : QgsFeatureRenderer( rendererName )
@@ -89,48 +88,66 @@ bool QgsPointDistanceRenderer::renderFeature( QgsFeature &feature, QgsRenderCont
     transformedFeature.setGeometry( geom );
   }
 
-  double searchDistance = context.convertToMapUnits( mTolerance, mToleranceUnit, mToleranceMapUnitScale );
   QgsPointXY point = transformedFeature.geometry().asPoint();
-  QList<QgsFeatureId> intersectList = mSpatialIndex->intersects( searchRect( point, searchDistance ) );
-  if ( intersectList.empty() )
+  if ( !std::isfinite( point.x() ) || !std::isfinite( point.y() ) )
+    return false;
+
+  // symbols are cloned once per render and shared by all the features using them
+  std::shared_ptr< QgsMarkerSymbol > &symbolClone = mSymbolClones[ symbol ];
+  if ( !symbolClone )
+    symbolClone.reset( symbol->clone() );
+
+  // find group with closest location to this point (may be more than one within search tolerance)
+  const QgsRectangle rect = searchRect( point, mSearchDistance );
+  const QPair< qint64, qint64 > minCell = gridCell( rect.xMinimum(), rect.yMinimum() );
+  const QPair< qint64, qint64 > maxCell = gridCell( rect.xMaximum(), rect.yMaximum() );
+  int groupIdx = -1;
+  double minDist = std::numeric_limits< double >::max();
+  for ( qint64 column = minCell.first; column <= maxCell.first; ++column )
+  {
+    for ( qint64 row = minCell.second; row <= maxCell.second; ++row )
+    {
+      const auto cellIt = mGroupGrid.constFind( qMakePair( column, row ) );
+      if ( cellIt == mGroupGrid.constEnd() )
+        continue;
+
+      for ( int candidateIdx : cellIt.value() )
+      {
+        if ( !rect.contains( mGroupSeeds.at( candidateIdx ) ) )
+          continue;
+
+        double newDist = mGroupLocations.at( candidateIdx ).distance( point );
+        if ( newDist < minDist )
+        {
+          minDist = newDist;
+          groupIdx = candidateIdx;
+        }
+      }
+    }
+  }
+
+  if ( groupIdx < 0 )
   {
-    mSpatialIndex->insertFeature( transformedFeature );
     // create new group
     ClusteredGroup newGroup;
-    newGroup << GroupedFeature( transformedFeature, symbol->clone(), selected, label );
+    newGroup << GroupedFeature( transformedFeature, symbolClone, selected, label );
     mClusteredGroups.push_back( newGroup );
-    // add to group index
-    mGroupIndex.insert( transformedFeature.id(), mClusteredGroups.count() - 1 );
-    mGroupLocations.insert( transformedFeature.id(), point );
+    groupIdx = mClusteredGroups.count() - 1;
+    mGroupSeeds.push_back( point );
+    mGroupLocations.push_back( point );
+    mGroupGrid[ gridCell( point.x(), point.y() )].push_back( groupIdx );
   }
   else
   {
-    // find group with closest location to this point (may be more than one within search tolerance)
-    QgsFeatureId minDistFeatureId = intersectList.at( 0 );
-    double minDist = mGroupLocations.value( minDistFeatureId ).distance( point );
-    for ( int i = 1; i < intersectList.count(); ++i )
-    {
-      QgsFeatureId candidateId = intersectList.at( i );
-      double newDist = mGroupLocations.value( candidateId ).distance( point );
-      if ( newDist < minDist )
-      {
-        minDist = newDist;
-        minDistFeatureId = candidateId;
-      }
-    }
-
-    int groupIdx = mGroupIndex[ minDistFeatureId ];
     ClusteredGroup &group = mClusteredGroups[groupIdx];
 
     // calculate new centroid of group
-    QgsPointXY oldCenter = mGroupLocations.value( minDistFeatureId );
-    mGroupLocations[ minDistFeatureId ] = QgsPointXY( ( oldCenter.x() * group.size() + point.x() ) / ( group.size() + 1.0 ),
-                                          ( oldCenter.y() * group.size() + point.y() ) / ( group.size() + 1.0 ) );
+    QgsPointXY oldCenter = mGroupLocations.at( groupIdx );
+    mGroupLocations[ groupIdx ] = QgsPointXY( ( oldCenter.x() * group.size() + point.x() ) / ( group.size() + 1.0 ),
+                                  ( oldCenter.y() * group.size() + point.y() ) / ( group.size() + 1.0 ) );
 
     // add to a group
-    group << GroupedFeature( transformedFeature, symbol->clone(), selected, label );
-    // add to group index
-    mGroupIndex.insert( transformedFeature.id(), groupIdx );
+    group << GroupedFeature( transformedFeature, symbolClone, selected, label );
   }
 
   return true;
@@ -139,14 +156,15 @@ bool QgsPointDistanceRenderer::renderFeature( QgsFeature &feature, QgsRenderCont
 void QgsPointDistanceRenderer::drawGroup( const ClusteredGroup &group, QgsRenderContext &context )
 {
   //calculate centroid of all points, this will be center of group
-  QgsMultiPointV2 *groupMultiPoint = new QgsMultiPointV2();
+  double sumX = 0;
+  double sumY = 0;
   Q_FOREACH ( const GroupedFeature &f, group )
   {
-    groupMultiPoint->addGeometry( f.feature.geometry().geometry()->clone() );
+    const QgsPointXY point = f.feature.geometry().asPoint();
+    sumX += point.x();
+    sumY += point.y();
   }
-  QgsGeometry groupGeom( groupMultiPoint );
-  QgsGeometry centroid = groupGeom.centroid();
-  QPointF pt = centroid.asQPointF();
+  QPointF pt( sumX / group.size(), sumY / group.size() );
   context.mapToPixel().transformInPlace( pt.rx(), pt.ry() );
 
   context.expressionContext().appendScope( createGroupScope( group ) );
@@ -290,9 +308,11 @@ void QgsPointDistanceRenderer::startRender( QgsRenderContext &context, const Qgs
   mRenderer->startRender( context, fields );
 
   mClusteredGroups.clear();
-  mGroupIndex.clear();
+  mGroupSeeds.clear();
   mGroupLocations.clear();
-  mSpatialIndex = new QgsSpatialIndex;
+  mGroupGrid.clear();
+  mSymbolClones.clear();
+  mSearchDistance = context.convertToMapUnits( mTolerance, mToleranceUnit, mToleranceMapUnitScale );
 
   if ( mLabelAttributeName.isEmpty() )
   {
@@ -323,10 +343,10 @@ void QgsPointDistanceRenderer::stopRender( QgsRenderContext &context )
   }
 
   mClusteredGroups.clear();
-  mGroupIndex.clear();
+  mGroupSeeds.clear();
   mGroupLocations.clear();
-  delete mSpatialIndex;
-  mSpatialIndex = nullptr;
+  mGroupGrid.clear();
+  mSymbolClones.clear();
 
   mRenderer->stopRender( context );
 }
@@ -345,6 +365,13 @@ QgsRectangle QgsPointDistanceRenderer::searchRect( const QgsPointXY &p, double d
   return QgsRectangle( p.x() - distance, p.y() - distance, p.x() + distance, p.y() + distance );
 }
 
+QPair< qint64, qint64 > QgsPointDistanceRenderer::gridCell( double x, double y ) const
+{
+  // cells are sized to the search distance, so a search rectangle overlaps at most 3x3 cells
+  const double cellSize = mSearchDistance > 0 ? mSearchDistance : 1.0;
+  return qMakePair( static_cast< qint64 >( std::floor( x / cellSize ) ), static_cast< qint64 >( std::floor( y / cellSize ) ) );
+}
+
 void QgsPointDistanceRenderer::printGroupInfo() const
 {
 #ifdef QGISDEBUG
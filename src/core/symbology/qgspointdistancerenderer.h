@@ -22,8 +22,8 @@
 #include "qgis.h"
 #include "qgsrenderer.h"
 #include <QFont>
-
-class QgsSpatialIndex;
+#include <QHash>
+#include <QVector>
 
 /**
  * \class QgsPointDistanceRenderer
@@ -57,6 +57,22 @@ class CORE_EXPORT QgsPointDistanceRenderer: public QgsFeatureRenderer
           , mSymbol( symbol )
         {}
 
+        /**
+         * Constructor for GroupedFeature, with a \a symbol which may be shared
+         * with other grouped features.
+         * \param feature feature
+         * \param symbol base symbol for rendering feature
+         * \param isSelected set to true if feature is selected and should be rendered in a selected state
+         * \param label optional label text, or empty string for no label
+         * \note not available in Python bindings
+         */
+        GroupedFeature( const QgsFeature &feature, const std::shared_ptr< QgsMarkerSymbol > &symbol, bool isSelected, const QString &label = QString() ) SIP_SKIP
+          : feature( feature )
+          , isSelected( isSelected )
+          , label( label )
+          , mSymbol( symbol )
+        {}
+
         //! Feature
         QgsFeature feature;
 
@@ -256,14 +272,24 @@ class CORE_EXPORT QgsPointDistanceRenderer: public QgsFeatureRenderer
     //! Groups of features that are considered clustered together.
     QList<ClusteredGroup> mClusteredGroups;
 
-    //! Mapping of feature ID to the feature's group index.
-    QMap<QgsFeatureId, int> mGroupIndex;
+    //! Location of the first point of each group, by group index.
+    QVector< QgsPointXY > mGroupSeeds;
+
+    //! Approximate location (centroid) of each group, by group index.
+    QVector< QgsPointXY > mGroupLocations;
+
+    /**
+     * Regular grid of cells sized to the search distance, used for fast lookup
+     * of the groups with a first point near a location. Contains the indexes of
+     * the groups by cell.
+     */
+    QHash< QPair< qint64, qint64 >, QVector< int > > mGroupGrid;
 
-    //! Mapping of feature ID to approximate group location
-    QMap<QgsFeatureId, QgsPointXY > mGroupLocations;
+    //! Distance tolerance in map units, calculated in startRender().
+    double mSearchDistance = 0;
 
-    //! Spatial index for fast lookup of nearby points.
-    QgsSpatialIndex *mSpatialIndex = nullptr;
+    //! Clones of the embedded renderer symbols, shared between the grouped features.
+    QHash< QgsMarkerSymbol *, std::shared_ptr< QgsMarkerSymbol > > mSymbolClones;
 
     /**
      * Renders the labels for a group.
@@ -288,6 +314,9 @@ class CORE_EXPORT QgsPointDistanceRenderer: public QgsFeatureRenderer
     //! Creates a search rectangle with specified distance tolerance.
     QgsRectangle searchRect( const QgsPointXY &p, double distance ) const;
 
+    //! Returns the grid cell containing a location
+    QPair< qint64, qint64 > gridCell( double x, double y ) const;
+
     //! Debugging function to check the entries in the clustered groups
     void printGroupInfo() const;
 
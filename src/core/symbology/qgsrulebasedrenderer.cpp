@@ -393,7 +393,7 @@ bool QgsRuleBasedRenderer::Rule::startRender( QgsRenderContext &context, const Q
 
   // init this rule
   if ( mFilter )
-    mFilter->prepare( &context.expressionContext() );
+    mFilter->compile( &context.expressionContext() );
   if ( mSymbol )
     mSymbol->startRender( context, fields );
 
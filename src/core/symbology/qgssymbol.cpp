@@ -108,16 +108,32 @@ QPolygonF QgsSymbol::_getLineString( QgsRenderContext &context, const QgsCurve &
   QPolygonF pts;
 
   //apply clipping for large lines to achieve a better rendering performance
+  //(lines completely within the clip rectangle are left untouched by clipping)
+  bool clip = false;
+  QgsRectangle clipRect;
   if ( clipToExtent && nPoints > 1 )
   {
     const QgsRectangle &e = context.extent();
     const double cw = e.width() / 10;
     const double ch = e.height() / 10;
-    const QgsRectangle clipRect( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
+    clipRect = QgsRectangle( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
+    clip = !clipRect.contains( curve.boundingBox() );
+  }
+
+  if ( clip )
+  {
     pts = QgsClipper::clippedLine( curve, clipRect );
   }
   else
   {
+    const QgsLineString *line = qgsgeometry_cast< const QgsLineString * >( &curve );
+    if ( line && !ct.isValid() )
+    {
+      //transform the line string vertices straight into screen coordinates
+      pts.resize( nPoints );
+      mtp.transformCoordinates( line->xData(), line->yData(), nPoints, pts.data() );
+      return pts;
+    }
     pts = curve.asQPolygonF();
   }
 
@@ -127,11 +143,7 @@ QPolygonF QgsSymbol::_getLineString( QgsRenderContext &context, const QgsCurve &
     ct.transformPolygon( pts );
   }
 
-  QPointF *ptr = pts.data();
-  for ( int i = 0; i < pts.size(); ++i, ++ptr )
-  {
-    mtp.transformInPlace( ptr->rx(), ptr->ry() );
-  }
+  mtp.transformInPlace( pts );
 
   return pts;
 }
@@ -145,14 +157,25 @@ QPolygonF QgsSymbol::_getPolygonRing( QgsRenderContext &context, const QgsCurve
   const double ch = e.height() / 10;
   QgsRectangle clipRect( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
 
-  QPolygonF poly = curve.asQPolygonF();
-
-  if ( curve.numPoints() < 1 )
+  const int nPoints = curve.numPoints();
+  if ( nPoints < 1 )
     return QPolygonF();
 
   //clip close to view extent, if needed
-  const QRectF ptsRect = poly.boundingRect();
-  if ( clipToExtent && !context.extent().contains( ptsRect ) )
+  const bool clip = clipToExtent && !context.extent().contains( curve.boundingBox() );
+
+  const QgsLineString *line = qgsgeometry_cast< const QgsLineString * >( &curve );
+  if ( !clip && line && !ct.isValid() )
+  {
+    //transform the ring vertices straight into screen coordinates
+    QPolygonF poly( nPoints );
+    mtp.transformCoordinates( line->xData(), line->yData(), nPoints, poly.data() );
+    return poly;
+  }
+
+  QPolygonF poly = curve.asQPolygonF();
+
+  if ( clip )
   {
     QgsClipper::trimPolygon( poly, clipRect );
   }
@@ -163,11 +186,7 @@ QPolygonF QgsSymbol::_getPolygonRing( QgsRenderContext &context, const QgsCurve
     ct.transformPolygon( poly );
   }
 
-  QPointF *ptr = poly.data();
-  for ( int i = 0; i < poly.size(); ++i, ++ptr )
-  {
-    mtp.transformInPlace( ptr->rx(), ptr->ry() );
-  }
+  mtp.transformInPlace( poly );
 
   return poly;
 }
@@ -19,6 +19,8 @@
 #include "geometry/qgsgeometry.h"
 #include "qgsexception.h"
 
+#include <algorithm>
+
 QgsAfsFeatureSource::QgsAfsFeatureSource( const std::shared_ptr<QgsAfsSharedData> &sharedData )
   : mSharedData( sharedData )
 {
@@ -53,6 +55,22 @@ QgsAfsFeatureIterator::QgsAfsFeatureIterator( QgsAfsFeatureSource *source, bool
     mClosed = true;
     return;
   }
+
+  if ( mRequest.filterType() == QgsFeatureRequest::FilterFids )
+  {
+    mFeatureIds = mRequest.filterFids().toList();
+    std::sort( mFeatureIds.begin(), mFeatureIds.end() );
+    mUseFeatureIds = true;
+  }
+  else if ( mRequest.filterType() != QgsFeatureRequest::FilterFid && !mFilterRect.isNull() )
+  {
+    // Only download the features in the requested extent
+    const QgsRectangle extent = mSource->sharedData()->extent().intersect( &mFilterRect );
+    bool ok = true;
+    if ( !extent.isNull() )
+      mFeatureIds = mSource->sharedData()->getFeatureIdsInExtent( extent, ok );
+    mUseFeatureIds = ok;
+  }
 }
 
 QgsAfsFeatureIterator::~QgsAfsFeatureIterator()
@@ -65,22 +83,13 @@ bool QgsAfsFeatureIterator::fetchFeature( QgsFeature &f )
   if ( mClosed )
     return false;
 
-  if ( mFeatureIterator >= mSource->sharedData()->featureCount() )
-    return false;
-
-  bool fetchGeometries = ( mRequest.flags() & QgsFeatureRequest::NoGeometry ) == 0;
-  QgsAttributeList fetchAttribures;
-  if ( ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes ) != 0 )
-    fetchAttribures = mRequest.subsetOfAttributes();
-  else
-  {
-    for ( int i = 0; i < mSource->sharedData()->fields().size(); ++i )
-      fetchAttribures.append( i );
-  }
-
   if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
-    bool result = mSource->sharedData()->getFeature( mRequest.filterFid(), f, fetchGeometries, fetchAttribures );
+    if ( mFeatureIterator > 0 )
+      return false;
+
+    mFeatureIterator = 1;
+    bool result = mSource->sharedData()->getFeature( mRequest.filterFid(), f );
     geometryToDestinationCrs( f, mTransform );
     return result;
   }
@@ -89,9 +98,13 @@ bool QgsAfsFeatureIterator::fetchFeature( QgsFeature &f )
     QgsRectangle filterRect = mSource->sharedData()->extent();
     if ( !mRequest.filterRect().isNull() )
       filterRect = filterRect.intersect( &mFilterRect );
-    while ( mFeatureIterator < mSource->sharedData()->featureCount() )
+    const QgsFeatureId featureCount = mUseFeatureIds ? mFeatureIds.size() : mSource->sharedData()->featureCount();
+    while ( mFeatureIterator < featureCount )
     {
-      bool success = mSource->sharedData()->getFeature( mFeatureIterator, f, fetchGeometries, fetchAttribures, filterRect );
+      const QgsFeatureId id = mUseFeatureIds ? mFeatureIds.at( mFeatureIterator ) : mFeatureIterator;
+      // on a cache miss, the following features are downloaded at the same time
+      const bool cached = mSource->sharedData()->isCached( id );
+      bool success = mSource->sharedData()->getFeature( id, f, filterRect, cached ? QList<QgsFeatureId>() : prefetchIds() );
       ++mFeatureIterator;
       if ( !success )
         continue;
@@ -102,6 +115,20 @@ bool QgsAfsFeatureIterator::fetchFeature( QgsFeature &f )
   return false;
 }
 
+QList<QgsFeatureId> QgsAfsFeatureIterator::prefetchIds() const
+{
+  const int prefetchSize = mSource->sharedData()->prefetchSize();
+  if ( mUseFeatureIds )
+    return mFeatureIds.mid( mFeatureIterator, prefetchSize );
+
+  QList<QgsFeatureId> ids;
+  const QgsFeatureId end = std::min<QgsFeatureId>( mFeatureIterator + prefetchSize, mSource->sharedData()->featureCount() );
+  ids.reserve( end - mFeatureIterator );
+  for ( QgsFeatureId id = mFeatureIterator; id < end; ++id )
+    ids.append( id );
+  return ids;
+}
+
 bool QgsAfsFeatureIterator::rewind()
 {
   if ( mClosed )
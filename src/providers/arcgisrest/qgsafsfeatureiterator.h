@@ -51,6 +51,13 @@ class QgsAfsFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsAfs
     QgsFeatureId mFeatureIterator = 0;
     QgsCoordinateTransform mTransform;
     QgsRectangle mFilterRect;
+
+    //! Ids of the features to iterate, when not iterating over all features
+    QList<QgsFeatureId> mFeatureIds;
+    bool mUseFeatureIds = false;
+
+    //! Returns the ids of the features following the current one, which are downloaded together
+    QList<QgsFeatureId> prefetchIds() const;
 };
 
 #endif // QGSAFSFEATUREITERATOR_H
@@ -148,11 +148,19 @@ QgsAfsProvider::QgsAfsProvider( const QString &uri )
       break;
     }
   }
+  mSharedData->mObjectIdFieldIdx = mObjectIdFieldIdx;
   foreach ( const QVariant &objectId, objectIdData["objectIds"].toList() )
   {
+    mSharedData->mObjectIdToFeatureId.insert( objectId.toInt(), mSharedData->mObjectIds.size() );
     mSharedData->mObjectIds.append( objectId.toInt() );
   }
 
+  // Features are downloaded in pages of the maximum number of records returned by the service
+  bool pageSizeOk = false;
+  int pageSize = layerData[QStringLiteral( "maxRecordCount" )].toInt( &pageSizeOk );
+  if ( pageSizeOk && pageSize > 0 )
+    mSharedData->mPageSize = std::min( pageSize, 1000 );
+
   mValid = true;
 }
 
@@ -199,7 +207,7 @@ QgsRectangle QgsAfsProvider::extent() const
 
 void QgsAfsProvider::reloadData()
 {
-  mSharedData->mCache.clear();
+  mSharedData->clearCache();
 }
 
 
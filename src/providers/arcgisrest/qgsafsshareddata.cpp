@@ -17,97 +17,224 @@
 #include "qgsarcgisrestutils.h"
 #include "qgslogger.h"
 
-bool QgsAfsSharedData::getFeature( QgsFeatureId id, QgsFeature &f, bool fetchGeometry, const QList<int> & /*fetchAttributes*/, const QgsRectangle &filterRect )
+#include <QEventLoop>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+
+//! Maximum number of features kept in the cache
+static const int AFS_CACHE_SIZE = 100000;
+//! Maximum number of regions whose feature ids are kept
+static const int AFS_MAX_REGIONS = 32;
+
+QgsAfsSharedData::QgsAfsSharedData()
 {
-  // If cached, return cached feature
-  QMap<QgsFeatureId, QgsFeature>::const_iterator it = mCache.constFind( id );
-  if ( it != mCache.constEnd() )
+  mCache.setMaxCost( AFS_CACHE_SIZE );
+}
+
+void QgsAfsSharedData::clearCache()
+{
+  QMutexLocker locker( &mMutex );
+  mCache.clear();
+  mRegions.clear();
+}
+
+QList<QgsFeatureId> QgsAfsSharedData::getFeatureIdsInExtent( const QgsRectangle &extent, bool &ok )
+{
+  ok = true;
+  QMutexLocker locker( &mMutex );
+
+  // Reuse the ids of a region containing the extent
+  for ( int i = 0; i < mRegions.size(); ++i )
   {
-    f = it.value();
-    return filterRect.isNull() || f.geometry().intersects( filterRect );
+    if ( mRegions.at( i ).extent.contains( extent ) )
+    {
+      if ( i > 0 )
+        mRegions.move( i, 0 );
+      return mRegions.at( 0 ).ids;
+    }
   }
 
-  // Determine attributes to fetch
-  /*QStringList fetchAttribNames;
-  foreach ( int idx, fetchAttributes )
-    fetchAttribNames.append( mFields.at( idx ).name() );
-  */
+  // The query runs a nested event loop, during which other iterators of the layer may use the cache
+  locker.unlock();
+  QString errorTitle, errorMessage;
+  QVariantMap objectIdData = QgsArcGisRestUtils::getObjectIdsByExtent( mDataSource.param( QStringLiteral( "url" ) ), extent,
+                             mDataSource.param( QStringLiteral( "crs" ) ), errorTitle, errorMessage );
+  if ( objectIdData.isEmpty() )
+  {
+    QgsDebugMsg( QString( "Query returned empty result: %1 - %2" ).arg( errorTitle, errorMessage ) );
+    ok = false;
+    return QList<QgsFeatureId>();
+  }
 
-  // When fetching from server, fetch all attributes and geometry by default so that we can cache them
-  QStringList fetchAttribNames;
-  QList<int> fetchAttribIdx;
-  fetchAttribIdx.reserve( mFields.size() );
-  for ( int idx = 0, n = mFields.size(); idx < n; ++idx )
+  Region region;
+  region.extent = extent;
+  const QVariantList objectIds = objectIdData[QStringLiteral( "objectIds" )].toList();
+  region.ids.reserve( objectIds.size() );
+  for ( const QVariant &objectId : objectIds )
   {
-    fetchAttribNames.append( mFields.at( idx ).name() );
-    fetchAttribIdx.append( idx );
+    QHash<quint32, QgsFeatureId>::const_iterator it = mObjectIdToFeatureId.constFind( objectId.toInt() );
+    if ( it != mObjectIdToFeatureId.constEnd() )
+      region.ids.append( it.value() );
   }
-  fetchGeometry = true;
-
-  // Fetch 100 features at the time
-  int startId = ( id / 100 ) * 100;
-  int stopId = std::min( startId + 100, mObjectIds.length() );
-  QList<quint32> objectIds;
-  objectIds.reserve( stopId );
-  for ( int i = startId; i < stopId; ++i )
+  std::sort( region.ids.begin(), region.ids.end() );
+
+  locker.relock();
+  mRegions.prepend( region );
+  while ( mRegions.size() > AFS_MAX_REGIONS )
+    mRegions.removeLast();
+
+  return region.ids;
+}
+
+bool QgsAfsSharedData::isCached( QgsFeatureId id )
+{
+  QMutexLocker locker( &mMutex );
+  return mCache.contains( id );
+}
+
+bool QgsAfsSharedData::getFeature( QgsFeatureId id, QgsFeature &f, const QgsRectangle &filterRect, const QList<QgsFeatureId> &prefetchIds )
+{
+  QMutexLocker locker( &mMutex );
+
+  // If cached, return cached feature
+  if ( QgsFeature *cached = mCache.object( id ) )
   {
-    objectIds.append( mObjectIds[i] );
+    f = *cached;
+    return filterRect.isNull() || ( f.hasGeometry() && f.geometry().intersects( filterRect ) );
   }
 
+  // Download the requested feature along with the uncached features which will be requested next
+  QList<QgsFeatureId> ids;
+  ids.reserve( prefetchIds.size() + 1 );
+  ids.append( id );
+  for ( QgsFeatureId prefetchId : prefetchIds )
+  {
+    if ( prefetchId != id && !mCache.contains( prefetchId ) )
+      ids.append( prefetchId );
+  }
 
-  // Query
-  QString errorTitle, errorMessage;
-  QVariantMap queryData = QgsArcGisRestUtils::getObjects(
-                            mDataSource.param( QStringLiteral( "url" ) ), objectIds, mDataSource.param( QStringLiteral( "crs" ) ), fetchGeometry,
-                            fetchAttribNames, QgsWkbTypes::hasM( mGeometryType ), QgsWkbTypes::hasZ( mGeometryType ),
-                            filterRect, errorTitle, errorMessage );
-  if ( queryData.isEmpty() )
+  // The download runs a nested event loop, during which other iterators of the layer may use the cache
+  locker.unlock();
+  const QgsFeatureMap features = downloadFeatures( ids );
+
+  locker.relock();
+  for ( QgsFeatureMap::const_iterator it = features.constBegin(); it != features.constEnd(); ++it )
   {
-//    const_cast<QgsAfsProvider *>( this )->pushError( errorTitle + ": " + errorMessage );
-    QgsDebugMsg( "Query returned empty result" );
-    return false;
+    mCache.insert( it.key(), new QgsFeature( it.value() ) );
   }
 
-  QVariantList featuresData = queryData[QStringLiteral( "features" )].toList();
-  if ( featuresData.isEmpty() )
+  QgsFeatureMap::const_iterator it = features.constFind( id );
+  if ( it == features.constEnd() )
   {
     QgsDebugMsg( "Query returned no features" );
     return false;
   }
-  for ( int i = 0, n = featuresData.size(); i < n; ++i )
+
+  f = it.value();
+  Q_ASSERT( f.isValid() );
+  return filterRect.isNull() || ( f.hasGeometry() && f.geometry().intersects( filterRect ) );
+}
+
+QgsFeatureMap QgsAfsSharedData::downloadFeatures( const QList<QgsFeatureId> &ids )
+{
+  // When fetching from server, fetch all attributes and geometry by default so that we can cache them
+  QStringList fetchAttribNames;
+  fetchAttribNames.reserve( mFields.size() );
+  for ( int idx = 0, n = mFields.size(); idx < n; ++idx )
+    fetchAttribNames.append( mFields.at( idx ).name() );
+
+  // One query per page of features, all issued at once
+  QVector<QUrl> queries;
+  QVector< QList<QgsFeatureId> > pageIds;
+  for ( int start = 0; start < ids.size(); start += mPageSize )
   {
-    QVariantMap featureData = featuresData[i].toMap();
-    QgsFeature feature;
+    QList<quint32> objectIds;
+    QList<QgsFeatureId> page = ids.mid( start, mPageSize );
+    objectIds.reserve( page.size() );
+    for ( QgsFeatureId id : qgsAsConst( page ) )
+    {
+      if ( id >= 0 && id < mObjectIds.size() )
+        objectIds.append( mObjectIds.at( id ) );
+    }
+    if ( objectIds.isEmpty() )
+      continue;
+
+    queries.append( QgsArcGisRestUtils::getObjectsUrl( mDataSource.param( QStringLiteral( "url" ) ), objectIds, mDataSource.param( QStringLiteral( "crs" ) ), true,
+                    fetchAttribNames, QgsWkbTypes::hasM( mGeometryType ), QgsWkbTypes::hasZ( mGeometryType ), QgsRectangle() ) );
+    pageIds.append( page );
+  }
 
-    // Set FID
-    feature.setId( startId + i );
+  QgsFeatureMap features;
+  if ( queries.isEmpty() )
+    return features;
 
-    // Set attributes
-    if ( !fetchAttribIdx.isEmpty() )
+  QVector<QByteArray> results( queries.size() );
+  QgsArcGisAsyncParallelQuery query;
+  QEventLoop evLoop;
+  QObject::connect( &query, &QgsArcGisAsyncParallelQuery::finished, &evLoop, &QEventLoop::quit );
+  query.start( queries, &results );
+  evLoop.exec( QEventLoop::ExcludeUserInputEvents );
+
+  for ( int page = 0; page < results.size(); ++page )
+  {
+    QJsonParseError err;
+    QJsonDocument doc = QJsonDocument::fromJson( results.at( page ), &err );
+    if ( doc.isNull() )
     {
-      QVariantMap attributesData = featureData[QStringLiteral( "attributes" )].toMap();
-      feature.setFields( mFields );
-      QgsAttributes attributes( mFields.size() );
-      foreach ( int idx, fetchAttribIdx )
-      {
-        attributes[idx] = attributesData[mFields.at( idx ).name()];
-      }
-      feature.setAttributes( attributes );
+      QgsDebugMsg( QString( "Parsing error: %1" ).arg( err.errorString() ) );
+      continue;
     }
 
-    // Set geometry
-    if ( fetchGeometry )
+    const QVariantMap queryData = doc.object().toVariantMap();
+    const QString esriGeometryType = queryData[QStringLiteral( "geometryType" )].toString();
+    const QVariantList featuresData = queryData[QStringLiteral( "features" )].toList();
+    const QList<QgsFeatureId> &requestedIds = pageIds.at( page );
+    for ( int i = 0, n = featuresData.size(); i < n; ++i )
     {
-      QVariantMap geometryData = featureData[QStringLiteral( "geometry" )].toMap();
-      QgsAbstractGeometry *geometry = QgsArcGisRestUtils::parseEsriGeoJSON( geometryData, queryData[QStringLiteral( "geometryType" )].toString(),
-                                      QgsWkbTypes::hasM( mGeometryType ), QgsWkbTypes::hasZ( mGeometryType ) );
-      // Above might return 0, which is OK since in theory empty geometries are allowed
-      feature.setGeometry( QgsGeometry( geometry ) );
+      const QgsFeature feature = parseFeature( featuresData[i].toMap(), esriGeometryType, i < requestedIds.size() ? requestedIds.at( i ) : FID_NULL );
+      if ( feature.id() != FID_NULL )
+        features.insert( feature.id(), feature );
     }
-    feature.setValid( true );
-    mCache.insert( feature.id(), feature );
   }
-  f = mCache[id];
-  Q_ASSERT( f.isValid() );
-  return filterRect.isNull() || ( f.hasGeometry() && f.geometry().intersects( filterRect ) );
+  return features;
+}
+
+QgsFeature QgsAfsSharedData::parseFeature( const QVariantMap &featureData, const QString &esriGeometryType, QgsFeatureId defaultId ) const
+{
+  QgsFeature feature;
+  feature.setId( defaultId );
+
+  // Set attributes
+  QVariantMap attributesData = featureData[QStringLiteral( "attributes" )].toMap();
+  feature.setFields( mFields );
+  QgsAttributes attributes( mFields.size() );
+  for ( int idx = 0, n = mFields.size(); idx < n; ++idx )
+  {
+    attributes[idx] = attributesData[mFields.at( idx ).name()];
+  }
+  feature.setAttributes( attributes );
+
+  // Set FID from the object id, features are not necessarily returned in the requested order
+  if ( mObjectIdFieldIdx >= 0 )
+  {
+    bool ok = false;
+    const quint32 objectId = attributes.at( mObjectIdFieldIdx ).toUInt( &ok );
+    if ( ok )
+    {
+      QHash<quint32, QgsFeatureId>::const_iterator it = mObjectIdToFeatureId.constFind( objectId );
+      if ( it != mObjectIdToFeatureId.constEnd() )
+        feature.setId( it.value() );
+    }
+  }
+
+  // Set geometry
+  QVariantMap geometryData = featureData[QStringLiteral( "geometry" )].toMap();
+  QgsAbstractGeometry *geometry = QgsArcGisRestUtils::parseEsriGeoJSON( geometryData, esriGeometryType,
+                                  QgsWkbTypes::hasM( mGeometryType ), QgsWkbTypes::hasZ( mGeometryType ) );
+  // Above might return 0, which is OK since in theory empty geometries are allowed
+  feature.setGeometry( QgsGeometry( geometry ) );
+  feature.setValid( true );
+  return feature;
 }
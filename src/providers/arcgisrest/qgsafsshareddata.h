@@ -17,6 +17,9 @@
 #define QGSAFSSHAREDDATA_H
 
 #include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
 #include "qgsfields.h"
 #include "qgsfeature.h"
 #include "qgsdatasourceuri.h"
@@ -28,23 +31,71 @@ class QgsAfsSharedData : public QObject
 {
     Q_OBJECT
   public:
-    QgsAfsSharedData() = default;
+    QgsAfsSharedData();
     long featureCount() const { return mObjectIds.size(); }
     const QgsFields &fields() const { return mFields; }
     QgsRectangle extent() const { return mExtent; }
     QgsCoordinateReferenceSystem crs() const { return mSourceCRS; }
 
-    bool getFeature( QgsFeatureId id, QgsFeature &f, bool fetchGeometry, const QList<int> &fetchAttributes, const QgsRectangle &filterRect = QgsRectangle() );
+    /**
+     * Returns the feature with the given \a id, from the cache or from the server. On a cache miss,
+     * the uncached features of \a prefetchIds are downloaded along with the requested feature.
+     */
+    bool getFeature( QgsFeatureId id, QgsFeature &f, const QgsRectangle &filterRect = QgsRectangle(), const QList<QgsFeatureId> &prefetchIds = QList<QgsFeatureId>() );
+
+    /**
+     * Returns the ids of the features whose envelope intersects \a extent, in ascending order.
+     * The server is only queried when the extent is not contained in a region queried before.
+     */
+    QList<QgsFeatureId> getFeatureIdsInExtent( const QgsRectangle &extent, bool &ok );
+
+    //! Returns true if the feature with the given \a id is in the cache
+    bool isCached( QgsFeatureId id );
+
+    //! Returns the number of features downloaded together by getFeature()
+    int prefetchSize() const { return mPageSize * PARALLEL_PAGES; }
+
+    //! Discards the cached features and downloaded regions
+    void clearCache();
 
   private:
     friend class QgsAfsProvider;
+
+    //! Number of pages downloaded concurrently
+    static const int PARALLEL_PAGES = 4;
+
+    //! A region of the layer for which the ids of all the features have been downloaded
+    struct Region
+    {
+      QgsRectangle extent;
+      QList<QgsFeatureId> ids;
+    };
+
+    /**
+     * Downloads the features with the given ids, in concurrent pages, and returns them.
+     * The download runs a nested event loop, the mutex must not be locked when calling it.
+     */
+    QgsFeatureMap downloadFeatures( const QList<QgsFeatureId> &ids );
+
+    QgsFeature parseFeature( const QVariantMap &featureData, const QString &esriGeometryType, QgsFeatureId defaultId ) const;
+
     QgsDataSourceUri mDataSource;
     QgsRectangle mExtent;
     QgsWkbTypes::Type mGeometryType = QgsWkbTypes::Unknown;
     QgsFields mFields;
+    int mObjectIdFieldIdx = -1;
+    //! Maximum number of features returned by a query of the server
+    int mPageSize = 100;
     QList<quint32> mObjectIds;
-    QMap<QgsFeatureId, QgsFeature> mCache;
+    //! Feature ids of the object ids
+    QHash<quint32, QgsFeatureId> mObjectIdToFeatureId;
     QgsCoordinateReferenceSystem mSourceCRS;
+
+    QMutex mMutex;
+    //! Recently used features
+    QCache<QgsFeatureId, QgsFeature> mCache;
+    //! Recently queried regions, most recent first
+    QList<Region> mRegions;
 };
 
 #endif
@@ -374,11 +374,37 @@ QVariantMap QgsArcGisRestUtils::getObjectIds( const QString &layerurl, QString &
   return queryServiceJSON( queryUrl, errorTitle, errorText );
 }
 
+QVariantMap QgsArcGisRestUtils::getObjectIdsByExtent( const QString &layerurl, const QgsRectangle &filterRect, const QString &crs, QString &errorTitle, QString &errorText )
+{
+  // http://sampleserver5.arcgisonline.com/arcgis/rest/services/Energy/Geology/FeatureServer/1/query?returnIdsOnly=true&geometry=-12,32,-11,33&geometryType=esriGeometryEnvelope&spatialRel=esriSpatialRelEnvelopeIntersects&f=json
+  QUrl queryUrl( layerurl + "/query" );
+  queryUrl.addQueryItem( QStringLiteral( "f" ), QStringLiteral( "json" ) );
+  queryUrl.addQueryItem( QStringLiteral( "where" ), QStringLiteral( "objectid=objectid" ) );
+  queryUrl.addQueryItem( QStringLiteral( "returnIdsOnly" ), QStringLiteral( "true" ) );
+  QString wkid = crs.indexOf( QLatin1String( ":" ) ) >= 0 ? crs.split( QStringLiteral( ":" ) )[1] : QLatin1String( "" );
+  queryUrl.addQueryItem( QStringLiteral( "inSR" ), wkid );
+  queryUrl.addQueryItem( QStringLiteral( "geometry" ), QStringLiteral( "%1,%2,%3,%4" )
+                         .arg( filterRect.xMinimum(), 0, 'f', -1 ).arg( filterRect.yMinimum(), 0, 'f', -1 )
+                         .arg( filterRect.xMaximum(), 0, 'f', -1 ).arg( filterRect.yMaximum(), 0, 'f', -1 ) );
+  queryUrl.addQueryItem( QStringLiteral( "geometryType" ), QStringLiteral( "esriGeometryEnvelope" ) );
+  queryUrl.addQueryItem( QStringLiteral( "spatialRel" ), QStringLiteral( "esriSpatialRelEnvelopeIntersects" ) );
+  return queryServiceJSON( queryUrl, errorTitle, errorText );
+}
+
 QVariantMap QgsArcGisRestUtils::getObjects( const QString &layerurl, const QList<quint32> &objectIds, const QString &crs,
     bool fetchGeometry, const QStringList &fetchAttributes,
     bool fetchM, bool fetchZ,
     const QgsRectangle &filterRect,
     QString &errorTitle, QString &errorText )
+{
+  QUrl queryUrl = getObjectsUrl( layerurl, objectIds, crs, fetchGeometry, fetchAttributes, fetchM, fetchZ, filterRect );
+  return queryServiceJSON( queryUrl, errorTitle, errorText );
+}
+
+QUrl QgsArcGisRestUtils::getObjectsUrl( const QString &layerurl, const QList<quint32> &objectIds, const QString &crs,
+                                        bool fetchGeometry, const QStringList &fetchAttributes,
+                                        bool fetchM, bool fetchZ,
+                                        const QgsRectangle &filterRect )
 {
   QStringList ids;
   foreach ( int id, objectIds )
@@ -412,7 +438,7 @@ QVariantMap QgsArcGisRestUtils::getObjects( const QString &layerurl, const QList
     queryUrl.addQueryItem( QStringLiteral( "geometryType" ), QStringLiteral( "esriGeometryEnvelope" ) );
     queryUrl.addQueryItem( QStringLiteral( "spatialRel" ), QStringLiteral( "esriSpatialRelEnvelopeIntersects" ) );
   }
-  return queryServiceJSON( queryUrl, errorTitle, errorText );
+  return queryUrl;
 }
 
 QByteArray QgsArcGisRestUtils::queryService( const QUrl &url, QString &errorTitle, QString &errorText )
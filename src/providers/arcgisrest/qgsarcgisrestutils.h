@@ -17,6 +17,7 @@
 
 #include <QStringList>
 #include <QVariant>
+#include <QUrl>
 #include "geometry/qgswkbtypes.h"
 
 class QNetworkReply;
@@ -37,9 +38,13 @@ class QgsArcGisRestUtils
     static QVariantMap getServiceInfo( const QString &baseurl, QString &errorTitle, QString &errorText );
     static QVariantMap getLayerInfo( const QString &layerurl, QString &errorTitle, QString &errorText );
     static QVariantMap getObjectIds( const QString &layerurl, QString &errorTitle, QString &errorText );
+    static QVariantMap getObjectIdsByExtent( const QString &layerurl, const QgsRectangle &filterRect, const QString &crs, QString &errorTitle, QString &errorText );
     static QVariantMap getObjects( const QString &layerurl, const QList<quint32> &objectIds, const QString &crs,
                                    bool fetchGeometry, const QStringList &fetchAttributes, bool fetchM, bool fetchZ,
                                    const QgsRectangle &filterRect, QString &errorTitle, QString &errorText );
+    static QUrl getObjectsUrl( const QString &layerurl, const QList<quint32> &objectIds, const QString &crs,
+                               bool fetchGeometry, const QStringList &fetchAttributes, bool fetchM, bool fetchZ,
+                               const QgsRectangle &filterRect );
     static QByteArray queryService( const QUrl &url, QString &errorTitle, QString &errorText );
     static QVariantMap queryServiceJSON( const QUrl &url, QString &errorTitle, QString &errorText );
 };
@@ -30,6 +30,10 @@
 #include <QTextCodec>
 #include <QFile>
 
+// Maximum number of ids pushed to OGR as an attribute filter when reading
+// features by id from a subset
+static const int MAX_FILTER_FIDS_IN_CLAUSE = 10000;
+
 // using from provider:
 // - setRelevantFields(), mRelevantFieldsForNextFeature
 // - ogrLayer
@@ -140,8 +144,37 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource *source, bool
     OGR_L_SetSpatialFilter( ogrLayer, nullptr );
   }
 
-  if ( request.filterType() == QgsFeatureRequest::FilterExpression
-       && QgsSettings().value( QStringLiteral( "qgis/compileExpressions" ), true ).toBool() )
+  if ( mOrigFidAdded && ( request.filterType() == QgsFeatureRequest::FilterFid || request.filterType() == QgsFeatureRequest::FilterFids ) )
+  {
+    // the features of a subset can only be reached by reading the result set, so
+    // the requested ids are read in a single pass instead of one pass per id
+    mScanFilterFids = true;
+    if ( request.filterType() == QgsFeatureRequest::FilterFid )
+    {
+      mFilterFids = QgsFeatureIds() << request.filterFid();
+    }
+
+    // let OGR skip the other features when the id list is reasonably short
+    OGR_L_SetAttributeFilter( ogrLayer, nullptr );
+    OGRFeatureDefnH fdef = OGR_L_GetLayerDefn( ogrLayer );
+    int lastField = OGR_FD_GetFieldCount( fdef ) - 1;
+    if ( lastField >= 0 && !mFilterFids.isEmpty() && mFilterFids.count() <= MAX_FILTER_FIDS_IN_CLAUSE )
+    {
+      QStringList ids;
+      Q_FOREACH ( QgsFeatureId id, mFilterFids )
+      {
+        ids << QString::number( id );
+      }
+      QByteArray origFidColumn = QgsOgrProviderUtils::quotedIdentifier( OGR_Fld_GetNameRef( OGR_FD_GetFieldDefn( fdef, lastField ) ), mSource->mDriverName );
+      QByteArray whereClause = origFidColumn + " IN (" + ids.join( ',' ).toLatin1() + ')';
+      if ( OGR_L_SetAttributeFilter( ogrLayer, whereClause.constData() ) != OGRERR_NONE )
+      {
+        OGR_L_SetAttributeFilter( ogrLayer, nullptr );
+      }
+    }
+  }
+  else if ( request.filterType() == QgsFeatureRequest::FilterExpression
+            && QgsSettings().value( QStringLiteral( "qgis/compileExpressions" ), true ).toBool() )
   {
     QgsSqlExpressionCompiler *compiler = nullptr;
     if ( source->mDriverName == QLatin1String( "SQLite" ) || source->mDriverName == QLatin1String( "GPKG" ) )
@@ -197,29 +230,7 @@ bool QgsOgrFeatureIterator::nextFeatureFilterExpression( QgsFeature &f )
 bool QgsOgrFeatureIterator::fetchFeatureWithId( QgsFeatureId id, QgsFeature &feature ) const
 {
   feature.setValid( false );
-  OGRFeatureH fet = 0;
-  if ( mOrigFidAdded )
-  {
-    OGR_L_ResetReading( ogrLayer );
-    OGRFeatureDefnH fdef = OGR_L_GetLayerDefn( ogrLayer );
-    int lastField = OGR_FD_GetFieldCount( fdef ) - 1;
-    if ( lastField >= 0 )
-    {
-      while ( ( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
-      {
-        if ( OGR_F_GetFieldAsInteger64( fet, lastField ) == id )
-        {
-          break;
-        }
-        OGR_F_Destroy( fet );
-      }
-    }
-  }
-  else
-  {
-    fet = OGR_L_GetFeature( ogrLayer, FID_TO_NUMBER( id ) );
-  }
-
+  OGRFeatureH fet = OGR_L_GetFeature( ogrLayer, FID_TO_NUMBER( id ) );
   if ( !fet )
   {
     return false;
@@ -240,7 +251,15 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature &feature )
   if ( mClosed || !ogrLayer )
     return false;
 
-  if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
+  if ( mScanFilterFids )
+  {
+    if ( mFilterFidsFound == mFilterFids.count() )
+    {
+      close();
+      return false;
+    }
+  }
+  else if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
     bool result = fetchFeatureWithId( mRequest.filterFid(), feature );
     close(); // the feature has been read or was not found: we have finished here
@@ -272,6 +291,14 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature &feature )
     if ( !mFilterRect.isNull() && !feature.hasGeometry() )
       continue;
 
+    if ( mScanFilterFids )
+    {
+      if ( !mFilterFids.contains( feature.id() ) )
+        continue;
+
+      ++mFilterFidsFound;
+    }
+
     // we have a feature, end this cycle
     feature.setValid( true );
     geometryToDestinationCrs( feature, mTransform );
@@ -292,6 +319,7 @@ bool QgsOgrFeatureIterator::rewind()
   OGR_L_ResetReading( ogrLayer );
 
   mFilterFidsIt = mFilterFids.constBegin();
+  mFilterFidsFound = 0;
 
   return true;
 }
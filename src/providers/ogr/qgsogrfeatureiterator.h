@@ -84,6 +84,11 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
     QgsFeatureIds mFilterFids;
     QgsFeatureIds::const_iterator mFilterFidsIt;
 
+    //! True if the requested ids are read with a single pass on the subset result set
+    bool mScanFilterFids = false;
+    //! Number of requested ids found while scanning the subset result set
+    int mFilterFidsFound = 0;
+
     QgsRectangle mFilterRect;
     QgsCoordinateTransform mTransform;
 
@@ -32,6 +32,7 @@
 #include <QProgressDialog>
 #include <QTimer>
 #include <QStyle>
+#include <QtConcurrentRun>
 
 QgsWFSFeatureHitsAsyncRequest::QgsWFSFeatureHitsAsyncRequest( QgsWFSDataSourceURI &uri )
   : QgsWfsRequest( uri.uri() )
@@ -75,6 +76,85 @@ QString QgsWFSFeatureHitsAsyncRequest::errorMessageWithReason( const QString &re
 
 // -------------------------
 
+QgsWFSFeaturePageRequest::QgsWFSFeaturePageRequest( QgsWFSSharedData *shared )
+  : QgsWfsRequest( shared->mURI.uri() )
+  , mParser( shared->createParser() )
+{
+  connect( this, &QgsWfsRequest::downloadFinished, this, &QgsWFSFeaturePageRequest::pageReplyFinished );
+  connect( &mParsing, &QFutureWatcher<bool>::finished, this, &QgsWFSFeaturePageRequest::pageParsed );
+}
+
+QgsWFSFeaturePageRequest::~QgsWFSFeaturePageRequest()
+{
+  // The parser must not be destroyed while the worker thread uses it
+  mParsing.waitForFinished();
+}
+
+void QgsWFSFeaturePageRequest::launch( const QUrl &url )
+{
+  if ( !sendGET( url,
+                 false, /* synchronous */
+                 true, /* forceRefresh */
+                 false /* cache */ ) )
+  {
+    mReady = true;
+  }
+}
+
+void QgsWFSFeaturePageRequest::pageReplyFinished()
+{
+  if ( mErrorCode == NoError )
+  {
+    mParsing.setFuture( QtConcurrent::run( parsePage, this ) );
+  }
+  else
+  {
+    mReady = true;
+    emit pageReady();
+  }
+}
+
+bool QgsWFSFeaturePageRequest::parsePage( QgsWFSFeaturePageRequest *page )
+{
+  return page->mParser->processData( page->mResponse, true, page->mParseErrorMsg );
+}
+
+void QgsWFSFeaturePageRequest::pageParsed()
+{
+  mParseOk = mParsing.result();
+  mResponse.clear();
+  mReady = true;
+  emit pageReady();
+}
+
+bool QgsWFSFeaturePageRequest::isValid() const
+{
+  return mReady && mErrorCode == NoError && mParseOk && !mParser->isException();
+}
+
+QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> QgsWFSFeaturePageRequest::getAndStealReadyFeatures()
+{
+  return mParser->getAndStealReadyFeatures();
+}
+
+QString QgsWFSFeaturePageRequest::pageErrorMessage() const
+{
+  if ( mErrorCode != NoError )
+    return mErrorMessage;
+  if ( !mParseOk )
+    return tr( "Error when parsing GetFeature response" ) + " : " + mParseErrorMsg;
+  if ( mParser->isException() )
+    return tr( "Server generated an exception in GetFeature response" ) + ": " + mParser->exceptionText();
+  return QString();
+}
+
+QString QgsWFSFeaturePageRequest::errorMessageWithReason( const QString &reason )
+{
+  return tr( "Download of features failed: %1" ).arg( reason );
+}
+
+// -------------------------
+
 QgsWFSFeatureDownloader::QgsWFSFeatureDownloader( QgsWFSSharedData *shared )
   : QgsWfsRequest( shared->mURI.uri() )
   , mShared( shared )
@@ -431,6 +511,8 @@ void QgsWFSFeatureDownloader::run( bool serializeFeatures, int maxFeatures )
   int pagingIter = 1;
   QString gmlIdFirstFeatureFirstIter;
   bool disablePaging = false;
+  const int concurrentRequests = s.value( QStringLiteral( "wfs/max_concurrent_page_requests" ), "4" ).toInt();
+  bool concurrentDownloadFailed = false;
   while ( true )
   {
     success = true;
@@ -592,62 +674,20 @@ void QgsWFSFeatureDownloader::run( bool serializeFeatures, int maxFeatures )
           }
         }
 
-        QVector<QgsWFSFeatureGmlIdPair> featureList;
-        for ( int i = 0; i < featurePtrList.size(); i++ )
-        {
-          QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair &featPair = featurePtrList[i];
-          QgsFeature &f = *( featPair.first );
-          QString gmlId( featPair.second );
-          if ( gmlId.isEmpty() )
-          {
-            // Should normally not happen on sane WFS sources, but can happen with
-            // Geomedia
-            gmlId = QgsWFSUtils::getMD5( f );
-            if ( !mShared->mHasWarnedAboutMissingFeatureId )
-            {
-              QgsDebugMsg( "Server returns features without fid/gml:id. Computing a fake one using feature attributes" );
-              mShared->mHasWarnedAboutMissingFeatureId = true;
-            }
-          }
-          if ( pagingIter == 1 && featureCountForThisResponse == 0 )
-          {
-            gmlIdFirstFeatureFirstIter = gmlId;
-          }
-          else if ( pagingIter == 2 && featureCountForThisResponse == 0 && gmlIdFirstFeatureFirstIter == gmlId )
-          {
-            disablePaging = true;
-            QgsDebugMsg( "Server does not seem to properly support paging since it returned the same first feature for 2 different page requests. Disabling paging" );
-          }
-
-          if ( mShared->mGetFeatureEPSGDotHonoursEPSGOrder && f.hasGeometry() )
-          {
-            QgsGeometry g = f.geometry();
-            g.transform( QTransform( 0, 1, 1, 0, 0, 0 ) );
-            f.setGeometry( g );
-          }
-
-          featureList.push_back( QgsWFSFeatureGmlIdPair( f, gmlId ) );
-          delete featPair.first;
-          if ( ( i > 0 && ( i % 1000 ) == 0 ) || i + 1 == featurePtrList.size() )
-          {
-            // We call it directly to avoid asynchronous signal notification, and
-            // as serializeFeatures() can modify the featureList to remove features
-            // that have already been cached, so as to avoid to notify them several
-            // times to subscribers
-            if ( serializeFeatures )
-              mShared->serializeFeatures( featureList );
-
-            if ( !featureList.isEmpty() )
-            {
-              emit featureReceived( featureList );
-              emit featureReceived( featureList.size() );
-            }
-
-            featureList.clear();
-          }
+        QString firstGmlId;
+        processFeatures( featurePtrList, serializeFeatures, &firstGmlId );
 
-          featureCountForThisResponse ++;
+        if ( pagingIter == 1 && featureCountForThisResponse == 0 )
+        {
+          gmlIdFirstFeatureFirstIter = firstGmlId;
+        }
+        else if ( pagingIter == 2 && featureCountForThisResponse == 0 && gmlIdFirstFeatureFirstIter == firstGmlId )
+        {
+          disablePaging = true;
+          QgsDebugMsg( "Server does not seem to properly support paging since it returned the same first feature for 2 different page requests. Disabling paging" );
         }
+
+        featureCountForThisResponse += featurePtrList.size();
       }
 
       if ( finished )
@@ -698,6 +738,25 @@ void QgsWFSFeatureDownloader::run( bool serializeFeatures, int maxFeatures )
         mShared->mMaxFeatures = 0;
       }
     }
+
+    // Once the first two pages have shown that the server properly supports
+    // paging, the next pages are requested concurrently
+    if ( mSupportsPaging && pagingIter > 2 && maxFeatures == 0 && mShared->mMaxFeatures > 0 &&
+         concurrentRequests > 1 && !concurrentDownloadFailed )
+    {
+      if ( downloadPagesConcurrently( serializeFeatures, concurrentRequests ) )
+        break;
+      if ( mStop )
+      {
+        interrupted = true;
+        success = false;
+        break;
+      }
+      // Go on with sequential requests from the first page that could not be
+      // processed, so that it benefits from the retry logic
+      concurrentDownloadFailed = true;
+      lastValidTotalDownloadedFeatureCount = mTotalDownloadedFeatureCount;
+    }
   }
 
   mStop = true;
@@ -729,6 +788,125 @@ void QgsWFSFeatureDownloader::run( bool serializeFeatures, int maxFeatures )
   mFeatureHitsAsyncRequest.abort();
 }
 
+void QgsWFSFeatureDownloader::processFeatures( QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> &featurePtrList,
+    bool serializeFeatures, QString *firstGmlId )
+{
+  QVector<QgsWFSFeatureGmlIdPair> featureList;
+  for ( int i = 0; i < featurePtrList.size(); i++ )
+  {
+    QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair &featPair = featurePtrList[i];
+    QgsFeature &f = *( featPair.first );
+    QString gmlId( featPair.second );
+    if ( gmlId.isEmpty() )
+    {
+      // Should normally not happen on sane WFS sources, but can happen with
+      // Geomedia
+      gmlId = QgsWFSUtils::getMD5( f );
+      if ( !mShared->mHasWarnedAboutMissingFeatureId )
+      {
+        QgsDebugMsg( "Server returns features without fid/gml:id. Computing a fake one using feature attributes" );
+        mShared->mHasWarnedAboutMissingFeatureId = true;
+      }
+    }
+    if ( i == 0 && firstGmlId )
+      *firstGmlId = gmlId;
+
+    if ( mShared->mGetFeatureEPSGDotHonoursEPSGOrder && f.hasGeometry() )
+    {
+      QgsGeometry g = f.geometry();
+      g.transform( QTransform( 0, 1, 1, 0, 0, 0 ) );
+      f.setGeometry( g );
+    }
+
+    featureList.push_back( QgsWFSFeatureGmlIdPair( f, gmlId ) );
+    delete featPair.first;
+    if ( ( i > 0 && ( i % 1000 ) == 0 ) || i + 1 == featurePtrList.size() )
+    {
+      // We call it directly to avoid asynchronous signal notification, and
+      // as serializeFeatures() can modify the featureList to remove features
+      // that have already been cached, so as to avoid to notify them several
+      // times to subscribers
+      if ( serializeFeatures )
+        mShared->serializeFeatures( featureList );
+
+      if ( !featureList.isEmpty() )
+      {
+        emit featureReceived( featureList );
+        emit featureReceived( featureList.size() );
+      }
+
+      featureList.clear();
+    }
+  }
+}
+
+// Keeps up to concurrentRequests page requests in flight, starting at
+// mTotalDownloadedFeatureCount. Pages are parsed in worker threads as soon as
+// they are received, but their features are processed in page order.
+// Returns true if the last page has been reached, false if the download was
+// stopped or if a page could not be processed.
+bool QgsWFSFeatureDownloader::downloadPagesConcurrently( bool serializeFeatures, int concurrentRequests )
+{
+  QEventLoop loop;
+  connect( this, &QgsWFSFeatureDownloader::doStop, &loop, &QEventLoop::quit );
+
+  const int pageSize = mShared->mMaxFeatures;
+  int nextStartIndex = mTotalDownloadedFeatureCount;
+  // Pages in flight, in increasing start index order
+  QList<QgsWFSFeaturePageRequest *> pages;
+  bool lastPageReached = false;
+  while ( !mStop )
+  {
+    // When the number of matched features is known, there is no need to
+    // request pages beyond the (empty) one that follows the last feature
+    while ( pages.size() < concurrentRequests &&
+            ( mNumberMatched <= 0 || nextStartIndex <= mNumberMatched ) )
+    {
+      QgsWFSFeaturePageRequest *page = new QgsWFSFeaturePageRequest( mShared );
+      connect( page, &QgsWFSFeaturePageRequest::pageReady, &loop, &QEventLoop::quit );
+      page->launch( buildURL( nextStartIndex, pageSize, false ) );
+      pages << page;
+      nextStartIndex += pageSize;
+    }
+    if ( pages.isEmpty() )
+      break;
+
+    QgsWFSFeaturePageRequest *page = pages.first();
+    if ( !page->isReady() )
+    {
+      loop.exec( QEventLoop::ExcludeUserInputEvents );
+      continue;
+    }
+    pages.removeFirst();
+
+    if ( !page->isValid() )
+    {
+      QgsDebugMsg( QString( "Page at index %1 failed: %2. Going on with sequential requests" ).arg( mTotalDownloadedFeatureCount ).arg( page->pageErrorMessage() ) );
+      delete page;
+      break;
+    }
+
+    QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> featurePtrList =
+      page->getAndStealReadyFeatures();
+    delete page;
+
+    mTotalDownloadedFeatureCount += featurePtrList.size();
+    emit updateProgress( mTotalDownloadedFeatureCount );
+
+    processFeatures( featurePtrList, serializeFeatures );
+
+    // Pages requested beyond a short page are ignored, whatever their result
+    if ( featurePtrList.size() < pageSize )
+    {
+      lastPageReached = true;
+      break;
+    }
+  }
+
+  qDeleteAll( pages );
+  return lastPageReached;
+}
+
 QString QgsWFSFeatureDownloader::errorMessageWithReason( const QString &reason )
 {
   return tr( "Download of features failed: %1" ).arg( reason );
@@ -23,6 +23,7 @@
 #include "qgsspatialindex.h"
 
 #include <memory>
+#include <QFutureWatcher>
 #include <QProgressDialog>
 #include <QPushButton>
 
@@ -60,6 +61,53 @@ class QgsWFSFeatureHitsAsyncRequest: public QgsWfsRequest
 };
 
 
+/**
+ * Utility class to issue the GetFeature request of a single page, when several
+    pages are downloaded concurrently. The response is parsed in a worker thread
+    as soon as it is received. */
+class QgsWFSFeaturePageRequest: public QgsWfsRequest
+{
+    Q_OBJECT
+  public:
+    explicit QgsWFSFeaturePageRequest( QgsWFSSharedData *shared );
+    ~QgsWFSFeaturePageRequest();
+
+    void launch( const QUrl &url );
+
+    //! Return whether the page has been downloaded and parsed, or has failed
+    bool isReady() const { return mReady; }
+
+    //! Return whether the page has been successfully downloaded and parsed
+    bool isValid() const;
+
+    //! Return the features of the page. Must only be called on a valid page
+    QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> getAndStealReadyFeatures();
+
+    //! Return the reason why the page is not valid
+    QString pageErrorMessage() const;
+
+  signals:
+    //! Emitted when the page is ready
+    void pageReady();
+
+  private slots:
+    void pageReplyFinished();
+    void pageParsed();
+
+  protected:
+    virtual QString errorMessageWithReason( const QString &reason ) override;
+
+  private:
+    static bool parsePage( QgsWFSFeaturePageRequest *page );
+
+    std::unique_ptr<QgsGmlStreamingParser> mParser;
+    QFutureWatcher<bool> mParsing;
+    QString mParseErrorMsg;
+    bool mParseOk = false;
+    bool mReady = false;
+};
+
+
 //! Utility class for QgsWFSFeatureDownloader
 class QgsWFSProgressDialog: public QProgressDialog
 {
@@ -134,6 +182,9 @@ class QgsWFSFeatureDownloader: public QgsWfsRequest
 
   private:
     QUrl buildURL( int startIndex, int maxFeatures, bool forHits );
+    bool downloadPagesConcurrently( bool serializeFeatures, int concurrentRequests );
+    void processFeatures( QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> &featurePtrList,
+                          bool serializeFeatures, QString *firstGmlId = nullptr );
     void pushError( const QString &errorMsg );
     QString sanitizeFilter( QString filter );
 
@@ -20,6 +20,7 @@
 #include "qgsmslayercache.h"
 #include "qgsaccesscontrol.h"
 #include "qgsproject.h"
+#include "qgsvectorlayer.h"
 
 #include <QFile>
 
@@ -38,19 +39,48 @@ QgsConfigCache::QgsConfigCache()
   QObject::connect( &mFileSystemWatcher, &QFileSystemWatcher::fileChanged, this, &QgsConfigCache::removeChangedEntry );
 }
 
-const QgsProject *QgsConfigCache::project( const QString &path )
+const QgsProject *QgsConfigCache::project( const QString &path, QgsProject::ReadFlags readFlags )
 {
   if ( ! mProjectCache[ path ] )
   {
     std::unique_ptr<QgsProject> prj( new QgsProject() );
-    if ( prj->read( path ) )
+    if ( prj->read( path, readFlags ) )
     {
-      mProjectCache.insert( path, prj.release() );
+      CachedProject *entry = new CachedProject();
+      entry->project = std::move( prj );
+      mProjectCache.insert( path, entry );
       mFileSystemWatcher.addPath( path );
     }
   }
 
-  return mProjectCache[ path ];
+  CachedProject *entry = mProjectCache[ path ];
+  return entry ? entry->project.get() : nullptr;
+}
+
+QgsSpatialIndex QgsConfigCache::layerSpatialIndex( const QgsProject *project, QgsVectorLayer *layer )
+{
+  // OGR does not apply subset strings when features are requested by id, so
+  // the index must only hold features matching the subset string
+  const QString key = layer->id() + '\n' + layer->subsetString();
+
+  // the indexes are stored with the project, so that they are released when
+  // the project is evicted from the cache
+  CachedProject *entry = mProjectCache.object( project->fileName() );
+  if ( entry && entry->project.get() == project )
+  {
+    QHash<QString, QgsSpatialIndex>::const_iterator it = entry->layerSpatialIndexes.constFind( key );
+    if ( it != entry->layerSpatialIndexes.constEnd() )
+      return it.value();
+  }
+
+  QgsFeatureRequest request;
+  request.setSubsetOfAttributes( QgsAttributeList() );
+  const QgsSpatialIndex index( layer->getFeatures( request ) );
+
+  // projects which are not cached do not keep their indexes
+  if ( entry && entry->project.get() == project )
+    entry->layerSpatialIndexes.insert( key, index );
+  return index;
 }
 
 QDomDocument *QgsConfigCache::xmlDocument( const QString &filePath )
@@ -26,11 +26,15 @@
 #include <QObject>
 #include <QDomDocument>
 
+#include <memory>
+
 #include "qgis_server.h"
 #include "qgis_sip.h"
 #include "qgsproject.h"
+#include "qgsspatialindex.h"
 
 class QgsAccessControl;
+class QgsVectorLayer;
 
 class SERVER_EXPORT QgsConfigCache : public QObject
 {
@@ -44,14 +48,36 @@ class SERVER_EXPORT QgsConfigCache : public QObject
      * If the project is not cached yet, then the project is read thank to the
      *  path. If the project is not available, then a nullptr is returned.
      * \param path the filename of the QGIS project
+     * \param readFlags flags used to read the project when it is not cached yet,
+     * e.g. to trust the layer metadata or to create the data providers of the
+     * layers on first use
      * \returns the project or nullptr if an error happened
      * \since QGIS 3.0
      */
-    const QgsProject *project( const QString &path );
+    const QgsProject *project( const QString &path, QgsProject::ReadFlags readFlags = QgsProject::ReadFlags() );
+
+    /**
+     * Returns a spatial index of the features of a vector \a layer from a cached
+     * \a project. The index is built on first use, with the current subset string
+     * of the layer, and is kept until the project is removed from the cache.
+     * It is therefore only suitable for data which is not modified while the
+     * project is cached.
+     * \since QGIS 3.0
+     */
+    QgsSpatialIndex layerSpatialIndex( const QgsProject *project, QgsVectorLayer *layer );
 
   private:
     QgsConfigCache() SIP_FORCE;
 
+    //! A cached project and the data built for it, released together
+    struct CachedProject
+    {
+      std::unique_ptr<QgsProject> project;
+
+      //! Spatial indexes of layers, by layer id and subset string
+      QHash<QString, QgsSpatialIndex> layerSpatialIndexes;
+    };
+
     //! Check for configuration file updates (remove entry from cache if file changes)
     QFileSystemWatcher mFileSystemWatcher;
 
@@ -59,7 +85,7 @@ class SERVER_EXPORT QgsConfigCache : public QObject
     QDomDocument *xmlDocument( const QString &filePath );
 
     QCache<QString, QDomDocument> mXmlDocumentCache;
-    QCache<QString, QgsProject> mProjectCache;
+    QCache<QString, CachedProject> mProjectCache;
 
   private slots:
     //! Removes changed entry from this cache
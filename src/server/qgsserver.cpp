@@ -349,7 +349,12 @@ void QgsServer::handleRequest( QgsServerRequest &request, QgsServerResponse &res
       QString configFilePath = configPath( *sConfigFilePath, parameterMap );
 
       // load the project if needed and not empty
-      const QgsProject *project = mConfigCache->project( configFilePath );
+      QgsProject::ReadFlags readFlags = QgsProject::ReadFlags();
+      if ( sSettings.trustLayerMetadata() )
+        readFlags |= QgsProject::FlagTrustLayerMetadata;
+      if ( sSettings.lazyDataProviders() )
+        readFlags |= QgsProject::FlagLazyDataProviders;
+      const QgsProject *project = mConfigCache->project( configFilePath, readFlags );
       if ( ! project )
       {
         throw QgsServerException( QStringLiteral( "Project file error" ) );
@@ -130,6 +130,61 @@ void QgsServerSettings::initSettings()
                                QVariant()
                              };
   mSettings[ sCacheSize.envVar ] = sCacheSize;
+
+  // wms metatile size
+  const Setting sMetatileSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_SIZE,
+                                  QgsServerSettingsEnv::DEFAULT_VALUE,
+                                  "Number of tiles per side of a metatile for tiled WMS getMap requests (0 to deactivate)",
+                                  "/qgis/wms_metatile_size",
+                                  QVariant::Int,
+                                  QVariant( 0 ),
+                                  QVariant()
+                                };
+  mSettings[ sMetatileSize.envVar ] = sMetatileSize;
+
+  // wms metatile cache size
+  const Setting sMetatileCacheSize = { QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_CACHE_SIZE,
+                                       QgsServerSettingsEnv::DEFAULT_VALUE,
+                                       "Specify the size of the in-memory cache for tiles sliced from metatiles",
+                                       "/qgis/wms_metatile_cache_size",
+                                       QVariant::LongLong,
+                                       QVariant( 64 * 1024 * 1024 ),
+                                       QVariant()
+                                     };
+  mSettings[ sMetatileCacheSize.envVar ] = sMetatileCacheSize;
+
+  // trust layer metadata
+  const Setting sTrustLayerMetadata = { QgsServerSettingsEnv::QGIS_SERVER_TRUST_LAYER_METADATA,
+                                        QgsServerSettingsEnv::DEFAULT_VALUE,
+                                        "Read layer extents from projects instead of computing them from data providers",
+                                        "/qgis/trust_layer_metadata",
+                                        QVariant::Bool,
+                                        QVariant( false ),
+                                        QVariant()
+                                      };
+  mSettings[ sTrustLayerMetadata.envVar ] = sTrustLayerMetadata;
+
+  // wms getfeatureinfo spatial index
+  const Setting sFeatureInfoIndex = { QgsServerSettingsEnv::QGIS_SERVER_WMS_FEATUREINFO_INDEX,
+                                      QgsServerSettingsEnv::DEFAULT_VALUE,
+                                      "Find GetFeatureInfo hits with spatial indexes of layers kept with cached projects",
+                                      "/qgis/wms_featureinfo_index",
+                                      QVariant::Bool,
+                                      QVariant( false ),
+                                      QVariant()
+                                    };
+  mSettings[ sFeatureInfoIndex.envVar ] = sFeatureInfoIndex;
+
+  // lazy data providers
+  const Setting sLazyDataProviders = { QgsServerSettingsEnv::QGIS_SERVER_LAZY_DATA_PROVIDERS,
+                                       QgsServerSettingsEnv::DEFAULT_VALUE,
+                                       "Create the data providers of vector layers when requests first access their data",
+                                       "/qgis/lazy_data_providers",
+                                       QVariant::Bool,
+                                       QVariant( false ),
+                                       QVariant()
+                                     };
+  mSettings[ sLazyDataProviders.envVar ] = sLazyDataProviders;
 }
 
 void QgsServerSettings::load()
@@ -305,3 +360,28 @@ QString QgsServerSettings::cacheDirectory() const
 {
   return value( QgsServerSettingsEnv::QGIS_SERVER_CACHE_DIRECTORY ).toString();
 }
+
+int QgsServerSettings::wmsMetatileSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_SIZE ).toInt();
+}
+
+qint64 QgsServerSettings::wmsMetatileCacheSize() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_METATILE_CACHE_SIZE ).toLongLong();
+}
+
+bool QgsServerSettings::trustLayerMetadata() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_TRUST_LAYER_METADATA ).toBool();
+}
+
+bool QgsServerSettings::wmsFeatureInfoIndex() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_WMS_FEATUREINFO_INDEX ).toBool();
+}
+
+bool QgsServerSettings::lazyDataProviders() const
+{
+  return value( QgsServerSettingsEnv::QGIS_SERVER_LAZY_DATA_PROVIDERS ).toBool();
+}
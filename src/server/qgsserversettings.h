@@ -56,7 +56,12 @@ class SERVER_EXPORT QgsServerSettingsEnv : public QObject
       QGIS_PROJECT_FILE,
       MAX_CACHE_LAYERS,
       QGIS_SERVER_CACHE_DIRECTORY,
-      QGIS_SERVER_CACHE_SIZE
+      QGIS_SERVER_CACHE_SIZE,
+      QGIS_SERVER_WMS_METATILE_SIZE,
+      QGIS_SERVER_WMS_METATILE_CACHE_SIZE,
+      QGIS_SERVER_TRUST_LAYER_METADATA,
+      QGIS_SERVER_WMS_FEATUREINFO_INDEX,
+      QGIS_SERVER_LAZY_DATA_PROVIDERS
     };
     Q_ENUM( EnvVar )
 };
@@ -157,6 +162,48 @@ class SERVER_EXPORT QgsServerSettings
       */
     QString cacheDirectory() const;
 
+    /**
+     * Returns the number of tiles per side of a WMS metatile. Tile shaped
+     * GetMap requests are rendered as a whole metatile when this value is
+     * greater than 1.
+     * \returns the metatile size or 0 if metatiling is disabled.
+     */
+    int wmsMetatileSize() const;
+
+    /**
+     * Returns the maximum size in bytes of the in-memory cache used to
+     * store tiles sliced from WMS metatiles.
+     * \returns the metatile cache size.
+     */
+    qint64 wmsMetatileCacheSize() const;
+
+    /**
+     * Returns true if the layer metadata stored in projects is trusted. In
+     * this case, extents are read from the project instead of being computed
+     * by the data providers and the primary key unicity of Postgres views is
+     * not checked, which reduces the time needed to load a project.
+     * \returns true if the layer metadata is trusted, false otherwise.
+     */
+    bool trustLayerMetadata() const;
+
+    /**
+     * Returns true if GetFeatureInfo requests look for features in spatial
+     * indexes of the vector layers, which are kept with the cached projects.
+     * This is only suitable for data which is not modified while projects
+     * are cached.
+     * \returns true if the spatial indexes are used, false otherwise.
+     */
+    bool wmsFeatureInfoIndex() const;
+
+    /**
+     * Returns true if the data providers of vector layers are only created
+     * when a request first accesses the data of the layers. Their geometry
+     * type, fields and capabilities are then read from the projects, so
+     * that loading a project does not open all its data sources.
+     * \returns true if the data providers are created on first use, false otherwise.
+     */
+    bool lazyDataProviders() const;
+
   private:
     void initSettings();
     QVariant value( QgsServerSettingsEnv::EnvVar envVar ) const;
@@ -25,186 +25,556 @@
 #include "qgsrasterpipe.h"
 #include "qgsrasterprojector.h"
 #include "qgsrasterfilewriter.h"
+#include "qgscoordinatetransform.h"
+#include "qgsmessagelog.h"
 
+#include <QDataStream>
 #include <QTemporaryFile>
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
 namespace QgsWcs
 {
 
-  /**
-   * Output WCS DescribeCoverage response
-   */
-  void writeGetCoverage( QgsServerInterface *serverIface, const QgsProject *project, const QString &version,
-                         const QgsServerRequest &request, QgsServerResponse &response )
+  namespace
   {
-    Q_UNUSED( version );
-
-    response.write( getCoverageData( serverIface, project, request ) );
-    response.setHeader( "Content-Type", "image/tiff" );
-  }
+    //! Parameters of a GetCoverage request
+    struct Coverage
+    {
+      QgsRasterLayer *layer = nullptr;
+      //! Extent in layer CRS
+      QgsRectangle extent;
+      int width = 0;
+      int height = 0;
+      //! Response CRS
+      QgsCoordinateReferenceSystem crs;
+    };
 
-  QByteArray getCoverageData( QgsServerInterface *serverIface, const QgsProject *project, const QgsServerRequest &request )
-  {
-    QgsServerRequest::Parameters parameters = request.parameters();
+    Coverage parseCoverage( QgsServerInterface *serverIface, const QgsProject *project, const QgsServerRequest &request )
+    {
+      QgsServerRequest::Parameters parameters = request.parameters();
 
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
-    QgsAccessControl *accessControl = serverIface->accessControls();
+      QgsAccessControl *accessControl = serverIface->accessControls();
 #endif
-    //defining coverage name
-    QString coveName;
-    //read COVERAGE
-    QMap<QString, QString>::const_iterator cove_name_it = parameters.constFind( QStringLiteral( "COVERAGE" ) );
-    if ( cove_name_it != parameters.constEnd() )
-    {
-      coveName = cove_name_it.value();
-    }
-    if ( coveName.isEmpty() )
-    {
-      QMap<QString, QString>::const_iterator cove_name_it = parameters.constFind( QStringLiteral( "IDENTIFIER" ) );
+      //defining coverage name
+      QString coveName;
+      //read COVERAGE
+      QMap<QString, QString>::const_iterator cove_name_it = parameters.constFind( QStringLiteral( "COVERAGE" ) );
       if ( cove_name_it != parameters.constEnd() )
       {
         coveName = cove_name_it.value();
       }
-    }
+      if ( coveName.isEmpty() )
+      {
+        QMap<QString, QString>::const_iterator cove_name_it = parameters.constFind( QStringLiteral( "IDENTIFIER" ) );
+        if ( cove_name_it != parameters.constEnd() )
+        {
+          coveName = cove_name_it.value();
+        }
+      }
 
-    if ( coveName.isEmpty() )
-    {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "COVERAGE is mandatory" ) );
-    }
+      if ( coveName.isEmpty() )
+      {
+        throw QgsRequestNotWellFormedException( QStringLiteral( "COVERAGE is mandatory" ) );
+      }
 
-    //get the raster layer
-    QStringList wcsLayersId = QgsServerProjectUtils::wcsLayerIds( *project );
+      //get the raster layer
+      QStringList wcsLayersId = QgsServerProjectUtils::wcsLayerIds( *project );
 
-    QgsRasterLayer *rLayer = nullptr;
-    for ( int i = 0; i < wcsLayersId.size(); ++i )
-    {
-      QgsMapLayer *layer = project->mapLayer( wcsLayersId.at( i ) );
-      if ( layer->type() != QgsMapLayer::LayerType::RasterLayer )
+      QgsRasterLayer *rLayer = nullptr;
+      for ( int i = 0; i < wcsLayersId.size(); ++i )
       {
-        continue;
-      }
+        QgsMapLayer *layer = project->mapLayer( wcsLayersId.at( i ) );
+        if ( layer->type() != QgsMapLayer::LayerType::RasterLayer )
+        {
+          continue;
+        }
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
-      if ( !accessControl->layerReadPermission( layer ) )
+        if ( !accessControl->layerReadPermission( layer ) )
+        {
+          continue;
+        }
+#endif
+        QString name = layer->name();
+        if ( !layer->shortName().isEmpty() )
+          name = layer->shortName();
+        name = name.replace( QLatin1String( " " ), QLatin1String( "_" ) );
+
+        if ( name == coveName )
+        {
+          rLayer = qobject_cast<QgsRasterLayer *>( layer );
+          break;
+        }
+      }
+      if ( !rLayer )
       {
-        continue;
+        throw QgsRequestNotWellFormedException( QStringLiteral( "The layer for the COVERAGE '%1' is not found" ).arg( coveName ) );
       }
-#endif
-      QString name = layer->name();
-      if ( !layer->shortName().isEmpty() )
-        name = layer->shortName();
-      name = name.replace( QLatin1String( " " ), QLatin1String( "_" ) );
 
-      if ( name == coveName )
+      double minx = 0.0, miny = 0.0, maxx = 0.0, maxy = 0.0;
+      // WIDTh and HEIGHT
+      int width = 0, height = 0;
+      // CRS
+      QString crs;
+
+      // read BBOX
+      QgsRectangle bbox = parseBbox( parameters.value( QStringLiteral( "BBOX" ) ) );
+      if ( !bbox.isEmpty() )
+      {
+        minx = bbox.xMinimum();
+        miny = bbox.yMinimum();
+        maxx = bbox.xMaximum();
+        maxy = bbox.yMaximum();
+      }
+      else
       {
-        rLayer = qobject_cast<QgsRasterLayer *>( layer );
-        break;
+        throw QgsRequestNotWellFormedException( QStringLiteral( "The BBOX is mandatory and has to be xx.xxx,yy.yyy,xx.xxx,yy.yyy" ) );
       }
+
+      // read WIDTH
+      bool conversionSuccess = false;
+      width = parameters.value( QStringLiteral( "WIDTH" ), QStringLiteral( "0" ) ).toInt( &conversionSuccess );
+      if ( !conversionSuccess )
+      {
+        width = 0;
+      }
+      // read HEIGHT
+      height = parameters.value( QStringLiteral( "HEIGHT" ), QStringLiteral( "0" ) ).toInt( &conversionSuccess );
+      if ( !conversionSuccess )
+      {
+        height = 0;
+      }
+
+      if ( width < 0 || height < 0 )
+      {
+        throw QgsRequestNotWellFormedException( QStringLiteral( "The WIDTH and HEIGHT are mandatory and have to be integer" ) );
+      }
+
+      crs = parameters.value( QStringLiteral( "CRS" ) );
+      if ( crs.isEmpty() )
+      {
+        throw QgsRequestNotWellFormedException( QStringLiteral( "The CRS is mandatory" ) );
+      }
+
+      QgsCoordinateReferenceSystem requestCRS = QgsCoordinateReferenceSystem::fromOgcWmsCrs( crs );
+      if ( !requestCRS.isValid() )
+      {
+        throw QgsRequestNotWellFormedException( QStringLiteral( "Invalid CRS" ) );
+      }
+
+      Coverage coverage;
+      QgsRectangle rect( minx, miny, maxx, maxy );
+
+      // transform rect
+      if ( requestCRS != rLayer->crs() )
+      {
+        QgsCoordinateTransform t( requestCRS, rLayer->crs() );
+        rect = t.transformBoundingBox( rect );
+      }
+
+      // RESPONSE_CRS
+      QgsCoordinateReferenceSystem responseCRS = rLayer->crs();
+      crs = parameters.value( QStringLiteral( "RESPONSE_CRS" ) );
+      if ( !crs.isEmpty() )
+      {
+        responseCRS = QgsCoordinateReferenceSystem::fromOgcWmsCrs( crs );
+        if ( !responseCRS.isValid() )
+        {
+          responseCRS = rLayer->crs();
+        }
+      }
+
+      coverage.layer = rLayer;
+      coverage.extent = rect;
+      coverage.width = width;
+      coverage.height = height;
+      coverage.crs = responseCRS;
+      return coverage;
     }
-    if ( !rLayer )
+
+    void setupPipe( QgsRasterPipe &pipe, const Coverage &coverage )
     {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "The layer for the COVERAGE '%1' is not found" ).arg( coveName ) );
-    }
+      QgsRasterLayer *rLayer = coverage.layer;
 
-    double minx = 0.0, miny = 0.0, maxx = 0.0, maxy = 0.0;
-    // WIDTh and HEIGHT
-    int width = 0, height = 0;
-    // CRS
-    QString crs;
+      // clone pipe/provider
+      if ( !pipe.set( rLayer->dataProvider()->clone() ) )
+      {
+        throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot set pipe provider" ) );
+      }
 
-    // read BBOX
-    QgsRectangle bbox = parseBbox( parameters.value( QStringLiteral( "BBOX" ) ) );
-    if ( !bbox.isEmpty() )
-    {
-      minx = bbox.xMinimum();
-      miny = bbox.yMinimum();
-      maxx = bbox.xMaximum();
-      maxy = bbox.yMaximum();
+      // add projector if necessary
+      if ( coverage.crs != rLayer->crs() )
+      {
+        QgsRasterProjector *projector = new QgsRasterProjector;
+        projector->setCrs( rLayer->crs(), coverage.crs );
+        if ( !pipe.insert( 2, projector ) )
+        {
+          throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot set pipe projector" ) );
+        }
+      }
     }
-    else
+
+    QByteArray coverageData( QgsRasterPipe &pipe, const Coverage &coverage )
     {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "The BBOX is mandatory and has to be xx.xxx,yy.yyy,xx.xxx,yy.yyy" ) );
+      QTemporaryFile tempFile;
+      tempFile.open();
+      QgsRasterFileWriter fileWriter( tempFile.fileName() );
+
+      QgsRasterFileWriter::WriterError err = fileWriter.writeRaster( &pipe, coverage.width, coverage.height, coverage.extent, coverage.crs );
+      if ( err != QgsRasterFileWriter::NoError )
+      {
+        throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot write raster error code: %1" ).arg( err ) );
+      }
+      return tempFile.readAll();
     }
 
-    // read WIDTH
-    bool conversionSuccess = false;
-    width = parameters.value( QStringLiteral( "WIDTH" ), QStringLiteral( "0" ) ).toInt( &conversionSuccess );
-    if ( !conversionSuccess )
+    // Size of the strips read from the pipe and written to the response
+    const qint64 STRIP_SIZE = 1024 * 1024;
+
+    // Classic TIFF offsets are 32 bits
+    const qint64 MAX_TIFF_SIZE = Q_INT64_C( 0xF0000000 );
+
+    // TIFF field types
+    const quint16 TIFF_ASCII = 2;
+    const quint16 TIFF_SHORT = 3;
+    const quint16 TIFF_LONG = 4;
+    const quint16 TIFF_DOUBLE = 12;
+
+    // The TIFF header is written in the host byte order, so that the pixel
+    // data of the raster blocks can be written as is
+    const QDataStream::ByteOrder TIFF_BYTE_ORDER = QSysInfo::ByteOrder == QSysInfo::LittleEndian ? QDataStream::LittleEndian : QDataStream::BigEndian;
+
+    struct TiffEntry
     {
-      width = 0;
-    }
-    // read HEIGHT
-    height = parameters.value( QStringLiteral( "HEIGHT" ), QStringLiteral( "0" ) ).toInt( &conversionSuccess );
-    if ( !conversionSuccess )
+      quint16 tag;
+      quint16 type;
+      quint32 count;
+      QByteArray data;
+    };
+
+    template<typename T> TiffEntry tiffEntry( quint16 tag, quint16 type, const QVector<T> &values )
     {
-      height = 0;
+      TiffEntry entry;
+      entry.tag = tag;
+      entry.type = type;
+      entry.count = values.size();
+      QDataStream stream( &entry.data, QIODevice::WriteOnly );
+      stream.setByteOrder( TIFF_BYTE_ORDER );
+      stream.setFloatingPointPrecision( QDataStream::DoublePrecision );
+      for ( const T &value : values )
+        stream << value;
+      return entry;
     }
 
-    if ( width < 0 || height < 0 )
+    TiffEntry tiffEntry( quint16 tag, const QByteArray &ascii )
     {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "The WIDTH and HEIGHT are mandatory and have to be integer" ) );
+      TiffEntry entry;
+      entry.tag = tag;
+      entry.type = TIFF_ASCII;
+      entry.data = ascii;
+      entry.data.append( '\0' );
+      entry.count = entry.data.size();
+      return entry;
     }
 
-    crs = parameters.value( QStringLiteral( "CRS" ) );
-    if ( crs.isEmpty() )
+    //! Parameters of a coverage which can be written as a streamed GeoTIFF
+    struct StreamingTiff
     {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "The CRS is mandatory" ) );
-    }
+      Qgis::DataType dataType = Qgis::UnknownDataType;
+      int bandCount = 0;
+      bool hasNoData = false;
+      double noData = 0;
+      int epsg = 0;
+      int rowsPerStrip = 0;
+      int stripsPerBand = 0;
+    };
 
-    QgsCoordinateReferenceSystem requestCRS = QgsCoordinateReferenceSystem::fromOgcWmsCrs( crs );
-    if ( !requestCRS.isValid() )
+    /**
+     * Checks whether the coverage can be written as a streamed GeoTIFF, i.e. an
+     * uncompressed TIFF whose strips can be computed and written one after the other.
+     * This is the case if its CRS has an EPSG code, its bands share a data type and
+     * a no data value is only needed if the source has one.
+     */
+    bool streamingTiffParameters( QgsRasterPipe &pipe, const Coverage &coverage, StreamingTiff &tiff )
     {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "Invalid CRS" ) );
-    }
+      if ( coverage.width <= 0 || coverage.height <= 0 )
+        return false;
+
+      const QString authid = coverage.crs.authid();
+      if ( !authid.startsWith( QLatin1String( "EPSG:" ) ) )
+        return false;
+      bool ok = false;
+      tiff.epsg = authid.mid( 5 ).toInt( &ok );
+      if ( !ok || tiff.epsg <= 0 || tiff.epsg > 65535 )
+        return false;
+
+      QgsRasterDataProvider *provider = pipe.provider();
+      tiff.bandCount = pipe.last()->bandCount();
+      if ( !provider || tiff.bandCount < 1 )
+        return false;
+
+      tiff.dataType = provider->sourceDataType( 1 );
+      switch ( tiff.dataType )
+      {
+        case Qgis::Byte:
+        case Qgis::UInt16:
+        case Qgis::Int16:
+        case Qgis::UInt32:
+        case Qgis::Int32:
+        case Qgis::Float32:
+        case Qgis::Float64:
+          break;
+        default:
+          return false;
+      }
+
+      const int typeSize = QgsRasterBlock::typeSize( tiff.dataType );
+      if ( static_cast<qint64>( coverage.width ) * coverage.height * tiff.bandCount * typeSize > MAX_TIFF_SIZE )
+        return false;
 
-    QgsRectangle rect( minx, miny, maxx, maxy );
+      // The extent of the source data used for the coverage, to know whether
+      // pixels without data are expected
+      QgsRectangle srcExtent = coverage.extent;
+      QgsRasterProjector *projector = pipe.projector();
+      if ( projector && projector->destinationCrs() != projector->sourceCrs() )
+      {
+        QgsCoordinateTransform ct( projector->destinationCrs(), projector->sourceCrs() );
+        srcExtent = ct.transformBoundingBox( coverage.extent );
+      }
+      const bool needsNoData = !provider->extent().contains( srcExtent );
+
+      tiff.hasNoData = provider->sourceHasNoDataValue( 1 );
+      tiff.noData = provider->sourceNoDataValue( 1 );
+      for ( int band = 1; band <= tiff.bandCount; ++band )
+      {
+        if ( provider->sourceDataType( band ) != tiff.dataType )
+          return false;
+
+        // GeoTIFF has a single no data value for all the bands
+        if ( provider->sourceHasNoDataValue( band ) != tiff.hasNoData )
+          return false;
+        const double noData = provider->sourceNoDataValue( band );
+        if ( tiff.hasNoData && !( std::isnan( noData ) && std::isnan( tiff.noData ) ) && !qgsDoubleNear( noData, tiff.noData ) )
+          return false;
+      }
+
+      // Choosing a no data value which is not used by the source requires its statistics,
+      // which is left to QgsRasterFileWriter
+      if ( needsNoData && !tiff.hasNoData )
+        return false;
+
+      const qint64 rowSize = static_cast<qint64>( coverage.width ) * typeSize;
+      tiff.rowsPerStrip = static_cast<int>( std::min( static_cast<qint64>( coverage.height ), std::max( Q_INT64_C( 1 ), STRIP_SIZE / rowSize ) ) );
+      tiff.stripsPerBand = ( coverage.height + tiff.rowsPerStrip - 1 ) / tiff.rowsPerStrip;
+      return true;
+    }
 
-    // transform rect
-    if ( requestCRS != rLayer->crs() )
+    int stripRows( const Coverage &coverage, const StreamingTiff &tiff, int strip )
     {
-      QgsCoordinateTransform t( requestCRS, rLayer->crs() );
-      rect = t.transformBoundingBox( rect );
+      return std::min( tiff.rowsPerStrip, coverage.height - strip * tiff.rowsPerStrip );
     }
 
-    // RESPONSE_CRS
-    QgsCoordinateReferenceSystem responseCRS = rLayer->crs();
-    crs = parameters.value( QStringLiteral( "RESPONSE_CRS" ) );
-    if ( !crs.isEmpty() )
+    QByteArray tiffHeader( const Coverage &coverage, const StreamingTiff &tiff )
     {
-      responseCRS = QgsCoordinateReferenceSystem::fromOgcWmsCrs( crs );
-      if ( !responseCRS.isValid() )
+      const int typeSize = QgsRasterBlock::typeSize( tiff.dataType );
+
+      quint16 sampleFormat = 1;
+      if ( tiff.dataType == Qgis::Int16 || tiff.dataType == Qgis::Int32 )
+        sampleFormat = 2;
+      else if ( tiff.dataType == Qgis::Float32 || tiff.dataType == Qgis::Float64 )
+        sampleFormat = 3;
+
+      // Bands are written one after the other (planar configuration), so that each
+      // strip is made of a single block
+      const int stripCount = tiff.bandCount * tiff.stripsPerBand;
+      QVector<quint32> stripOffsets( stripCount, 0 );
+      QVector<quint32> stripByteCounts;
+      stripByteCounts.reserve( stripCount );
+      for ( int band = 0; band < tiff.bandCount; ++band )
       {
-        responseCRS = rLayer->crs();
+        for ( int strip = 0; strip < tiff.stripsPerBand; ++strip )
+        {
+          stripByteCounts << static_cast<quint32>( static_cast<qint64>( coverage.width ) * stripRows( coverage, tiff, strip ) * typeSize );
+        }
       }
-    }
 
-    QTemporaryFile tempFile;
-    tempFile.open();
-    QgsRasterFileWriter fileWriter( tempFile.fileName() );
+      const double pixelWidth = coverage.extent.width() / coverage.width;
+      const double pixelHeight = coverage.extent.height() / coverage.height;
 
-    // clone pipe/provider
-    QgsRasterPipe pipe;
-    if ( !pipe.set( rLayer->dataProvider()->clone() ) )
-    {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot set pipe provider" ) );
+      QVector<quint16> geoKeys;
+      geoKeys << 1 << 1 << 0 << 3; // version, revision, minor revision, key count
+      geoKeys << 1024 << 0 << 1 << ( coverage.crs.isGeographic() ? 2 : 1 ); // GTModelTypeGeoKey
+      geoKeys << 1025 << 0 << 1 << 1; // GTRasterTypeGeoKey: RasterPixelIsArea
+      geoKeys << ( coverage.crs.isGeographic() ? 2048 : 3072 ) << 0 << 1 << static_cast<quint16>( tiff.epsg ); // GeographicTypeGeoKey or ProjectedCSTypeGeoKey
+
+      QList<TiffEntry> entries;
+      entries << tiffEntry<quint32>( 256, TIFF_LONG, QVector<quint32>() << coverage.width ); // ImageWidth
+      entries << tiffEntry<quint32>( 257, TIFF_LONG, QVector<quint32>() << coverage.height ); // ImageLength
+      entries << tiffEntry<quint16>( 258, TIFF_SHORT, QVector<quint16>( tiff.bandCount, typeSize * 8 ) ); // BitsPerSample
+      entries << tiffEntry<quint16>( 259, TIFF_SHORT, QVector<quint16>() << 1 ); // Compression: none
+      entries << tiffEntry<quint16>( 262, TIFF_SHORT, QVector<quint16>() << 1 ); // PhotometricInterpretation: BlackIsZero
+      const int stripOffsetsIndex = entries.size();
+      entries << tiffEntry<quint32>( 273, TIFF_LONG, stripOffsets ); // StripOffsets
+      entries << tiffEntry<quint16>( 277, TIFF_SHORT, QVector<quint16>() << tiff.bandCount ); // SamplesPerPixel
+      entries << tiffEntry<quint32>( 278, TIFF_LONG, QVector<quint32>() << tiff.rowsPerStrip ); // RowsPerStrip
+      entries << tiffEntry<quint32>( 279, TIFF_LONG, stripByteCounts ); // StripByteCounts
+      entries << tiffEntry<quint16>( 284, TIFF_SHORT, QVector<quint16>() << ( tiff.bandCount > 1 ? 2 : 1 ) ); // PlanarConfiguration
+      if ( tiff.bandCount > 1 )
+        entries << tiffEntry<quint16>( 338, TIFF_SHORT, QVector<quint16>( tiff.bandCount - 1, 0 ) ); // ExtraSamples: unspecified
+      entries << tiffEntry<quint16>( 339, TIFF_SHORT, QVector<quint16>( tiff.bandCount, sampleFormat ) ); // SampleFormat
+      entries << tiffEntry<double>( 33550, TIFF_DOUBLE, QVector<double>() << pixelWidth << pixelHeight << 0.0 ); // ModelPixelScaleTag
+      entries << tiffEntry<double>( 33922, TIFF_DOUBLE, QVector<double>() << 0.0 << 0.0 << 0.0 << coverage.extent.xMinimum() << coverage.extent.yMaximum() << 0.0 ); // ModelTiepointTag
+      entries << tiffEntry<quint16>( 34735, TIFF_SHORT, geoKeys ); // GeoKeyDirectoryTag
+      if ( tiff.hasNoData )
+        entries << tiffEntry( 42113, QString::number( tiff.noData, 'g', 17 ).toLatin1() ); // GDAL_NODATA
+
+      // Image file directory right after the header, followed by the values which
+      // do not fit in the directory entries, then by the strips
+      const quint32 ifdOffset = 8;
+      const quint32 ifdSize = 2 + 12 * entries.size() + 4;
+      quint32 valuesSize = 0;
+      for ( const TiffEntry &entry : qgsAsConst( entries ) )
+      {
+        if ( entry.data.size() > 4 )
+          valuesSize += entry.data.size() + entry.data.size() % 2;
+      }
+      const quint32 dataOffset = ifdOffset + ifdSize + valuesSize;
+
+      quint32 offset = dataOffset;
+      for ( int i = 0; i < stripCount; ++i )
+      {
+        stripOffsets[i] = offset;
+        offset += stripByteCounts.at( i );
+      }
+      entries[stripOffsetsIndex] = tiffEntry<quint32>( 273, TIFF_LONG, stripOffsets );
+
+      QByteArray header;
+      QDataStream stream( &header, QIODevice::WriteOnly );
+      stream.setByteOrder( TIFF_BYTE_ORDER );
+      stream.writeRawData( TIFF_BYTE_ORDER == QDataStream::LittleEndian ? "II" : "MM", 2 );
+      stream << static_cast<quint16>( 42 ) << ifdOffset;
+
+      QByteArray values;
+      stream << static_cast<quint16>( entries.size() );
+      for ( const TiffEntry &entry : qgsAsConst( entries ) )
+      {
+        stream << entry.tag << entry.type << entry.count;
+        if ( entry.data.size() > 4 )
+        {
+          stream << static_cast<quint32>( ifdOffset + ifdSize + values.size() );
+          values.append( entry.data );
+          if ( entry.data.size() % 2 )
+            values.append( '\0' );
+        }
+        else
+        {
+          // Values fitting in 4 bytes are left-justified in the entry
+          stream.writeRawData( entry.data.constData(), entry.data.size() );
+          for ( int i = entry.data.size(); i < 4; ++i )
+            stream << static_cast<quint8>( 0 );
+        }
+      }
+      stream << static_cast<quint32>( 0 ); // no next image file directory
+      stream.writeRawData( values.constData(), values.size() );
+
+      Q_ASSERT( static_cast<quint32>( header.size() ) == dataOffset );
+      return header;
     }
 
-    // add projector if necessary
-    if ( responseCRS != rLayer->crs() )
+    /**
+     * Writes the coverage to the response as an uncompressed GeoTIFF, strip by strip,
+     * without temporary file. Returns false, without writing anything, if the coverage
+     * cannot be streamed or its first strip cannot be read. Throws an exception if
+     * a strip cannot be read once the response is partially sent.
+     */
+    bool writeStreamingTiff( QgsRasterPipe &pipe, const Coverage &coverage, QgsServerResponse &response )
     {
-      QgsRasterProjector *projector = new QgsRasterProjector;
-      projector->setCrs( rLayer->crs(), responseCRS );
-      if ( !pipe.insert( 2, projector ) )
+      StreamingTiff tiff;
+      if ( !streamingTiffParameters( pipe, coverage, tiff ) )
+        return false;
+
+      // the headers are only sent with the first strip, until then the request can
+      // still fall back to QgsRasterFileWriter
+      response.write( tiffHeader( coverage, tiff ) );
+
+      const int typeSize = QgsRasterBlock::typeSize( tiff.dataType );
+      const double pixelHeight = coverage.extent.height() / coverage.height;
+      QgsRasterInterface *iface = pipe.last();
+      for ( int band = 1; band <= tiff.bandCount; ++band )
       {
-        throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot set pipe projector" ) );
+        for ( int strip = 0; strip < tiff.stripsPerBand; ++strip )
+        {
+          const int firstRow = strip * tiff.rowsPerStrip;
+          const int rows = stripRows( coverage, tiff, strip );
+          const qgssize pixelCount = static_cast<qgssize>( coverage.width ) * rows;
+          const QgsRectangle stripExtent( coverage.extent.xMinimum(),
+                                          coverage.extent.yMaximum() - ( firstRow + rows ) * pixelHeight,
+                                          coverage.extent.xMaximum(),
+                                          coverage.extent.yMaximum() - firstRow * pixelHeight );
+
+          std::unique_ptr< QgsRasterBlock > block( iface->block( band, stripExtent, coverage.width, rows ) );
+          if ( !block || !block->isValid() || block->width() != coverage.width || block->height() != rows ||
+               ( block->dataType() != tiff.dataType && !block->convert( tiff.dataType ) ) )
+          {
+            if ( !response.headersSent() )
+            {
+              // nothing is sent yet, the coverage is written with QgsRasterFileWriter instead
+              response.truncate();
+              return false;
+            }
+
+            // The response is aborted, so that the client gets a truncated file
+            // rather than a valid file with empty strips
+            const QString message = QStringLiteral( "Cannot read strip %1 of band %2 for coverage %3" ).arg( strip ).arg( band ).arg( coverage.layer->name() );
+            QgsMessageLog::logMessage( message, QStringLiteral( "Server" ), QgsMessageLog::CRITICAL );
+            response.truncate();
+            throw QgsServerException( message );
+          }
+
+          if ( tiff.hasNoData && block->hasNoData() )
+          {
+            for ( qgssize i = 0; i < pixelCount; ++i )
+            {
+              if ( block->isNoData( i ) )
+                QgsRasterBlock::writeValue( block->bits(), tiff.dataType, i, tiff.noData );
+            }
+          }
+          response.write( block->bits(), static_cast<qint64>( pixelCount ) * typeSize );
+          response.flush();
+        }
       }
+      return true;
     }
+  }
 
-    QgsRasterFileWriter::WriterError err = fileWriter.writeRaster( &pipe, width, height, rect, responseCRS );
-    if ( err != QgsRasterFileWriter::NoError )
+  /**
+   * Output WCS GetCoverage response
+   */
+  void writeGetCoverage( QgsServerInterface *serverIface, const QgsProject *project, const QString &version,
+                         const QgsServerRequest &request, QgsServerResponse &response )
+  {
+    Q_UNUSED( version );
+
+    const Coverage coverage = parseCoverage( serverIface, project, request );
+    QgsRasterPipe pipe;
+    setupPipe( pipe, coverage );
+
+    response.setHeader( "Content-Type", "image/tiff" );
+    if ( !writeStreamingTiff( pipe, coverage, response ) )
     {
-      throw QgsRequestNotWellFormedException( QStringLiteral( "Cannot write raster error code: %1" ).arg( err ) );
+      response.write( coverageData( pipe, coverage ) );
     }
-    return tempFile.readAll();
+  }
+
+  QByteArray getCoverageData( QgsServerInterface *serverIface, const QgsProject *project, const QgsServerRequest &request )
+  {
+    const Coverage coverage = parseCoverage( serverIface, project, request );
+    QgsRasterPipe pipe;
+    setupPipe( pipe, coverage );
+    return coverageData( pipe, coverage );
   }
 
 } // namespace QgsWcs
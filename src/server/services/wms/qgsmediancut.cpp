@@ -24,6 +24,11 @@
 #include <QList>
 #include <QMultiMap>
 #include <QHash>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <climits>
 
 namespace QgsWms
 {
@@ -34,32 +39,6 @@ namespace QgsWms
   namespace
   {
 
-    void imageColors( QHash<QRgb, int> &colors, const QImage &image )
-    {
-      colors.clear();
-      int width = image.width();
-      int height = image.height();
-
-      const QRgb *currentScanLine = nullptr;
-      QHash<QRgb, int>::iterator colorIt;
-      for ( int i = 0; i < height; ++i )
-      {
-        currentScanLine = ( const QRgb * )( image.scanLine( i ) );
-        for ( int j = 0; j < width; ++j )
-        {
-          colorIt = colors.find( currentScanLine[j] );
-          if ( colorIt == colors.end() )
-          {
-            colors.insert( currentScanLine[j], 1 );
-          }
-          else
-          {
-            colorIt.value()++;
-          }
-        }
-      }
-    }
-
     bool minMaxRange( const QgsColorBox &colorBox, int &redRange, int &greenRange, int &blueRange, int &alphaRange )
     {
       if ( colorBox.size() < 1 )
@@ -251,73 +230,328 @@ namespace QgsWms
       colorBoxMap.insert( halfSum * 2.0 - currentSum, newColorBox2 );
     }
 
-  } // namespace
+    void medianCutColors( QVector<QRgb> &colorTable, int nColors, const QHash<QRgb, int> &inputColors )
+    {
+      if ( inputColors.size() <= nColors ) //all the colors in the image can be mapped to one palette color
+      {
+        colorTable.resize( inputColors.size() );
+        int index = 0;
+        for ( auto inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+        {
+          colorTable[index] = inputColorIt.key();
+          ++index;
+        }
+        return;
+      }
 
-  void medianCut( QVector<QRgb> &colorTable, int nColors, const QImage &inputImage )
-  {
-    QHash<QRgb, int> inputColors;
-    imageColors( inputColors, inputImage );
+      //create first box
+      QgsColorBox firstBox; //QList< QPair<QRgb, int> >
+      int firstBoxPixelSum = 0;
+      for ( auto  inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+      {
+        firstBox.push_back( qMakePair( inputColorIt.key(), inputColorIt.value() ) );
+        firstBoxPixelSum += inputColorIt.value();
+      }
 
-    if ( inputColors.size() <= nColors ) //all the colors in the image can be mapped to one palette color
-    {
-      colorTable.resize( inputColors.size() );
+      QgsColorBoxMap colorBoxMap; //QMultiMap< int, ColorBox >
+      colorBoxMap.insert( firstBoxPixelSum, firstBox );
+      QMap<int, QgsColorBox>::iterator colorBoxMapIt = colorBoxMap.end();
+
+      //split boxes until number of boxes == nColors or all the boxes have color count 1
+      bool allColorsMapped = false;
+      while ( colorBoxMap.size() < nColors )
+      {
+        //start at the end of colorBoxMap and pick the first entry with number of colors < 1
+        colorBoxMapIt = colorBoxMap.end();
+        while ( true )
+        {
+          --colorBoxMapIt;
+          if ( colorBoxMapIt.value().size() > 1 )
+          {
+            splitColorBox( colorBoxMapIt.value(), colorBoxMap, colorBoxMapIt );
+            break;
+          }
+          if ( colorBoxMapIt == colorBoxMap.begin() )
+          {
+            allColorsMapped = true;
+            break;
+          }
+        }
+
+        if ( allColorsMapped )
+        {
+          break;
+        }
+      }
+
+      //get representative colors for the boxes
       int index = 0;
-      for ( auto inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+      colorTable.resize( colorBoxMap.size() );
+      for ( auto colorBoxIt = colorBoxMap.constBegin(); colorBoxIt != colorBoxMap.constEnd(); ++colorBoxIt )
       {
-        colorTable[index] = inputColorIt.key();
+        colorTable[index] = boxColor( colorBoxIt.value(), colorBoxIt.key() );
         ++index;
       }
-      return;
     }
 
-    //create first box
-    QgsColorBox firstBox; //QList< QPair<QRgb, int> >
-    int firstBoxPixelSum = 0;
-    for ( auto  inputColorIt = inputColors.constBegin(); inputColorIt != inputColors.constEnd(); ++inputColorIt )
+    // images with less pixels are remapped in the calling thread
+    const int PARALLEL_PIXELS_THRESHOLD = 100000;
+
+    // number of histogram bins with colors reduced to 5 bits per channel (4 bits for alpha)
+    const int HISTOGRAM_SIZE = 1 << 19;
+
+    inline int histogramBin( QRgb color )
     {
-      firstBox.push_back( qMakePair( inputColorIt.key(), inputColorIt.value() ) );
-      firstBoxPixelSum += inputColorIt.value();
+      return ( ( qRed( color ) >> 3 ) << 14 ) | ( ( qGreen( color ) >> 3 ) << 9 ) | ( ( qBlue( color ) >> 3 ) << 4 ) | ( qAlpha( color ) >> 4 );
     }
 
-    QgsColorBoxMap colorBoxMap; //QMultiMap< int, ColorBox >
-    colorBoxMap.insert( firstBoxPixelSum, firstBox );
-    QMap<int, QgsColorBox>::iterator colorBoxMapIt = colorBoxMap.end();
+    // expands the reduced channels so that 0 and 255 are preserved
+    inline QRgb histogramBinColor( int bin )
+    {
+      const int red = ( bin >> 14 ) & 0x1f;
+      const int green = ( bin >> 9 ) & 0x1f;
+      const int blue = ( bin >> 4 ) & 0x1f;
+      const int alpha = bin & 0xf;
+      return qRgba( ( red << 3 ) | ( red >> 2 ), ( green << 3 ) | ( green >> 2 ), ( blue << 3 ) | ( blue >> 2 ), ( alpha << 4 ) | alpha );
+    }
 
-    //split boxes until number of boxes == nColors or all the boxes have color count 1
-    bool allColorsMapped = false;
-    while ( colorBoxMap.size() < nColors )
+    //! Collects the exact image colors. Returns false if there are more than maxColors colors.
+    bool exactImageColors( QHash<QRgb, int> &colors, const QImage &image, int maxColors )
     {
-      //start at the end of colorBoxMap and pick the first entry with number of colors < 1
-      colorBoxMapIt = colorBoxMap.end();
-      while ( true )
+      colors.clear();
+      int width = image.width();
+      int height = image.height();
+
+      for ( int i = 0; i < height; ++i )
       {
-        --colorBoxMapIt;
-        if ( colorBoxMapIt.value().size() > 1 )
+        const QRgb *currentScanLine = reinterpret_cast< const QRgb * >( image.constScanLine( i ) );
+
+        // neighbouring pixels often share the same color: count runs to
+        // avoid a hash lookup per pixel
+        QRgb runColor = currentScanLine[0];
+        int runLength = 0;
+        for ( int j = 0; j < width; ++j )
         {
-          splitColorBox( colorBoxMapIt.value(), colorBoxMap, colorBoxMapIt );
-          break;
+          if ( currentScanLine[j] == runColor )
+          {
+            ++runLength;
+            continue;
+          }
+
+          colors[runColor] += runLength;
+          if ( colors.size() > maxColors )
+            return false;
+
+          runColor = currentScanLine[j];
+          runLength = 1;
         }
-        if ( colorBoxMapIt == colorBoxMap.begin() )
+
+        colors[runColor] += runLength;
+        if ( colors.size() > maxColors )
+          return false;
+      }
+      return true;
+    }
+
+    //! Builds a histogram of the image colors reduced to 5 bits per channel (4 bits for alpha)
+    void histogramColors( QHash<QRgb, int> &colors, QVector<int> &histogram, const QImage &image )
+    {
+      histogram.fill( 0, HISTOGRAM_SIZE );
+      int width = image.width();
+      int height = image.height();
+
+      int *bins = histogram.data();
+      for ( int i = 0; i < height; ++i )
+      {
+        const QRgb *currentScanLine = reinterpret_cast< const QRgb * >( image.constScanLine( i ) );
+        for ( int j = 0; j < width; ++j )
         {
-          allColorsMapped = true;
-          break;
+          ++bins[ histogramBin( currentScanLine[j] )];
+        }
+      }
+
+      colors.clear();
+      for ( int bin = 0; bin < HISTOGRAM_SIZE; ++bin )
+      {
+        if ( bins[bin] > 0 )
+          colors.insert( histogramBinColor( bin ), bins[bin] );
+      }
+    }
+
+    int nearestColorIndex( QRgb color, const QVector<QRgb> &colorTable )
+    {
+      int nearestIndex = 0;
+      int nearestDistance = INT_MAX;
+      for ( int i = 0; i < colorTable.size(); ++i )
+      {
+        const QRgb current = colorTable.at( i );
+        const int dr = qRed( color ) - qRed( current );
+        const int dg = qGreen( color ) - qGreen( current );
+        const int db = qBlue( color ) - qBlue( current );
+        const int da = qAlpha( color ) - qAlpha( current );
+        const int distance = dr * dr + dg * dg + db * db + da * da;
+        if ( distance < nearestDistance )
+        {
+          nearestDistance = distance;
+          nearestIndex = i;
+          if ( distance == 0 )
+            break;
+        }
+      }
+      return nearestIndex;
+    }
+
+    //! Palette index lookup for images whose colors are all in the palette
+    struct ExactColorIndex
+    {
+      QHash<QRgb, uchar> indexes;
+
+      uchar operator()( QRgb color ) const
+      {
+        return indexes.value( color );
+      }
+    };
+
+    //! Palette index lookup through the reduced colors histogram
+    struct HistogramColorIndex
+    {
+      QVector<uchar> indexes;
+
+      uchar operator()( QRgb color ) const
+      {
+        return indexes.at( histogramBin( color ) );
+      }
+    };
+
+    struct RowBlock
+    {
+      int beginLine;
+      int endLine;
+    };
+
+    //! Writes the palette indexes of a block of rows in the output image
+    template <typename ColorIndex>
+    class RemapRows
+    {
+      public:
+        RemapRows( const QImage &input, uchar *outputBits, int outputBytesPerLine, const ColorIndex &colorIndex )
+          : mInput( input )
+          , mOutputBits( outputBits )
+          , mOutputBytesPerLine( outputBytesPerLine )
+          , mColorIndex( colorIndex )
+        {}
+
+        void operator()( RowBlock &block )
+        {
+          const int width = mInput.width();
+          for ( int i = block.beginLine; i < block.endLine; ++i )
+          {
+            const QRgb *inputLine = reinterpret_cast< const QRgb * >( mInput.constScanLine( i ) );
+            uchar *outputLine = mOutputBits + i * mOutputBytesPerLine;
+
+            QRgb lastColor = inputLine[0];
+            uchar lastIndex = mColorIndex( lastColor );
+            for ( int j = 0; j < width; ++j )
+            {
+              if ( inputLine[j] != lastColor )
+              {
+                lastColor = inputLine[j];
+                lastIndex = mColorIndex( lastColor );
+              }
+              outputLine[j] = lastIndex;
+            }
+          }
         }
+
+      private:
+        const QImage &mInput;
+        uchar *mOutputBits = nullptr;
+        int mOutputBytesPerLine = 0;
+        const ColorIndex &mColorIndex;
+    };
+
+    template <typename ColorIndex>
+    void remapImage( const QImage &input, QImage &output, const ColorIndex &colorIndex )
+    {
+      // scan lines are addressed from the detached output data so that
+      // threads do not have to touch the output image itself
+      const int height = input.height();
+      RemapRows<ColorIndex> remap( input, output.bits(), output.bytesPerLine(), colorIndex );
+
+      if ( input.width() * height < PARALLEL_PIXELS_THRESHOLD )
+      {
+        RowBlock block = { 0, height };
+        remap( block );
+        return;
       }
 
-      if ( allColorsMapped )
+      const int blockCount = std::max( 1, QThread::idealThreadCount() );
+      const int blockLength = height / blockCount + 1;
+      QList< RowBlock > blocks;
+      for ( int begin = 0; begin < height; begin += blockLength )
       {
-        break;
+        RowBlock block = { begin, std::min( begin + blockLength, height ) };
+        blocks << block;
       }
+
+      QtConcurrent::blockingMap( blocks, remap );
+    }
+
+  } // namespace
+
+  QImage quantizeImage( const QImage &inputImage, int nColors )
+  {
+    // RGB32 pixels are stored as 0xffRRGGBB and can be read as ARGB32
+    QImage image = inputImage;
+    if ( image.format() != QImage::Format_ARGB32 && image.format() != QImage::Format_RGB32 )
+    {
+      image = inputImage.convertToFormat( QImage::Format_ARGB32 );
+    }
+
+    QImage result( image.width(), image.height(), QImage::Format_Indexed8 );
+    if ( result.isNull() )
+    {
+      return result;
     }
+    result.setDotsPerMeterX( image.dotsPerMeterX() );
+    result.setDotsPerMeterY( image.dotsPerMeterY() );
+
+    QVector<QRgb> colorTable;
+    QHash<QRgb, int> colors;
+    if ( exactImageColors( colors, image, nColors ) )
+    {
+      // all the image colors fit in the palette
+      medianCutColors( colorTable, nColors, colors );
 
-    //get representative colors for the boxes
-    int index = 0;
-    colorTable.resize( colorBoxMap.size() );
-    for ( auto colorBoxIt = colorBoxMap.constBegin(); colorBoxIt != colorBoxMap.constEnd(); ++colorBoxIt )
+      ExactColorIndex colorIndex;
+      for ( int i = 0; i < colorTable.size(); ++i )
+      {
+        colorIndex.indexes.insert( colorTable.at( i ), static_cast< uchar >( i ) );
+      }
+
+      result.setColorTable( colorTable );
+      remapImage( image, result, colorIndex );
+    }
+    else
     {
-      colorTable[index] = boxColor( colorBoxIt.value(), colorBoxIt.key() );
-      ++index;
+      QVector<int> histogram;
+      histogramColors( colors, histogram, image );
+      medianCutColors( colorTable, nColors, colors );
+
+      // resolve the nearest palette color once per used histogram bin
+      HistogramColorIndex colorIndex;
+      colorIndex.indexes.fill( 0, HISTOGRAM_SIZE );
+      for ( int bin = 0; bin < HISTOGRAM_SIZE; ++bin )
+      {
+        if ( histogram.at( bin ) > 0 )
+          colorIndex.indexes[bin] = static_cast< uchar >( nearestColorIndex( histogramBinColor( bin ), colorTable ) );
+      }
+
+      result.setColorTable( colorTable );
+      remapImage( image, result, colorIndex );
     }
+
+    return result;
   }
 
 } // namespace QgsWms
@@ -35,9 +35,14 @@ namespace QgsWms
 {
 
   /**
-   * Median cut implementation used when reducing RGB colors to palletized colors
+   * Converts an image to an 8 bits palettized image with at most nColors colors.
+   *
+   * The palette is computed with a median cut over the exact image colors
+   * when there are few of them, or over a histogram of the colors reduced to
+   * 5 bits per channel (4 bits for alpha) otherwise. Pixels are then remapped
+   * with a lookup table, in parallel for large images.
    */
-  void medianCut( QVector<QRgb> &colorTable, int nColors, const QImage &inputImage );
+  QImage quantizeImage( const QImage &inputImage, int nColors );
 
 } // namespace QgsWms
 
@@ -20,6 +20,7 @@
  ***************************************************************************/
 #include "qgswmsutils.h"
 #include "qgswmsgetmap.h"
+#include "qgswmsmetatile.h"
 #include "qgswmsrenderer.h"
 
 #include <QImage>
@@ -34,13 +35,20 @@ namespace QgsWms
     Q_UNUSED( version );
 
     QgsServerRequest::Parameters params = request.parameters();
-    QgsRenderer renderer( serverIface, project, params );
 
-    std::unique_ptr<QImage> result( renderer.getMap() );
+    // tile shaped requests may be served from a metatile, in which case
+    // cached tiles are returned without setting up a renderer
+    std::unique_ptr<QImage> result( getMetatiledMap( serverIface, project, params ) );
+    if ( !result )
+    {
+      QgsRenderer renderer( serverIface, project, params );
+      result.reset( renderer.getMap() );
+    }
+
     if ( result )
     {
       QString format = params.value( QStringLiteral( "FORMAT" ), QStringLiteral( "PNG" ) );
-      writeImage( response, *result, format, renderer.getImageQuality() );
+      writeImage( response, *result, format, imageQuality( *project, params ) );
     }
     else
     {
@@ -0,0 +1,254 @@
+/***************************************************************************
+                              qgswmsmetatile.cpp
+                              -------------------------
+  begin                : October 18, 2026
+  copyright            : (C) 2026 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgswmsutils.h"
+#include "qgswmsmetatile.h"
+#include "qgswmsrenderer.h"
+#include "qgsaccesscontrol.h"
+#include "qgscoordinatereferencesystem.h"
+#include "qgsproject.h"
+#include "qgsprojectversion.h"
+#include "qgsserverprojectutils.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+
+namespace QgsWms
+{
+
+  namespace
+  {
+    // Tile shaped requests out of this range are rendered as regular requests
+    const int MIN_TILE_SIZE = 64;
+    const int MAX_TILE_SIZE = 1024;
+
+    // Metatiles are never rendered larger than this, even if the project
+    // does not limit the size of GetMap images
+    const int MAX_METATILE_SIZE = 4096;
+
+    // Maximum offset (in fraction of tile) between the BBOX and the tile grid
+    const double GRID_TOLERANCE = 1e-3;
+
+    // Returns the index of the grid cell starting at origin, or false if
+    // origin is not aligned on the grid
+    bool gridIndex( double origin, double cellSize, qint64 &index )
+    {
+      const double position = origin / cellSize;
+      const double rounded = std::round( position );
+      if ( std::fabs( position - rounded ) > GRID_TOLERANCE )
+        return false;
+
+      index = static_cast<qint64>( rounded );
+      return true;
+    }
+
+    // Returns the first index of the metatile containing the grid cell
+    qint64 metatileIndex( qint64 index, int metatileSize )
+    {
+      return static_cast<qint64>( std::floor( static_cast<double>( index ) / metatileSize ) ) * metatileSize;
+    }
+
+    QString toString( double value )
+    {
+      return QString::number( value, 'g', 17 );
+    }
+  }
+
+  QgsWmsMetatile::QgsWmsMetatile( const QgsServerRequest::Parameters &parameters, int metatileSize )
+    : mParameters( parameters )
+    , mSize( metatileSize )
+  {
+    if ( metatileSize < 2 )
+      return;
+
+    bool widthOk = false;
+    bool heightOk = false;
+    const int width = parameters.value( QStringLiteral( "WIDTH" ) ).toInt( &widthOk );
+    const int height = parameters.value( QStringLiteral( "HEIGHT" ) ).toInt( &heightOk );
+    if ( !widthOk || !heightOk || width != height || width < MIN_TILE_SIZE || width > MAX_TILE_SIZE )
+      return;
+
+    // parse the BBOX without reordering the axis so that the metatile
+    // BBOX is built with the same axis order as the request
+    const QStringList bbox = parameters.value( QStringLiteral( "BBOX" ) ).split( ',' );
+    if ( bbox.count() != 4 )
+      return;
+
+    double d[4];
+    for ( int i = 0; i < 4; i++ )
+    {
+      bool ok = false;
+      QString value = bbox.at( i );
+      d[i] = value.replace( ' ', '+' ).toDouble( &ok );
+      if ( !ok )
+        return;
+    }
+
+    const double cellSize1 = d[2] - d[0];
+    const double cellSize2 = d[3] - d[1];
+    if ( cellSize1 <= 0 || cellSize2 <= 0 )
+      return;
+
+    qint64 index1 = 0;
+    qint64 index2 = 0;
+    if ( !gridIndex( d[0], cellSize1, index1 ) || !gridIndex( d[1], cellSize2, index2 ) )
+      return;
+
+    const qint64 metaIndex1 = metatileIndex( index1, metatileSize );
+    const qint64 metaIndex2 = metatileIndex( index2, metatileSize );
+
+    mMetatileBbox = QStringLiteral( "%1,%2,%3,%4" ).arg( toString( metaIndex1 * cellSize1 ),
+                    toString( metaIndex2 * cellSize2 ),
+                    toString( ( metaIndex1 + metatileSize ) * cellSize1 ),
+                    toString( ( metaIndex2 + metatileSize ) * cellSize2 ) );
+
+    // the first BBOX axis is the image y axis for WMS 1.3.0 requests in a
+    // CRS with inverted axis (see QgsRenderer::configureMapSettings)
+    QString version = parameters.value( QStringLiteral( "VERSION" ) );
+    QString crs = parameters.value( QStringLiteral( "CRS" ) );
+    if ( crs.isEmpty() )
+      crs = parameters.value( QStringLiteral( "SRS" ) );
+
+    bool invertedAxis = false;
+    if ( ( version.isEmpty() || QgsProjectVersion( version ) >= QgsProjectVersion( 1, 3, 0 ) )
+         && crs.compare( QLatin1String( "CRS:84" ), Qt::CaseInsensitive ) != 0 )
+    {
+      invertedAxis = QgsCoordinateReferenceSystem::fromOgcWmsCrs( crs ).hasAxisInverted();
+    }
+
+    const int offset1 = static_cast<int>( index1 - metaIndex1 );
+    const int offset2 = static_cast<int>( index2 - metaIndex2 );
+    if ( invertedAxis )
+      mTilePosition = QPoint( offset2, metatileSize - 1 - offset1 );
+    else
+      mTilePosition = QPoint( offset1, metatileSize - 1 - offset2 );
+
+    mTileSize = width;
+    mValid = true;
+  }
+
+  QgsServerRequest::Parameters QgsWmsMetatile::metatileParameters() const
+  {
+    QgsServerRequest::Parameters parameters = mParameters;
+    parameters.insert( QStringLiteral( "BBOX" ), mMetatileBbox );
+    parameters.insert( QStringLiteral( "WIDTH" ), QString::number( mTileSize * mSize ) );
+    parameters.insert( QStringLiteral( "HEIGHT" ), QString::number( mTileSize * mSize ) );
+    return parameters;
+  }
+
+  QRect QgsWmsMetatile::tileRect( const QPoint &position ) const
+  {
+    return QRect( position.x() * mTileSize, position.y() * mTileSize, mTileSize, mTileSize );
+  }
+
+  QgsWmsMetatileCache *QgsWmsMetatileCache::instance()
+  {
+    static QgsWmsMetatileCache *sInstance = new QgsWmsMetatileCache();
+    return sInstance;
+  }
+
+  void QgsWmsMetatileCache::setMaxSize( qint64 size )
+  {
+    mTiles.setMaxCost( static_cast<int>( std::min( size / 1024, static_cast<qint64>( std::numeric_limits<int>::max() ) ) ) );
+  }
+
+  QImage QgsWmsMetatileCache::tile( const QString &key ) const
+  {
+    QImage *image = mTiles.object( key );
+    return image ? *image : QImage();
+  }
+
+  void QgsWmsMetatileCache::insertTile( const QString &key, const QImage &tile )
+  {
+    mTiles.insert( key, new QImage( tile ), std::max( 1, tile.byteCount() / 1024 ) );
+  }
+
+  QImage *getMetatiledMap( QgsServerInterface *serverIface, const QgsProject *project,
+                           const QgsServerRequest::Parameters &parameters )
+  {
+    const QgsServerSettings *settings = serverIface->serverSettings();
+    const QgsWmsMetatile metatile( parameters, settings->wmsMetatileSize() );
+    if ( !metatile.isValid() )
+      return nullptr;
+
+    // the metatile has to be renderable within the project limits
+    const int metatileWidth = metatile.tileSize() * metatile.size();
+    const int wmsMaxWidth = QgsServerProjectUtils::wmsMaxWidth( *project );
+    const int wmsMaxHeight = QgsServerProjectUtils::wmsMaxHeight( *project );
+    if ( metatileWidth > MAX_METATILE_SIZE
+         || ( wmsMaxWidth != -1 && metatileWidth > wmsMaxWidth ) || ( wmsMaxHeight != -1 && metatileWidth > wmsMaxHeight ) )
+      return nullptr;
+
+    // the cache key is made of everything but the tile position
+    QStringList cacheKeyList;
+    cacheKeyList << project->fileName();
+    cacheKeyList << QString::number( QFileInfo( project->fileName() ).lastModified().toMSecsSinceEpoch() );
+    for ( auto it = parameters.constBegin(); it != parameters.constEnd(); ++it )
+    {
+      if ( it.key() == QLatin1String( "BBOX" ) || it.key() == QLatin1String( "WIDTH" ) || it.key() == QLatin1String( "HEIGHT" ) )
+        continue;
+
+      cacheKeyList << it.key() + '=' + it.value();
+    }
+    cacheKeyList << metatile.metatileBbox();
+
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+    QgsAccessControl *accessControl = serverIface->accessControls();
+    if ( accessControl && !accessControl->fillCacheKey( cacheKeyList ) )
+      return nullptr;
+#endif
+
+    const QString cacheKey = cacheKeyList.join( QStringLiteral( "-" ) );
+    const auto tileKey = [&cacheKey]( const QPoint & position )
+    {
+      return QStringLiteral( "%1-%2-%3" ).arg( cacheKey ).arg( position.x() ).arg( position.y() );
+    };
+
+    QgsWmsMetatileCache *cache = QgsWmsMetatileCache::instance();
+    cache->setMaxSize( settings->wmsMetatileCacheSize() );
+
+    QImage tile = cache->tile( tileKey( metatile.tilePosition() ) );
+    if ( !tile.isNull() )
+      return new QImage( tile );
+
+    // render the whole metatile and slice it
+    const QgsServerRequest::Parameters metatileParameters = metatile.metatileParameters();
+    QgsRenderer renderer( serverIface, project, metatileParameters );
+    std::unique_ptr<QImage> metatileImage( renderer.getMap() );
+    if ( !metatileImage || metatileImage->width() != metatileWidth || metatileImage->height() != metatileWidth )
+      return nullptr;
+
+    for ( int row = 0; row < metatile.size(); ++row )
+    {
+      for ( int column = 0; column < metatile.size(); ++column )
+      {
+        const QPoint position( column, row );
+        const QImage slice = metatileImage->copy( metatile.tileRect( position ) );
+        if ( position == metatile.tilePosition() )
+          tile = slice;
+
+        cache->insertTile( tileKey( position ), slice );
+      }
+    }
+
+    return new QImage( tile );
+  }
+
+} // namespace QgsWms
@@ -0,0 +1,120 @@
+/***************************************************************************
+                              qgswmsmetatile.h
+                              -------------------------
+  begin                : October 18, 2026
+  copyright            : (C) 2026 by the QGIS project
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSWMSMETATILE_H
+#define QGSWMSMETATILE_H
+
+#include "qgsserverrequest.h"
+
+#include <QCache>
+#include <QImage>
+#include <QRect>
+#include <QString>
+
+class QgsProject;
+class QgsServerInterface;
+
+namespace QgsWms
+{
+
+  /**
+   * \ingroup server
+   * Snaps a tile shaped GetMap request (square image with a BBOX aligned on
+   * a regular grid of its own size) to a metatile of NxN tiles.
+   *
+   * Rendering the whole metatile once makes labels consistent across tile
+   * edges and lets the neighbouring tiles be served from a cache.
+   * \since QGIS 3.0
+   */
+  class QgsWmsMetatile
+  {
+    public:
+
+      /**
+       * Constructor
+       * \param parameters the GetMap request parameters
+       * \param metatileSize number of tiles per side of the metatile
+       */
+      QgsWmsMetatile( const QgsServerRequest::Parameters &parameters, int metatileSize );
+
+      //! Returns true if the request is tile shaped and may be metatiled
+      bool isValid() const { return mValid; }
+
+      //! Returns the parameters to use to render the whole metatile
+      QgsServerRequest::Parameters metatileParameters() const;
+
+      //! Returns the metatile BBOX in the axis order of the request
+      QString metatileBbox() const { return mMetatileBbox; }
+
+      //! Returns the number of tiles per side of the metatile
+      int size() const { return mSize; }
+
+      //! Returns the tile size in pixels
+      int tileSize() const { return mTileSize; }
+
+      //! Returns the position (column, row) of the requested tile in the metatile
+      QPoint tilePosition() const { return mTilePosition; }
+
+      //! Returns the area covered by the tile at the given position in the metatile image
+      QRect tileRect( const QPoint &position ) const;
+
+    private:
+      QgsServerRequest::Parameters mParameters;
+      bool mValid = false;
+      int mSize = 0;
+      int mTileSize = 0;
+      QString mMetatileBbox;
+      QPoint mTilePosition;
+  };
+
+  /**
+   * \ingroup server
+   * In-memory cache of the tiles sliced from rendered metatiles. The cost of
+   * an entry is the size of its image in kilobytes.
+   * \since QGIS 3.0
+   */
+  class QgsWmsMetatileCache
+  {
+    public:
+      static QgsWmsMetatileCache *instance();
+
+      //! Sets the maximum size of the cache in bytes
+      void setMaxSize( qint64 size );
+
+      //! Returns a copy of the cached tile or a null image if not found
+      QImage tile( const QString &key ) const;
+
+      //! Inserts a tile in the cache
+      void insertTile( const QString &key, const QImage &tile );
+
+    private:
+      QgsWmsMetatileCache() = default;
+
+      QCache<QString, QImage> mTiles;
+  };
+
+  /**
+   * Returns the map for a tile shaped GetMap request. The metatile containing
+   * the requested tile is rendered and sliced if the tile is not cached yet.
+   * \returns the tile image or a null pointer if the request cannot be
+   * metatiled (in which case it has to be rendered as a regular request). The
+   * caller takes ownership of the image.
+   */
+  QImage *getMetatiledMap( QgsServerInterface *serverIface, const QgsProject *project,
+                           const QgsServerRequest::Parameters &parameters );
+
+} // namespace QgsWms
+
+#endif
@@ -22,12 +22,14 @@
 #include "qgswmsrenderer.h"
 #include "qgsfilterrestorer.h"
 #include "qgscapabilitiescache.h"
+#include "qgsconfigcache.h"
 #include "qgsexception.h"
 #include "qgsfields.h"
 #include "qgsfieldformatter.h"
 #include "qgsfieldformatterregistry.h"
 #include "qgsfeatureiterator.h"
 #include "qgsgeometry.h"
+#include "qgsgeometryengine.h"
 #include "qgsmapserviceexception.h"
 #include "qgslayertree.h"
 #include "qgslayertreemodel.h"
@@ -1438,14 +1440,39 @@ namespace QgsWms
       fReq.setFlags( fReq.flags() & ~ QgsFeatureRequest::ExactIntersect );
     }
 
+    // Look for the features intersecting the search rectangle in a spatial index
+    // kept with the cached project, so that the cost of the request depends on
+    // the number of hits only. The filter expression is then evaluated on the hits.
+    const bool useIndex = mSettings.wmsFeatureInfoIndex() && !searchRect.isEmpty() &&
+                          layer->wkbType() != QgsWkbTypes::NoGeometry && !mProject->fileName().isEmpty();
+
+    // The filter geometry is tested on the hits of the index with a prepared geometry,
+    // and otherwise with an expression, which gives the same features
+    std::unique_ptr< QgsGeometryEngine > filterGeomEngine;
+    QString filterGeomExpression;
     if ( filterGeom )
     {
-      fReq.setFilterExpression( QString( "intersects( $geometry, geom_from_wkt('%1') )" ).arg( filterGeom->exportToWkt() ) );
+      if ( useIndex )
+      {
+        filterGeomEngine.reset( QgsGeometry::createGeometryEngine( filterGeom->geometry() ) );
+        filterGeomEngine->prepareGeometry();
+      }
+      else
+      {
+        filterGeomExpression = QStringLiteral( "intersects( $geometry, geom_from_wkt('%1') )" ).arg( filterGeom->exportToWkt() );
+        fReq.setFilterExpression( filterGeomExpression );
+      }
     }
 
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
     mAccessControl->filterFeatures( layer, fReq );
 
+    // the access control filter replaces the filter geometry expression, both have to be satisfied
+    if ( !filterGeomExpression.isEmpty() && fReq.filterExpression() && fReq.filterExpression()->expression() != filterGeomExpression )
+    {
+      fReq.setFilterExpression( QStringLiteral( "( %1 ) AND ( %2 )" ).arg( filterGeomExpression, fReq.filterExpression()->expression() ) );
+    }
+
     QStringList attributes;
     QgsField field;
     Q_FOREACH ( field, layer->pendingFields().toList() )
@@ -1456,6 +1483,32 @@ namespace QgsWms
     fReq.setSubsetOfAttributes( attributes, layer->pendingFields() );
 #endif
 
+    std::unique_ptr< QgsExpression > hitsFilter;
+    QgsExpressionContext hitsFilterContext;
+    if ( useIndex )
+    {
+      if ( fReq.filterType() == QgsFeatureRequest::FilterExpression && fReq.filterExpression() )
+      {
+        hitsFilterContext.appendScopes( QgsExpressionContextUtils::globalProjectLayerScopes( layer ) );
+        hitsFilter.reset( new QgsExpression( *fReq.filterExpression() ) );
+        hitsFilter->prepare( &hitsFilterContext );
+        if ( fReq.flags() & QgsFeatureRequest::SubsetOfAttributes )
+        {
+          QgsAttributeList subset = fReq.subsetOfAttributes();
+          Q_FOREACH ( int idx, hitsFilter->referencedAttributeIndexes( fields ) )
+          {
+            if ( !subset.contains( idx ) )
+              subset << idx;
+          }
+          fReq.setSubsetOfAttributes( subset );
+        }
+      }
+
+      // the exact intersection with the search rectangle is tested on the hits
+      fReq.setFlags( fReq.flags() & ~QgsFeatureRequest::NoGeometry );
+      fReq.setFilterFids( QgsConfigCache::instance()->layerSpatialIndex( mProject, layer ).intersects( searchRect ).toSet() );
+    }
+
     QgsFeatureIterator fit = layer->getFeatures( fReq );
     QgsFeatureRenderer *r2 = layer->renderer();
     if ( r2 )
@@ -1471,6 +1524,28 @@ namespace QgsWms
         break;
       }
 
+      if ( filterGeomEngine && ( !feature.hasGeometry() || !filterGeomEngine->intersects( feature.geometry().geometry() ) ) )
+      {
+        continue;
+      }
+
+      if ( useIndex )
+      {
+        if ( !feature.hasGeometry() || !feature.geometry().intersects( searchRect ) )
+        {
+          continue;
+        }
+
+        if ( hitsFilter )
+        {
+          hitsFilterContext.setFeature( feature );
+          if ( !hitsFilter->evaluate( &hitsFilterContext ).toBool() )
+          {
+            continue;
+          }
+        }
+      }
+
       ++featureCounter;
       if ( featureCounter > nFeatures )
       {
@@ -2249,22 +2324,7 @@ namespace QgsWms
 
   int QgsRenderer::getImageQuality() const
   {
-
-    // First taken from QGIS project
-    int imageQuality = QgsServerProjectUtils::wmsImageQuality( *mProject );
-
-    // Then checks if a parameter is given, if so use it instead
-    if ( mParameters.contains( QStringLiteral( "IMAGE_QUALITY" ) ) )
-    {
-      bool conversionSuccess;
-      int imageQualityParameter;
-      imageQualityParameter = mParameters[ QStringLiteral( "IMAGE_QUALITY" )].toInt( &conversionSuccess );
-      if ( conversionSuccess )
-      {
-        imageQuality = imageQualityParameter;
-      }
-    }
-    return imageQuality;
+    return imageQuality( *mProject, mParameters );
   }
 
   int QgsRenderer::getWMSPrecision() const
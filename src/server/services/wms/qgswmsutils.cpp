@@ -117,16 +117,10 @@ namespace QgsWms
         saveFormat = "PNG";
         break;
       case PNG8:
-      {
-        QVector<QRgb> colorTable;
-        medianCut( colorTable, 256, img );
-        result = img.convertToFormat( QImage::Format_Indexed8, colorTable,
-                                      Qt::ColorOnly | Qt::ThresholdDither |
-                                      Qt::ThresholdAlphaDither | Qt::NoOpaqueDetection );
-      }
-      contentType = "image/png";
-      saveFormat = "PNG";
-      break;
+        result = quantizeImage( img, 256 );
+        contentType = "image/png";
+        saveFormat = "PNG";
+        break;
       case PNG16:
         result = img.convertToFormat( QImage::Format_ARGB4444_Premultiplied );
         contentType = "image/png";
@@ -162,6 +156,25 @@ namespace QgsWms
     }
   }
 
+  int imageQuality( const QgsProject &project, const QgsServerRequest::Parameters &parameters )
+  {
+    // First taken from QGIS project
+    int quality = QgsServerProjectUtils::wmsImageQuality( project );
+
+    // Then checks if a parameter is given, if so use it instead
+    if ( parameters.contains( QStringLiteral( "IMAGE_QUALITY" ) ) )
+    {
+      bool conversionSuccess;
+      int imageQualityParameter;
+      imageQualityParameter = parameters[ QStringLiteral( "IMAGE_QUALITY" )].toInt( &conversionSuccess );
+      if ( conversionSuccess )
+      {
+        quality = imageQualityParameter;
+      }
+    }
+    return quality;
+  }
+
   QgsRectangle parseBbox( const QString &bboxStr )
   {
     QStringList lst = bboxStr.split( ',' );
@@ -69,6 +69,12 @@ namespace QgsWms
   void writeImage( QgsServerResponse &response, QImage &img, const QString &formatStr,
                    int imageQuality = -1 );
 
+  /**
+   * Returns the image quality of the project, or the one of the IMAGE_QUALITY
+   * parameter if it is given
+   */
+  int imageQuality( const QgsProject &project, const QgsServerRequest::Parameters &parameters );
+
   /**
    * Parse bbox parameter
    * \param bboxstr the bbox string as comma separated values
@@ -0,0 +1,283 @@
+/***************************************************************************
+     testqgskde.cpp
+     --------------------------------------
+    Date                 : October 2017
+    Copyright            : (C) 2017 by the QGIS project
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QDir>
+#include "qgstest.h"
+
+#include "qgsapplication.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+#include "qgskde.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+#include <gdal.h>
+
+#include <cmath>
+#include <memory>
+
+/**
+ * \ingroup UnitTests
+ * This is a unit test for the kernel density estimation
+ */
+class TestQgsKernelDensityEstimation : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init() {}
+    void cleanup() {}
+
+    void testTiles();
+
+  private:
+    QgsVectorLayer *pointLayer() const;
+    QgsFeatureList overflowingFeatures( const QgsVectorLayer *layer ) const;
+    QgsKernelDensityEstimation::Result accumulate( QgsKernelDensityEstimation &kde, const QgsVectorLayer *layer, const QgsFeatureList &extraFeatures ) const;
+    bool readRaster( const QString &fileName, QVector<float> &values, int &columns, int &rows ) const;
+};
+
+// the raster extends 30 map units (the maximum radius) around the points, and
+// is made of 5 x 4 tiles of 256 pixels of 0.7 map units
+static const double RADIUS = 30;
+static const double PIXEL_SIZE = 0.7;
+static const float NO_DATA = -9999;
+
+void TestQgsKernelDensityEstimation::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  GDALAllRegister();
+}
+
+void TestQgsKernelDensityEstimation::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QgsVectorLayer *TestQgsKernelDensityEstimation::pointLayer() const
+{
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Point?crs=epsg:3857&field=weight:double&field=radius:double" ), QStringLiteral( "points" ), QStringLiteral( "memory" ) );
+
+  struct Point
+  {
+    QgsPointXY point;
+    double weight;
+    double radius;
+  };
+  QList< Point > points;
+
+  // corners of the extent, whose kernel windows reach the raster edges
+  points << Point{ QgsPointXY( 0, 0 ), 1.0, RADIUS } << Point{ QgsPointXY( 700, 600 ), 2.0, RADIUS }
+         << Point{ QgsPointXY( 0, 600 ), 1.5, RADIUS } << Point{ QgsPointXY( 700, 0 ), 0.5, RADIUS };
+
+  // points on the edges of the 256 pixels tiles, which start every 179.2 map units
+  // from the top left corner (-30, 630) of the raster
+  points << Point{ QgsPointXY( 149.2, 450.8 ), 1.0, RADIUS } << Point{ QgsPointXY( 149.0, 271.6 ), 2.0, 20 }
+         << Point{ QgsPointXY( 328.4, 450.8 ), 3.0, RADIUS } << Point{ QgsPointXY( 507.6, 300 ), 1.0, 20 }
+         << Point{ QgsPointXY( 328.5, 271.5 ), 2.0, RADIUS } << Point{ QgsPointXY( 507.7, 92.5 ), 1.0, 10 };
+
+  // and overlapping kernels all over the raster
+  for ( int i = 0; i < 400; ++i )
+  {
+    points << Point{ QgsPointXY( std::fmod( i * 37.3, 700.0 ), std::fmod( i * 53.9, 600.0 ) ), 1.0 + i % 3, i % 4 == 0 ? 20 : RADIUS };
+  }
+
+  QgsFeatureList features;
+  for ( const Point &point : qgsAsConst( points ) )
+  {
+    QgsFeature feature( layer->fields() );
+    feature.setGeometry( QgsGeometry::fromPoint( point.point ) );
+    feature.setAttributes( QgsAttributes() << point.weight << point.radius );
+    features << feature;
+  }
+  layer->dataProvider()->addFeatures( features );
+  layer->updateExtents();
+  return layer;
+}
+
+QgsFeatureList TestQgsKernelDensityEstimation::overflowingFeatures( const QgsVectorLayer *layer ) const
+{
+  // features added on top of the source ones, with a radius larger than the
+  // distance to the raster edges: their kernel windows are clipped to the raster
+  QgsFeatureList features;
+  const QList< QgsPointXY > points = QList< QgsPointXY >() << QgsPointXY( 0, 0 ) << QgsPointXY( 700, 600 ) << QgsPointXY( 10, 590 );
+  for ( const QgsPointXY &point : points )
+  {
+    QgsFeature feature( layer->fields() );
+    feature.setGeometry( QgsGeometry::fromPoint( point ) );
+    feature.setAttributes( QgsAttributes() << 1.0 << 2 * RADIUS );
+    features << feature;
+  }
+  return features;
+}
+
+QgsKernelDensityEstimation::Result TestQgsKernelDensityEstimation::accumulate( QgsKernelDensityEstimation &kde, const QgsVectorLayer *layer, const QgsFeatureList &extraFeatures ) const
+{
+  QgsKernelDensityEstimation::Result result = kde.prepare();
+  if ( result != QgsKernelDensityEstimation::Success )
+    return result;
+
+  QgsFeatureIterator it = layer->getFeatures();
+  QgsFeature feature;
+  while ( it.nextFeature( feature ) )
+    kde.addFeature( feature );
+  for ( const QgsFeature &extraFeature : extraFeatures )
+    kde.addFeature( extraFeature );
+
+  return kde.finalise();
+}
+
+bool TestQgsKernelDensityEstimation::readRaster( const QString &fileName, QVector<float> &values, int &columns, int &rows ) const
+{
+  GDALDatasetH dataset = GDALOpen( fileName.toUtf8().constData(), GA_ReadOnly );
+  if ( !dataset )
+    return false;
+
+  columns = GDALGetRasterXSize( dataset );
+  rows = GDALGetRasterYSize( dataset );
+  values.resize( columns * rows );
+  const bool ok = GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, columns, rows,
+                                values.data(), columns, rows, GDT_Float32, 0, 0 ) == CE_None;
+  GDALClose( dataset );
+  return ok;
+}
+
+void TestQgsKernelDensityEstimation::testTiles()
+{
+  std::unique_ptr< QgsVectorLayer > layer( pointLayer() );
+  QCOMPARE( layer->extent(), QgsRectangle( 0, 0, 700, 600 ) );
+  const QgsFeatureList extraFeatures = overflowingFeatures( layer.get() );
+
+  QgsKernelDensityEstimation::Parameters parameters;
+  parameters.source = layer.get();
+  parameters.radius = RADIUS;
+  parameters.radiusField = QStringLiteral( "radius" );
+  parameters.weightField = QStringLiteral( "weight" );
+  parameters.pixelSize = PIXEL_SIZE;
+  parameters.shape = QgsKernelDensityEstimation::KernelQuartic;
+  parameters.decayRatio = 0;
+  parameters.outputValues = QgsKernelDensityEstimation::OutputRaw;
+
+  // all the tiles in memory
+  const QString fileName = QDir::tempPath() + "/kde_tiles.tif";
+  QgsKernelDensityEstimation kde( parameters, fileName, QStringLiteral( "GTiff" ) );
+  QCOMPARE( kde.maximumTileCount(), 1024 );
+  QCOMPARE( accumulate( kde, layer.get(), extraFeatures ), QgsKernelDensityEstimation::Success );
+
+  QVector<float> values;
+  int columns = 0;
+  int rows = 0;
+  QVERIFY( readRaster( fileName, values, columns, rows ) );
+  QCOMPARE( columns, 1087 );
+  QCOMPARE( rows, 944 );
+
+  // a single tile in memory, tiles are written to the raster and read back
+  // for almost every point
+  const QString spilledFileName = QDir::tempPath() + "/kde_tiles_spilled.tif";
+  QgsKernelDensityEstimation spilledKde( parameters, spilledFileName, QStringLiteral( "GTiff" ) );
+  spilledKde.setMaximumTileCount( 1 );
+  QCOMPARE( spilledKde.maximumTileCount(), 1 );
+  QCOMPARE( accumulate( spilledKde, layer.get(), extraFeatures ), QgsKernelDensityEstimation::Success );
+
+  QVector<float> spilledValues;
+  int spilledColumns = 0;
+  int spilledRows = 0;
+  QVERIFY( readRaster( spilledFileName, spilledValues, spilledColumns, spilledRows ) );
+  QCOMPARE( spilledColumns, columns );
+  QCOMPARE( spilledRows, rows );
+
+  // the points are summed in the same order whatever the number of tiles in memory
+  QVERIFY( spilledValues == values );
+
+  // reference: the kernel of each point added to the raster one after the other,
+  // as the pixel windows were read and written for every point
+  const double xMin = -RADIUS;
+  const double yMin = -RADIUS;
+  const double yMax = 600 + RADIUS;
+  QVector<double> reference( columns * rows, NO_DATA );
+  int edgeWindows = 0;
+  int clippedWindows = 0;
+
+  QgsFeatureList features;
+  QgsFeatureIterator it = layer->getFeatures();
+  QgsFeature sourceFeature;
+  while ( it.nextFeature( sourceFeature ) )
+    features << sourceFeature;
+  features << extraFeatures;
+
+  for ( const QgsFeature &feature : qgsAsConst( features ) )
+  {
+    const QgsPointXY point = feature.geometry().asPoint();
+    const double weight = feature.attribute( 0 ).toDouble();
+    const double radius = feature.attribute( 1 ).toDouble();
+
+    int buffer = radius / PIXEL_SIZE;
+    if ( radius - PIXEL_SIZE * buffer > 0.5 )
+      ++buffer;
+    const int blockSize = 2 * buffer + 1;
+
+    const int xPosition = ( ( point.x() - xMin ) / PIXEL_SIZE ) - buffer;
+    const int yPosition = ( ( point.y() - yMin ) / PIXEL_SIZE ) - buffer;
+    const int yPositionIO = ( ( yMax - point.y() ) / PIXEL_SIZE ) - buffer;
+    if ( xPosition < 0 || yPositionIO < 0 || xPosition + blockSize > columns || yPositionIO + blockSize > rows )
+      clippedWindows++;
+    else if ( xPosition == 0 || yPositionIO == 0 || xPosition + blockSize == columns || yPositionIO + blockSize == rows )
+      edgeWindows++;
+
+    for ( int yp = 0; yp < blockSize; ++yp )
+    {
+      for ( int xp = 0; xp < blockSize; ++xp )
+      {
+        const int column = xPosition + xp;
+        const int row = yPositionIO + yp;
+        if ( column < 0 || row < 0 || column >= columns || row >= rows )
+          continue;
+
+        const double pixelCentroidX = ( xPosition + xp + 0.5 ) * PIXEL_SIZE + xMin;
+        const double pixelCentroidY = ( yPosition + yp + 0.5 ) * PIXEL_SIZE + yMin;
+        const double distance = std::sqrt( std::pow( pixelCentroidX - point.x(), 2.0 ) + std::pow( pixelCentroidY - point.y(), 2.0 ) );
+        if ( distance > radius )
+          continue;
+
+        double &value = reference[ row * columns + column ];
+        if ( value == NO_DATA )
+          value = 0;
+        value += weight * std::pow( 1. - std::pow( distance / radius, 2 ), 2 );
+      }
+    }
+  }
+  QVERIFY( edgeWindows >= 4 );
+  QCOMPARE( clippedWindows, extraFeatures.count() );
+
+  for ( int i = 0; i < values.size(); ++i )
+  {
+    if ( reference.at( i ) == NO_DATA )
+    {
+      QCOMPARE( values.at( i ), NO_DATA );
+    }
+    else if ( !qgsDoubleNear( values.at( i ), reference.at( i ), 1e-4 * std::max( 1.0, std::fabs( reference.at( i ) ) ) ) )
+    {
+      QFAIL( QStringLiteral( "Pixel %1, %2: %3 instead of %4" ).arg( i % columns ).arg( i / columns ).arg( values.at( i ) ).arg( reference.at( i ) ).toUtf8().constData() );
+    }
+  }
+
+  QFile::remove( fileName );
+  QFile::remove( spilledFileName );
+}
+
+QGSTEST_MAIN( TestQgsKernelDensityEstimation )
+#include "testqgskde.moc"
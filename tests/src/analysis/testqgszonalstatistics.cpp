@@ -19,10 +19,16 @@
 #include "qgsapplication.h"
 #include "qgsfeatureiterator.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectordataprovider.h"
 #include "qgsrasterlayer.h"
 #include "qgszonalstatistics.h"
 #include "qgsproject.h"
 
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <memory>
+
 /**
  * \ingroup UnitTests
  * This is a unit test for the zonal statistics class
@@ -38,8 +44,11 @@ class TestQgsZonalStatistics : public QObject
     void cleanup() {}
 
     void testStatistics();
+    void testParallelStatistics();
 
   private:
+    QgsVectorLayer *gridPolygonLayer() const;
+
     QgsVectorLayer *mVectorLayer = nullptr;
     QgsRasterLayer *mRasterLayer = nullptr;
 };
@@ -182,5 +191,86 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "myqgis2__4" ).toDouble(), 0.13888888888889 );
 }
 
+QgsVectorLayer *TestQgsZonalStatistics::gridPolygonLayer() const
+{
+  QgsVectorLayer *layer = new QgsVectorLayer( QStringLiteral( "Polygon" ), QStringLiteral( "polys" ), QStringLiteral( "memory" ) );
+  QgsFeatureList features;
+  for ( int i = 0; i < 40; ++i )
+  {
+    for ( int j = 0; j < 40; ++j )
+    {
+      // polygons smaller than a cell, spanning many cells, on the raster edges or outside of it
+      double x = -10 + i * 8.2;
+      double y = -10 + j * 5.7;
+      double size = 0.3 + ( ( i * 7 + j * 3 ) % 11 ) * 1.3;
+      QString wkt = ( i + j ) % 2 ? QStringLiteral( "Polygon((%1 %2, %3 %2, %3 %4, %1 %4, %1 %2))" ).arg( x ).arg( y ).arg( x + size ).arg( y + size * 0.7 )
+                    : QStringLiteral( "Polygon((%1 %2, %3 %4, %5 %6, %1 %2))" ).arg( x ).arg( y ).arg( x + size ).arg( y + size * 0.2 ).arg( x + size * 0.4 ).arg( y + size );
+      QgsFeature feature;
+      feature.setGeometry( QgsGeometry::fromWkt( wkt ) );
+      features << feature;
+    }
+  }
+  layer->dataProvider()->addFeatures( features );
+  return layer;
+}
+
+void TestQgsZonalStatistics::testParallelStatistics()
+{
+  // a 300x200 raster with a few cells without data
+  QString rasterPath = QDir::tempPath() + "/zonalstatistics_grid.asc";
+  QFile rasterFile( rasterPath );
+  QVERIFY( rasterFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+  QTextStream stream( &rasterFile );
+  stream << "ncols 300\nnrows 200\nxllcorner 0\nyllcorner 0\ncellsize 1\nNODATA_value -9999\n";
+  for ( int row = 0; row < 200; ++row )
+  {
+    for ( int column = 0; column < 300; ++column )
+    {
+      stream << ( ( row * 300 + column ) % 23 ? ( column * 31 + row * 17 ) % 97 : -9999 ) << ' ';
+    }
+    stream << '\n';
+  }
+  stream.flush();
+  rasterFile.close();
+
+  QgsRasterLayer rasterLayer( rasterPath, QStringLiteral( "grid" ), QStringLiteral( "gdal" ) );
+  QVERIFY( rasterLayer.isValid() );
+
+  std::unique_ptr< QgsVectorLayer > sequentialLayer( gridPolygonLayer() );
+  std::unique_ptr< QgsVectorLayer > parallelLayer( gridPolygonLayer() );
+  QCOMPARE( sequentialLayer->featureCount(), 1600L );
+
+  // the polygons are processed sequentially if the thread pool has a single thread
+  QThreadPool *pool = QThreadPool::globalInstance();
+  int maxThreadCount = pool->maxThreadCount();
+  pool->setMaxThreadCount( 1 );
+  QgsZonalStatistics sequential( sequentialLayer.get(), &rasterLayer, QString(), 1, QgsZonalStatistics::All );
+  QCOMPARE( sequential.calculateStatistics( nullptr ), 0 );
+
+  pool->setMaxThreadCount( 4 );
+  QgsZonalStatistics parallel( parallelLayer.get(), &rasterLayer, QString(), 1, QgsZonalStatistics::All );
+  QCOMPARE( parallel.calculateStatistics( nullptr ), 0 );
+  pool->setMaxThreadCount( maxThreadCount );
+
+  QCOMPARE( parallelLayer->fields().names(), sequentialLayer->fields().names() );
+  int countIndex = sequentialLayer->fields().lookupField( QStringLiteral( "count" ) );
+  QVERIFY( countIndex >= 0 );
+
+  int featuresWithCells = 0;
+  QgsFeature sequentialFeature;
+  QgsFeatureIterator it = sequentialLayer->getFeatures();
+  while ( it.nextFeature( sequentialFeature ) )
+  {
+    QgsFeature parallelFeature;
+    QVERIFY( parallelLayer->getFeatures( QgsFeatureRequest( sequentialFeature.id() ) ).nextFeature( parallelFeature ) );
+    QCOMPARE( parallelFeature.attributes(), sequentialFeature.attributes() );
+    if ( sequentialFeature.attribute( countIndex ).toDouble() > 0 )
+      ++featuresWithCells;
+  }
+
+  // most polygons cover cells, through more than one chunk of features
+  QVERIFY( featuresWithCells > 1024 );
+}
+
 QGSTEST_MAIN( TestQgsZonalStatistics )
 #include "testqgszonalstatistics.moc"
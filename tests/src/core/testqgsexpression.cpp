@@ -44,6 +44,24 @@ static void _parseAndEvalExpr( int arg )
   }
 }
 
+//! Replaces the lower() function when set in a context
+class ContextLowerFunction : public QgsScopedExpressionFunction
+{
+  public:
+    ContextLowerFunction()
+      : QgsScopedExpressionFunction( QStringLiteral( "lower" ), 1, QStringLiteral( "test" ) ) {}
+
+    virtual QVariant func( const QVariantList &values, const QgsExpressionContext *, QgsExpression *, const QgsExpressionNodeFunction * ) override
+    {
+      return QStringLiteral( "context %1" ).arg( values.at( 0 ).toString() );
+    }
+
+    QgsScopedExpressionFunction *clone() const override
+    {
+      return new ContextLowerFunction();
+    }
+};
+
 class TestQgsExpression: public QObject
 {
     Q_OBJECT
@@ -1321,6 +1339,218 @@ class TestQgsExpression: public QObject
       QCOMPARE( res2.type(), QVariant::Invalid );
     }
 
+    void evaluate_batch_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::newRow( "column" ) << "int_field";
+      QTest::newRow( "int plus" ) << "int_field + 1";
+      QTest::newRow( "int times double" ) << "int_field * dbl_field";
+      QTest::newRow( "division by zero" ) << "int_field / 0";
+      QTest::newRow( "int modulo" ) << "int_field % 3";
+      QTest::newRow( "integer division" ) << "dbl_field // 2";
+      QTest::newRow( "power" ) << "int_field ^ 2";
+      QTest::newRow( "minus int" ) << "-int_field";
+      QTest::newRow( "minus double" ) << "-dbl_field";
+      QTest::newRow( "not" ) << "NOT int_field";
+      QTest::newRow( "and" ) << "int_field > 2 AND dbl_field < 3.5";
+      QTest::newRow( "or" ) << "int_field = 2 OR str_field = 'b'";
+      QTest::newRow( "compare strings" ) << "str_field >= 'ab'";
+      QTest::newRow( "concat" ) << "str_field || '_' || int_field";
+      QTest::newRow( "like" ) << "str_field LIKE 'a%'";
+      QTest::newRow( "ilike" ) << "str_field ILIKE 'A_'";
+      QTest::newRow( "not like" ) << "str_field NOT LIKE '%b'";
+      QTest::newRow( "regexp" ) << "str_field ~ '^b'";
+      QTest::newRow( "in" ) << "int_field IN (1, 3, NULL)";
+      QTest::newRow( "not in" ) << "int_field NOT IN (1, '3', 'x')";
+      QTest::newRow( "in strings" ) << "str_field IN ('a', 'b')";
+      QTest::newRow( "is null" ) << "str_field IS NULL";
+      QTest::newRow( "is not" ) << "int_field IS NOT dbl_field";
+      QTest::newRow( "abs" ) << "abs(dbl_field - 3)";
+      QTest::newRow( "round" ) << "round(dbl_field)";
+      QTest::newRow( "round places" ) << "round(dbl_field / 3, 2)";
+      QTest::newRow( "to_int" ) << "to_int(dbl_field)";
+      QTest::newRow( "upper" ) << "upper(str_field)";
+      QTest::newRow( "length" ) << "length(str_field)";
+      QTest::newRow( "coalesce" ) << "coalesce(int_field, dbl_field, 0)";
+      QTest::newRow( "condition" ) << "CASE WHEN int_field > 1 THEN 'big' ELSE str_field END";
+      QTest::newRow( "numeric strings" ) << "mixed_field + 1";
+      QTest::newRow( "nested fallback" ) << "int_field + to_int(mixed_field) > 5";
+      QTest::newRow( "errors" ) << "str_field + 1";
+      QTest::newRow( "feature function" ) << "$id * 2 + int_field";
+    }
+
+    void evaluate_batch()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "dbl_field" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "str_field" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "mixed_field" ), QVariant::String ) );
+
+      QList< QgsAttributes > attributes;
+      attributes << ( QgsAttributes() << 1 << 1.5 << QStringLiteral( "a" ) << QStringLiteral( "5" ) );
+      attributes << ( QgsAttributes() << 2 << 2.25 << QStringLiteral( "ab" ) << QStringLiteral( "7" ) );
+      attributes << ( QgsAttributes() << QVariant( QVariant::Int ) << 3.0 << QVariant( QVariant::String ) << QStringLiteral( "x" ) );
+      attributes << ( QgsAttributes() << 4 << QVariant( QVariant::Double ) << QStringLiteral( "b" ) << QVariant( QVariant::String ) );
+      attributes << ( QgsAttributes() << 3 << -0.5 << QStringLiteral( "B" ) << QStringLiteral( "2" ) );
+
+      QgsFeatureList features;
+      for ( int i = 0; i < attributes.count(); ++i )
+      {
+        QgsFeature f( fields, i + 1 );
+        f.setAttributes( attributes.at( i ) );
+        features << f;
+      }
+
+      QgsExpressionContext context;
+      context.setFields( fields );
+      QgsExpression exp( string );
+      QVERIFY( !exp.hasParserError() );
+      exp.prepare( &context );
+
+      // feature by feature evaluation
+      QVariantList expected;
+      QString expectedError;
+      for ( const QgsFeature &f : qgsAsConst( features ) )
+      {
+        context.setFeature( f );
+        expected << exp.evaluate( &context );
+        if ( exp.hasEvalError() && expectedError.isNull() )
+          expectedError = exp.evalErrorString();
+      }
+
+      const QVariantList results = exp.evaluateBatch( features, &context );
+      QCOMPARE( results.count(), expected.count() );
+      for ( int i = 0; i < results.count(); ++i )
+      {
+        QCOMPARE( results.at( i ).type(), expected.at( i ).type() );
+        QCOMPARE( results.at( i ), expected.at( i ) );
+      }
+      QCOMPARE( exp.hasEvalError(), !expectedError.isNull() );
+      QCOMPARE( exp.evalErrorString(), expectedError );
+    }
+
+    void evaluate_compiled_data()
+    {
+      evaluate_batch_data();
+      QTest::newRow( "case without else" ) << "CASE WHEN int_field = 1 THEN 'one' WHEN dbl_field > 2 THEN dbl_field END";
+      QTest::newRow( "case error" ) << "CASE WHEN str_field + 1 > 0 THEN 1 ELSE 2 END";
+      QTest::newRow( "nested functions" ) << "round(abs(coalesce(dbl_field, int_field)) * 10) / 10";
+      QTest::newRow( "static subtree" ) << "int_field * (2 + 3) + length('abc')";
+      QTest::newRow( "in expressions" ) << "int_field IN (dbl_field, 2)";
+      QTest::newRow( "lazy function" ) << "if(int_field > 2, str_field, mixed_field)";
+      QTest::newRow( "variable" ) << "@my_var + int_field";
+      QTest::newRow( "context function" ) << "lower(str_field)";
+      QTest::newRow( "unknown column" ) << "unknown_field IS NULL";
+    }
+
+    void evaluate_compiled()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "int_field" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "dbl_field" ), QVariant::Double ) );
+      fields.append( QgsField( QStringLiteral( "str_field" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "mixed_field" ), QVariant::String ) );
+
+      QList< QgsAttributes > attributes;
+      attributes << ( QgsAttributes() << 1 << 1.5 << QStringLiteral( "a" ) << QStringLiteral( "5" ) );
+      attributes << ( QgsAttributes() << 2 << 2.25 << QStringLiteral( "ab" ) << QStringLiteral( "7" ) );
+      attributes << ( QgsAttributes() << QVariant( QVariant::Int ) << 3.0 << QVariant( QVariant::String ) << QStringLiteral( "x" ) );
+      attributes << ( QgsAttributes() << 4 << QVariant( QVariant::Double ) << QStringLiteral( "b" ) << QVariant( QVariant::String ) );
+      attributes << ( QgsAttributes() << 3 << -0.5 << QStringLiteral( "B" ) << QStringLiteral( "2" ) );
+
+      QgsExpressionContextScope *scope = new QgsExpressionContextScope();
+      scope->setVariable( QStringLiteral( "my_var" ), 10 );
+      scope->addFunction( QStringLiteral( "lower" ), new ContextLowerFunction() );
+      QgsExpressionContext context;
+      context << scope;
+      context.setFields( fields );
+
+      QgsExpression exp( string );
+      QVERIFY( !exp.hasParserError() );
+      bool prepared = exp.prepare( &context );
+      QgsExpression compiledExp( string );
+      QCOMPARE( compiledExp.compile( &context ), prepared );
+      QCOMPARE( compiledExp.isCompiled(), prepared );
+
+      for ( int i = 0; i < attributes.count(); ++i )
+      {
+        QgsFeature f( fields, i + 1 );
+        f.setAttributes( attributes.at( i ) );
+        context.setFeature( f );
+
+        QVariant expected = exp.evaluate( &context );
+        QVariant result = compiledExp.evaluate( &context );
+        QCOMPARE( result.type(), expected.type() );
+        QCOMPARE( result, expected );
+        QCOMPARE( compiledExp.hasEvalError(), exp.hasEvalError() );
+        QCOMPARE( compiledExp.evalErrorString(), exp.evalErrorString() );
+      }
+
+      // preparing again discards the compiled program
+      compiledExp.prepare( &context );
+      QVERIFY( !compiledExp.isCompiled() );
+    }
+
+    void benchmark_compiled_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "compiled" );
+
+      const QStringList expressions = QStringList()
+                                      << QStringLiteral( "\"population\" > 10000 AND \"type\" = 'city'" )
+                                      << QStringLiteral( "\"type\" IN ('town', 'village') OR \"population\" < 100" )
+                                      << QStringLiteral( "CASE WHEN \"population\" > 100000 THEN 4 WHEN \"population\" > 10000 THEN 3 ELSE 1 + \"area\" / 1000 END" )
+                                      << QStringLiteral( "coalesce( \"area\" * 2.5, 1 ) + sqrt( \"population\" ) / 10" );
+      for ( const QString &expression : expressions )
+      {
+        QTest::newRow( QStringLiteral( "interpreted %1" ).arg( expression ).toUtf8().constData() ) << expression << false;
+        QTest::newRow( QStringLiteral( "compiled %1" ).arg( expression ).toUtf8().constData() ) << expression << true;
+      }
+    }
+
+    void benchmark_compiled()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, compiled );
+
+      QgsFields fields;
+      fields.append( QgsField( QStringLiteral( "name" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "type" ), QVariant::String ) );
+      fields.append( QgsField( QStringLiteral( "population" ), QVariant::Int ) );
+      fields.append( QgsField( QStringLiteral( "area" ), QVariant::Double ) );
+
+      const QStringList types = QStringList() << QStringLiteral( "city" ) << QStringLiteral( "town" ) << QStringLiteral( "village" );
+      QgsFeatureList features;
+      for ( int i = 0; i < 1000; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttributes( QgsAttributes() << QStringLiteral( "place %1" ).arg( i ) << types.at( i % 3 ) << i * 137 << i * 1.5 );
+        features << f;
+      }
+
+      QgsExpressionContext context;
+      context.setFields( fields );
+      QgsExpression exp( string );
+      if ( compiled )
+        QVERIFY( exp.compile( &context ) );
+      else
+        QVERIFY( exp.prepare( &context ) );
+
+      QBENCHMARK
+      {
+        for ( const QgsFeature &f : qgsAsConst( features ) )
+        {
+          context.setFeature( f );
+          exp.evaluate( &context );
+        }
+      }
+    }
+
     void eval_feature_id()
     {
       QgsFeature f( 100 );
@@ -1685,6 +1915,103 @@ class TestQgsExpression: public QObject
       QCOMPARE( res, result );
     }
 
+    void relationAggregateGrouped_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<int>( "parentCount" );
+
+      // parents 3 and 4 have children, the other parents have none
+      QTest::newRow( "sum below threshold" ) << "relation_aggregate('my_rel','sum',\"col3\")" << 4;
+      QTest::newRow( "sum above threshold" ) << "relation_aggregate('my_rel','sum',\"col3\")" << 10;
+      QTest::newRow( "count below threshold" ) << "relation_aggregate('my_rel','count',\"col3\")" << 4;
+      QTest::newRow( "count above threshold" ) << "relation_aggregate('my_rel','count',\"col3\")" << 10;
+      QTest::newRow( "max above threshold" ) << "relation_aggregate('my_rel','max',\"col3\")" << 10;
+      QTest::newRow( "count missing above threshold" ) << "relation_aggregate('my_rel','count_missing',\"col2\")" << 10;
+      QTest::newRow( "sub expression above threshold" ) << "relation_aggregate('my_rel','sum',\"col3\" * 2)" << 10;
+      QTest::newRow( "concatenation above threshold" ) << "relation_aggregate('my_rel','concatenate',to_string(\"col3\"),concatenator:=',')" << 10;
+    }
+
+    void relationAggregateGrouped()
+    {
+      QFETCH( QString, string );
+      QFETCH( int, parentCount );
+
+      // expected values are calculated for each parent in its own context, so that the
+      // children of the parent are aggregated individually
+      QMap< int, QVariant > expected;
+      for ( int parentKey = 1; parentKey <= parentCount; ++parentKey )
+      {
+        QgsExpressionContext context;
+        context.appendScope( QgsExpressionContextUtils::layerScope( mAggregatesLayer ) );
+        QgsFeature parentFeature( mAggregatesLayer->dataProvider()->fields(), parentKey );
+        parentFeature.setAttribute( QStringLiteral( "col1" ), parentKey );
+        context.setFeature( parentFeature );
+
+        QgsExpression exp( string );
+        expected.insert( parentKey, exp.evaluate( &context ) );
+        QVERIFY( !exp.hasEvalError() );
+      }
+
+      // evaluating all the parents in the same context switches to a single grouped
+      // aggregate of the children once more than a few parents are requested
+      QgsExpressionContext context;
+      context.appendScope( QgsExpressionContextUtils::layerScope( mAggregatesLayer ) );
+      QgsExpression exp( string );
+      for ( int parentKey = 1; parentKey <= parentCount; ++parentKey )
+      {
+        QgsFeature parentFeature( mAggregatesLayer->dataProvider()->fields(), parentKey );
+        parentFeature.setAttribute( QStringLiteral( "col1" ), parentKey );
+        context.setFeature( parentFeature );
+
+        QVariant res = exp.evaluate( &context );
+        QVERIFY( !exp.hasEvalError() );
+        QCOMPARE( res, expected.value( parentKey ) );
+
+        // check again - make sure value was correctly cached
+        res = exp.evaluate( &context );
+        QCOMPARE( res, expected.value( parentKey ) );
+      }
+
+      if ( string == QLatin1String( "relation_aggregate('my_rel','sum',\"col3\")" ) )
+      {
+        QCOMPARE( expected.value( 1 ), QVariant( 0 ) );
+        QCOMPARE( expected.value( 3 ), QVariant( 9 ) );
+        QCOMPARE( expected.value( 4 ), QVariant( 5 ) );
+      }
+      else if ( string == QLatin1String( "relation_aggregate('my_rel','count',\"col3\")" ) )
+      {
+        QCOMPARE( expected.value( 1 ), QVariant( 0 ) );
+        QCOMPARE( expected.value( 3 ), QVariant( 2 ) );
+        QCOMPARE( expected.value( 4 ), QVariant( 3 ) );
+      }
+    }
+
+    void aggregateGrouped()
+    {
+      // aggregates with a group_by are also calculated for all the groups at once, once
+      // more than a few groups are requested in the same context
+      QMap< int, QVariant > expected;
+      expected.insert( 1, 2 );
+      expected.insert( 2, 9 );
+      expected.insert( 3, 13 );
+
+      QgsExpressionContext context;
+      context.appendScope( QgsExpressionContextUtils::layerScope( mAggregatesLayer ) );
+      QgsExpression exp( QStringLiteral( "sum(\"col1\", group_by:=\"col3\")" ) );
+
+      // groups 4 to 8 have no features
+      for ( int group = 1; group <= 8; ++group )
+      {
+        QgsFeature f( mAggregatesLayer->dataProvider()->fields(), group );
+        f.setAttribute( QStringLiteral( "col3" ), group );
+        context.setFeature( f );
+
+        QVariant res = exp.evaluate( &context );
+        QVERIFY( !exp.hasEvalError() );
+        QCOMPARE( res, expected.value( group, QVariant( 0 ) ) );
+      }
+    }
+
     void get_feature_geometry()
     {
       //test that get_feature fetches feature's geometry
@@ -37,6 +37,7 @@ class TestQgsExpressionContext : public QObject
     void contextScopeCopy();
     void contextScopeFunctions();
     void contextStack();
+    void variableHandle();
     void scopeByName();
     void contextCopy();
     void contextStackFunctions();
@@ -351,6 +352,86 @@ void TestQgsExpressionContext::contextCopy()
   QCOMPARE( copy.variableNames().length(), 1 );
 }
 
+void TestQgsExpressionContext::variableHandle()
+{
+  QgsExpressionContext context;
+  QgsExpressionContextScope *scope1 = new QgsExpressionContextScope();
+  scope1->setVariable( QStringLiteral( "test" ), 1 );
+  scope1->setVariable( QStringLiteral( "other" ), QStringLiteral( "a" ) );
+  QgsExpressionContextScope *scope2 = new QgsExpressionContextScope();
+  context << scope1 << scope2;
+
+  QgsExpressionContext::VariableHandle handle = context.resolveVariable( QStringLiteral( "test" ) );
+  QCOMPARE( handle.name(), QString( "test" ) );
+  QCOMPARE( context.variable( handle ).toInt(), 1 );
+
+  // changing the value keeps the handle valid
+  scope1->setVariable( QStringLiteral( "test" ), 2 );
+  QCOMPARE( context.variable( handle ).toInt(), 2 );
+
+  // variable shadowed by a higher scope
+  scope2->setVariable( QStringLiteral( "test" ), 3 );
+  QCOMPARE( context.variable( handle ).toInt(), 3 );
+  handle = context.resolveVariable( QStringLiteral( "test" ) );
+  QCOMPARE( context.variable( handle ).toInt(), 3 );
+  scope2->setVariable( QStringLiteral( "test" ), 4 );
+  QCOMPARE( context.variable( handle ).toInt(), 4 );
+  QVERIFY( scope2->removeVariable( QStringLiteral( "test" ) ) );
+  QCOMPARE( context.variable( handle ).toInt(), 2 );
+
+  // appended and popped scopes
+  handle = context.resolveVariable( QStringLiteral( "test" ) );
+  QgsExpressionContextScope *scope3 = new QgsExpressionContextScope();
+  scope3->setVariable( QStringLiteral( "test" ), 5 );
+  context << scope3;
+  QCOMPARE( context.variable( handle ).toInt(), 5 );
+  handle = context.resolveVariable( QStringLiteral( "test" ) );
+  QCOMPARE( context.variable( handle ).toInt(), 5 );
+  delete context.popScope();
+  QCOMPARE( context.variable( handle ).toInt(), 2 );
+
+  // the same scope can be appended again without resolving the handle
+  scope2->setVariable( QStringLiteral( "point" ), 8 );
+  QgsExpressionContext::VariableHandle pointHandle = context.resolveVariable( QStringLiteral( "point" ) );
+  QgsExpressionContextScope *featureScope = context.popScope();
+  QVERIFY( !context.variable( pointHandle ).isValid() );
+  context << featureScope;
+  featureScope->setVariable( QStringLiteral( "point" ), 9 );
+  QCOMPARE( context.variable( pointHandle ).toInt(), 9 );
+
+  // missing variable
+  QgsExpressionContext::VariableHandle missing = context.resolveVariable( QStringLiteral( "missing" ) );
+  QVERIFY( !context.variable( missing ).isValid() );
+  scope1->setVariable( QStringLiteral( "missing" ), 6 );
+  QCOMPARE( context.variable( missing ).toInt(), 6 );
+
+  // handle used with another context
+  QgsExpressionContext copy( context );
+  scope1->setVariable( QStringLiteral( "test" ), 7 );
+  QCOMPARE( copy.variable( handle ).toInt(), 2 );
+  QCOMPARE( context.variable( handle ).toInt(), 7 );
+  QVERIFY( !copy.isValidHandle( handle ) );
+
+  // removing a variable moves another one to its slot
+  QgsExpressionContextScope *slotScope = new QgsExpressionContextScope();
+  slotScope->setVariable( QStringLiteral( "first" ), 1 );
+  slotScope->setVariable( QStringLiteral( "second" ), 2 );
+  slotScope->setVariable( QStringLiteral( "third" ), 3 );
+  context << slotScope;
+  QgsExpressionContext::VariableHandle thirdHandle = context.resolveVariable( QStringLiteral( "third" ) );
+  QVERIFY( context.isValidHandle( thirdHandle ) );
+  QCOMPARE( context.variable( thirdHandle ).toInt(), 3 );
+  QVERIFY( slotScope->removeVariable( QStringLiteral( "first" ) ) );
+  QVERIFY( !context.isValidHandle( thirdHandle ) );
+  QCOMPARE( context.variable( thirdHandle ).toInt(), 3 );
+  QCOMPARE( slotScope->variable( QStringLiteral( "second" ) ).toInt(), 2 );
+  QCOMPARE( slotScope->variableCount(), 2 );
+  thirdHandle = context.resolveVariable( QStringLiteral( "third" ) );
+  QVERIFY( context.isValidHandle( thirdHandle ) );
+  slotScope->setVariable( QStringLiteral( "third" ), 4 );
+  QCOMPARE( context.variable( thirdHandle ).toInt(), 4 );
+}
+
 void TestQgsExpressionContext::contextStackFunctions()
 {
   QgsExpression::registerFunction( new GetTestValueFunction(), true );
@@ -15,6 +15,7 @@
 #include "qgstest.h"
 #include <QObject>
 #include <QString>
+#include <QPolygonF>
 //header for class being tested
 #include <qgsrectangle.h>
 #include <qgsmaptopixel.h>
@@ -29,6 +30,7 @@ class TestQgsMapToPixel: public QObject
     void getters();
     void fromScale();
     void toMapPoint();
+    void transformCoordinates();
 };
 
 void TestQgsMapToPixel::rotation()
@@ -119,6 +121,34 @@ void TestQgsMapToPixel::toMapPoint()
   QCOMPARE( p, QgsPointXY( 20, 20 ) );
 }
 
+void TestQgsMapToPixel::transformCoordinates()
+{
+  const QVector<double> x { 5, 5.5, -3, 1000 };
+  const QVector<double> y { 5, 4.5, 12, -250 };
+
+  for ( double rotation : { 0.0, 30.0, 90.0 } )
+  {
+    QgsMapToPixel m2p( 0.1, 5, 5, 10, 10, rotation );
+
+    QPolygonF out( x.size() );
+    m2p.transformCoordinates( x.constData(), y.constData(), x.size(), out.data() );
+
+    QPolygonF poly;
+    for ( int i = 0; i < x.size(); ++i )
+      poly << QPointF( x.at( i ), y.at( i ) );
+    m2p.transformInPlace( poly );
+
+    for ( int i = 0; i < x.size(); ++i )
+    {
+      const QgsPointXY d = m2p.transform( x.at( i ), y.at( i ) );
+      QGSCOMPARENEAR( out.at( i ).x(), d.x(), 0.000001 );
+      QGSCOMPARENEAR( out.at( i ).y(), d.y(), 0.000001 );
+      QGSCOMPARENEAR( poly.at( i ).x(), d.x(), 0.000001 );
+      QGSCOMPARENEAR( poly.at( i ).y(), d.y(), 0.000001 );
+    }
+  }
+}
+
 QGSTEST_MAIN( TestQgsMapToPixel )
 #include "testqgsmaptopixel.moc"
 
@@ -19,6 +19,8 @@
 #include <QApplication>
 #include <QFileInfo>
 #include <QDir>
+#include <QImage>
+#include <QPainter>
 
 //qgis includes...
 #include "qgsrasterlayer.h"
@@ -32,6 +34,8 @@
 #include "qgssinglesymbolrenderer.h"
 #include "qgsmarkersymbollayer.h"
 #include "qgsproperty.h"
+#include "qgsrendercontext.h"
+#include "qgsexpressioncontext.h"
 
 //qgis unit test includes
 #include <qgsrenderchecker.h>
@@ -60,6 +64,7 @@ class TestQgsMarkerLineSymbol : public QObject
     void lineOffset();
     void pointNumInterval();
     void pointNumVertex();
+    void pointNumVariableHandle();
 
   private:
     bool render( const QString &fileName );
@@ -197,6 +202,66 @@ void TestQgsMarkerLineSymbol::pointNumVertex()
   QVERIFY( render( "point_num_vertex" ) );
 }
 
+void TestQgsMarkerLineSymbol::pointNumVariableHandle()
+{
+  QgsMarkerLineSymbolLayer *ml = new QgsMarkerLineSymbolLayer();
+  ml->setPlacement( QgsMarkerLineSymbolLayer::Vertex );
+  QgsLineSymbol lineSymbol;
+  lineSymbol.changeSymbolLayer( 0, ml );
+
+  QgsStringMap props;
+  props[QStringLiteral( "color" )] = QStringLiteral( "255,0,0" );
+  props[QStringLiteral( "size" )] = QStringLiteral( "2" );
+  props[QStringLiteral( "outline_style" )] = QStringLiteral( "no" );
+  QgsSimpleMarkerSymbolLayer *marker = static_cast< QgsSimpleMarkerSymbolLayer * >( QgsSimpleMarkerSymbolLayer::create( props ) );
+  marker->setDataDefinedProperty( QgsSymbolLayer::PropertySize, QgsProperty::fromExpression( QStringLiteral( "@geometry_point_num * 2" ) ) );
+
+  QgsMarkerSymbol *subSymbol = new QgsMarkerSymbol();
+  subSymbol->changeSymbolLayer( 0, marker );
+  ml->setSubSymbol( subSymbol );
+
+  // render the symbol without the layer renderer, with the settings used by the render checker
+  mMapSettings->setExtent( QgsRectangle( -140, -140, 140, 140 ) );
+  mMapSettings->setOutputSize( QSize( 100, 100 ) );
+  mMapSettings->setOutputDpi( 96 );
+  mMapSettings->setFlag( QgsMapSettings::Antialiasing );
+  QImage image( mMapSettings->outputSize(), QImage::Format_ARGB32_Premultiplied );
+  image.fill( qRgb( 152, 219, 249 ) );
+  QPainter painter( &image );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( *mMapSettings );
+  context.setPainter( &painter );
+  context.expressionContext() << QgsExpressionContextUtils::layerScope( mLinesLayer );
+
+  // the size expression is compiled when the rendering starts, without the scopes
+  // of the symbol and of the marker line which hold the geometry variables, so the
+  // variable handle of @geometry_point_num has to be resolved again while rendering
+  lineSymbol.startRender( context, mLinesLayer->fields() );
+  QgsFeatureIterator it = mLinesLayer->getFeatures();
+  QgsFeature feature;
+  int pointCount = 0;
+  while ( it.nextFeature( feature ) )
+  {
+    context.expressionContext().setFeature( feature );
+    lineSymbol.renderFeature( feature, context );
+    pointCount += feature.geometry().geometry()->nCoordinates();
+  }
+  lineSymbol.stopRender( context );
+  painter.end();
+  QVERIFY( pointCount > 10 );
+
+  // the markers get the sizes of the point numbers, as when rendered by the layer
+  const QString renderedImageFile = QDir::tempPath() + "/point_num_variable_handle.png";
+  QVERIFY( image.save( renderedImageFile, "PNG" ) );
+  mReport += QLatin1String( "<h2>point_num_variable_handle</h2>\n" );
+  QgsRenderChecker checker;
+  checker.setControlPathPrefix( QStringLiteral( "symbol_markerline" ) );
+  checker.setControlName( QStringLiteral( "expected_point_num_vertex" ) );
+  checker.setColorTolerance( 2 );
+  const bool result = checker.compareImages( QStringLiteral( "point_num_variable_handle" ), 20, renderedImageFile );
+  mReport += "\n\n\n" + checker.report();
+  QVERIFY( result );
+}
+
 bool TestQgsMarkerLineSymbol::render( const QString &testType )
 {
   mReport += "<h2>" + testType + "</h2>\n";
@@ -245,6 +245,64 @@ class TestQgsPointLocator : public QObject
       mVL->rollBack();
     }
 
+    void testManyLayerUpdates()
+    {
+      QgsVectorLayer *vl = new QgsVectorLayer( QStringLiteral( "Point" ), QStringLiteral( "x" ), QStringLiteral( "memory" ) );
+      QgsFeature f0;
+      f0.setGeometry( QgsGeometry::fromPoint( QgsPointXY( -1, -1 ) ) );
+      QgsFeatureList flist;
+      flist << f0;
+      vl->dataProvider()->addFeatures( flist );
+
+      QgsPointLocator loc( vl );
+      QVERIFY( loc.init() );
+      QCOMPARE( loc.cachedGeometryCount(), 1 );
+
+      // add enough features to get them packed in the index
+      vl->startEditing();
+      QList<QgsFeatureId> ids;
+      for ( int i = 0; i < 1000; ++i )
+      {
+        QgsFeature f;
+        f.setGeometry( QgsGeometry::fromPoint( QgsPointXY( i, i ) ) );
+        QVERIFY( vl->addFeature( f ) );
+        ids << f.id();
+      }
+      QCOMPARE( loc.cachedGeometryCount(), 1001 );
+
+      QgsPointLocator::Match m = loc.nearestVertex( QgsPointXY( 500.2, 500.2 ), 1 );
+      QVERIFY( m.isValid() );
+      QCOMPARE( m.point(), QgsPointXY( 500, 500 ) );
+      QCOMPARE( m.featureId(), ids.at( 500 ) );
+
+      // delete every other added feature
+      for ( int i = 0; i < 1000; i += 2 )
+        QVERIFY( vl->deleteFeature( ids.at( i ) ) );
+      QCOMPARE( loc.cachedGeometryCount(), 501 );
+
+      m = loc.nearestVertex( QgsPointXY( 500.2, 500.2 ), 2 );
+      QVERIFY( m.isValid() );
+      QCOMPARE( m.point(), QgsPointXY( 501, 501 ) );
+      QCOMPARE( m.featureId(), ids.at( 501 ) );
+
+      // move a packed feature
+      QVERIFY( vl->changeGeometry( ids.at( 501 ), QgsGeometry::fromPoint( QgsPointXY( -10, -10 ) ) ) );
+      QCOMPARE( loc.cachedGeometryCount(), 501 );
+      m = loc.nearestVertex( QgsPointXY( 500.2, 500.2 ), 2 );
+      QVERIFY( m.isValid() );
+      QCOMPARE( m.point(), QgsPointXY( 499, 499 ) );
+      m = loc.nearestVertex( QgsPointXY( -10, -10 ), 1 );
+      QVERIFY( m.isValid() );
+      QCOMPARE( m.featureId(), ids.at( 501 ) );
+
+      m = loc.nearestVertex( QgsPointXY( -1, -1 ), 0.5 );
+      QVERIFY( m.isValid() );
+      QCOMPARE( m.point(), QgsPointXY( -1, -1 ) );
+
+      vl->rollBack();
+      delete vl;
+    }
+
     void testExtent()
     {
       QgsRectangle bbox1( 10, 10, 11, 11 ); // out of layer's bounds
@@ -0,0 +1,143 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for checking out large layers with QgsOfflineEditing.
+
+From build dir, run: ctest -R PyQgsOfflineEditingBulk -V
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'The QGIS Project'
+__date__ = '2017-10-18'
+__copyright__ = 'Copyright 2017, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import shutil
+import tempfile
+import time
+
+from qgis.core import (
+    QgsCoordinateReferenceSystem,
+    QgsFeature,
+    QgsFeatureRequest,
+    QgsGeometry,
+    QgsMessageLog,
+    QgsOfflineEditing,
+    QgsPointXY,
+    QgsProject,
+    QgsVectorFileWriter,
+    QgsVectorLayer,
+)
+from qgis.testing import start_app, unittest
+
+start_app()
+
+FEATURE_COUNT = 20000
+
+
+def logThroughput(operation, featureCount, elapsed):
+    """Logs the throughput of an operation, timings are not asserted so that the test stays stable on slow machines"""
+    QgsMessageLog.logMessage('{} {} features in {:.2f}s ({:.0f} features/s)'.format(operation, featureCount, elapsed, featureCount / max(elapsed, 1e-6)),
+                             'Offline Editing', QgsMessageLog.INFO)
+
+
+class TestQgsOfflineEditingBulk(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        """Run before all tests"""
+        cls.temp_path = tempfile.mkdtemp()
+
+    @classmethod
+    def tearDownClass(cls):
+        """Run after all tests"""
+        QgsProject.instance().removeAllMapLayers()
+        shutil.rmtree(cls.temp_path, True)
+
+    def createRemoteLayer(self):
+        ml = QgsVectorLayer('Point?crs=epsg:4326&field=id:integer&field=name:string(20)&field=value:double', 'test', 'memory')
+        features = []
+        for i in range(FEATURE_COUNT):
+            f = QgsFeature(ml.fields())
+            f.setAttributes([i, 'name {}'.format(i), i / 2.0])
+            f.setGeometry(QgsGeometry.fromPoint(QgsPointXY(i % 200, i // 200)))
+            features.append(f)
+        self.assertTrue(ml.dataProvider().addFeatures(features)[0])
+
+        dest_file_name = os.path.join(self.temp_path, 'remote.shp')
+        write_result, error_message = QgsVectorFileWriter.writeAsVectorFormat(
+            ml,
+            dest_file_name,
+            'utf-8',
+            QgsCoordinateReferenceSystem('EPSG:4326'),
+            'ESRI Shapefile')
+        self.assertEqual(write_result, QgsVectorFileWriter.NoError, error_message)
+
+        layer = QgsVectorLayer(dest_file_name, 'remote', 'ogr')
+        self.assertTrue(layer.isValid())
+        return layer
+
+    def featureByAttribute(self, layer, value):
+        request = QgsFeatureRequest().setFilterExpression('"id" = {}'.format(value))
+        return next(layer.getFeatures(request))
+
+    def testCheckoutAndSynchronize(self):
+        """Check out a large layer, edit it offline and synchronize it back"""
+        remote_layer = self.createRemoteLayer()
+        QgsProject.instance().addMapLayer(remote_layer)
+
+        ol = QgsOfflineEditing()
+        start = time.time()
+        self.assertTrue(ol.convertToOfflineProject(self.temp_path, 'bulk.sqlite', [remote_layer.id()]))
+        logThroughput('Checked out', FEATURE_COUNT, time.time() - start)
+
+        offline_layer = list(QgsProject.instance().mapLayers().values())[0]
+        self.assertTrue(offline_layer.isValid())
+        self.assertTrue(offline_layer.name().find('(offline)') > -1)
+        self.assertEqual(offline_layer.featureCount(), FEATURE_COUNT)
+
+        for i in (0, 1234, FEATURE_COUNT - 1):
+            f = self.featureByAttribute(offline_layer, i)
+            self.assertEqual(f['name'], 'name {}'.format(i))
+            self.assertEqual(f['value'], i / 2.0)
+            self.assertEqual(f.geometry().asPoint(), QgsPointXY(i % 200, i // 200))
+
+        # spatial index was built after loading the features
+        request = QgsFeatureRequest().setFilterRect(offline_layer.extent().buffered(-0.5))
+        self.assertTrue(len([f for f in offline_layer.getFeatures(request)]) > 0)
+
+        # edit offline
+        self.assertTrue(offline_layer.startEditing())
+        f = self.featureByAttribute(offline_layer, 1234)
+        self.assertTrue(offline_layer.changeAttributeValue(f.id(), offline_layer.fields().lookupField('name'), 'edited'))
+        self.assertTrue(offline_layer.changeGeometry(f.id(), QgsGeometry.fromPoint(QgsPointXY(-10, -10))))
+        f = self.featureByAttribute(offline_layer, 5000)
+        self.assertTrue(offline_layer.deleteFeature(f.id()))
+        f = QgsFeature(offline_layer.fields())
+        f.setAttributes([FEATURE_COUNT, 'new', 1.5])
+        f.setGeometry(QgsGeometry.fromPoint(QgsPointXY(-20, -20)))
+        self.assertTrue(offline_layer.addFeature(f))
+        self.assertTrue(offline_layer.commitChanges())
+
+        start = time.time()
+        ol.synchronize()
+        QgsMessageLog.logMessage('Synchronized the offline edits of {} features in {:.2f}s'.format(FEATURE_COUNT, time.time() - start),
+                                 'Offline Editing', QgsMessageLog.INFO)
+
+        online_layer = list(QgsProject.instance().mapLayers().values())[0]
+        self.assertTrue(online_layer.isValid())
+        self.assertFalse(online_layer.name().find('(offline)') > -1)
+        self.assertEqual(online_layer.featureCount(), FEATURE_COUNT)
+        f = self.featureByAttribute(online_layer, 1234)
+        self.assertEqual(f['name'], 'edited')
+        self.assertEqual(f.geometry().asPoint(), QgsPointXY(-10, -10))
+        self.assertEqual(self.featureByAttribute(online_layer, FEATURE_COUNT)['name'], 'new')
+        self.assertEqual(len([f for f in online_layer.getFeatures(QgsFeatureRequest().setFilterExpression('"id" = 5000'))]), 0)
+        self.assertEqual(self.featureByAttribute(online_layer, 1233)['name'], 'name 1233')
+
+
+if __name__ == '__main__':
+    unittest.main()
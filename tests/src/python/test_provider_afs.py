@@ -0,0 +1,192 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for the ArcGIS Feature Service provider, against a local mock server.
+
+From build dir, run: ctest -R PyQgsAFSProvider -V
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'The QGIS Project'
+__date__ = '2017-10-18'
+__copyright__ = 'Copyright 2017, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import json
+import subprocess
+import sys
+import urllib.request
+
+import qgis  # NOQA
+
+from qgis.core import (
+    QgsFeatureRequest,
+    QgsRectangle,
+    QgsVectorLayer,
+)
+from qgis.testing import start_app, unittest
+
+start_app()
+
+# The mock server runs in its own process, as the provider blocks the
+# Python interpreter while it waits for the replies.
+SERVER_SCRIPT = r'''
+import http.server
+import json
+import socketserver
+import sys
+import urllib.parse
+
+# 25 points with non contiguous object ids
+FEATURES = [{'attributes': {'OBJECTID': i * 10, 'name': 'point {}'.format(i)},
+             'geometry': {'x': float(i), 'y': float(i)}} for i in range(1, 26)]
+
+LAYER_INFO = {
+    'name': 'points',
+    'description': 'mock layer',
+    'geometryType': 'esriGeometryPoint',
+    'hasM': False,
+    'hasZ': False,
+    'maxRecordCount': 5,
+    'extent': {'xmin': 1, 'ymin': 1, 'xmax': 25, 'ymax': 25, 'spatialReference': {'wkid': 4326}},
+    'fields': [{'name': 'OBJECTID', 'type': 'esriFieldTypeOID'},
+               {'name': 'name', 'type': 'esriFieldTypeString', 'length': 20}]
+}
+
+requests = []
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+
+    def log_message(self, *args):
+        pass
+
+    def reply(self, data):
+        body = json.dumps(data).encode()
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        url = urllib.parse.urlparse(self.path)
+        params = dict(urllib.parse.parse_qsl(url.query))
+        if url.path == '/requests':
+            self.reply(requests)
+            del requests[:]
+            return
+
+        requests.append(params)
+        if url.path == '/FeatureServer/0':
+            self.reply(LAYER_INFO)
+        elif url.path == '/FeatureServer/0/query':
+            features = FEATURES
+            if 'geometry' in params:
+                xmin, ymin, xmax, ymax = [float(v) for v in params['geometry'].split(',')]
+                features = [f for f in features if xmin <= f['geometry']['x'] <= xmax and ymin <= f['geometry']['y'] <= ymax]
+            if params.get('returnIdsOnly') == 'true':
+                self.reply({'objectIdFieldName': 'OBJECTID', 'objectIds': [f['attributes']['OBJECTID'] for f in features]})
+            else:
+                ids = [int(i) for i in params['objectIds'].split(',')]
+                # features are not necessarily returned in the requested order
+                self.reply({'geometryType': 'esriGeometryPoint',
+                            'features': [f for f in reversed(features) if f['attributes']['OBJECTID'] in ids]})
+        else:
+            self.send_error(404)
+
+
+httpd = socketserver.ThreadingTCPServer(('localhost', 0), Handler)
+print(httpd.server_address[1])
+sys.stdout.flush()
+httpd.serve_forever()
+'''
+
+
+class TestPyQgsAFSProvider(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        cls.server = subprocess.Popen([sys.executable, '-c', SERVER_SCRIPT], stdout=subprocess.PIPE)
+        cls.port = int(cls.server.stdout.readline())
+        cls.url = 'http://localhost:{}'.format(cls.port)
+
+    @classmethod
+    def tearDownClass(cls):
+        cls.server.terminate()
+        cls.server.wait()
+
+    def serverRequests(self):
+        with urllib.request.urlopen(self.url + '/requests') as reply:
+            return json.loads(reply.read().decode())
+
+    def createLayer(self):
+        uri = "crs='EPSG:4326' url='{}/FeatureServer/0'".format(self.url)
+        layer = QgsVectorLayer(uri, 'test', 'arcgisfeatureserver')
+        self.assertTrue(layer.isValid())
+        self.serverRequests()
+        return layer
+
+    def testGetFeatures(self):
+        layer = self.createLayer()
+        self.assertEqual(layer.featureCount(), 25)
+
+        features = {f['OBJECTID']: f for f in layer.getFeatures()}
+        self.assertEqual(sorted(features.keys()), [i * 10 for i in range(1, 26)])
+        for objectId, f in features.items():
+            self.assertEqual(f['name'], 'point {}'.format(objectId // 10))
+            self.assertEqual(f.geometry().asPoint().x(), objectId // 10)
+
+        # pages of 5 features, downloaded 4 at a time
+        requests = self.serverRequests()
+        self.assertEqual(len(requests), 5)
+        for r in requests:
+            self.assertLessEqual(len(r['objectIds'].split(',')), 5)
+
+        # everything is cached now
+        self.assertEqual(len(list(layer.getFeatures())), 25)
+        self.assertEqual(self.serverRequests(), [])
+
+        f = layer.getFeature(3)
+        self.assertEqual(f['OBJECTID'], 40)
+        self.assertEqual(sorted(f['OBJECTID'] for f in layer.getFeatures(QgsFeatureRequest().setFilterFids([1, 5, 20]))), [20, 60, 210])
+
+    def testExtent(self):
+        layer = self.createLayer()
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(2.5, 2.5, 6.5, 6.5))
+        self.assertEqual(sorted(f['OBJECTID'] for f in layer.getFeatures(request)), [30, 40, 50, 60])
+
+        # only the features within the extent are downloaded
+        requests = self.serverRequests()
+        self.assertEqual(len(requests), 2)
+        self.assertEqual(requests[0]['returnIdsOnly'], 'true')
+        self.assertEqual(sorted(int(i) for i in requests[1]['objectIds'].split(',')), [30, 40, 50, 60])
+
+        # a smaller extent is served from the downloaded region
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(3.5, 3.5, 5.5, 5.5))
+        self.assertEqual(sorted(f['OBJECTID'] for f in layer.getFeatures(request)), [40, 50])
+        self.assertEqual(self.serverRequests(), [])
+
+        # a larger extent requires a new query, but only uncached features are downloaded
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(4.5, 4.5, 8.5, 8.5))
+        self.assertEqual(sorted(f['OBJECTID'] for f in layer.getFeatures(request)), [50, 60, 70, 80])
+        requests = self.serverRequests()
+        self.assertEqual(len(requests), 2)
+        self.assertEqual(sorted(int(i) for i in requests[1]['objectIds'].split(',')), [70, 80])
+
+        # an extent without features
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(100, 100, 101, 101))
+        self.assertEqual(list(layer.getFeatures(request)), [])
+
+        # reloading the data clears the cache
+        layer.dataProvider().reloadData()
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(3.5, 3.5, 5.5, 5.5))
+        self.assertEqual(sorted(f['OBJECTID'] for f in layer.getFeatures(request)), [40, 50])
+        self.assertEqual(len(self.serverRequests()), 2)
+
+
+if __name__ == '__main__':
+    unittest.main()
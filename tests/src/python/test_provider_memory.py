@@ -14,6 +14,8 @@ __revision__ = '$Format:%H$'
 
 
 from qgis.core import (
+    QgsAbstractFeatureIterator,
+    QgsAggregateCalculator,
     QgsField,
     QgsFields,
     QgsLayerDefinition,
@@ -26,7 +28,8 @@ from qgis.core import (
     QgsWkbTypes,
     NULL,
     QgsMemoryProviderUtils,
-    QgsCoordinateReferenceSystem
+    QgsCoordinateReferenceSystem,
+    QgsRectangle
 )
 
 from qgis.testing import (
@@ -403,6 +406,22 @@ class TestPyQgsMemoryProvider(unittest.TestCase, ProviderTestCase):
         self.assertEqual(layer.fields()[0].name(), 'rect')
         self.assertEqual(layer.fields()[0].type(), QVariant.String) # should be mapped to string
 
+    def testFidsRequest(self):
+        """ Test requests by feature ids combined with a filter rect, on a layer without spatial index """
+        fids = dict((f['pk'], f.id()) for f in self.source.getFeatures())
+        request = QgsFeatureRequest().setFilterFids([fids[1], fids[2], fids[3], fids[5], 1234567])
+        self.assertEqual(set(f['pk'] for f in self.source.getFeatures(request)), set([1, 2, 3, 5]))
+        request.setFilterRect(QgsRectangle(-70.5, 65.5, -68, 72))
+        self.assertEqual(set(f['pk'] for f in self.source.getFeatures(request)), set([1, 2]))
+        request.setFlags(QgsFeatureRequest.ExactIntersect)
+        self.assertEqual(set(f['pk'] for f in self.source.getFeatures(request)), set([1, 2]))
+        request = QgsFeatureRequest(fids[4]).setFilterRect(QgsRectangle(-70.5, 65.5, -68, 72))
+        self.assertEqual([f['pk'] for f in self.source.getFeatures(request)], [])
+        request = QgsFeatureRequest(fids[3]).setFilterRect(QgsRectangle(-70.5, 65.5, -68, 72))
+        self.assertEqual([f['pk'] for f in self.source.getFeatures(request)], [])
+        request = QgsFeatureRequest(fids[2]).setFilterRect(QgsRectangle(-70.5, 65.5, -68, 72))
+        self.assertEqual([f['pk'] for f in self.source.getFeatures(request)], [2])
+
 
 class TestPyQgsMemoryProviderIndexed(unittest.TestCase, ProviderTestCase):
 
@@ -477,6 +496,221 @@ class TestPyQgsMemoryProviderIndexed(unittest.TestCase, ProviderTestCase):
         """
         pass
 
+    def testAutomaticIndex(self):
+        """ Test that large layers are indexed and the index is kept up to date """
+        layer = QgsVectorLayer('Point?crs=epsg:4326&field=pk:integer', 'test', 'memory')
+        self.assertFalse('index=' in layer.source())
+        features = []
+        for i in range(1000):
+            f = QgsFeature()
+            f.setAttributes([i])
+            f.setGeometry(QgsGeometry.fromPointXY(QgsPointXY(-i, -i)))
+            features.append(f)
+        self.assertTrue(layer.dataProvider().addFeatures(features))
+        # the index is built automatically, but not stored in the uri
+        self.assertFalse('index=' in layer.source())
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(-10.5, -10.5, -4.5, -4.5))
+        self.assertEqual(set(f['pk'] for f in layer.getFeatures(request)), set(range(5, 11)))
+
+        # edits after the index was copied by a feature source must keep negative coordinates
+        it = layer.getFeatures(request)
+        f = QgsFeature()
+        f.setAttributes([1000])
+        f.setGeometry(QgsGeometry.fromPointXY(QgsPointXY(-7.2, -7.2)))
+        self.assertTrue(layer.dataProvider().addFeatures([f]))
+        self.assertEqual(set(f['pk'] for f in it), set(range(5, 11)))
+        self.assertEqual(set(f['pk'] for f in layer.getFeatures(request)), set(range(5, 11)) | set([1000]))
+
+        fid = [f.id() for f in layer.getFeatures(QgsFeatureRequest().setFilterExpression('pk = 6'))][0]
+        self.assertTrue(layer.dataProvider().changeGeometryValues({fid: QgsGeometry.fromPointXY(QgsPointXY(50, 50))}))
+        self.assertTrue(layer.dataProvider().deleteFeatures([fid + 1]))
+        self.assertEqual(set(f['pk'] for f in layer.getFeatures(request)), set([5, 8, 9, 10, 1000]))
+
+        layer = QgsVectorLayer('Point?crs=epsg:4326&field=pk:integer&index=no', 'test', 'memory')
+        self.assertTrue('index=no' in layer.source())
+        self.assertTrue(layer.dataProvider().addFeatures(features))
+        self.assertEqual(set(f['pk'] for f in layer.getFeatures(request)), set(range(5, 11)))
+
+
+class TestPyQgsMemoryProviderColumnar(unittest.TestCase, ProviderTestCase):
+
+    """Runs the provider test suite against a memory layer storing its features by columns"""
+
+    @classmethod
+    def createLayer(cls):
+        vl = QgsVectorLayer(
+            'Point?crs=epsg:4326&storage=columnar&field=pk:integer&field=cnt:integer&field=name:string(0)&field=name2:string(0)&field=num_char:string&key=pk',
+            'test', 'memory')
+        assert (vl.isValid())
+
+        f1 = QgsFeature()
+        f1.setAttributes([5, -200, NULL, 'NuLl', '5'])
+        f1.setGeometry(QgsGeometry.fromWkt('Point (-71.123 78.23)'))
+
+        f2 = QgsFeature()
+        f2.setAttributes([3, 300, 'Pear', 'PEaR', '3'])
+
+        f3 = QgsFeature()
+        f3.setAttributes([1, 100, 'Orange', 'oranGe', '1'])
+        f3.setGeometry(QgsGeometry.fromWkt('Point (-70.332 66.33)'))
+
+        f4 = QgsFeature()
+        f4.setAttributes([2, 200, 'Apple', 'Apple', '2'])
+        f4.setGeometry(QgsGeometry.fromWkt('Point (-68.2 70.8)'))
+
+        f5 = QgsFeature()
+        f5.setAttributes([4, 400, 'Honey', 'Honey', '4'])
+        f5.setGeometry(QgsGeometry.fromWkt('Point (-65.32 78.3)'))
+
+        vl.dataProvider().addFeatures([f1, f2, f3, f4, f5])
+        return vl
+
+    @classmethod
+    def setUpClass(cls):
+        """Run before all tests"""
+        # Create test layer
+        cls.vl = cls.createLayer()
+        assert (cls.vl.isValid())
+        cls.source = cls.vl.dataProvider()
+
+        # poly layer
+        cls.poly_vl = QgsVectorLayer('Polygon?crs=epsg:4326&storage=columnar&field=pk:integer&key=pk',
+                                     'test', 'memory')
+        assert (cls.poly_vl.isValid())
+        cls.poly_provider = cls.poly_vl.dataProvider()
+
+        f1 = QgsFeature()
+        f1.setAttributes([1])
+        f1.setGeometry(QgsGeometry.fromWkt('Polygon ((-69.03664108 81.35818902, -69.09237722 80.24346619, -73.718477 80.1319939, -73.718477 76.28620011, -74.88893598 76.34193625, -74.83319983 81.35818902, -69.03664108 81.35818902))'))
+
+        f2 = QgsFeature()
+        f2.setAttributes([2])
+        f2.setGeometry(QgsGeometry.fromWkt('Polygon ((-67.58750139 81.1909806, -66.30557012 81.24671674, -66.30557012 76.89929767, -67.58750139 76.89929767, -67.58750139 81.1909806))'))
+
+        f3 = QgsFeature()
+        f3.setAttributes([3])
+        f3.setGeometry(QgsGeometry.fromWkt('Polygon ((-68.36780737 75.78457483, -67.53176524 72.60761475, -68.64648808 73.66660144, -70.20710006 72.9420316, -68.36780737 75.78457483))'))
+
+        f4 = QgsFeature()
+        f4.setAttributes([4])
+
+        cls.poly_provider.addFeatures([f1, f2, f3, f4])
+
+    @classmethod
+    def tearDownClass(cls):
+        """Run after all tests"""
+
+    def getEditableLayer(self):
+        return self.createLayer()
+
+    def testUri(self):
+        layer = self.createLayer()
+        self.assertIn('storage=columnar', layer.dataProvider().dataSourceUri())
+        clone = QgsVectorLayer(layer.dataProvider().dataSourceUri(), 'clone', 'memory')
+        self.assertTrue(clone.isValid())
+        self.assertIn('storage=columnar', clone.dataProvider().dataSourceUri())
+
+    def testConvertValues(self):
+        layer = QgsVectorLayer('None?storage=columnar&field=i:integer&field=l:long&field=d:double&field=s:string&field=dt:date', 'test', 'memory')
+        self.assertTrue(layer.isValid())
+
+        f = QgsFeature()
+        f.setAttributes(['5', 'a', 1, 2, NULL])
+        self.assertTrue(layer.dataProvider().addFeatures([f]))
+        f = next(layer.getFeatures())
+        self.assertEqual(f['i'], 5)
+        self.assertEqual(f['l'], NULL)
+        self.assertEqual(f['d'], 1.0)
+        self.assertEqual(f['s'], '2')
+        self.assertEqual(f['dt'], NULL)
+
+    def testEdits(self):
+        layer = QgsVectorLayer('Point?crs=epsg:4326&storage=columnar&index=yes&field=pk:integer&field=name:string', 'test', 'memory')
+        provider = layer.dataProvider()
+        features = []
+        for i in range(100):
+            f = QgsFeature()
+            f.setAttributes([i, 'name {}'.format(i % 10)])
+            f.setGeometry(QgsGeometry.fromWkt('Point ({} {})'.format(i, i)))
+            features.append(f)
+        res, features = provider.addFeatures(features)
+        self.assertTrue(res)
+        ids = [f.id() for f in features]
+
+        # deleting most features compacts the store
+        self.assertTrue(provider.deleteFeatures(ids[:80]))
+        self.assertEqual(provider.featureCount(), 20)
+        self.assertEqual([f['pk'] for f in provider.getFeatures()], list(range(80, 100)))
+        self.assertEqual(provider.extent(), QgsRectangle(80, 80, 99, 99))
+        self.assertEqual(next(provider.getFeatures(QgsFeatureRequest(ids[90])))['pk'], 90)
+
+        self.assertTrue(provider.changeAttributeValues({ids[90]: {1: 'changed'}}))
+        self.assertTrue(provider.changeGeometryValues({ids[91]: QgsGeometry.fromWkt('Point (500 500)')}))
+        self.assertEqual(next(provider.getFeatures(QgsFeatureRequest(ids[90])))['name'], 'changed')
+        self.assertEqual([f['pk'] for f in provider.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(400, 400, 600, 600)))], [91])
+        self.assertEqual([f['pk'] for f in provider.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(90.5, 90.5, 91.5, 91.5)))], [])
+
+        self.assertTrue(provider.addAttributes([QgsField('value', QVariant.Double)]))
+        self.assertTrue(provider.deleteAttributes([1]))
+        f = next(provider.getFeatures(QgsFeatureRequest(ids[95])))
+        self.assertEqual(len(f.attributes()), 2)
+        self.assertEqual(f['pk'], 95)
+        self.assertEqual(f['value'], NULL)
+
+    def testFilters(self):
+        layer = self.createLayer()
+
+        # filters evaluated over whole columns, including three-valued logic over NULL values
+        tests = [('cnt > 100 AND name IS NOT NULL', [2, 3, 4]),
+                 ('NOT (name = \'Apple\')', [1, 3, 4]),
+                 ('name = \'Apple\' OR cnt < 0', [2, 5]),
+                 ('NOT (name <> \'Apple\' OR name IS NULL)', [2]),
+                 ('cnt IN (100, -200)', [1, 5]),
+                 ('name NOT IN (\'Apple\', NULL)', []),
+                 ('num_char > 3', [4, 5]),
+                 ('-200 = cnt', [5])]
+        for expression, expected in tests:
+            it = layer.dataProvider().getFeatures(QgsFeatureRequest().setFilterExpression(expression))
+            self.assertEqual(it.compileStatus(), QgsAbstractFeatureIterator.Compiled)
+            self.assertEqual(set([f['pk'] for f in it]), set(expected), expression)
+
+        # subset strings
+        layer.dataProvider().setSubsetString('cnt >= 200')
+        self.assertEqual(layer.dataProvider().featureCount(), 3)
+        self.assertEqual(set([f['pk'] for f in layer.dataProvider().getFeatures(QgsFeatureRequest().setFilterExpression('name LIKE \'%e%\''))]), set([2, 3, 4]))
+
+    def testAggregates(self):
+        layer = self.createLayer()
+        tests = [(QgsAggregateCalculator.Count, 5),
+                 (QgsAggregateCalculator.Sum, 800),
+                 (QgsAggregateCalculator.Min, -200),
+                 (QgsAggregateCalculator.Max, 400),
+                 (QgsAggregateCalculator.Mean, 160),
+                 (QgsAggregateCalculator.Median, 200),
+                 (QgsAggregateCalculator.Range, 600)]
+        for aggregate, expected in tests:
+            val, ok = layer.aggregate(aggregate, 'cnt')
+            self.assertTrue(ok)
+            self.assertEqual(val, expected)
+
+        params = QgsAggregateCalculator.AggregateParameters()
+        params.filter = 'name IS NOT NULL AND cnt < 400'
+        val, ok = layer.aggregate(QgsAggregateCalculator.Sum, 'cnt', params)
+        self.assertTrue(ok)
+        self.assertEqual(val, 600)
+
+        # filters which can't be evaluated over columns fall back to the aggregate calculator
+        params.filter = 'length(name) = 5'
+        val, ok = layer.aggregate(QgsAggregateCalculator.Sum, 'cnt', params)
+        self.assertTrue(ok)
+        self.assertEqual(val, 600)
+
+        layer.dataProvider().setSubsetString('cnt > 100')
+        val, ok = layer.aggregate(QgsAggregateCalculator.Count, 'cnt')
+        self.assertTrue(ok)
+        self.assertEqual(val, 3)
+
 
 if __name__ == '__main__':
     unittest.main()
@@ -19,7 +19,7 @@ import tempfile
 import shutil
 from osgeo import gdal, ogr
 
-from qgis.core import QgsVectorLayer, QgsVectorLayerExporter, QgsFeature, QgsGeometry, QgsRectangle, QgsSettings
+from qgis.core import QgsVectorLayer, QgsVectorLayerExporter, QgsFeature, QgsFeatureRequest, QgsGeometry, QgsRectangle, QgsSettings
 from qgis.PyQt.QtCore import QCoreApplication
 from qgis.testing import start_app, unittest
 
@@ -224,6 +224,34 @@ class TestPyQgsOGRProviderGpkg(unittest.TestCase):
         got = [feat for feat in vl.getFeatures()]
         self.assertEqual(len(got), 1)
 
+    def testFilterFidsWithSubsetString(self):
+
+        tmpfile = os.path.join(self.basetestpath, 'testFilterFidsWithSubsetString.gpkg')
+        ds = ogr.GetDriverByName('GPKG').CreateDataSource(tmpfile)
+        lyr = ds.CreateLayer('test', geom_type=ogr.wkbPoint)
+        lyr.CreateField(ogr.FieldDefn('foo', ogr.OFTInteger))
+        for i in range(10):
+            f = ogr.Feature(lyr.GetLayerDefn())
+            f['foo'] = i
+            lyr.CreateFeature(f)
+            f = None
+        ds = None
+
+        vl = QgsVectorLayer('{}|layerid=0'.format(tmpfile), 'test', 'ogr')
+        vl.setSubsetString('foo >= 5')
+        fids = {feat.id(): feat['foo'] for feat in vl.getFeatures()}
+        self.assertEqual(sorted(fids.values()), [5, 6, 7, 8, 9])
+
+        # ids of features outside of the subset are not returned
+        got = {feat.id(): feat['foo'] for feat in vl.getFeatures(QgsFeatureRequest().setFilterFids(list(fids.keys())[:3] + [1, 2]))}
+        self.assertEqual(got, {fid: fids[fid] for fid in list(fids.keys())[:3]})
+
+        fid = list(fids.keys())[-1]
+        got = [feat['foo'] for feat in vl.getFeatures(QgsFeatureRequest().setFilterFid(fid))]
+        self.assertEqual(got, [fids[fid]])
+        got = [feat for feat in vl.getFeatures(QgsFeatureRequest().setFilterFid(1))]
+        self.assertEqual(got, [])
+
     def testStyle(self):
 
         # First test with invalid URI
@@ -313,6 +313,58 @@ class TestQgsAggregateCalculator(unittest.TestCase):
         self.assertTrue(ok)
         self.assertEqual(val, 24)
 
+    def testGrouped(self):
+        """ test calculating aggregates by group """
+
+        layer = QgsVectorLayer("Point?field=fldint:integer&field=fldstring:string", "layer", "memory")
+        pr = layer.dataProvider()
+
+        values = [[4, 'a'], [2, 'b'], [3, 'a'], [2, None], [5, 'b'], [None, 'a'], [8, None]]
+
+        features = []
+        for v in values:
+            f = QgsFeature()
+            f.setFields(layer.fields())
+            f.setAttributes(v)
+            features.append(f)
+        assert pr.addFeatures(features)
+
+        agg = QgsAggregateCalculator(layer)
+
+        # group by field
+        val, ok = agg.calculateGrouped(QgsAggregateCalculator.Sum, 'fldint', ['fldstring'])
+        self.assertTrue(ok)
+        self.assertEqual(len(val), 3)
+        self.assertEqual(val[QgsAggregateCalculator.groupKey(['a'])], 7)
+        self.assertEqual(val[QgsAggregateCalculator.groupKey(['b'])], 7)
+        self.assertEqual(val[QgsAggregateCalculator.groupKey([NULL])], 10)
+
+        # group by expression, with equal values of different types
+        val, ok = agg.calculateGrouped(QgsAggregateCalculator.Count, 'fldint', ['fldint % 2'])
+        self.assertTrue(ok)
+        self.assertEqual(val[QgsAggregateCalculator.groupKey([0])], 4)
+        self.assertEqual(val[QgsAggregateCalculator.groupKey([1])], 2)
+        self.assertEqual(QgsAggregateCalculator.groupKey([1]), QgsAggregateCalculator.groupKey([1.0]))
+
+        # aggregate of an expression, with a filter
+        agg.setFilter('fldint > 2')
+        val, ok = agg.calculateGrouped(QgsAggregateCalculator.StringConcatenate, "fldint || 'x'", ['fldstring'])
+        self.assertTrue(ok)
+        self.assertEqual(len(val), 3)
+        self.assertEqual(val[QgsAggregateCalculator.groupKey(['a'])], '4x3x')
+        self.assertEqual(val[QgsAggregateCalculator.groupKey(['b'])], '5x')
+        agg.setFilter(None)
+
+        # groups without features
+        self.assertEqual(agg.emptyAggregate(QgsAggregateCalculator.Count, 'fldint'), 0)
+        self.assertEqual(agg.emptyAggregate(QgsAggregateCalculator.Max, 'fldint * 2'), NULL)
+
+        # bad expressions
+        val, ok = agg.calculateGrouped(QgsAggregateCalculator.Sum, 'fldint', ['not_a_field + 1'])
+        self.assertFalse(ok)
+        val, ok = agg.calculateGrouped(QgsAggregateCalculator.Sum, '5+', ['fldstring'])
+        self.assertFalse(ok)
+
     def testExpression(self):
         """ test aggregate calculation using an expression """
 
@@ -280,6 +280,66 @@ class TestQgsFeatureIterator(unittest.TestCase):
 
         QgsProject.instance().removeMapLayers([layer.id(), joinLayer.id()])
 
+    def test_JoinWithoutMemoryCache(self):
+        """ test joined attributes fetched in batches when the join is not cached """
+        joinLayer = QgsVectorLayer(
+            "Point?field=x:string&field=y:integer&field=z:integer",
+            "joinlayer", "memory")
+        pr = joinLayer.dataProvider()
+        join_features = []
+        for i in range(0, 3000, 2):
+            f = QgsFeature()
+            f.setAttributes(["name {}".format(i), i, i * 10])
+            join_features.append(f)
+        # only the first matching feature is joined
+        f = QgsFeature()
+        f.setAttributes(["duplicate", 10, -1])
+        join_features.append(f)
+        self.assertTrue(pr.addFeatures(join_features))
+
+        layer = QgsVectorLayer("Point?field=fldtxt:string&field=fldint:integer",
+                               "addfeat", "memory")
+        pr = layer.dataProvider()
+        features = []
+        for i in range(2500):
+            f = QgsFeature()
+            # repeated and missing join values
+            f.setAttributes(["test {}".format(i), i % 1500])
+            features.append(f)
+        f = QgsFeature()
+        f.setAttributes(["null", NULL])
+        features.append(f)
+        self.assertTrue(pr.addFeatures(features))
+
+        QgsProject.instance().addMapLayers([layer, joinLayer])
+
+        join = QgsVectorLayerJoinInfo()
+        join.setTargetFieldName("fldint")
+        join.setJoinLayer(joinLayer)
+        join.setJoinFieldName("y")
+        join.setUsingMemoryCache(False)
+        layer.addJoin(join)
+
+        count = 0
+        for f in layer.getFeatures():
+            count += 1
+            if f['fldint'] == NULL:
+                self.assertEqual(f['joinlayer_x'], NULL)
+                self.assertEqual(f['joinlayer_z'], NULL)
+            elif f['fldint'] % 2 == 0:
+                self.assertEqual(f['joinlayer_x'], "name {}".format(f['fldint']))
+                self.assertEqual(f['joinlayer_z'], f['fldint'] * 10)
+            else:
+                self.assertEqual(f['joinlayer_x'], NULL)
+                self.assertEqual(f['joinlayer_z'], NULL)
+        self.assertEqual(count, 2501)
+
+        # subset of attributes and filter expression on a joined field
+        request = QgsFeatureRequest().setSubsetOfAttributes(['fldint', 'joinlayer_z'], layer.fields()).setFilterExpression('joinlayer_z=20')
+        self.assertEqual(sorted(f['fldint'] for f in layer.getFeatures(request)), [2, 2])
+
+        QgsProject.instance().removeMapLayers([layer.id(), joinLayer.id()])
+
     def test_invalidGeometryFilter(self):
         layer = QgsVectorLayer(
             "Polygon?field=x:string",
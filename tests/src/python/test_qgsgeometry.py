@@ -35,6 +35,7 @@ from qgis.core import (
     QgsPolygonV2,
     QgsCoordinateTransform,
     QgsRectangle,
+    QgsMapToPixelSimplifier,
     QgsWkbTypes,
     QgsRenderChecker
 )
@@ -3464,6 +3465,41 @@ class TestQgsGeometry(unittest.TestCase):
         wkb2 = geom.exportToWkb()
         self.assertEqual(wkb1, wkb2)
 
+    def testFromWkbNotParsed(self):
+        """ test geometries created from WKB before and after they are parsed """
+        tests = ['LineString (0 0, 10 5, 20 -3)',
+                 'LineStringZM (0 0 1 2, 10 5 3 4)',
+                 'Polygon ((0 0, 10 0, 10 10, 0 10, 0 0), (2 2, 4 2, 4 4, 2 2))',
+                 'PolygonZ ((0 0 1, 10 0 2, 10 10 3, 0 0 1))',
+                 'MultiLineString ((0 0, 1 1), (-5 3, 2 8))',
+                 'MultiPolygon (((0 0, 1 0, 1 1, 0 0)), ((10 10, 12 10, 12 12, 10 10)))',
+                 'MultiPolygonM (((0 0 1, 1 0 2, 1 1 3, 0 0 1)))',
+                 'LineString25D (0 0 1, 1 1 2)',
+                 'Point (1 2)']
+        for wkt in tests:
+            reference = QgsGeometry.fromWkt(wkt)
+            wkb = reference.exportToWkb()
+
+            geom = QgsGeometry()
+            geom.fromWkb(wkb)
+            self.assertEqual(geom.wkbType(), reference.wkbType(), wkt)
+            self.assertEqual(geom.type(), reference.type(), wkt)
+            self.assertEqual(geom.isMultipart(), reference.isMultipart(), wkt)
+            self.assertEqual(geom.boundingBox(), reference.boundingBox(), wkt)
+            self.assertEqual(geom.exportToWkb(), wkb, wkt)
+
+            simplifier = QgsMapToPixelSimplifier(QgsMapToPixelSimplifier.SimplifyGeometry, 3)
+            self.assertEqual(simplifier.simplify(geom).exportToWkt(), simplifier.simplify(reference).exportToWkt(), wkt)
+
+            # a copy modified after the WKB has been read must not alter the original geometry
+            copy = QgsGeometry(geom)
+            self.assertEqual(copy.translate(1, 1), QgsGeometry.Success)
+            self.assertEqual(geom.exportToWkb(), wkb, wkt)
+            self.assertEqual(geom.exportToWkt(), reference.exportToWkt(), wkt)
+            reference.translate(1, 1)
+            self.assertEqual(copy.boundingBox(), reference.boundingBox(), wkt)
+            self.assertEqual(copy.exportToWkt(), reference.exportToWkt(), wkt)
+
     def testMergeLines(self):
         """ test merging linestrings """
 
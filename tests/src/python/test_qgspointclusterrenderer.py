@@ -24,9 +24,10 @@ __copyright__ = '(C) 2016, Nyall Dawson'
 __revision__ = '$Format:%H$'
 
 import os
+import random
 
 from qgis.PyQt.QtCore import QSize
-from qgis.PyQt.QtGui import QColor
+from qgis.PyQt.QtGui import QColor, QImage, QPainter
 from qgis.PyQt.QtXml import QDomDocument
 
 from qgis.core import (QgsVectorLayer,
@@ -42,9 +43,16 @@ from qgis.core import (QgsVectorLayer,
                        QgsPointDisplacementRenderer,
                        QgsMapSettings,
                        QgsProperty,
-                       QgsSymbolLayer
+                       QgsSymbolLayer,
+                       QgsExpression,
+                       QgsFeature,
+                       QgsGeometry,
+                       QgsPointXY,
+                       QgsCoordinateReferenceSystem,
+                       QgsMapRendererCustomPainterJob
                        )
 from qgis.testing import start_app, unittest
+from qgis.utils import qgsfunction
 from utilities import (unitTestDataPath)
 
 # Convenience instances in case you may need them
@@ -182,6 +190,92 @@ class TestQgsPointClusterRenderer(unittest.TestCase):
         self.layer.renderer().setClusterSymbol(old_marker)
         self.assertTrue(result)
 
+    def referenceClusters(self, points, distance):
+        """
+        Groups points one after another like the renderer did when looking for groups
+        with a spatial index: a point joins the group with the nearest centre among
+        the groups whose first point is within distance, or starts a new group.
+        Returns the size of each group by id of its first point.
+        """
+        seeds = []
+        centres = []
+        groups = []
+        for fid, point in points:
+            nearest = -1
+            nearest_distance = 0
+            for i, seed in enumerate(seeds):
+                if abs(seed.x() - point.x()) > distance or abs(seed.y() - point.y()) > distance:
+                    continue
+                d = centres[i].distance(point)
+                if nearest < 0 or d < nearest_distance:
+                    nearest = i
+                    nearest_distance = d
+
+            if nearest < 0:
+                seeds.append(point)
+                centres.append(point)
+                groups.append([fid])
+            else:
+                n = len(groups[nearest])
+                centre = centres[nearest]
+                centres[nearest] = QgsPointXY((centre.x() * n + point.x()) / (n + 1),
+                                              (centre.y() * n + point.y()) / (n + 1))
+                groups[nearest].append(fid)
+
+        return {group[0]: len(group) for group in groups}
+
+    def testClustersMatchPairwiseGrouping(self):
+        """ test that the grid clustering groups points like the pairwise search """
+        layer = QgsVectorLayer('Point?crs=epsg:4326', 'random', 'memory')
+        generator = random.Random(12345)
+        features = []
+        for i in range(500):
+            f = QgsFeature()
+            f.setGeometry(QgsGeometry.fromPoint(QgsPointXY(generator.uniform(0, 10), generator.uniform(0, 10))))
+            features.append(f)
+        self.assertTrue(layer.dataProvider().addFeatures(features)[0])
+        points = [(f.id(), f.geometry().asPoint()) for f in layer.getFeatures()]
+
+        clusters = {}
+
+        @qgsfunction(args='auto', group='testing', register=False)
+        def record_cluster(size, fid, feature, parent):
+            clusters[fid] = size
+            return 3
+
+        QgsExpression.registerFunction(record_cluster)
+        try:
+            for tolerance in (0.2, 0.5, 1.5):
+                renderer = QgsPointClusterRenderer()
+                renderer.setEmbeddedRenderer(QgsSingleSymbolRenderer(QgsMarkerSymbol.createSimple({'size': '1'})))
+                cluster_symbol = QgsMarkerSymbol.createSimple({'size': '3'})
+                cluster_symbol.symbolLayer(0).setDataDefinedProperty(QgsSymbolLayer.PropertySize, QgsProperty.fromExpression('record_cluster(@cluster_size, $id)'))
+                renderer.setClusterSymbol(cluster_symbol)
+                renderer.setTolerance(tolerance)
+                renderer.setToleranceUnit(QgsUnitTypes.RenderMapUnits)
+                layer.setRenderer(renderer)
+
+                settings = QgsMapSettings()
+                settings.setOutputSize(QSize(200, 200))
+                settings.setDestinationCrs(QgsCoordinateReferenceSystem('EPSG:4326'))
+                settings.setExtent(QgsRectangle(-1, -1, 11, 11))
+                settings.setLayers([layer])
+
+                clusters.clear()
+                image = QImage(settings.outputSize(), QImage.Format_ARGB32_Premultiplied)
+                painter = QPainter(image)
+                job = QgsMapRendererCustomPainterJob(settings, painter)
+                job.renderSynchronously()
+                painter.end()
+
+                expected = self.referenceClusters(points, tolerance)
+                # isolated points are drawn with their own symbol
+                expected = {fid: size for fid, size in expected.items() if size > 1}
+                self.assertTrue(expected)
+                self.assertEqual(clusters, expected)
+        finally:
+            QgsExpression.unregisterFunction('record_cluster')
+
 
 if __name__ == '__main__':
     unittest.main()
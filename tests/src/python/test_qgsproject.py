@@ -23,7 +23,9 @@ from qgis.core import (QgsProject,
                        QgsUnitTypes,
                        QgsCoordinateReferenceSystem,
                        QgsVectorLayer,
-                       QgsMapLayer)
+                       QgsRasterLayer,
+                       QgsMapLayer,
+                       QgsSettings)
 from qgis.gui import (QgsLayerTreeMapCanvasBridge,
                       QgsMapCanvas)
 
@@ -768,6 +770,37 @@ class TestQgsProject(unittest.TestCase):
         project2.clear()
         self.assertFalse(project2.isZipped())
 
+    def testParallelLayerLoading(self):
+        tmpDir = QTemporaryDir()
+        tmpFile = "{}/project.qgs".format(tmpDir.path())
+
+        project = QgsProject()
+        layers = [QgsVectorLayer(os.path.join(TEST_DATA_DIR, "points.shp"), "points", "ogr"),
+                  QgsVectorLayer(os.path.join(TEST_DATA_DIR, "lines.shp"), "lines", "ogr"),
+                  QgsVectorLayer(os.path.join(TEST_DATA_DIR, "polys.shp"), "polys", "ogr"),
+                  QgsVectorLayer(os.path.join(TEST_DATA_DIR, "points.shp"), "points2", "ogr"),
+                  QgsRasterLayer(os.path.join(TEST_DATA_DIR, "float1-16.tif"), "raster", "gdal"),
+                  QgsRasterLayer(os.path.join(TEST_DATA_DIR, "landsat-f32-b1.tif"), "raster2", "gdal")]
+        project.addMapLayers(layers)
+        self.assertTrue(project.write(tmpFile))
+
+        settings = QgsSettings()
+        for parallel in (True, False):
+            settings.setValue("qgis/parallelLayerLoading", parallel)
+
+            project2 = QgsProject()
+            self.assertTrue(project2.read(tmpFile))
+            loaded = project2.mapLayers()
+            self.assertEqual(len(loaded), len(layers))
+            for layer in layers:
+                self.assertTrue(loaded[layer.id()].isValid())
+                self.assertEqual(loaded[layer.id()].name(), layer.name())
+                self.assertEqual(loaded[layer.id()].source(), layer.source())
+            self.assertEqual(loaded[layers[0].id()].featureCount(), layers[0].featureCount())
+            self.assertEqual(loaded[layers[3].id()].featureCount(), layers[3].featureCount())
+
+        settings.remove("qgis/parallelLayerLoading")
+
     def testUpgradeOtfFrom2x(self):
         """
         Test that upgrading a 2.x project correctly brings across project CRS and OTF transformation settings
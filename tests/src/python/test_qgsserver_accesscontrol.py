@@ -31,6 +31,7 @@ import urllib.request
 import urllib.parse
 import urllib.error
 import base64
+import re
 
 
 XML_NS = \
@@ -1367,6 +1368,71 @@ class TestQgsServerAccessControl(unittest.TestCase):
             str(response).find("<qgs:pk>") != -1,
             "Unexpected result from GetFeatureInfo Hello/2\n%s" % response)
 
+    def _filter_geom_query_string(self, layer, filter_geom):
+        return "&".join(["%s=%s" % i for i in list({
+            "SERVICE": "WMS",
+            "VERSION": "1.1.1",
+            "REQUEST": "GetFeatureInfo",
+            "LAYERS": layer,
+            "QUERY_LAYERS": layer,
+            "STYLES": "",
+            "FORMAT": "image/png",
+            "HEIGHT": "500",
+            "WIDTH": "500",
+            "SRS": "EPSG:3857",
+            "FEATURE_COUNT": "10",
+            "INFO_FORMAT": "application/vnd.ogc.gml",
+            "FILTER_GEOM": urllib.parse.quote(filter_geom),
+            "MAP": urllib.parse.quote(self.projectPath)
+        }.items())])
+
+    def _feature_info_pks(self, response):
+        return sorted(int(pk) for pk in re.findall(r"<qgs:pk>(\d+)</qgs:pk>", str(response)))
+
+    def _check_getfeatureinfo_filter_geom(self):
+        # intersects the features 1 and 2 only
+        query_string = self._filter_geom_query_string(
+            "Hello", "POLYGON((-12300000 7400000, -9800000 7400000, -9800000 8700000, -12300000 8700000, -12300000 7400000))")
+        response, headers = self._get_fullaccess(query_string)
+        self.assertEqual(self._feature_info_pks(response), [1, 2], "Wrong result in GetFeatureInfo with FILTER_GEOM\n%s" % response)
+
+        response, headers = self._get_restricted(query_string)
+        self.assertEqual(self._feature_info_pks(response), [1], "Access control not honored in GetFeatureInfo with FILTER_GEOM\n%s" % response)
+
+        # intersects the feature 2 only, which is filtered out by the access control
+        query_string = self._filter_geom_query_string(
+            "Hello", "POLYGON((-10000000 8500000, -9800000 8500000, -9800000 8700000, -10000000 8700000, -10000000 8500000))")
+        response, headers = self._get_fullaccess(query_string)
+        self.assertEqual(self._feature_info_pks(response), [2], "Wrong result in GetFeatureInfo with FILTER_GEOM\n%s" % response)
+
+        response, headers = self._get_restricted(query_string)
+        self.assertEqual(self._feature_info_pks(response), [], "FILTER_GEOM not honored with access control in GetFeatureInfo\n%s" % response)
+
+        # intersects the features 6, 7 and 8, the project subset string only keeps 7 and 8
+        # and the access control subset string only keeps 6 and 7
+        query_string = self._filter_geom_query_string(
+            "Hello_Project_SubsetString", "POLYGON((-6300000 3300000, 1600000 3300000, 1600000 3770000, -6300000 3770000, -6300000 3300000))")
+        response, headers = self._get_fullaccess(query_string)
+        self.assertEqual(self._feature_info_pks(response), [7, 8], "Project subset string not honored in GetFeatureInfo with FILTER_GEOM\n%s" % response)
+
+        response, headers = self._get_restricted(query_string)
+        self.assertEqual(self._feature_info_pks(response), [7], "Subset strings not honored in GetFeatureInfo with FILTER_GEOM\n%s" % response)
+
+    def test_wms_getfeatureinfo_filter_geom(self):
+        self._check_getfeatureinfo_filter_geom()
+
+    def test_wms_getfeatureinfo_filter_geom_index(self):
+        """The features found with the spatial index are the same as without it"""
+        self._server.putenv("QGIS_SERVER_WMS_FEATUREINFO_INDEX", "1")
+        try:
+            self._check_getfeatureinfo_filter_geom()
+            self.test_wms_getfeatureinfo_hello()
+            self.test_wms_getfeatureinfo_projectsubsetstring()
+            self.test_wms_getfeatureinfo_projectsubsetstring5()
+            self.test_wms_getfeatureinfo_projectsubsetstring3()
+        finally:
+            self._server.putenv("QGIS_SERVER_WMS_FEATUREINFO_INDEX", "")
+
 # # WFS # # WFS # # WFS # #
 
     def test_wfs_getfeature_subsetstring(self):
@@ -0,0 +1,103 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsConfigCache with trusted layer metadata.
+
+From build dir, run: ctest -R PyQgsServerConfigCache -V
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+"""
+__author__ = 'The QGIS Project'
+__date__ = '2017-10-18'
+__copyright__ = 'Copyright 2017, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import shutil
+import tempfile
+
+from qgis.core import QgsProject, QgsRectangle, QgsVectorLayer
+from qgis.server import QgsConfigCache
+from qgis.testing import start_app, unittest
+
+start_app()
+
+
+class TestQgsServerConfigCache(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        """Run before all tests"""
+        cls.dbconn = 'dbname=\'qgis_test\''
+        if 'QGIS_PGTEST_DB' in os.environ:
+            cls.dbconn = os.environ['QGIS_PGTEST_DB']
+        cls.temp_path = tempfile.mkdtemp()
+
+    @classmethod
+    def tearDownClass(cls):
+        """Run after all tests"""
+        shutil.rmtree(cls.temp_path, True)
+
+    def writeViewProject(self, name, extent):
+        """Writes a project with a layer based on a view, whose extent stored in the project is extent"""
+        vl = QgsVectorLayer(self.dbconn + ' sslmode=disable key=\'pk\' srid=4326 type=POLYGON table="qgis_test"."some_poly_data_view" (geom) sql=', 'view', 'postgres')
+        self.assertTrue(vl.isValid())
+        self.assertFalse(vl.dataProvider().hasMetadata())
+        originalExtent = vl.extent()
+        vl.setExtent(extent)
+
+        project = QgsProject()
+        project.addMapLayer(vl)
+        path = os.path.join(self.temp_path, name)
+        self.assertTrue(project.write(path))
+        return path, originalExtent
+
+    def layer(self, project):
+        layers = list(project.mapLayers().values())
+        self.assertEqual(len(layers), 1)
+        self.assertTrue(layers[0].isValid())
+        return layers[0]
+
+    def testTrustLayerMetadata(self):
+        customExtent = QgsRectangle(-80, 80, -70, 90)
+
+        # the extent and the primary key checks come from the project XML
+        path, originalExtent = self.writeViewProject('trusted.qgs', customExtent)
+        project = QgsConfigCache.instance().project(path, QgsProject.FlagTrustLayerMetadata)
+        self.assertIsNotNone(project)
+        self.assertTrue(project.trustLayerMetadata())
+        layer = self.layer(project)
+        self.assertEqual(layer.extent(), customExtent)
+        self.assertEqual(layer.dataProvider().uri().param('checkPrimaryKeyUnicity'), '0')
+
+        # otherwise they are computed by the provider
+        path, originalExtent = self.writeViewProject('untrusted.qgs', customExtent)
+        project = QgsConfigCache.instance().project(path)
+        self.assertIsNotNone(project)
+        self.assertFalse(project.trustLayerMetadata())
+        layer = self.layer(project)
+        self.assertEqual(layer.extent(), originalExtent)
+        self.assertEqual(layer.dataProvider().uri().param('checkPrimaryKeyUnicity'), '1')
+
+    def testReadFlags(self):
+        customExtent = QgsRectangle(-80, 80, -70, 90)
+        path, originalExtent = self.writeViewProject('flags.qgs', customExtent)
+
+        # the flag survives the reset of the project done when it is read
+        project = QgsProject()
+        project.setTrustLayerMetadata(False)
+        self.assertTrue(project.read(path, QgsProject.FlagTrustLayerMetadata))
+        self.assertTrue(project.trustLayerMetadata())
+        self.assertEqual(self.layer(project).extent(), customExtent)
+
+        # reading the project again without the flag does not trust it anymore
+        self.assertTrue(project.read(path))
+        self.assertFalse(project.trustLayerMetadata())
+        self.assertEqual(self.layer(project).extent(), originalExtent)
+
+
+if __name__ == '__main__':
+    unittest.main()
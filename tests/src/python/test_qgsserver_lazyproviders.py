@@ -0,0 +1,143 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for the lazy creation of the data providers of server projects.
+
+From build dir, run: ctest -R PyQgsServerLazyProviders -V
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+"""
+__author__ = 'The QGIS Project'
+__date__ = '2017-10-18'
+__copyright__ = 'Copyright 2017, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import re
+import shutil
+import tempfile
+
+from qgis.core import QgsProject, QgsVectorFileWriter, QgsVectorLayer
+from qgis.server import QgsConfigCache
+from qgis.testing import start_app, unittest
+from utilities import unitTestDataPath
+
+start_app()
+
+SHAPEFILE_EXTENSIONS = ['shp', 'shx', 'dbf', 'prj']
+
+
+class TestQgsServerLazyProviders(unittest.TestCase):
+
+    def setUp(self):
+        """Run before each test"""
+        self.temp_path = tempfile.mkdtemp()
+        self.hidden_path = os.path.join(self.temp_path, 'hidden')
+        os.mkdir(self.hidden_path)
+        for extension in SHAPEFILE_EXTENSIONS:
+            shutil.copy(os.path.join(unitTestDataPath(), 'points.' + extension), self.temp_path)
+
+    def tearDown(self):
+        """Run after each test"""
+        shutil.rmtree(self.temp_path, True)
+
+    def writeProject(self, name):
+        """Writes a project with the points layer, returns its path and the layer"""
+        vl = QgsVectorLayer(os.path.join(self.temp_path, 'points.shp'), 'points', 'ogr')
+        self.assertTrue(vl.isValid())
+
+        # the project owns the layer, it is kept for the comparisons
+        self.sourceProject = QgsProject()
+        self.sourceProject.addMapLayer(vl)
+        path = os.path.join(self.temp_path, name)
+        self.assertTrue(self.sourceProject.write(path))
+        return path, vl
+
+    def hideData(self):
+        for extension in SHAPEFILE_EXTENSIONS:
+            os.rename(os.path.join(self.temp_path, 'points.' + extension), os.path.join(self.hidden_path, 'points.' + extension))
+
+    def restoreData(self):
+        for extension in SHAPEFILE_EXTENSIONS:
+            os.rename(os.path.join(self.hidden_path, 'points.' + extension), os.path.join(self.temp_path, 'points.' + extension))
+
+    def layers(self, project):
+        return list(project.mapLayers().values())
+
+    def testLazyDataProviders(self):
+        path, vl = self.writeProject('lazy.qgs')
+
+        # the data source is not opened when the project is read, the
+        # layer metadata come from the project
+        self.hideData()
+        project = QgsConfigCache.instance().project(path, QgsProject.FlagLazyDataProviders)
+        self.assertIsNotNone(project)
+        layers = self.layers(project)
+        self.assertEqual(len(layers), 1)
+        layer = layers[0]
+        self.assertTrue(layer.isValid())
+        self.assertEqual(layer.name(), 'points')
+        self.assertEqual(layer.wkbType(), vl.wkbType())
+        self.assertEqual(layer.fields().names(), vl.fields().names())
+        self.assertEqual([f.type() for f in layer.fields()], [f.type() for f in vl.fields()])
+        self.assertEqual(layer.extent(), vl.extent())
+        self.assertEqual(layer.crs(), vl.crs())
+        self.assertEqual(layer.dataProvider().capabilities(), vl.dataProvider().capabilities())
+
+        # the provider is created when the features are first requested
+        self.restoreData()
+        self.assertEqual(len(list(layer.getFeatures())), vl.featureCount())
+        self.assertEqual(layer.featureCount(), vl.featureCount())
+
+        # without the flag, the data source is opened when the project is read
+        self.hideData()
+        project = QgsProject()
+        self.assertTrue(project.read(path))
+        self.assertEqual(self.layers(project), [])
+        self.restoreData()
+
+    def testProjectWithoutMetadata(self):
+        path, vl = self.writeProject('nometadata.qgs')
+
+        # projects saved before the metadata were stored open the data source
+        # when they are read
+        with open(path) as f:
+            content = f.read()
+        content, count = re.subn(r'<providerMetadata .*?</providerMetadata>', '', content, flags=re.DOTALL)
+        self.assertEqual(count, 1)
+        with open(path, 'w') as f:
+            f.write(content)
+
+        self.hideData()
+        project = QgsProject()
+        self.assertTrue(project.read(path, QgsProject.FlagLazyDataProviders))
+        self.assertEqual(self.layers(project), [])
+
+        self.restoreData()
+        self.assertTrue(project.read(path, QgsProject.FlagLazyDataProviders))
+        layers = self.layers(project)
+        self.assertEqual(len(layers), 1)
+        self.assertEqual(len(list(layers[0].getFeatures())), vl.featureCount())
+
+    def testChangedFields(self):
+        path, vl = self.writeProject('changed.qgs')
+
+        project = QgsProject()
+        self.assertTrue(project.read(path, QgsProject.FlagLazyDataProviders))
+        layer = self.layers(project)[0]
+
+        # the data source does not match the fields stored in the project
+        # anymore, no feature is returned
+        other = QgsVectorLayer('Point?crs=epsg:4326&field=other:integer', 'other', 'memory')
+        self.hideData()
+        error, message = QgsVectorFileWriter.writeAsVectorFormat(other, os.path.join(self.temp_path, 'points.shp'), 'utf-8', other.crs(), 'ESRI Shapefile')
+        self.assertEqual(error, QgsVectorFileWriter.NoError)
+        self.assertEqual(list(layer.getFeatures()), [])
+        self.assertFalse(layer.dataProvider().isValid())
+
+
+if __name__ == '__main__':
+    unittest.main()
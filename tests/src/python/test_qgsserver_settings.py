@@ -133,6 +133,56 @@ class TestQgsServerSettings(unittest.TestCase):
         self.assertEqual(self.settings.cacheDirectory(), "/tmp/fake")
         os.environ.pop(env)
 
+    def test_env_wms_metatile_size(self):
+        env = "QGIS_SERVER_WMS_METATILE_SIZE"
+
+        self.assertEqual(self.settings.wmsMetatileSize(), 0)
+
+        os.environ[env] = "4"
+        self.settings.load()
+        self.assertEqual(self.settings.wmsMetatileSize(), 4)
+        os.environ.pop(env)
+
+    def test_env_wms_metatile_cache_size(self):
+        env = "QGIS_SERVER_WMS_METATILE_CACHE_SIZE"
+
+        self.assertEqual(self.settings.wmsMetatileCacheSize(), 64 * 1024 * 1024)
+
+        os.environ[env] = "2048"
+        self.settings.load()
+        self.assertEqual(self.settings.wmsMetatileCacheSize(), 2048)
+        os.environ.pop(env)
+
+    def test_env_trust_layer_metadata(self):
+        env = "QGIS_SERVER_TRUST_LAYER_METADATA"
+
+        self.assertFalse(self.settings.trustLayerMetadata())
+
+        os.environ[env] = "1"
+        self.settings.load()
+        self.assertTrue(self.settings.trustLayerMetadata())
+        os.environ.pop(env)
+
+    def test_env_lazy_data_providers(self):
+        env = "QGIS_SERVER_LAZY_DATA_PROVIDERS"
+
+        self.assertFalse(self.settings.lazyDataProviders())
+
+        os.environ[env] = "1"
+        self.settings.load()
+        self.assertTrue(self.settings.lazyDataProviders())
+        os.environ.pop(env)
+
+    def test_env_wms_featureinfo_index(self):
+        env = "QGIS_SERVER_WMS_FEATUREINFO_INDEX"
+
+        self.assertFalse(self.settings.wmsFeatureInfoIndex())
+
+        os.environ[env] = "1"
+        self.settings.load()
+        self.assertTrue(self.settings.wmsFeatureInfoIndex())
+        os.environ.pop(env)
+
     def test_priority(self):
         env = "QGIS_OPTIONS_PATH"
         dpath = "conf0"
@@ -0,0 +1,163 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsServer WCS.
+
+From build dir, run: ctest -R PyQgsServerWCS -V
+
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+"""
+__author__ = 'The QGIS Project'
+__date__ = '2026-10-18'
+__copyright__ = 'Copyright 2026, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import shutil
+import struct
+import tempfile
+import urllib.parse
+
+from osgeo import gdal, osr
+from qgis.core import (QgsCoordinateReferenceSystem,
+                       QgsCoordinateTransform,
+                       QgsProject,
+                       QgsRasterFileWriter,
+                       QgsRasterLayer,
+                       QgsRasterPipe,
+                       QgsRectangle)
+from qgis.testing import unittest
+
+from test_qgsserver import QgsServerTestBase
+
+
+class TestQgsServerWCS(QgsServerTestBase):
+
+    """QGIS Server WCS Tests"""
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestQgsServerWCS, cls).setUpClass()
+        cls.temp_path = tempfile.mkdtemp()
+        cls.rasterPath = os.path.join(cls.temp_path, 'coverage.tif')
+        cls.writeRaster(cls.rasterPath)
+
+        layer = QgsRasterLayer(cls.rasterPath, 'coverage')
+        assert layer.isValid()
+        project = QgsProject()
+        project.addMapLayer(layer)
+        project.writeEntry('WCSLayers', '/', [layer.id()])
+        cls.wcsProjectPath = os.path.join(cls.temp_path, 'wcs.qgs')
+        assert project.write(cls.wcsProjectPath)
+
+    @classmethod
+    def tearDownClass(cls):
+        shutil.rmtree(cls.temp_path, True)
+        super(TestQgsServerWCS, cls).tearDownClass()
+
+    @classmethod
+    def writeRaster(cls, path):
+        """Writes a two bands Int16 raster in EPSG:4326 with a few pixels without data"""
+        width, height = 60, 40
+        ds = gdal.GetDriverByName('GTiff').Create(path, width, height, 2, gdal.GDT_Int16)
+        ds.SetGeoTransform([10, 0.1, 0, 50, 0, -0.1])
+        srs = osr.SpatialReference()
+        srs.ImportFromEPSG(4326)
+        ds.SetProjection(srs.ExportToWkt())
+        for band in range(1, 3):
+            values = []
+            for y in range(height):
+                for x in range(width):
+                    values.append(-9999 if (x + y) % 17 == 0 else band * 1000 + x * y)
+            ds.GetRasterBand(band).SetNoDataValue(-9999)
+            ds.GetRasterBand(band).WriteRaster(0, 0, width, height, struct.pack('<%dh' % len(values), *values))
+        ds = None
+
+    def getCoverage(self, bbox, crs, width, height):
+        query_string = "&".join(["%s=%s" % i for i in list({
+            "MAP": urllib.parse.quote(self.wcsProjectPath),
+            "SERVICE": "WCS",
+            "VERSION": "1.0.0",
+            "REQUEST": "GetCoverage",
+            "COVERAGE": "coverage",
+            "CRS": crs,
+            "BBOX": ",".join([repr(bbox.xMinimum()), repr(bbox.yMinimum()), repr(bbox.xMaximum()), repr(bbox.yMaximum())]),
+            "WIDTH": str(width),
+            "HEIGHT": str(height),
+            "FORMAT": "GeoTIFF",
+        }.items())])
+        header, body = self._execute_request('?' + query_string)
+        response, headers = self._result((header, body))
+        self.assertEqual(headers.get("Content-Type"), "image/tiff", response)
+
+        path = os.path.join(self.temp_path, 'response.tif')
+        with open(path, 'wb') as f:
+            f.write(response)
+        return path
+
+    def writeReference(self, bbox, crs, width, height):
+        """Writes the coverage with QgsRasterFileWriter, as done by the server for the coverages which cannot be streamed"""
+        layer = QgsRasterLayer(self.rasterPath, 'coverage')
+        self.assertTrue(layer.isValid())
+
+        extent = QgsRectangle(bbox)
+        requestCrs = QgsCoordinateReferenceSystem(crs)
+        if requestCrs != layer.crs():
+            extent = QgsCoordinateTransform(requestCrs, layer.crs()).transformBoundingBox(extent)
+
+        pipe = QgsRasterPipe()
+        self.assertTrue(pipe.set(layer.dataProvider().clone()))
+
+        path = os.path.join(self.temp_path, 'reference.tif')
+        writer = QgsRasterFileWriter(path)
+        self.assertEqual(writer.writeRaster(pipe, width, height, extent, layer.crs()), QgsRasterFileWriter.NoError)
+        return path
+
+    def assertCoverageEqual(self, path, referencePath):
+        ds = gdal.Open(path, gdal.GA_ReadOnly)
+        self.assertIsNotNone(ds, "Cannot open the coverage")
+        reference = gdal.Open(referencePath, gdal.GA_ReadOnly)
+        self.assertIsNotNone(reference)
+
+        self.assertEqual(ds.RasterXSize, reference.RasterXSize)
+        self.assertEqual(ds.RasterYSize, reference.RasterYSize)
+        self.assertEqual(ds.RasterCount, reference.RasterCount)
+
+        for value, expected in zip(ds.GetGeoTransform(), reference.GetGeoTransform()):
+            self.assertAlmostEqual(value, expected, 9)
+
+        srs = osr.SpatialReference(ds.GetProjection())
+        expectedSrs = osr.SpatialReference(reference.GetProjection())
+        self.assertTrue(srs.IsSame(expectedSrs), "%s != %s" % (ds.GetProjection(), reference.GetProjection()))
+
+        for band in range(1, ds.RasterCount + 1):
+            self.assertEqual(ds.GetRasterBand(band).DataType, reference.GetRasterBand(band).DataType)
+            self.assertEqual(ds.GetRasterBand(band).GetNoDataValue(), reference.GetRasterBand(band).GetNoDataValue())
+            self.assertEqual(ds.GetRasterBand(band).ReadRaster(), reference.GetRasterBand(band).ReadRaster(), "Pixels of band %d differ" % band)
+
+        ds = None
+        reference = None
+
+    def test_getcoverage_streamed(self):
+        """The streamed GeoTIFF matches the one written by QgsRasterFileWriter"""
+        for bbox, crs, width, height in [
+            # inside the raster, no pixel without data is added
+            (QgsRectangle(11, 47, 15, 49.5), 'EPSG:4326', 40, 25),
+            # whole raster, at another resolution
+            (QgsRectangle(10, 46, 16, 50), 'EPSG:4326', 17, 13),
+            # partly outside the raster, filled with the no data value
+            (QgsRectangle(9, 45, 13, 48), 'EPSG:4326', 50, 30),
+            # bbox given in another CRS
+            (QgsRectangle(1300000, 5900000, 1600000, 6300000), 'EPSG:3857', 30, 40),
+        ]:
+            path = self.getCoverage(bbox, crs, width, height)
+            referencePath = self.writeReference(bbox, crs, width, height)
+            self.assertCoverageEqual(path, referencePath)
+
+
+if __name__ == '__main__':
+    unittest.main()
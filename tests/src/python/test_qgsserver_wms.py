@@ -28,6 +28,7 @@ import urllib.error
 
 from qgis.testing import unittest
 from qgis.PyQt.QtCore import QSize
+from qgis.PyQt.QtGui import QImage, QColor, qRed, qGreen, qBlue, qAlpha
 
 import osgeo.gdal  # NOQA
 
@@ -266,6 +267,124 @@ class TestQgsServerWMS(QgsServerTestBase):
         r, h = self._result(self._execute_request(qs))
         self._img_diff_error(r, h, "WMS_GetMap_Mode_16bit", 20000)
 
+    def test_wms_getmap_metatile(self):
+        def getmap(version, crs_parameter, crs, bbox):
+            qs = "?" + "&".join(["%s=%s" % i for i in list({
+                "MAP": urllib.parse.quote(self.projectPath),
+                "SERVICE": "WMS",
+                "VERSION": version,
+                "REQUEST": "GetMap",
+                "LAYERS": "Country",
+                "STYLES": "",
+                "FORMAT": "image/png",
+                "BBOX": bbox,
+                "HEIGHT": "256",
+                "WIDTH": "256",
+                crs_parameter: crs
+            }.items())])
+            r, h = self._result(self._execute_request(qs))
+            self.assertEqual(h.get("Content-Type"), "image/png", r)
+            return QImage.fromData(r, "PNG").convertToFormat(QImage.Format_ARGB32)
+
+        def assertSameImage(image, expected):
+            self.assertEqual(image.size(), expected.size())
+            different = 0
+            for y in range(image.height()):
+                for x in range(image.width()):
+                    c1 = image.pixel(x, y)
+                    c2 = expected.pixel(x, y)
+                    if max(abs(qRed(c1) - qRed(c2)), abs(qGreen(c1) - qGreen(c2)),
+                           abs(qBlue(c1) - qBlue(c2)), abs(qAlpha(c1) - qAlpha(c2))) > 16:
+                        different += 1
+            # antialiasing may slightly differ along the tile edges
+            self.assertLess(different, image.width() * image.height() / 100)
+
+        # tiles of the same 2x2 metatile, at positions (0, 1) and (1, 0)
+        tile_a = "0,5000000,2500000,7500000"
+        tile_b = "2500000,7500000,5000000,10000000"
+        # a tile at position (1, 1) of its metatile, whose BBOX is given in
+        # longitude, latitude order for WMS 1.1.1 and in latitude, longitude
+        # order for WMS 1.3.0
+        tile_c_111 = "22.5,0,45,22.5"
+        tile_c_130 = "0,22.5,22.5,45"
+
+        direct_a = getmap("1.1.1", "SRS", "EPSG:3857", tile_a)
+        direct_b = getmap("1.1.1", "SRS", "EPSG:3857", tile_b)
+        direct_c = getmap("1.1.1", "SRS", "EPSG:4326", tile_c_111)
+
+        self.server.putenv("QGIS_SERVER_WMS_METATILE_SIZE", "2")
+        try:
+            # the metatile is rendered and sliced
+            assertSameImage(getmap("1.1.1", "SRS", "EPSG:3857", tile_a), direct_a)
+            # the neighbouring tile is served from the metatile cache
+            assertSameImage(getmap("1.1.1", "SRS", "EPSG:3857", tile_b), direct_b)
+            # sliced tiles follow the WMS 1.3.0 axis order
+            assertSameImage(getmap("1.3.0", "CRS", "EPSG:4326", tile_c_130), direct_c)
+        finally:
+            self.server.putenv("QGIS_SERVER_WMS_METATILE_SIZE", "")
+
+    def test_wms_getmap_8bit_palette(self):
+        def getmap(bbox, format, bgcolor='white'):
+            qs = "?" + "&".join(["%s=%s" % i for i in list({
+                "MAP": urllib.parse.quote(self.projectPath),
+                "SERVICE": "WMS",
+                "VERSION": "1.1.1",
+                "REQUEST": "GetMap",
+                "LAYERS": "Country",
+                "STYLES": "",
+                "FORMAT": format,
+                "BBOX": bbox,
+                "HEIGHT": "200",
+                "WIDTH": "200",
+                "CRS": "EPSG:3857",
+                "BGCOLOR": bgcolor
+            }.items())])
+            r, h = self._result(self._execute_request(qs))
+            self.assertEqual(h.get("Content-Type"), "image/png")
+            image = QImage.fromData(r, "PNG")
+            self.assertFalse(image.isNull())
+            return image
+
+        # a single color image of the open ocean keeps an exact palette
+        empty_bbox = "-15000000,-6000000,-14000000,-5000000"
+        image = getmap(empty_bbox, "image/png; mode=8bit", "0x123456")
+        self.assertEqual(image.format(), QImage.Format_Indexed8)
+        self.assertEqual(image.colorCount(), 1)
+        self.assertEqual(QColor(image.colorTable()[0]), QColor(0x12, 0x34, 0x56))
+        self.assertEqual(image.pixelIndex(0, 0), 0)
+        self.assertEqual(image.pixelIndex(199, 199), 0)
+
+        # an antialiased map has more colors than the palette: each pixel is
+        # mapped to the palette color nearest to its color reduced to 5 bits
+        # per channel (4 bits for alpha)
+        bbox = "-16817707,-4710778,5696513,14587125"
+        reference = getmap(bbox, "image/png").convertToFormat(QImage.Format_ARGB32)
+        image = getmap(bbox, "image/png; mode=8bit")
+        self.assertEqual(image.format(), QImage.Format_Indexed8)
+        palette = image.colorTable()
+        self.assertLessEqual(len(palette), 256)
+        self.assertGreater(len(palette), 1)
+
+        def reduced(color):
+            def expand(value, bits):
+                return (value << (8 - bits)) | (value >> (2 * bits - 8))
+            return (expand(qRed(color) >> 3, 5), expand(qGreen(color) >> 3, 5),
+                    expand(qBlue(color) >> 3, 5), expand(qAlpha(color) >> 4, 4))
+
+        def distance(c1, c2):
+            return sum((a - b) ** 2 for a, b in zip(c1, c2))
+
+        channels = [(qRed(c), qGreen(c), qBlue(c), qAlpha(c)) for c in palette]
+        nearest = {}
+        for y in range(image.height()):
+            for x in range(image.width()):
+                color = reduced(reference.pixel(x, y))
+                if color not in nearest:
+                    nearest[color] = min(distance(color, c) for c in channels)
+                index = image.pixelIndex(x, y)
+                self.assertEqual(distance(color, channels[index]), nearest[color],
+                                 "pixel %d,%d is not mapped to its nearest palette color" % (x, y))
+
     def test_wms_getmap_basic(self):
         qs = "?" + "&".join(["%s=%s" % i for i in list({
             "MAP": urllib.parse.quote(self.projectPath),
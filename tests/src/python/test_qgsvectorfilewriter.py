@@ -20,6 +20,7 @@ import qgis  # NOQA
 from qgis.core import (QgsVectorLayer,
                        QgsFeature,
                        QgsField,
+                       QgsFields,
                        QgsGeometry,
                        QgsPointXY,
                        QgsCoordinateReferenceSystem,
@@ -520,6 +521,39 @@ class TestQgsVectorFileWriter(unittest.TestCase):
         int8_idx = created_layer.fields().lookupField('int8')
         self.assertEqual(f.attributes()[int8_idx], 2123456789)
 
+    def testWriteGpkgInBatches(self):
+        """Check features added to a GeoPackage sink are committed in batches."""
+        fields = QgsFields()
+        fields.append(QgsField('name', QVariant.String))
+        fields.append(QgsField('value', QVariant.Int))
+
+        dest_file_name = os.path.join(str(QDir.tempPath()), 'batches.gpkg')
+        writer = QgsVectorFileWriter(dest_file_name, 'utf-8', fields, QgsWkbTypes.Point,
+                                     QgsCoordinateReferenceSystem('EPSG:4326'), 'GPKG')
+        self.assertEqual(writer.hasError(), QgsVectorFileWriter.NoError)
+        self.assertEqual(writer.transactionBatchSize(), 10000)
+        writer.setTransactionBatchSize(3)
+        self.assertEqual(writer.transactionBatchSize(), 3)
+
+        features = []
+        for i in range(10):
+            f = QgsFeature(fields)
+            f.setAttributes(['feature {}'.format(i), i])
+            f.setGeometry(QgsGeometry.fromPoint(QgsPointXY(i, -i)))
+            features.append(f)
+        self.assertTrue(writer.addFeatures(features))
+        self.assertTrue(writer.flushBuffer())
+        del writer
+
+        created_layer = QgsVectorLayer(dest_file_name, 'test', 'ogr')
+        self.assertTrue(created_layer.isValid())
+        self.assertEqual(created_layer.featureCount(), 10)
+        features = {f['value']: f for f in created_layer.getFeatures()}
+        self.assertEqual(sorted(features.keys()), list(range(10)))
+        for i, f in features.items():
+            self.assertEqual(f['name'], 'feature {}'.format(i))
+            self.assertEqual(f.geometry().asPoint(), QgsPointXY(i, -i))
+
     def testDefaultDatasetOptions(self):
         """ Test retrieving default dataset options for a format """
 
@@ -0,0 +1,320 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsVectorLayerTileCache.
+
+From build dir, run: ctest -R PyQgsVectorLayerTileCache -V
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'The QGIS Project'
+__date__ = '2017-10-18'
+__copyright__ = 'Copyright 2017, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import math
+import os
+import shutil
+import struct
+import tempfile
+
+import qgis  # NOQA
+
+from qgis.PyQt.QtCore import QDir, QSize
+from qgis.core import (
+    QgsCategorizedSymbolRenderer,
+    QgsFeature,
+    QgsFeatureRequest,
+    QgsFeedback,
+    QgsFillSymbol,
+    QgsGeometry,
+    QgsMapSettings,
+    QgsMultiRenderChecker,
+    QgsRectangle,
+    QgsRendererCategory,
+    QgsVectorFileWriter,
+    QgsVectorLayer,
+    QgsVectorLayerTileCache,
+    QgsVectorSimplifyMethod,
+)
+from qgis.testing import start_app, unittest
+
+start_app()
+
+
+def writeLayer(layer, path):
+    """Writes the features of a memory layer to a shapefile and returns the layer reading it"""
+    error, message = QgsVectorFileWriter.writeAsVectorFormat(layer, path, 'utf-8', layer.crs(), 'ESRI Shapefile')
+    assert error == QgsVectorFileWriter.NoError, message
+    fileLayer = QgsVectorLayer(path, layer.name(), 'ogr')
+    assert fileLayer.isValid()
+    return fileLayer
+
+
+def createMemoryLayer():
+    layer = QgsVectorLayer('Polygon?crs=epsg:3857&field=id:integer&field=name:string', 'polygons', 'memory')
+    features = []
+    for i in range(10):
+        for j in range(10):
+            # detailed circles, which are reduced to a few vertices at small scales
+            points = ['{} {}'.format(i * 100 + 50 + 40 * math.cos(a * math.pi / 180), j * 100 + 50 + 40 * math.sin(a * math.pi / 180)) for a in range(0, 360, 2)]
+            points.append(points[0])
+            f = QgsFeature(layer.fields())
+            f.setAttributes([i * 10 + j, 'circle {}'.format(i * 10 + j)])
+            f.setGeometry(QgsGeometry.fromWkt('Polygon(({}))'.format(', '.join(points))))
+            features.append(f)
+    assert layer.dataProvider().addFeatures(features)[0]
+    layer.updateExtents()
+    return layer
+
+
+def createLayer(directory):
+    return writeLayer(createMemoryLayer(), os.path.join(directory, 'polygons.shp'))
+
+
+def createSquaresLayer(directory):
+    """Creates a layer of squares aligned on a 10 map units grid, all of class 1"""
+    layer = QgsVectorLayer('Polygon?crs=epsg:3857&field=class:integer', 'squares', 'memory')
+    features = []
+    for i in range(10):
+        for j in range(10):
+            f = QgsFeature(layer.fields())
+            f.setAttributes([1])
+            f.setGeometry(QgsGeometry.fromRect(QgsRectangle(i * 100 + 20, j * 100 + 20, i * 100 + 80, j * 100 + 80)))
+            features.append(f)
+    assert layer.dataProvider().addFeatures(features)[0]
+    return writeLayer(layer, os.path.join(directory, 'squares.shp'))
+
+
+class TestQgsVectorLayerTileCache(unittest.TestCase):
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.dataDirectory = tempfile.mkdtemp()
+        self.report = "<h1>Python QgsVectorLayerTileCache Tests</h1>\n"
+
+    def tearDown(self):
+        report_file_path = "%s/qgistest.html" % QDir.tempPath()
+        with open(report_file_path, 'a') as report_file:
+            report_file.write(self.report)
+        shutil.rmtree(self.directory, True)
+        shutil.rmtree(self.dataDirectory, True)
+
+    def testBuild(self):
+        layer = createLayer(self.dataDirectory)
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertEqual(cache.directory(), self.directory)
+        self.assertFalse(cache.isValid())
+        self.assertEqual(cache.levelForTolerance(100), -1)
+        self.assertFalse(cache.getFeatures(0).isValid())
+
+        cache.setLevelCount(4)
+        feedback = QgsFeedback()
+        self.assertTrue(cache.build(feedback), cache.errorMessage())
+        self.assertTrue(cache.isValid())
+        self.assertTrue(os.path.exists(cache.filePath()))
+        self.assertEqual(feedback.progress(), 100)
+
+        # each level halves the tolerance of the previous one
+        threshold = layer.simplifyMethod().threshold()
+        side = max(layer.extent().width(), layer.extent().height())
+        self.assertAlmostEqual(cache.levelTolerance(0), threshold * side / 256, 3)
+        for level in range(1, 4):
+            self.assertAlmostEqual(cache.levelTolerance(level), cache.levelTolerance(level - 1) / 2, 6)
+        self.assertEqual(cache.levelTolerance(4), -1)
+
+        self.assertEqual(cache.levelForTolerance(1000), 0)
+        self.assertEqual(cache.levelForTolerance(cache.levelTolerance(2)), 2)
+        self.assertEqual(cache.levelForTolerance(cache.levelTolerance(2) * 1.5), 2)
+        self.assertEqual(cache.levelForTolerance(cache.levelTolerance(3) / 2), -1)
+
+    def testGetFeatures(self):
+        layer = createLayer(self.dataDirectory)
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertTrue(cache.build(), cache.errorMessage())
+
+        original = {f['id']: f for f in layer.getFeatures()}
+        for level in range(cache.levelCount()):
+            features = {f['id']: f for f in cache.getFeatures(level)}
+            self.assertEqual(set(features.keys()), set(original.keys()))
+            for fid, f in features.items():
+                self.assertEqual(f.attributes(), original[fid].attributes())
+                self.assertTrue(f.hasGeometry())
+                # coarse levels have fewer vertices
+                self.assertLessEqual(len(list(f.geometry().vertices())), len(list(original[fid].geometry().vertices())))
+
+        coarse = next(cache.getFeatures(0))
+        self.assertLess(len(list(coarse.geometry().vertices())), 181)
+
+        # filter rectangle
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(0, 0, 190, 90))
+        self.assertEqual(sorted(f['id'] for f in cache.getFeatures(3, request)), [0, 10])
+
+        # expression filters are handled by the iterator too
+        request = QgsFeatureRequest().setFilterExpression('"id" > 95')
+        self.assertEqual(sorted(f['id'] for f in cache.getFeatures(2, request)), [96, 97, 98, 99])
+
+    def testReuseAndClear(self):
+        layer = createLayer(self.dataDirectory)
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertTrue(cache.build(), cache.errorMessage())
+
+        # an existing cache file is used without being built again
+        cache2 = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertTrue(cache2.isValid())
+        self.assertEqual(cache2.filePath(), cache.filePath())
+        self.assertEqual(len(list(cache2.getFeatures(1))), 100)
+
+        # changing the simplification settings invalidates the cache
+        original = QgsVectorSimplifyMethod(layer.simplifyMethod())
+        method = QgsVectorSimplifyMethod(layer.simplifyMethod())
+        method.setThreshold(method.threshold() * 2)
+        layer.setSimplifyMethod(method)
+        self.assertFalse(cache.isValid())
+        self.assertNotEqual(cache.filePath(), cache2.filePath())
+
+        layer.setSimplifyMethod(original)
+        self.assertTrue(cache.isValid())
+        cache.clear()
+        self.assertFalse(cache.isValid())
+        self.assertFalse(cache2.isValid())
+        self.assertFalse(os.path.exists(cache2.filePath()))
+
+    def testCorruptedFile(self):
+        layer = createLayer(self.dataDirectory)
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        cache.setLevelCount(3)
+        self.assertTrue(cache.build(), cache.errorMessage())
+        with open(cache.filePath(), 'rb') as f:
+            content = f.read()
+
+        def check(corrupted):
+            with open(cache.filePath(), 'wb') as f:
+                f.write(corrupted)
+            return QgsVectorLayerTileCache(layer, self.directory).isValid()
+
+        self.assertTrue(check(content))
+
+        # grid dimensions of level 1 which do not match the level
+        level1 = struct.pack('>dii', cache.levelTolerance(1), 2, 2)
+        self.assertEqual(content.count(level1), 1)
+        self.assertFalse(check(content.replace(level1, struct.pack('>dii', cache.levelTolerance(1), 0x7fffffff, 0x7fffffff))))
+        self.assertFalse(check(content.replace(level1, struct.pack('>dii', cache.levelTolerance(1), 4, 1))))
+        # tolerance which does not match the other levels
+        self.assertFalse(check(content.replace(level1, struct.pack('>dii', cache.levelTolerance(1) * 3, 2, 2))))
+
+        # tile data out of the file
+        self.assertFalse(check(content[:-10]))
+        # truncated header
+        self.assertFalse(check(content[:len(content) // 10]))
+
+    def testLayer(self):
+        layer = createLayer(self.dataDirectory)
+        self.assertIsNone(layer.renderingTileCache())
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertTrue(cache.build(), cache.errorMessage())
+        layer.setRenderingTileCache(cache)
+        self.assertEqual(layer.renderingTileCache(), cache)
+        self.assertTrue(cache.isValid())
+
+        # committed changes clear the cache
+        self.assertTrue(layer.startEditing())
+        self.assertTrue(layer.changeAttributeValue(1, 1, 'changed'))
+        self.assertTrue(layer.commitChanges())
+        self.assertFalse(cache.isValid())
+
+        layer.setRenderingTileCache(None)
+        self.assertIsNone(layer.renderingTileCache())
+
+    def testMemoryLayer(self):
+        # the features of memory layers have no revision to key the cache with
+        layer = createMemoryLayer()
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertFalse(cache.build())
+        self.assertTrue(cache.errorMessage())
+        self.assertFalse(cache.isValid())
+        self.assertEqual(cache.levelForTolerance(100), -1)
+        self.assertFalse(os.listdir(self.directory))
+
+    def testKey(self):
+        layer = createLayer(self.dataDirectory)
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertTrue(cache.build(), cache.errorMessage())
+
+        # another layer reading the same data gets its own cache
+        layer2 = QgsVectorLayer(layer.source(), 'polygons', 'ogr')
+        self.assertTrue(layer2.isValid())
+        self.assertNotEqual(layer2.id(), layer.id())
+        cache2 = QgsVectorLayerTileCache(layer2, self.directory)
+        self.assertNotEqual(cache2.filePath(), cache.filePath())
+        self.assertFalse(cache2.isValid())
+
+        # a change of the data made by another layer is a new revision, and
+        # invalidates the cache even if it was not cleared by the layer
+        f = QgsFeature(layer2.fields())
+        f.setAttributes([100, 'circle 100'])
+        f.setGeometry(QgsGeometry.fromRect(QgsRectangle(1000, 1000, 1100, 1100)))
+        self.assertTrue(layer2.dataProvider().addFeatures([f])[0])
+        layer.reload()
+        self.assertFalse(cache.isValid())
+        self.assertTrue(cache.build(), cache.errorMessage())
+        self.assertTrue(cache.isValid())
+        self.assertEqual(len(list(cache.getFeatures(0))), 101)
+
+    def testRender(self):
+        layer = createSquaresLayer(self.dataDirectory)
+        layer.setRenderer(QgsCategorizedSymbolRenderer('class', [
+            QgsRendererCategory(1, QgsFillSymbol.createSimple({'color': '255,0,0', 'outline_style': 'no'}), '1'),
+            QgsRendererCategory(2, QgsFillSymbol.createSimple({'color': '0,0,255', 'outline_style': 'no'}), '2')]))
+        method = QgsVectorSimplifyMethod(layer.simplifyMethod())
+        method.setSimplifyHints(QgsVectorSimplifyMethod.GeometrySimplification)
+        layer.setSimplifyMethod(method)
+
+        cache = QgsVectorLayerTileCache(layer, self.directory)
+        self.assertTrue(cache.build(), cache.errorMessage())
+        layer.setRenderingTileCache(cache)
+
+        mapSettings = QgsMapSettings()
+        mapSettings.setOutputSize(QSize(100, 100))
+        mapSettings.setExtent(QgsRectangle(0, 0, 1000, 1000))
+        mapSettings.setDestinationCrs(layer.crs())
+        mapSettings.setLayers([layer])
+        mapSettings.setFlag(QgsMapSettings.UseRenderingOptimization, True)
+
+        # the tolerance computed by the renderer at this scale is served by the cache
+        self.assertEqual(mapSettings.mapUnitsPerPixel(), 10)
+        self.assertEqual(cache.levelForTolerance(method.threshold() * mapSettings.mapUnitsPerPixel()), 0)
+
+        # change the class of the squares without going through the layer: the
+        # attributes are stored in the .dbf file, and the revision of the .shp file
+        # holding the data of the layer is unchanged, so the cache is still valid
+        layer2 = QgsVectorLayer(layer.source(), 'squares', 'ogr')
+        self.assertTrue(layer2.isValid())
+        classIndex = layer2.fields().lookupField('class')
+        self.assertTrue(layer2.dataProvider().changeAttributeValues({f.id(): {classIndex: 2} for f in layer2.getFeatures()}))
+        layer.reload()
+        self.assertEqual(set(f['class'] for f in layer.getFeatures()), {2})
+        self.assertTrue(cache.isValid())
+
+        # the features are drawn from the cache, with their class at the time it was built
+        self.assertTrue(self.renderCheck(mapSettings, 'tilecache_cached'))
+
+        # and from the provider without the cache
+        layer.setRenderingTileCache(None)
+        self.assertTrue(self.renderCheck(mapSettings, 'tilecache_provider'))
+
+    def renderCheck(self, mapSettings, name):
+        checker = QgsMultiRenderChecker()
+        checker.setMapSettings(mapSettings)
+        checker.setControlPathPrefix('vectorlayertilecache')
+        checker.setControlName('expected_' + name)
+        checker.setColorTolerance(2)
+        result = checker.runTest(name, 200)
+        self.report += checker.report()
+        return result
+
+
+if __name__ == '__main__':
+    unittest.main()